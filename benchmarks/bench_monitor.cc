@@ -0,0 +1,314 @@
+#include "synthetic.hpp"
+
+#include "percemon/fixed.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+
+namespace mon = percemon::monitoring;
+using namespace percemon::benchmarks;
+
+namespace {
+
+constexpr size_t STREAM_LENGTH = 256;
+
+mon::MonitorOptions options_of(int64_t strategy) {
+  return mon::MonitorOptions{
+      strategy == 0 ? mon::EvalStrategy::Recompute : mon::EvalStrategy::Incremental};
+}
+
+/**
+ * Add a frame and compute the robustness on each iteration, cycling through a stream
+ * after filling the buffer. The time per iteration is the latency of a frame, and the
+ * items per second are the frames per second.
+ */
+void run_online(
+    benchmark::State& state,
+    const percemon::Expr& phi,
+    size_t num_objects,
+    const mon::MonitorOptions& options) {
+  const auto stream = generate_stream(STREAM_LENGTH, num_objects);
+  auto monitor      = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+  size_t i          = 0;
+  for (; i < std::min(monitor.get_max_horizon(), stream.size()); i++) {
+    monitor.add_frame(stream[i]);
+  }
+
+  for (auto _ : state) {
+    monitor.add_frame(stream[i++ % stream.size()]);
+    benchmark::DoNotOptimize(monitor.eval());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["horizon"] = static_cast<double>(monitor.get_max_horizon());
+}
+
+/**
+ * Args: the specification (1 to 4), the number of objects, and the strategy (0 for
+ * Recompute, 1 for Incremental).
+ */
+void BM_OnlineEval(benchmark::State& state) {
+  const auto phi = get_phi(static_cast<size_t>(state.range(0)));
+  run_online(state, phi, static_cast<size_t>(state.range(1)), options_of(state.range(2)));
+}
+BENCHMARK(BM_OnlineEval)
+    ->ArgNames({"phi", "objects", "incremental"})
+    ->ArgsProduct({{1, 2, 3, 4}, {4, 16, 64}, {0, 1}});
+
+// The specifications of synthetic.hpp, as fixed formulas.
+
+auto get_fixed_phi1() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  return Exists(id1, id2).dot((id1 == id2) & (Class(id1) == Class(id2)));
+}
+
+auto get_fixed_phi2() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  return Forall(id1).dot(
+      Previous(Const{true}) >>
+      Previous(Exists(id2).dot((id1 == id2) & (Class(id1) == Class(id2)))));
+}
+
+auto get_fixed_phi3() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  constexpr auto x   = VarX<1>{};
+  constexpr auto f   = VarF<1>{};
+
+  const auto phi1 = And(1 <= f - C_FRAME{}, f - C_FRAME{} <= 2);
+  const auto phi2 = Exists(id2).dot((id1 == id2) & (Class(id1) == Class(id2)));
+  return Forall(id1).at(x, f).dot(Always(phi1 >> phi2));
+}
+
+auto get_fixed_phi4() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  constexpr auto f   = VarF<1>{};
+
+  const auto margins = And(
+      Lon(id1, CRT::TM) > 200.0,
+      Lon(id1, CRT::BM) < 1080.0 - 200.0,
+      Lat(id1, CRT::LM) > 200.0,
+      Lat(id1, CRT::RM) < 1920.0 - 200.0);
+  const auto high_prob = And(Class(id1) == 1, Prob(id1) > 0.8, margins);
+  const auto reappear  = (id1 == id2) & (Prob(id2) > 0.7) & (Class(id2) == 1);
+  return Forall(id1).at(f).dot(
+      high_prob >> Always((f - C_FRAME{} < 6) >> Exists(id2).dot(reappear)));
+}
+
+/**
+ * The same as BM_OnlineEval, for the fixed formula of a specification.
+ */
+template <typename Phi>
+void run_fixed(benchmark::State& state, const Phi& phi, size_t num_objects) {
+  const auto stream = generate_stream(STREAM_LENGTH, num_objects);
+  auto monitor      = percemon::fixed::Monitor{phi, FPS};
+  size_t i          = 0;
+  for (; i < std::min(monitor.get_max_horizon(), stream.size()); i++) {
+    monitor.add_frame(stream[i]);
+  }
+
+  for (auto _ : state) {
+    monitor.add_frame(stream[i++ % stream.size()]);
+    benchmark::DoNotOptimize(monitor.eval());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["horizon"] = static_cast<double>(monitor.get_max_horizon());
+}
+
+/**
+ * Args: the specification (1 to 4), and the number of objects.
+ */
+void BM_FixedEval(benchmark::State& state) {
+  const auto num_objects = static_cast<size_t>(state.range(1));
+  switch (state.range(0)) {
+    case 1: return run_fixed(state, get_fixed_phi1(), num_objects);
+    case 2: return run_fixed(state, get_fixed_phi2(), num_objects);
+    case 3: return run_fixed(state, get_fixed_phi3(), num_objects);
+    default: return run_fixed(state, get_fixed_phi4(), num_objects);
+  }
+}
+BENCHMARK(BM_FixedEval)
+    ->ArgNames({"phi", "objects"})
+    ->ArgsProduct({{1, 2, 3, 4}, {4, 16, 64}});
+
+/**
+ * Args: the number of frames in the Always of phi4, and the strategy.
+ */
+void BM_Horizon(benchmark::State& state) {
+  const auto phi = get_phi4(static_cast<double>(state.range(0)));
+  run_online(state, phi, 16, options_of(state.range(1)));
+}
+BENCHMARK(BM_Horizon)
+    ->ArgNames({"frames", "incremental"})
+    ->ArgsProduct({{6, 30, 120}, {0, 1}});
+
+/**
+ * Args: the number of nested quantifiers, and the strategy.
+ */
+void BM_QuantifierDepth(benchmark::State& state) {
+  const auto phi = get_nested(static_cast<size_t>(state.range(0)));
+  run_online(state, phi, 12, options_of(state.range(1)));
+}
+BENCHMARK(BM_QuantifierDepth)
+    ->ArgNames({"depth", "incremental"})
+    ->ArgsProduct({{1, 2, 3}, {0, 1}});
+
+/**
+ * Restore a monitor from a checkpoint of a warm one and evaluate it, which is what a
+ * worker taking over a stream does instead of replaying the frames in the horizon.
+ * Args: the number of frames in the Always of phi4, and the strategy.
+ */
+void BM_Restore(benchmark::State& state) {
+  const auto phi     = get_phi4(static_cast<double>(state.range(0)));
+  const auto options = options_of(state.range(1));
+  const auto stream  = generate_stream(STREAM_LENGTH, 16);
+  auto monitor       = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+  for (const auto& frame : stream) {
+    monitor.add_frame(frame);
+    monitor.eval();
+  }
+  const auto snapshot = monitor.checkpoint();
+
+  auto restored = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+  for (auto _ : state) {
+    restored.restore(snapshot);
+    benchmark::DoNotOptimize(restored.eval());
+  }
+  state.counters["bytes"] = static_cast<double>(snapshot.size());
+}
+BENCHMARK(BM_Restore)
+    ->ArgNames({"frames", "incremental"})
+    ->ArgsProduct({{6, 30, 120}, {0, 1}});
+
+/**
+ * Monitor a stream coming in at a third of the nominal frame rate, buffering the frames
+ * by count (with the time bound converted at the nominal rate) or by time. Args: the
+ * seconds in the Always of the timed phi4, the buffer (0 for Frames, 1 for Time), and
+ * the strategy.
+ */
+void BM_TimeBuffer(benchmark::State& state) {
+  const auto phi = get_phi4_timed(static_cast<double>(state.range(0)));
+  auto options   = options_of(state.range(2));
+  options.buffer = state.range(1) == 0 ? mon::BufferMode::Frames : mon::BufferMode::Time;
+  auto stream    = generate_stream(STREAM_LENGTH, 16);
+  for (auto& frame : stream) { frame.timestamp *= 3; }
+
+  auto monitor = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+  size_t i     = 0;
+  for (; i < stream.size(); i++) { monitor.add_frame(stream[i]); }
+  for (auto _ : state) {
+    // The timestamps keep increasing as the stream is cycled.
+    auto frame      = stream[i % stream.size()];
+    frame.timestamp = 3 * static_cast<double>(i++) / FPS;
+    monitor.add_frame(frame);
+    benchmark::DoNotOptimize(monitor.eval());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeBuffer)
+    ->ArgNames({"seconds", "time", "incremental"})
+    ->ArgsProduct({{1, 4}, {0, 1}, {0, 1}});
+
+/**
+ * Monitor a static camera, where each frame of the stream is repeated 8 times, with
+ * and without skipping the evaluations of the unchanged frames. Args: the
+ * specification (1 to 4), and if unchanged frames are skipped.
+ */
+void BM_SkipUnchanged(benchmark::State& state) {
+  const auto phi         = get_phi(static_cast<size_t>(state.range(0)));
+  auto options           = mon::MonitorOptions{};
+  options.skip_unchanged = state.range(1) != 0;
+  const auto stream      = generate_stream(STREAM_LENGTH / 8, 16);
+
+  auto monitor = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+  size_t i     = 0;
+  for (auto _ : state) {
+    auto frame      = stream[(i / 8) % stream.size()];
+    frame.frame_num = i;
+    frame.timestamp = static_cast<double>(i++) / FPS;
+    monitor.add_frame(frame);
+    benchmark::DoNotOptimize(monitor.eval());
+  }
+  state.SetItemsProcessed(state.iterations());
+  const auto counts = monitor.get_eval_counts();
+  state.counters["skipped"] =
+      static_cast<double>(counts.skipped) /
+      static_cast<double>(std::max<size_t>(1, counts.skipped + counts.evaluated));
+}
+BENCHMARK(BM_SkipUnchanged)
+    ->ArgNames({"phi", "skip"})
+    ->ArgsProduct({{1, 2, 3, 4}, {0, 1}});
+
+/**
+ * Recompute the robustness with each representation of the signals. Args: the number
+ * of frames in the Always of phi4, and the signals (0 for Robustness, 1 for Boolean).
+ */
+void BM_Signals(benchmark::State& state) {
+  const auto phi  = get_phi4(static_cast<double>(state.range(0)));
+  auto options    = mon::MonitorOptions{mon::EvalStrategy::Recompute};
+  options.signals = state.range(1) == 0 ? mon::SignalMode::Robustness
+                                        : mon::SignalMode::Boolean;
+  run_online(state, phi, 16, options);
+}
+BENCHMARK(BM_Signals)
+    ->ArgNames({"frames", "boolean"})
+    ->ArgsProduct({{6, 30, 120}, {0, 1}});
+
+/**
+ * Evaluate a whole stream offline. Args: the specification and the number of threads.
+ */
+void BM_EvaluateTrace(benchmark::State& state) {
+  const auto phi      = get_phi(static_cast<size_t>(state.range(0)));
+  const auto stream   = generate_stream(1024, 16);
+  auto options        = mon::MonitorOptions{mon::EvalStrategy::Incremental};
+  options.num_threads = static_cast<size_t>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        mon::evaluate_trace(phi, stream, FPS, WIDTH, HEIGHT, options));
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(stream.size()));
+}
+BENCHMARK(BM_EvaluateTrace)
+    ->ArgNames({"phi", "threads"})
+    ->ArgsProduct({{1, 4}, {1, 4}})
+    ->UseRealTime();
+
+/**
+ * Add frames to an AsyncOnlineMonitor. The time per iteration is the latency of
+ * `add_frame` on the thread adding the frames. Args: the specification, and the
+ * backpressure (0 for Block, 1 for Drop, 2 for Coalesce).
+ */
+void BM_AsyncAddFrame(benchmark::State& state) {
+  const auto phi    = get_phi(static_cast<size_t>(state.range(0)));
+  const auto stream = generate_stream(STREAM_LENGTH, 16);
+  const auto policy = std::array{
+      mon::Backpressure::Block, mon::Backpressure::Drop, mon::Backpressure::Coalesce};
+  auto monitor = mon::AsyncOnlineMonitor{
+      phi,
+      FPS,
+      WIDTH,
+      HEIGHT,
+      options_of(1),
+      mon::AsyncOptions{64, policy.at(static_cast<size_t>(state.range(1)))}};
+
+  size_t i = 0;
+  for (auto _ : state) { monitor.add_frame(stream[i++ % stream.size()]); }
+  monitor.flush();
+  state.SetItemsProcessed(state.iterations());
+  state.counters["dropped"] = static_cast<double>(monitor.num_dropped());
+  benchmark::DoNotOptimize(monitor.take_results());
+}
+BENCHMARK(BM_AsyncAddFrame)
+    ->ArgNames({"phi", "backpressure"})
+    ->ArgsProduct({{1, 4}, {0, 1, 2}})
+    ->UseRealTime();
+
+} // namespace
@@ -0,0 +1,81 @@
+#include "percemon/topo.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace topo = percemon::topo;
+
+namespace {
+
+/**
+ * Random boxes in a 1920x1080 image, with sides between 20 and 200 pixels.
+ */
+std::vector<topo::Region> random_boxes(size_t n, unsigned int seed) {
+  auto rng  = std::mt19937{seed};
+  auto x    = std::uniform_real_distribution<double>{0, 1720};
+  auto y    = std::uniform_real_distribution<double>{0, 880};
+  auto size = std::uniform_real_distribution<double>{20, 200};
+
+  auto ret = std::vector<topo::Region>{};
+  for (size_t i = 0; i < n; i++) {
+    const double x0 = x(rng), y0 = y(rng);
+    ret.emplace_back(topo::BoundingBox{x0, x0 + size(rng), y0, y0 + size(rng)});
+  }
+  return ret;
+}
+
+topo::Region union_of(size_t n, unsigned int seed) {
+  return topo::spatial_union(random_boxes(n, seed));
+}
+
+/**
+ * Args: the number of boxes.
+ */
+void BM_SpatialUnion(benchmark::State& state) {
+  const auto boxes = random_boxes(static_cast<size_t>(state.range(0)), 1);
+  for (auto _ : state) {
+    const topo::ArenaScope arena_scope{};
+    benchmark::DoNotOptimize(topo::spatial_union(boxes));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SpatialUnion)->RangeMultiplier(4)->Range(2, 512);
+
+/**
+ * Intersect two unions. Args: the number of boxes in each union.
+ */
+void BM_SpatialIntersect(benchmark::State& state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  const auto lhs = union_of(n, 1);
+  const auto rhs = union_of(n, 2);
+  for (auto _ : state) {
+    const topo::ArenaScope arena_scope{};
+    benchmark::DoNotOptimize(topo::spatial_intersect(lhs, rhs));
+  }
+}
+BENCHMARK(BM_SpatialIntersect)->RangeMultiplier(4)->Range(2, 128);
+
+/**
+ * Args: the number of boxes in the union.
+ */
+void BM_SimplifyRegion(benchmark::State& state) {
+  const auto region = union_of(static_cast<size_t>(state.range(0)), 3);
+  for (auto _ : state) {
+    const topo::ArenaScope arena_scope{};
+    benchmark::DoNotOptimize(topo::simplify_region(region));
+  }
+}
+BENCHMARK(BM_SimplifyRegion)->RangeMultiplier(4)->Range(2, 512);
+
+/**
+ * Args: the number of boxes in the union.
+ */
+void BM_Area(benchmark::State& state) {
+  const auto region = union_of(static_cast<size_t>(state.range(0)), 4);
+  for (auto _ : state) { benchmark::DoNotOptimize(topo::area(region)); }
+}
+BENCHMARK(BM_Area)->RangeMultiplier(4)->Range(2, 512);
+
+} // namespace
@@ -0,0 +1,161 @@
+/**
+ * Synthetic streams and the specifications used by the benchmarks.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_BENCHMARKS_SYNTHETIC_HPP__
+#define __PERCEMON_BENCHMARKS_SYNTHETIC_HPP__
+
+#include "percemon/percemon.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace percemon::benchmarks {
+
+constexpr double FPS    = 30.0;
+constexpr size_t WIDTH  = 1920;
+constexpr size_t HEIGHT = 1080;
+
+/**
+ * Generate a deterministic stream where each of `num_tracks` objects is in a frame with
+ * probability 0.8, with a box that drifts between frames.
+ */
+inline std::vector<datastream::TrackedFrame>
+generate_stream(size_t num_frames, size_t num_tracks, unsigned int seed = 42) {
+  auto rng        = std::mt19937{seed};
+  auto is_present = std::bernoulli_distribution{0.8};
+  auto label      = std::uniform_int_distribution<int>{1, 3};
+  auto prob       = std::uniform_real_distribution<double>{0.5, 1.0};
+  auto step       = std::uniform_int_distribution<int>{-8, 8};
+  auto x_coord    = std::uniform_int_distribution<size_t>{0, WIDTH - 200};
+  auto y_coord    = std::uniform_int_distribution<size_t>{0, HEIGHT - 200};
+  auto size       = std::uniform_int_distribution<size_t>{20, 200};
+
+  struct Track {
+    int object_class;
+    size_t x, y, w, h;
+  };
+  auto tracks = std::vector<Track>{};
+  for (size_t i = 0; i < num_tracks; i++) {
+    tracks.push_back(Track{label(rng), x_coord(rng), y_coord(rng), size(rng), size(rng)});
+  }
+
+  const auto drift = [&](size_t v, size_t max) {
+    const auto next = static_cast<long>(v) + step(rng);
+    return static_cast<size_t>(std::clamp<long>(next, 0, static_cast<long>(max)));
+  };
+
+  auto stream = std::vector<datastream::TrackedFrame>{};
+  for (size_t i = 0; i < num_frames; i++) {
+    const double time = static_cast<double>(i) / FPS;
+    auto frame        = datastream::TrackedFrame{time, i, WIDTH, HEIGHT, {}};
+    for (size_t id = 0; id < tracks.size(); id++) {
+      auto& t = tracks[id];
+      t.x     = drift(t.x, WIDTH - t.w);
+      t.y     = drift(t.y, HEIGHT - t.h);
+      if (!is_present(rng)) { continue; }
+      const auto bbox = datastream::BoundingBox{t.x, t.x + t.w, t.y, t.y + t.h};
+      frame.objects.emplace(id, datastream::Object{t.object_class, prob(rng), bbox});
+    }
+    stream.push_back(std::move(frame));
+  }
+  return stream;
+}
+
+// The specifications of the MOT17 example (examples/mot17/mot17_example.cc).
+
+inline Expr get_phi1() {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  return Exists({id1, id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)});
+}
+
+inline Expr get_phi2() {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  return Forall({id1})->dot(
+      Expr{Previous(Const{true})} >>
+      Previous(Exists({id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)})));
+}
+
+inline Expr get_phi3() {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto x   = Var_x{"1"};
+  auto f   = Var_f{"1"};
+
+  Expr phi1 = And({1 <= f - C_FRAME{}, f - C_FRAME{} <= 2});
+  Expr phi2 = Exists({id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)});
+  return Forall({id1})->at({x, f})->dot(Always(phi1 >> phi2));
+}
+
+/**
+ * phi4 of the MOT17 example, where the high probability objects should have existed in
+ * the last `num_frames` frames (6 in the example).
+ */
+inline Expr get_phi4(double num_frames = 6) {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto f   = Var_f{"1"};
+
+  Expr margins = And(
+      {Lon(id1, CRT::TM) > 200.0,
+       Lon(id1, CRT::BM) < 1080.0 - 200.0,
+       Lat(id1, CRT::LM) > 200.0,
+       Lat(id1, CRT::RM) < 1920.0 - 200.0});
+  Expr high_prob = And({Class(id1) == 1, Prob(id1) > 0.8, margins});
+  Expr reappear  = Expr{id1 == id2} & (Prob(id2) > 0.7) & (Class(id2) == 1);
+  return Forall({id1})->at(Pin{f})->dot(
+      high_prob >> Always((f - C_FRAME{} < num_frames) >> Exists({id2})->dot(reappear)));
+}
+
+/**
+ * phi4 with a time bound, where the high probability objects should have existed in the
+ * last `seconds` seconds.
+ */
+inline Expr get_phi4_timed(double seconds) {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto x   = Var_x{"1"};
+
+  Expr high_prob = And({Class(id1) == 1, Prob(id1) > 0.8});
+  Expr reappear  = Expr{id1 == id2} & (Prob(id2) > 0.7) & (Class(id2) == 1);
+  return Forall({id1})->at(Pin{x})->dot(
+      high_prob >> Always((x - C_TIME{} < seconds) >> Exists({id2})->dot(reappear)));
+}
+
+inline Expr get_phi(size_t i) {
+  switch (i) {
+    case 1: return get_phi1();
+    case 2: return get_phi2();
+    case 3: return get_phi3();
+    default: return get_phi4();
+  }
+}
+
+/**
+ * A formula with `depth` nested quantifiers, i.e., there are `depth` distinct objects
+ * of the same class that overlap the first one.
+ */
+inline Expr get_nested(size_t depth) {
+  auto ids = std::vector<Var_id>{};
+  for (size_t i = 0; i < depth; i++) { ids.emplace_back(std::to_string(i + 1)); }
+
+  Expr body = Prob(ids[0]) > 0.5;
+  for (size_t i = 1; i < depth; i++) {
+    body = body & Expr{Class(ids[0]) == Class(ids[i])} &
+           Expr{std::make_shared<ast::CompareSpArea>(
+               Area(Intersect({BBox{ids[0]}, BBox{ids[i]}})) > 0.0)};
+  }
+  Expr phi = body;
+  for (size_t i = depth; i > 0; i--) { phi = Exists({ids[i - 1]})->dot(phi); }
+  return phi;
+}
+
+} // namespace percemon::benchmarks
+
+#endif /* end of include guard: __PERCEMON_BENCHMARKS_SYNTHETIC_HPP__ */
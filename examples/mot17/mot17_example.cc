@@ -1,6 +1,7 @@
 #include "mot17_helpers.hpp"
 
 #include "percemon/fmt.hpp"
+#include "percemon/io.hpp"
 #include "percemon/percemon.hpp"
 
 #include <CLI/CLI.hpp>
@@ -112,12 +113,12 @@ percemon::Expr get_phi(PhiNumber opt) {
 
 std::vector<bool> compute(
     percemon::monitoring::OnlineMonitor& monitor,
-    const std::vector<ds::Frame>& trace) {
+    percemon::io::MotReader& reader) {
   std::vector<bool> sat_unsat;
 
-  for (auto&& [i, it] = std::make_tuple(0, std::begin(trace)); it != std::end(trace);
-       it++, i++) {
-    auto& frame = *it;
+  // Frames are monitored as they are read from the file.
+  auto frame = ds::FrameView{};
+  for (size_t i = 0; reader.next(frame); i++) {
     monitor.add_frame(frame);
     double rob = monitor.eval();
     sat_unsat.push_back(rob >= 0);
@@ -127,6 +128,26 @@ std::vector<bool> compute(
   return sat_unsat;
 }
 
+std::vector<bool> compute_offline(
+    const percemon::Expr& phi,
+    const std::vector<ds::TrackedFrame>& trace,
+    double fps,
+    double width,
+    double height) {
+  // Use all the hardware threads for chunks of the trace.
+  auto options        = percemon::monitoring::MonitorOptions{};
+  options.num_threads = 0;
+  const auto rob =
+      percemon::monitoring::evaluate_trace(phi, trace, fps, width, height, options);
+
+  std::vector<bool> sat_unsat;
+  for (auto&& [i, r] : iter::enumerate(rob)) {
+    sat_unsat.push_back(r >= 0);
+    fmt::print("rob[{}]\t= {}\n", i, r);
+  }
+  return sat_unsat;
+}
+
 void save_to_file(const std::vector<bool>& out, const std::string& file) {
   fmt::print("Saving frame-by-frame robustness to: {}\n", file);
   auto output_file_path = fs::absolute(fs::path(file));
@@ -165,6 +186,10 @@ int main(int argc, char* argv[]) {
               {"phi4", PhiNumber::Example4}},
           CLI::ignore_case));
 
+  bool offline = false;
+  app.add_flag(
+      "--offline", offline, "If set, will evaluate the whole trace in parallel chunks");
+
   bool verbose = false;
   app.add_flag("-v,--verbose", verbose, "If set, will set logging level to DEBUG");
 
@@ -174,7 +199,6 @@ int main(int argc, char* argv[]) {
   size_t height = size.second;
 
   percemon::Expr phi = get_phi(phi_option);
-  auto trace         = mot17::parse_results(filename, fps, width, height);
 
   fmt::print("Running online monitor for:\n\t {}\n", phi);
   if (auto hrz = percemon::monitoring::get_horizon(phi, fps); hrz.has_value()) {
@@ -185,9 +209,19 @@ int main(int argc, char* argv[]) {
   }
   fmt::format("FPS:      {}\n", fps);
 
-  auto monitor = percemon::monitoring::OnlineMonitor{
-      phi, fps, static_cast<double>(width), static_cast<double>(height)};
-  auto frame_rob = compute(monitor, trace);
+  auto frame_rob = std::vector<bool>{};
+  if (offline) {
+    auto trace = mot17::parse_results(filename, fps, width, height);
+    frame_rob  = compute_offline(
+        phi, trace, fps, static_cast<double>(width), static_cast<double>(height));
+  } else {
+    const auto options = percemon::io::MotOptions{
+        fps, width, height, static_cast<int>(mot17::Labels::Pedestrian)};
+    auto reader  = percemon::io::MotReader{filename, options};
+    auto monitor = percemon::monitoring::OnlineMonitor{
+        phi, fps, static_cast<double>(width), static_cast<double>(height)};
+    frame_rob = compute(monitor, reader);
+  }
 
   save_to_file(frame_rob, out_file);
 
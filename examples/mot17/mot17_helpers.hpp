@@ -25,7 +25,11 @@ enum class Labels : int {
   Reflection          = 12
 };
 
-std::vector<percemon::datastream::Frame> parse_results(
+/**
+ * Parse the tracker results in the MOT17 CSV format into a stream of frames, keeping
+ * the integer track IDs.
+ */
+std::vector<percemon::datastream::TrackedFrame> parse_results(
     const std::string& file,
     const double fps,
     const size_t frame_width,
@@ -30,7 +30,9 @@ ast::AndPtr And(const std::vector<Expr>& args);
 ast::OrPtr Or(const std::vector<Expr>& args);
 ast::PreviousPtr Previous(const Expr& arg);
 ast::AlwaysPtr Always(const Expr& arg);
+ast::AlwaysPtr Always(const FrameInterval&, const Expr& arg);
 ast::SometimesPtr Sometimes(const Expr& arg);
+ast::SometimesPtr Sometimes(const FrameInterval&, const Expr& arg);
 ast::SincePtr Since(const Expr& a, const Expr& b);
 ast::BackToPtr BackTo(const Expr& a, const Expr& b);
 
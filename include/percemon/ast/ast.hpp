@@ -126,6 +126,17 @@ Expr operator&(const Expr& lhs, const Expr& rhs);
 Expr operator|(const Expr& lhs, const Expr& rhs);
 Expr operator>>(const Expr& lhs, const Expr& rhs);
 
+/**
+ * Rewrite a formula into an equivalent one that is cheaper to monitor.
+ *
+ * Negations are pushed down to the leaves (flipping the TimeBound, FrameBound, and ID
+ * comparisons), nested And and Or are flattened, constants are folded, Pins are moved
+ * above the quantifiers, and the operands of an Exists over an And (or a Forall over an
+ * Or) that don't depend on the quantified IDs are moved out of the quantifier. The
+ * robustness of the formula is unchanged.
+ */
+Expr simplify(const Expr& phi);
+
 } // namespace percemon::ast
 
 #endif /* end of include guard: __PERCEMON_AST_AST_HPP__ */
@@ -167,17 +167,21 @@ struct Previous {
 };
 
 struct Always {
+  std::optional<FrameInterval> interval = {};
   Expr arg;
 
   Always() = delete;
   Always(Expr arg_) : arg{std::move(arg_)} {};
+  Always(FrameInterval i, Expr arg_) : interval{i}, arg{std::move(arg_)} {};
 };
 
 struct Sometimes {
+  std::optional<FrameInterval> interval = {};
   Expr arg;
 
   Sometimes() = delete;
   Sometimes(Expr arg_) : arg{std::move(arg_)} {};
+  Sometimes(FrameInterval i, Expr arg_) : interval{i}, arg{std::move(arg_)} {};
 };
 
 struct Since {
@@ -6,6 +6,10 @@
  * fixed sampling rate or frames per second. Each frame consists of frame
  * number/time stamp and a map associating IDs with labelled objects.
  *
+ * Objects are identified either by strings (Frame) or by the integer track IDs
+ * assigned by a tracker (TrackedFrame). A FrameView is a TrackedFrame whose objects are
+ * stored in arrays owned by the caller.
+ *
  * Each labelled object should contain the following:
  *
  * - Class: Type of the object, outputted from some object detection algorithm.
@@ -18,6 +22,7 @@
 #ifndef __PERCEMON_STREAM_HH__
 #define __PERCEMON_STREAM_HH__
 
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -66,6 +71,46 @@ struct Frame {
   std::map<std::string, Object> objects;
 };
 
+/**
+ * Integer ID assigned to an object by a tracker.
+ */
+using TrackId = std::uint64_t;
+
+/**
+ * A Frame where the objects are identified by integer track IDs.
+ *
+ * The track ID `n` refers to the same object as the string ID `std::to_string(n)` in a
+ * Frame, so both kinds of frames can be added to the same monitor.
+ */
+struct TrackedFrame {
+  double timestamp;
+  size_t frame_num;
+  size_t size_x, size_y;
+
+  std::map<TrackId, Object> objects;
+};
+
+/**
+ * A frame whose objects are stored by the caller in contiguous arrays, e.g., in the
+ * buffer a detector writes its detections to.
+ *
+ * The `i`th object has the track ID `ids[i]`, class `object_class[i]`, probability
+ * `probability[i]`, and bounding box `bbox[i]`, for `i < num_objects`. The track IDs are
+ * the same as in a TrackedFrame, and must be distinct. The monitors copy the contents of
+ * the arrays when the frame is added, so they only need to outlive that call.
+ */
+struct FrameView {
+  double timestamp;
+  size_t frame_num;
+  size_t size_x, size_y;
+
+  size_t num_objects;
+  const TrackId* ids;
+  const int* object_class;
+  const double* probability;
+  const BoundingBox* bbox;
+};
+
 } // namespace percemon::datastream
 
 #endif /* end of include guard: __PERCEMON_STREAM_HH__ */
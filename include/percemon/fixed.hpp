@@ -0,0 +1,1287 @@
+/**
+ * Statically typed formulas, for specifications that are fixed when the monitor is
+ * built (e.g., on a camera that always checks the same properties).
+ *
+ * The functions and operators here mirror the ones for `ast::Expr`, but each ID and
+ * pinned variable is a distinct type, and the formula they build is a tree of types
+ * that only holds the constants of the formula:
+ *
+ * ```
+ * using namespace percemon::fixed;
+ * constexpr auto id1 = Id<1>{};
+ * constexpr auto id2 = Id<2>{};
+ * constexpr auto f   = VarF<1>{};
+ *
+ * const auto reappear = (id1 == id2) & (Prob(id2) > 0.7) & (Class(id2) == 1);
+ * const auto phi      = Forall(id1).at(f).dot(
+ *     (Prob(id1) > 0.8) >> Always((f - C_FRAME{} < 6) >> Exists(id2).dot(reappear)));
+ * auto monitor = Monitor{phi, fps};
+ * ```
+ *
+ * A `fixed::Monitor` evaluates the formula without going through a compiled Program:
+ * each node computes its robustness at a frame by calling the nodes below it, with the
+ * comparisons and the IDs of the quantifiers resolved at compile time, so the whole
+ * evaluation can be inlined into `eval`. The robustness is the same as that of an
+ * OnlineMonitor for the equivalent `ast::Expr` (see `to_expr`), which is also used to
+ * check the formula and compute its horizon when the monitor is created.
+ *
+ * @note The nodes are evaluated at one frame at a time, so a temporal operator
+ * evaluates its operands at every frame in its window. This suits the specifications
+ * with short windows that the monitor is meant for, but the cost of nested temporal
+ * operators multiplies. The spatial operators aren't supported.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_FIXED_HPP__
+#define __PERCEMON_FIXED_HPP__
+
+#include "percemon/ast.hpp"
+#include "percemon/datastream.hpp"
+#include "percemon/monitoring.hpp"
+#include "percemon/program.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace percemon::fixed {
+
+using ast::C_FRAME;
+using ast::C_TIME;
+using ast::ComparisonOp;
+using ast::CRT;
+using ast::FrameInterval;
+
+namespace details {
+
+constexpr double TOP    = std::numeric_limits<double>::infinity();
+constexpr double BOTTOM = -TOP;
+
+constexpr double bool_to_robustness(const bool v) { return (v) ? TOP : BOTTOM; }
+
+template <ComparisonOp Op>
+constexpr bool compare(const double lhs, const double rhs) {
+  if constexpr (Op == ComparisonOp::GT) {
+    return lhs > rhs;
+  } else if constexpr (Op == ComparisonOp::GE) {
+    return lhs >= rhs;
+  } else if constexpr (Op == ComparisonOp::LT) {
+    return lhs < rhs;
+  } else if constexpr (Op == ComparisonOp::LE) {
+    return lhs <= rhs;
+  } else if constexpr (Op == ComparisonOp::EQ) {
+    return lhs == rhs;
+  } else {
+    return lhs != rhs;
+  }
+}
+
+constexpr bool compare(const ComparisonOp op, const double lhs, const double rhs) {
+  switch (op) {
+    case ComparisonOp::GT: return lhs > rhs;
+    case ComparisonOp::GE: return lhs >= rhs;
+    case ComparisonOp::LT: return lhs < rhs;
+    case ComparisonOp::LE: return lhs <= rhs;
+    case ComparisonOp::EQ: return lhs == rhs;
+    case ComparisonOp::NE: return lhs != rhs;
+  }
+  return false;
+}
+
+/**
+ * The relation `~'` such that `a ~ b` is `b ~' a`.
+ */
+constexpr ComparisonOp mirror(const ComparisonOp op) {
+  switch (op) {
+    case ComparisonOp::GT: return ComparisonOp::LT;
+    case ComparisonOp::GE: return ComparisonOp::LE;
+    case ComparisonOp::LT: return ComparisonOp::GT;
+    case ComparisonOp::LE: return ComparisonOp::GE;
+    default: return op;
+  }
+}
+
+/**
+ * Number of ID slots used by the given nodes, i.e., one more than the largest `N` of an
+ * `Id<N>` in them.
+ */
+template <typename... Ts>
+constexpr size_t num_ids_of() {
+  return std::max({size_t{0}, Ts::num_ids...});
+}
+
+/**
+ * Dense integer assigned to an object ID.
+ */
+using ObjectId = std::uint32_t;
+
+/**
+ * Table assigning a dense integer to each object ID seen by a monitor, where a track ID
+ * is the same object as its decimal string.
+ */
+class IdTable {
+ public:
+  ObjectId intern(const std::string& name) {
+    const auto next = static_cast<ObjectId>(this->ids.size());
+    return this->ids.try_emplace(name, next).first->second;
+  }
+
+  ObjectId intern(const datastream::TrackId track) {
+    const auto it = this->tracks.find(track);
+    if (it != this->tracks.end()) { return it->second; }
+    const ObjectId id = this->intern(std::to_string(track));
+    this->tracks.emplace(track, id);
+    return id;
+  }
+
+ private:
+  std::unordered_map<std::string, ObjectId> ids;
+  std::unordered_map<datastream::TrackId, ObjectId> tracks;
+};
+
+/**
+ * A buffered frame, with the objects sorted by their interned ID.
+ */
+struct Slot {
+  double timestamp = 0.0;
+  size_t frame_num = 0;
+
+  std::vector<ObjectId> ids;
+  std::vector<datastream::Object> objects;
+
+  /**
+   * The object with the given ID, or `nullptr` if it isn't in the frame.
+   */
+  [[nodiscard]] const datastream::Object* find(const ObjectId id) const {
+    const auto it = std::lower_bound(this->ids.begin(), this->ids.end(), id);
+    if (it == this->ids.end() || *it != id) { return nullptr; }
+    return &(this->objects[static_cast<size_t>(it - this->ids.begin())]);
+  }
+};
+
+/**
+ * Ring of the most recent frames, where frame `0` is the oldest buffered frame.
+ */
+class Trace {
+ public:
+  explicit Trace(const size_t capacity) : slots(capacity) {}
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  [[nodiscard]] const Slot& operator[](const size_t t) const {
+    return slots[(first + t) % slots.size()];
+  }
+  [[nodiscard]] const Slot& back() const { return (*this)[count - 1]; }
+
+  /**
+   * The slot to write a new frame to, dropping the oldest frame if the ring is full.
+   * The storage of the dropped frame is reused.
+   */
+  Slot& push_back() {
+    if (count < slots.size()) {
+      count++;
+    } else {
+      first = (first + 1) % slots.size();
+    }
+    return slots[(first + count - 1) % slots.size()];
+  }
+
+ private:
+  std::vector<Slot> slots;
+  size_t first = 0, count = 0;
+};
+
+/**
+ * The buffered frames, and the object bound to each ID slot, while evaluating a
+ * formula.
+ */
+template <size_t NumIds>
+struct Context {
+  const Trace& trace;
+  std::array<ObjectId, NumIds> binding;
+};
+
+/**
+ * Base of the formula nodes, so that the logical operators only apply to formulas.
+ */
+struct Formula {};
+
+/**
+ * Base of the object attributes (Class, Prob, Area, Lat, and Lon).
+ */
+struct Attribute {};
+
+/**
+ * The attributes that can be compared against each other.
+ *
+ * @note Unlike the `ast` ones, a Lat can't be compared with a Lon, as the monitors
+ * evaluate the right hand side of such a comparison on the axis of the left.
+ */
+enum class AttributeKind { Class, Prob, Area, Lat, Lon };
+
+/**
+ * The right hand side of a comparison against a number.
+ */
+struct Literal {
+  static constexpr size_t num_ids = 0;
+  double value;
+};
+
+// Coordinates of the reference points of a bounding box, as in the monitors.
+
+constexpr double lateral_distance(const datastream::BoundingBox& bbox, const CRT crt) {
+  const auto xmin = static_cast<double>(bbox.xmin);
+  const auto xmax = static_cast<double>(bbox.xmax);
+  switch (crt) {
+    case CRT::CT: return (xmax + xmin) / 2;
+    case CRT::RM:
+    case CRT::TM: return xmax;
+    case CRT::LM:
+    case CRT::BM: return xmin;
+  }
+  return 0;
+}
+
+constexpr double
+longitudinal_distance(const datastream::BoundingBox& bbox, const CRT crt) {
+  const auto ymin = static_cast<double>(bbox.ymin);
+  const auto ymax = static_cast<double>(bbox.ymax);
+  switch (crt) {
+    case CRT::CT: return (ymax + ymin) / 2;
+    case CRT::TM:
+    case CRT::LM: return ymin;
+    case CRT::BM:
+    case CRT::RM: return ymax;
+  }
+  return 0;
+}
+
+/**
+ * The frames covered by a FrameInterval at frame `t`, as offsets `[first, last)` into
+ * the past, or all the frames up to `t` if there is no interval.
+ */
+struct FrameWindow {
+  bool bounded = false;
+  size_t first = 0, last = 0;
+
+  static constexpr bool is_lopen(const FrameInterval::Bound b) {
+    return b == FrameInterval::OPEN || b == FrameInterval::LOPEN;
+  }
+  static constexpr bool is_ropen(const FrameInterval::Bound b) {
+    return b == FrameInterval::OPEN || b == FrameInterval::ROPEN;
+  }
+
+  constexpr FrameWindow() = default;
+  constexpr explicit FrameWindow(const FrameInterval& i) :
+      bounded{true},
+      first{i.low + is_lopen(i.bound)},
+      last{i.high + !is_ropen(i.bound)} {}
+
+  /**
+   * Call `fn(s)` for the frames `s` in the window of frame `t`, from the oldest, until
+   * it returns `false`.
+   */
+  template <typename Fn>
+  constexpr void for_each(const size_t t, Fn&& fn) const {
+    if (!bounded) {
+      for (size_t s = 0; s <= t && fn(s); s++) {}
+      return;
+    }
+    if (first >= last || t < first) { return; }
+    const size_t oldest = (t + 1 > last) ? t + 1 - last : 0;
+    for (size_t s = oldest; s <= t - first && fn(s); s++) {}
+  }
+};
+
+} // namespace details
+
+template <typename T>
+inline constexpr bool is_formula_v = std::is_base_of_v<details::Formula, T>;
+
+template <typename T>
+inline constexpr bool is_attribute_v = std::is_base_of_v<details::Attribute, T>;
+
+// Variables, each of which is identified by its type. The `N` of an `Id<N>` is also the
+// slot that the object bound to it is stored in, so it should be small. The variables
+// are named after their `N` in the equivalent `ast::Expr`.
+
+template <size_t N>
+struct Id {
+  static constexpr size_t num_ids = N + 1;
+  static ast::Var_id to_ast() { return ast::Var_id{std::to_string(N)}; }
+};
+
+template <size_t N>
+struct VarX {
+  static ast::Var_x to_ast() { return ast::Var_x{std::to_string(N)}; }
+};
+
+template <size_t N>
+struct VarF {
+  static ast::Var_f to_ast() { return ast::Var_f{std::to_string(N)}; }
+};
+
+/**
+ * Node that holds a constant value, true or false.
+ */
+struct Const : details::Formula {
+  static constexpr size_t num_ids = 0;
+  bool value = false;
+
+  constexpr Const(const bool value_) : value{value_} {}
+
+  template <typename Ctx>
+  double eval(Ctx&, size_t) const {
+    return details::bool_to_robustness(value);
+  }
+  [[nodiscard]] ast::Expr to_expr() const { return ast::Const{value}; }
+};
+
+// Object attributes, with an optional multiplier.
+
+template <size_t N>
+struct Class : details::Attribute {
+  static constexpr auto kind      = details::AttributeKind::Class;
+  static constexpr size_t slot    = N;
+  static constexpr size_t num_ids = N + 1;
+  using ast_compare               = ast::CompareClass;
+  using ast_literal               = int;
+
+  constexpr explicit Class(Id<N>) {}
+
+  [[nodiscard]] constexpr double of(const datastream::Object& obj) const {
+    return obj.object_class;
+  }
+  [[nodiscard]] ast::Class to_ast() const { return ast::Class{Id<N>::to_ast()}; }
+};
+
+template <size_t N>
+struct Prob : details::Attribute {
+  static constexpr auto kind      = details::AttributeKind::Prob;
+  static constexpr size_t slot    = N;
+  static constexpr size_t num_ids = N + 1;
+  using ast_compare               = ast::CompareProb;
+  using ast_literal               = double;
+
+  double scale = 1.0;
+
+  constexpr Prob(Id<N>, const double scale_ = 1.0) : scale{scale_} {}
+
+  [[nodiscard]] constexpr double of(const datastream::Object& obj) const {
+    return obj.probability * scale;
+  }
+  [[nodiscard]] ast::Prob to_ast() const { return ast::Prob{Id<N>::to_ast(), scale}; }
+
+  friend constexpr Prob operator*(Prob lhs, const double rhs) {
+    lhs.scale *= rhs;
+    return lhs;
+  }
+  friend constexpr Prob operator*(const double lhs, const Prob& rhs) {
+    return rhs * lhs;
+  }
+};
+
+template <size_t N>
+struct Area : details::Attribute {
+  static constexpr auto kind      = details::AttributeKind::Area;
+  static constexpr size_t slot    = N;
+  static constexpr size_t num_ids = N + 1;
+  using ast_compare               = ast::CompareArea;
+  using ast_literal               = double;
+
+  double scale = 1.0;
+
+  constexpr Area(Id<N>, const double scale_ = 1.0) : scale{scale_} {}
+
+  [[nodiscard]] double of(const datastream::Object& obj) const {
+    const auto& b = obj.bbox;
+    const double w = static_cast<double>(b.xmin) - static_cast<double>(b.xmax);
+    const double h = static_cast<double>(b.ymin) - static_cast<double>(b.ymax);
+    return std::abs(w * h) * scale;
+  }
+  [[nodiscard]] ast::AreaOf to_ast() const {
+    return ast::AreaOf{Id<N>::to_ast(), scale};
+  }
+
+  friend constexpr Area operator*(Area lhs, const double rhs) {
+    lhs.scale *= rhs;
+    return lhs;
+  }
+  friend constexpr Area operator*(const double lhs, const Area& rhs) {
+    return rhs * lhs;
+  }
+};
+
+template <size_t N>
+struct Lat : details::Attribute {
+  static constexpr auto kind      = details::AttributeKind::Lat;
+  static constexpr size_t slot    = N;
+  static constexpr size_t num_ids = N + 1;
+  using ast_compare               = ast::CompareLat;
+  using ast_literal               = double;
+
+  CRT crt;
+  double scale = 1.0;
+
+  constexpr Lat(Id<N>, const CRT crt_, const double scale_ = 1.0) :
+      crt{crt_}, scale{scale_} {}
+
+  [[nodiscard]] constexpr double of(const datastream::Object& obj) const {
+    return details::lateral_distance(obj.bbox, crt) * scale;
+  }
+  [[nodiscard]] ast::Lat to_ast() const {
+    return ast::Lat{Id<N>::to_ast(), crt, scale};
+  }
+
+  friend constexpr Lat operator*(Lat lhs, const double rhs) {
+    lhs.scale *= rhs;
+    return lhs;
+  }
+  friend constexpr Lat operator*(const double lhs, const Lat& rhs) { return rhs * lhs; }
+};
+
+template <size_t N>
+struct Lon : details::Attribute {
+  static constexpr auto kind      = details::AttributeKind::Lon;
+  static constexpr size_t slot    = N;
+  static constexpr size_t num_ids = N + 1;
+  using ast_compare               = ast::CompareLon;
+  using ast_literal               = double;
+
+  CRT crt;
+  double scale = 1.0;
+
+  constexpr Lon(Id<N>, const CRT crt_, const double scale_ = 1.0) :
+      crt{crt_}, scale{scale_} {}
+
+  [[nodiscard]] constexpr double of(const datastream::Object& obj) const {
+    return details::longitudinal_distance(obj.bbox, crt) * scale;
+  }
+  [[nodiscard]] ast::Lon to_ast() const {
+    return ast::Lon{Id<N>::to_ast(), crt, scale};
+  }
+
+  friend constexpr Lon operator*(Lon lhs, const double rhs) {
+    lhs.scale *= rhs;
+    return lhs;
+  }
+  friend constexpr Lon operator*(const double lhs, const Lon& rhs) { return rhs * lhs; }
+};
+
+// Leaf predicates.
+
+/**
+ * Comparison of an attribute of an object against either a literal or an attribute of
+ * another object, which is `-inf` at the frames where the objects aren't present.
+ */
+template <typename Lhs, ComparisonOp Op, typename Rhs>
+struct CompareExpr : details::Formula {
+  static constexpr size_t num_ids = details::num_ids_of<Lhs, Rhs>();
+  Lhs lhs;
+  Rhs rhs;
+
+  constexpr CompareExpr(Lhs lhs_, Rhs rhs_) : lhs{lhs_}, rhs{rhs_} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    const auto& frame = ctx.trace[t];
+    const auto* obj1  = frame.find(ctx.binding[Lhs::slot]);
+    if (obj1 == nullptr) { return details::BOTTOM; }
+    double rhs_value = 0.0;
+    if constexpr (std::is_same_v<Rhs, details::Literal>) {
+      rhs_value = rhs.value;
+    } else {
+      const auto* obj2 = frame.find(ctx.binding[Rhs::slot]);
+      if (obj2 == nullptr) { return details::BOTTOM; }
+      rhs_value = rhs.of(*obj2);
+    }
+    return details::bool_to_robustness(details::compare<Op>(lhs.of(*obj1), rhs_value));
+  }
+
+  [[nodiscard]] ast::Expr to_expr() const {
+    using Compare = typename Lhs::ast_compare;
+    if constexpr (std::is_same_v<Rhs, details::Literal>) {
+      return Compare{
+          lhs.to_ast(), Op, static_cast<typename Lhs::ast_literal>(rhs.value)};
+    } else {
+      return Compare{lhs.to_ast(), Op, rhs.to_ast()};
+    }
+  }
+};
+
+/**
+ * Comparison of the objects bound to two IDs.
+ */
+template <size_t N, ComparisonOp Op, size_t M>
+struct CompareIdExpr : details::Formula {
+  static constexpr size_t num_ids = std::max(N, M) + 1;
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, size_t) const {
+    const bool equal = ctx.binding[N] == ctx.binding[M];
+    return details::bool_to_robustness((Op == ComparisonOp::EQ) == equal);
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return ast::CompareId{Id<N>::to_ast(), Op, Id<M>::to_ast()};
+  }
+};
+
+/**
+ * `x - C_TIME`, the time elapsed from a frame to the frame pinned by `x`.
+ */
+template <size_t N>
+struct TimeDiff {};
+
+/**
+ * `f - C_FRAME`, the number of frames from a frame to the frame pinned by `f`.
+ */
+template <size_t N>
+struct FrameDiff {};
+
+/**
+ * A bound `x - C_TIME ~ c`. Pins always refer to the current frame.
+ */
+template <size_t N>
+struct TimeBoundExpr : details::Formula {
+  static constexpr size_t num_ids = 0;
+  /**
+   * The bound as given, and as evaluated, where non-positive bounds are negated along
+   * with the relation (as ast::TimeBound does).
+   */
+  ComparisonOp op;
+  double bound;
+  ComparisonOp eval_op;
+  double eval_bound;
+
+  constexpr TimeBoundExpr(const ComparisonOp op_, const double bound_) :
+      op{op_},
+      bound{bound_},
+      eval_op{(bound_ <= 0.0) ? details::mirror(op_) : op_},
+      eval_bound{(bound_ <= 0.0) ? -bound_ : bound_} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    const double elapsed = ctx.trace.back().timestamp - ctx.trace[t].timestamp;
+    return details::bool_to_robustness(details::compare(eval_op, elapsed, eval_bound));
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return ast::TimeBound{VarX<N>::to_ast(), op, bound};
+  }
+};
+
+/**
+ * A bound `f - C_FRAME ~ c`. Pins always refer to the current frame.
+ */
+template <size_t N>
+struct FrameBoundExpr : details::Formula {
+  static constexpr size_t num_ids = 0;
+  ComparisonOp op;
+  size_t bound;
+
+  constexpr FrameBoundExpr(const ComparisonOp op_, const size_t bound_) :
+      op{op_}, bound{bound_} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    const double f       = static_cast<double>(ctx.trace.back().frame_num);
+    const double elapsed = f - static_cast<double>(ctx.trace[t].frame_num);
+    return details::bool_to_robustness(
+        details::compare(op, elapsed, static_cast<double>(bound)));
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return ast::FrameBound{VarF<N>::to_ast(), op, bound};
+  }
+};
+
+// Logical operators. And and Or skip their second operand once the first one decides
+// the result.
+
+template <typename Arg>
+struct NotExpr : details::Formula {
+  static constexpr size_t num_ids = Arg::num_ids;
+  Arg arg;
+
+  constexpr explicit NotExpr(Arg arg_) : arg{std::move(arg_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    return -arg.eval(ctx, t);
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return std::make_shared<ast::Not>(arg.to_expr());
+  }
+};
+
+template <typename Lhs, typename Rhs>
+struct AndExpr : details::Formula {
+  static constexpr size_t num_ids = details::num_ids_of<Lhs, Rhs>();
+  Lhs lhs;
+  Rhs rhs;
+
+  constexpr AndExpr(Lhs lhs_, Rhs rhs_) : lhs{std::move(lhs_)}, rhs{std::move(rhs_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    const double rob = lhs.eval(ctx, t);
+    if (rob == details::BOTTOM) { return rob; }
+    return std::min(rob, rhs.eval(ctx, t));
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return std::make_shared<ast::And>(std::vector{lhs.to_expr(), rhs.to_expr()});
+  }
+};
+
+template <typename Lhs, typename Rhs>
+struct OrExpr : details::Formula {
+  static constexpr size_t num_ids = details::num_ids_of<Lhs, Rhs>();
+  Lhs lhs;
+  Rhs rhs;
+
+  constexpr OrExpr(Lhs lhs_, Rhs rhs_) : lhs{std::move(lhs_)}, rhs{std::move(rhs_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    const double rob = lhs.eval(ctx, t);
+    if (rob == details::TOP) { return rob; }
+    return std::max(rob, rhs.eval(ctx, t));
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return std::make_shared<ast::Or>(std::vector{lhs.to_expr(), rhs.to_expr()});
+  }
+};
+
+// Temporal operators.
+
+template <typename Arg>
+struct PreviousExpr : details::Formula {
+  static constexpr size_t num_ids = Arg::num_ids;
+  Arg arg;
+
+  constexpr explicit PreviousExpr(Arg arg_) : arg{std::move(arg_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    return (t == 0) ? details::BOTTOM : arg.eval(ctx, t - 1);
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    return std::make_shared<ast::Previous>(arg.to_expr());
+  }
+};
+
+/**
+ * Always (if `IsAlways`) or Sometimes, over the frames in the interval or, if
+ * unbounded, over all the buffered frames up to the current one.
+ */
+template <bool IsAlways, typename Arg>
+struct WindowExpr : details::Formula {
+  static constexpr size_t num_ids = Arg::num_ids;
+  std::optional<FrameInterval> interval;
+  details::FrameWindow window;
+  Arg arg;
+
+  constexpr explicit WindowExpr(Arg arg_) :
+      interval{}, window{}, arg{std::move(arg_)} {}
+  constexpr WindowExpr(const FrameInterval& interval_, Arg arg_) :
+      interval{interval_}, window{interval_}, arg{std::move(arg_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    constexpr double decided = IsAlways ? details::BOTTOM : details::TOP;
+    double ret               = -decided;
+    window.for_each(t, [&](const size_t s) {
+      const double rob = arg.eval(ctx, s);
+      ret              = IsAlways ? std::min(ret, rob) : std::max(ret, rob);
+      return ret != decided;
+    });
+    return ret;
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    using Op = std::conditional_t<IsAlways, ast::Always, ast::Sometimes>;
+    if (interval.has_value()) { return std::make_shared<Op>(*interval, arg.to_expr()); }
+    return std::make_shared<Op>(arg.to_expr());
+  }
+};
+
+template <typename Arg>
+using AlwaysExpr = WindowExpr<true, Arg>;
+template <typename Arg>
+using SometimesExpr = WindowExpr<false, Arg>;
+
+/**
+ * Since (if `IsSince`) or BackTo, which is `~(~lhs S ~rhs)`, over the buffered frames.
+ */
+template <bool IsSince, typename Lhs, typename Rhs>
+struct SinceExpr : details::Formula {
+  static constexpr size_t num_ids = details::num_ids_of<Lhs, Rhs>();
+  Lhs lhs;
+  Rhs rhs;
+
+  constexpr SinceExpr(Lhs lhs_, Rhs rhs_) :
+      lhs{std::move(lhs_)}, rhs{std::move(rhs_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    // The same recurrence as the monitors, from the oldest frame.
+    constexpr double sign = IsSince ? 1.0 : -1.0;
+    double ret = details::TOP, max_rhs = details::BOTTOM;
+    for (size_t s = 0; s <= t; s++) {
+      const double x = sign * lhs.eval(ctx, s);
+      const double y = sign * rhs.eval(ctx, s);
+      max_rhs        = std::max(max_rhs, y);
+      ret            = std::max({y, std::min(x, ret), -max_rhs});
+    }
+    return sign * ret;
+  }
+  [[nodiscard]] ast::Expr to_expr() const {
+    using Op = std::conditional_t<IsSince, ast::Since, ast::BackTo>;
+    return std::make_shared<Op>(lhs.to_expr(), rhs.to_expr());
+  }
+};
+
+template <typename Lhs, typename Rhs>
+using BackToExpr = SinceExpr<false, Lhs, Rhs>;
+
+// Quantifiers.
+
+struct NoVar {};
+
+/**
+ * The frame and time variables pinned by a quantifier, each of which is a `VarX<N>` (or
+ * `VarF<N>`) or `NoVar`.
+ */
+template <typename X, typename F>
+struct Pins {
+  [[nodiscard]] static constexpr bool empty() {
+    return std::is_same_v<X, NoVar> && std::is_same_v<F, NoVar>;
+  }
+
+  [[nodiscard]] static ast::Pin to_ast() {
+    auto x = std::optional<ast::Var_x>{};
+    auto f = std::optional<ast::Var_f>{};
+    if constexpr (!std::is_same_v<X, NoVar>) { x = X::to_ast(); }
+    if constexpr (!std::is_same_v<F, NoVar>) { f = F::to_ast(); }
+    return ast::Pin{x, f};
+  }
+};
+
+/**
+ * Exists (if `IsExists`) or Forall over the tuples of objects in the current frame,
+ * binding the `i`th object to `Id<Ns[i]>`. The enumeration stops once the result is
+ * decided.
+ */
+template <bool IsExists, typename PinsT, typename Body, size_t... Ns>
+struct QuantifierExpr : details::Formula {
+  static_assert(sizeof...(Ns) > 0, "A quantifier must have at least one ID");
+  static constexpr size_t num_ids = std::max({Body::num_ids, (Ns + 1)...});
+  static constexpr std::array<size_t, sizeof...(Ns)> slots{Ns...};
+  Body body;
+
+  constexpr explicit QuantifierExpr(Body body_) : body{std::move(body_)} {}
+
+  template <typename Ctx>
+  double eval(Ctx& ctx, const size_t t) const {
+    return this->template bind<0>(ctx, t, ctx.trace.back());
+  }
+
+  [[nodiscard]] ast::Expr to_expr() const {
+    using Quantifier = std::conditional_t<IsExists, ast::Exists, ast::Forall>;
+    auto q = Quantifier{std::vector<ast::Var_id>{Id<Ns>::to_ast()...}};
+    if constexpr (PinsT::empty()) {
+      return q.dot(body.to_expr());
+    } else {
+      return q.at(PinsT::to_ast())->dot(body.to_expr());
+    }
+  }
+
+ private:
+  template <size_t I, typename Ctx>
+  double bind(Ctx& ctx, const size_t t, const details::Slot& frame) const {
+    if constexpr (I == sizeof...(Ns)) {
+      return body.eval(ctx, t);
+    } else {
+      constexpr double decided = IsExists ? details::TOP : details::BOTTOM;
+      double ret               = -decided;
+      for (const details::ObjectId id : frame.ids) {
+        ctx.binding[slots[I]] = id;
+        const double rob      = this->template bind<I + 1>(ctx, t, frame);
+        ret                   = IsExists ? std::max(ret, rob) : std::min(ret, rob);
+        if (ret == decided) { break; }
+      }
+      return ret;
+    }
+  }
+};
+
+/**
+ * The quantifier before its body is given: `Exists(id1, id2).at(f).dot(body)`.
+ */
+template <bool IsExists, typename PinsT, size_t... Ns>
+struct Quantifier {
+  template <size_t X, size_t F>
+  constexpr auto at(VarX<X>, VarF<F>) const {
+    return Quantifier<IsExists, Pins<VarX<X>, VarF<F>>, Ns...>{};
+  }
+  template <size_t X>
+  constexpr auto at(VarX<X>) const {
+    return Quantifier<IsExists, Pins<VarX<X>, NoVar>, Ns...>{};
+  }
+  template <size_t F>
+  constexpr auto at(VarF<F>) const {
+    return Quantifier<IsExists, Pins<NoVar, VarF<F>>, Ns...>{};
+  }
+
+  template <typename Body>
+  constexpr auto dot(Body body) const {
+    static_assert(is_formula_v<Body>, "The body of a quantifier must be a formula");
+    return QuantifierExpr<IsExists, PinsT, Body, Ns...>{std::move(body)};
+  }
+};
+
+template <size_t... Ns>
+constexpr auto Exists(Id<Ns>...) {
+  return Quantifier<true, Pins<NoVar, NoVar>, Ns...>{};
+}
+
+template <size_t... Ns>
+constexpr auto Forall(Id<Ns>...) {
+  return Quantifier<false, Pins<NoVar, NoVar>, Ns...>{};
+}
+
+// Operators building the formulas, as for ast::Expr.
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto Not(Arg arg) {
+  return NotExpr<Arg>{std::move(arg)};
+}
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto operator~(Arg arg) {
+  return NotExpr<Arg>{std::move(arg)};
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    typename = std::enable_if_t<is_formula_v<Lhs> && is_formula_v<Rhs>>>
+constexpr auto operator&(Lhs lhs, Rhs rhs) {
+  return AndExpr<Lhs, Rhs>{std::move(lhs), std::move(rhs)};
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    typename = std::enable_if_t<is_formula_v<Lhs> && is_formula_v<Rhs>>>
+constexpr auto operator|(Lhs lhs, Rhs rhs) {
+  return OrExpr<Lhs, Rhs>{std::move(lhs), std::move(rhs)};
+}
+
+/**
+ * Implication, i.e., `~lhs | rhs`.
+ */
+template <
+    typename Lhs,
+    typename Rhs,
+    typename = std::enable_if_t<is_formula_v<Lhs> && is_formula_v<Rhs>>>
+constexpr auto operator>>(Lhs lhs, Rhs rhs) {
+  return ~std::move(lhs) | std::move(rhs);
+}
+
+/**
+ * Conjunction of two or more formulas, as `((a & b) & c) ...`.
+ */
+template <typename Arg, typename... Args>
+constexpr auto And(Arg arg, Args... args) {
+  static_assert(sizeof...(Args) > 0, "An And needs at least 2 operands");
+  return (std::move(arg) & ... & std::move(args));
+}
+
+/**
+ * Disjunction of two or more formulas, as `((a | b) | c) ...`.
+ */
+template <typename Arg, typename... Args>
+constexpr auto Or(Arg arg, Args... args) {
+  static_assert(sizeof...(Args) > 0, "An Or needs at least 2 operands");
+  return (std::move(arg) | ... | std::move(args));
+}
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto Previous(Arg arg) {
+  return PreviousExpr<Arg>{std::move(arg)};
+}
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto Always(Arg arg) {
+  return AlwaysExpr<Arg>{std::move(arg)};
+}
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto Always(const FrameInterval& interval, Arg arg) {
+  return AlwaysExpr<Arg>{interval, std::move(arg)};
+}
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto Sometimes(Arg arg) {
+  return SometimesExpr<Arg>{std::move(arg)};
+}
+
+template <typename Arg, typename = std::enable_if_t<is_formula_v<Arg>>>
+constexpr auto Sometimes(const FrameInterval& interval, Arg arg) {
+  return SometimesExpr<Arg>{interval, std::move(arg)};
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    typename = std::enable_if_t<is_formula_v<Lhs> && is_formula_v<Rhs>>>
+constexpr auto Since(Lhs lhs, Rhs rhs) {
+  return SinceExpr<true, Lhs, Rhs>{std::move(lhs), std::move(rhs)};
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    typename = std::enable_if_t<is_formula_v<Lhs> && is_formula_v<Rhs>>>
+constexpr auto BackTo(Lhs lhs, Rhs rhs) {
+  return BackToExpr<Lhs, Rhs>{std::move(lhs), std::move(rhs)};
+}
+
+// Comparisons of the IDs, attributes, and the time and frame variables.
+
+template <size_t N, size_t M>
+constexpr auto operator==(Id<N>, Id<M>) {
+  return CompareIdExpr<N, ComparisonOp::EQ, M>{};
+}
+template <size_t N, size_t M>
+constexpr auto operator!=(Id<N>, Id<M>) {
+  return CompareIdExpr<N, ComparisonOp::NE, M>{};
+}
+
+template <size_t N, size_t M>
+constexpr auto operator==(Class<N> lhs, Class<M> rhs) {
+  return CompareExpr<Class<N>, ComparisonOp::EQ, Class<M>>{lhs, rhs};
+}
+template <size_t N, size_t M>
+constexpr auto operator!=(Class<N> lhs, Class<M> rhs) {
+  return CompareExpr<Class<N>, ComparisonOp::NE, Class<M>>{lhs, rhs};
+}
+template <size_t N>
+constexpr auto operator==(Class<N> lhs, const int rhs) {
+  return CompareExpr<Class<N>, ComparisonOp::EQ, details::Literal>{lhs, {double(rhs)}};
+}
+template <size_t N>
+constexpr auto operator!=(Class<N> lhs, const int rhs) {
+  return CompareExpr<Class<N>, ComparisonOp::NE, details::Literal>{lhs, {double(rhs)}};
+}
+template <size_t N>
+constexpr auto operator==(const int lhs, Class<N> rhs) {
+  return rhs == lhs;
+}
+template <size_t N>
+constexpr auto operator!=(const int lhs, Class<N> rhs) {
+  return rhs != lhs;
+}
+
+namespace details {
+
+/**
+ * If the attributes can be compared with `<`, `<=`, `>`, and `>=`.
+ */
+template <typename Lhs, typename Rhs>
+constexpr bool is_ordered() {
+  if constexpr (is_attribute_v<Lhs> && is_attribute_v<Rhs>) {
+    return Lhs::kind == Rhs::kind && Lhs::kind != AttributeKind::Class;
+  } else if constexpr (is_attribute_v<Lhs> && std::is_arithmetic_v<Rhs>) {
+    return Lhs::kind != AttributeKind::Class;
+  } else {
+    return false;
+  }
+}
+
+template <ComparisonOp Op, typename Lhs, typename Rhs>
+constexpr auto make_compare(Lhs lhs, Rhs rhs) {
+  if constexpr (is_attribute_v<Rhs>) {
+    return CompareExpr<Lhs, Op, Rhs>{lhs, rhs};
+  } else {
+    return CompareExpr<Lhs, Op, Literal>{lhs, Literal{static_cast<double>(rhs)}};
+  }
+}
+
+} // namespace details
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<details::is_ordered<Lhs, Rhs>(), int> = 0>
+constexpr auto operator>(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::GT>(lhs, rhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<details::is_ordered<Lhs, Rhs>(), int> = 0>
+constexpr auto operator>=(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::GE>(lhs, rhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<details::is_ordered<Lhs, Rhs>(), int> = 0>
+constexpr auto operator<(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::LT>(lhs, rhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<details::is_ordered<Lhs, Rhs>(), int> = 0>
+constexpr auto operator<=(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::LE>(lhs, rhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<std::is_arithmetic_v<Lhs> && details::is_ordered<Rhs, Lhs>(),
+                     int> = 0>
+constexpr auto operator>(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::LT>(rhs, lhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<std::is_arithmetic_v<Lhs> && details::is_ordered<Rhs, Lhs>(),
+                     int> = 0>
+constexpr auto operator>=(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::LE>(rhs, lhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<std::is_arithmetic_v<Lhs> && details::is_ordered<Rhs, Lhs>(),
+                     int> = 0>
+constexpr auto operator<(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::GT>(rhs, lhs);
+}
+
+template <
+    typename Lhs,
+    typename Rhs,
+    std::enable_if_t<std::is_arithmetic_v<Lhs> && details::is_ordered<Rhs, Lhs>(),
+                     int> = 0>
+constexpr auto operator<=(Lhs lhs, Rhs rhs) {
+  return details::make_compare<ComparisonOp::GE>(rhs, lhs);
+}
+
+template <size_t N>
+constexpr TimeDiff<N> operator-(VarX<N>, C_TIME) {
+  return {};
+}
+template <size_t N>
+constexpr FrameDiff<N> operator-(VarF<N>, C_FRAME) {
+  return {};
+}
+
+template <size_t N>
+constexpr auto operator>(TimeDiff<N>, const double bound) {
+  return TimeBoundExpr<N>{ComparisonOp::GT, bound};
+}
+template <size_t N>
+constexpr auto operator>(const double bound, TimeDiff<N>) {
+  return TimeBoundExpr<N>{ComparisonOp::LT, bound};
+}
+
+template <size_t N>
+constexpr auto operator>=(TimeDiff<N>, const double bound) {
+  return TimeBoundExpr<N>{ComparisonOp::GE, bound};
+}
+template <size_t N>
+constexpr auto operator>=(const double bound, TimeDiff<N>) {
+  return TimeBoundExpr<N>{ComparisonOp::LE, bound};
+}
+
+template <size_t N>
+constexpr auto operator<(TimeDiff<N>, const double bound) {
+  return TimeBoundExpr<N>{ComparisonOp::LT, bound};
+}
+template <size_t N>
+constexpr auto operator<(const double bound, TimeDiff<N>) {
+  return TimeBoundExpr<N>{ComparisonOp::GT, bound};
+}
+
+template <size_t N>
+constexpr auto operator<=(TimeDiff<N>, const double bound) {
+  return TimeBoundExpr<N>{ComparisonOp::LE, bound};
+}
+template <size_t N>
+constexpr auto operator<=(const double bound, TimeDiff<N>) {
+  return TimeBoundExpr<N>{ComparisonOp::GE, bound};
+}
+
+template <size_t N>
+constexpr auto operator>(FrameDiff<N>, const size_t bound) {
+  return FrameBoundExpr<N>{ComparisonOp::GT, bound};
+}
+template <size_t N>
+constexpr auto operator>(const size_t bound, FrameDiff<N>) {
+  return FrameBoundExpr<N>{ComparisonOp::LT, bound};
+}
+
+template <size_t N>
+constexpr auto operator>=(FrameDiff<N>, const size_t bound) {
+  return FrameBoundExpr<N>{ComparisonOp::GE, bound};
+}
+template <size_t N>
+constexpr auto operator>=(const size_t bound, FrameDiff<N>) {
+  return FrameBoundExpr<N>{ComparisonOp::LE, bound};
+}
+
+template <size_t N>
+constexpr auto operator<(FrameDiff<N>, const size_t bound) {
+  return FrameBoundExpr<N>{ComparisonOp::LT, bound};
+}
+template <size_t N>
+constexpr auto operator<(const size_t bound, FrameDiff<N>) {
+  return FrameBoundExpr<N>{ComparisonOp::GT, bound};
+}
+
+template <size_t N>
+constexpr auto operator<=(FrameDiff<N>, const size_t bound) {
+  return FrameBoundExpr<N>{ComparisonOp::LE, bound};
+}
+template <size_t N>
+constexpr auto operator<=(const size_t bound, FrameDiff<N>) {
+  return FrameBoundExpr<N>{ComparisonOp::GE, bound};
+}
+
+/**
+ * Online monitor for a statically typed formula, with the same interface as the
+ * OnlineMonitor.
+ *
+ * @throws std::invalid_argument (from the constructor) under the same conditions as
+ * `monitoring::compile` for the equivalent `ast::Expr`.
+ */
+template <typename Phi>
+class Monitor {
+  static_assert(is_formula_v<Phi>, "A monitor can only be created for a formula");
+
+ public:
+  Monitor() = delete;
+  Monitor(Phi phi_, const double fps_) :
+      phi{std::move(phi_)},
+      fps{fps_},
+      max_horizon{monitoring::get_horizon(
+          monitoring::compile(ast::simplify(phi.to_expr())), fps_)},
+      trace{max_horizon} {}
+
+  /**
+   * Add a new frame to the monitor buffer, dropping the oldest frame once the buffer
+   * holds `get_max_horizon()` frames.
+   */
+  void add_frame(const datastream::Frame& frame) { this->push(frame); }
+  /**
+   * Add a new frame with integer track IDs to the monitor buffer. The track ID `n`
+   * refers to the same object as the string ID `std::to_string(n)`.
+   */
+  void add_frame(const datastream::TrackedFrame& frame) { this->push(frame); }
+  /**
+   * Add a frame whose objects are in arrays owned by the caller.
+   *
+   * @throws std::invalid_argument if the frame has duplicate track IDs.
+   */
+  void add_frame(const datastream::FrameView& frame) {
+    this->scratch.clear();
+    for (size_t i = 0; i < frame.num_objects; i++) {
+      this->scratch.emplace_back(
+          this->ids.intern(frame.ids[i]),
+          datastream::Object{
+              frame.object_class[i], frame.probability[i], frame.bbox[i]});
+    }
+    this->sort_scratch();
+    const auto dup = std::adjacent_find(
+        this->scratch.begin(), this->scratch.end(), [](const auto& a, const auto& b) {
+          return a.first == b.first;
+        });
+    if (dup != this->scratch.end()) {
+      throw std::invalid_argument(
+          "Frame view has multiple objects with the same track ID");
+    }
+    this->store(frame.timestamp, frame.frame_num);
+  }
+
+  /**
+   * Compute the robustness of the currently buffered frames.
+   *
+   * @throws std::logic_error if no frames have been added.
+   */
+  double eval() const {
+    if (this->trace.size() == 0) {
+      throw std::logic_error("Cannot evaluate a monitor without any frames");
+    }
+    auto ctx = details::Context<Phi::num_ids>{this->trace, {}};
+    return this->phi.eval(ctx, this->trace.size() - 1);
+  }
+
+  [[nodiscard]] size_t get_max_horizon() const { return max_horizon; }
+  [[nodiscard]] double get_fps() const { return fps; }
+  [[nodiscard]] const Phi& get_phi() const { return phi; }
+
+ private:
+  const Phi phi;
+  const double fps;
+  const size_t max_horizon;
+
+  details::IdTable ids;
+  details::Trace trace;
+  /**
+   * The objects of the frame being added, with their interned IDs.
+   */
+  std::vector<std::pair<details::ObjectId, datastream::Object>> scratch;
+
+  template <typename FrameT>
+  void push(const FrameT& frame) {
+    this->scratch.clear();
+    for (const auto& [key, obj] : frame.objects) {
+      this->scratch.emplace_back(this->ids.intern(key), obj);
+    }
+    this->sort_scratch();
+    this->store(frame.timestamp, frame.frame_num);
+  }
+
+  void sort_scratch() {
+    std::sort(
+        this->scratch.begin(), this->scratch.end(), [](const auto& a, const auto& b) {
+          return a.first < b.first;
+        });
+  }
+
+  void store(const double timestamp, const size_t frame_num) {
+    auto& slot     = this->trace.push_back();
+    slot.timestamp = timestamp;
+    slot.frame_num = frame_num;
+    slot.ids.clear();
+    slot.objects.clear();
+    for (const auto& [id, obj] : this->scratch) {
+      slot.ids.push_back(id);
+      slot.objects.push_back(obj);
+    }
+  }
+};
+
+} // namespace percemon::fixed
+
+#endif /* end of include guard: __PERCEMON_FIXED_HPP__ */
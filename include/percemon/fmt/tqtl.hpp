@@ -111,6 +111,9 @@ struct fmt::formatter<percemon::ast::Always>
     : percemon::ast::formatter<percemon::ast::Always> {
   template <typename FormatContext>
   auto format(const percemon::ast::Always& e, FormatContext& ctx) {
+    if (e.interval.has_value()) {
+      return format_to(ctx.out(), "Alw_{} {}", *(e.interval), e.arg);
+    }
     return format_to(ctx.out(), "Alw {}", e.arg);
   }
 };
@@ -120,6 +123,9 @@ struct fmt::formatter<percemon::ast::Sometimes>
     : percemon::ast::formatter<percemon::ast::Sometimes> {
   template <typename FormatContext>
   auto format(const percemon::ast::Sometimes& e, FormatContext& ctx) {
+    if (e.interval.has_value()) {
+      return format_to(ctx.out(), "Sometimes_{} {}", *(e.interval), e.arg);
+    }
     return format_to(ctx.out(), "Sometimes {}", e.arg);
   }
 };
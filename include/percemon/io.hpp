@@ -0,0 +1,282 @@
+/**
+ * Readers for files of recorded perception data, which produce the frames one at a time
+ * so that they can be added to a monitor while the file is being read, and a compact
+ * binary format for traces.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_IO_HPP__
+#define __PERCEMON_IO_HPP__
+
+#include "percemon/datastream.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace percemon::io {
+
+struct MotOptions {
+  /**
+   * Frame rate of the recording, used to compute the timestamps of the frames.
+   */
+  double fps = 30.0;
+  /**
+   * Size of the images in pixels.
+   */
+  size_t frame_width = 0, frame_height = 0;
+  /**
+   * Class assigned to all the objects, as the MOT17 results don't have one.
+   */
+  int object_class = 1;
+
+  /**
+   * If the file should be memory-mapped (where supported). Otherwise, or if mapping the
+   * file fails, it is read in chunks of `chunk_size` bytes.
+   */
+  bool memory_map   = true;
+  size_t chunk_size = size_t{1} << 20;
+};
+
+/**
+ * First of the track IDs given to the rows of MOT files with a negative ID. The IDs of
+ * the tracks in the files are all less than it.
+ */
+constexpr datastream::TrackId FIRST_UNASSIGNED_ID = datastream::TrackId{1} << 63;
+
+/**
+ * Reader for tracker results in the MOTChallenge CSV format, i.e., rows of
+ *
+ *     <frame>, <id>, <bb_left>, <bb_top>, <bb_width>, <bb_height>, <conf>, ...
+ *
+ * where the rows of each frame are contiguous and the frames are in increasing order.
+ * Frames are numbered from 1, and a frame without any rows is produced as a frame
+ * without objects. Only the current frame is held in memory, so the memory used doesn't
+ * depend on the length of the file. Files whose rows aren't in frame order (e.g., the
+ * ground truth files of MOT17, which are sorted by track) can be read with `read_mot`.
+ * If a frame has several rows with the same ID, the last of them is kept.
+ *
+ * Rows with a negative ID, e.g., the `-1` of detection files for the detections that
+ * aren't assigned to a track, are each given a fresh ID, counting up from
+ * `FIRST_UNASSIGNED_ID`. They are then distinct objects, in their frame and across
+ * frames. A monitor frees the IDs of the objects in a frame once the frame leaves its
+ * buffer, so these fresh IDs don't make it use more memory over the file.
+ *
+ * ```
+ * auto reader = io::MotReader{"results.csv", {fps, width, height}};
+ * auto frame  = datastream::FrameView{};
+ * while (reader.next(frame)) {
+ *   monitor.add_frame(frame);
+ *   double rob = monitor.eval();
+ * }
+ * ```
+ */
+class MotReader {
+ public:
+  MotReader() = delete;
+  /**
+   * @throws std::invalid_argument if the file can't be opened.
+   */
+  MotReader(const std::string& file, MotOptions options_);
+
+  MotReader(MotReader&&) noexcept;
+  ~MotReader();
+
+  /**
+   * Read the next frame. The arrays of the view are owned by the reader and are valid
+   * until the next call.
+   *
+   * @returns false at the end of the file, in which case `frame` isn't modified.
+   * @throws std::invalid_argument if a row is malformed or the frames aren't in
+   * increasing order.
+   */
+  bool next(datastream::FrameView& frame);
+
+  /**
+   * Read the next frame into `frame`, reusing its storage.
+   */
+  bool next(datastream::TrackedFrame& frame);
+
+  [[nodiscard]] const MotOptions& get_options() const { return options; }
+
+ private:
+  struct Source;
+
+  const MotOptions options;
+  std::unique_ptr<Source> source;
+
+  struct Row {
+    size_t frame;
+    datastream::TrackId id;
+    double confidence;
+    datastream::BoundingBox bbox;
+  };
+
+  /**
+   * Number of the next frame to produce.
+   */
+  size_t frame_num = 1;
+  /**
+   * The last row that was read, if it isn't in a frame that was produced yet.
+   */
+  Row pending      = {};
+  bool has_pending = false;
+  size_t line_num  = 0;
+  /**
+   * Number of rows with a negative ID read so far.
+   */
+  datastream::TrackId num_unassigned = 0;
+
+  std::vector<datastream::TrackId> ids;
+  std::vector<int> object_class;
+  std::vector<double> probability;
+  std::vector<datastream::BoundingBox> bbox;
+  // Scratch space for `keep_last_rows`.
+  std::vector<std::pair<datastream::TrackId, size_t>> order;
+  std::vector<bool> replaced;
+
+  /**
+   * Read the next non-empty row into `pending`, or return false at the end of the file.
+   */
+  bool read_row();
+  /**
+   * Drop the rows of the current frame that are followed by a row with the same ID.
+   */
+  void keep_last_rows();
+
+  friend std::vector<datastream::TrackedFrame>
+  read_mot(const std::string& file, MotOptions options);
+};
+
+/**
+ * Read a whole MOTChallenge results file into memory. Unlike with the MotReader, the
+ * rows may be in any order, and if a frame has several rows with the same ID, the last
+ * of them is kept.
+ *
+ * @throws std::invalid_argument if the file can't be opened or a row is malformed.
+ */
+std::vector<datastream::TrackedFrame>
+read_mot(const std::string& file, MotOptions options);
+
+/**
+ * The information in the header of a binary trace.
+ */
+struct TraceHeader {
+  double fps         = 30.0;
+  size_t frame_width = 0, frame_height = 0;
+  /**
+   * Number of frames in the trace, which is filled in by the writer when it is closed.
+   */
+  size_t num_frames = 0;
+};
+
+/**
+ * Writer for binary traces, i.e., a header with the fps and the frame size, followed by
+ * a record for each frame with the fixed-width attributes of the objects in columns:
+ *
+ *     timestamp, frame_num, num_objects, record size
+ *     id[num_objects]           (uint64)
+ *     probability[num_objects]  (double)
+ *     bbox[num_objects]         (4 x uint64: xmin, xmax, ymin, ymax)
+ *     class[num_objects]        (int32, padded to a multiple of 8 bytes)
+ *
+ * The values are in the byte order of the machine that wrote the trace, and every
+ * column is 8-byte aligned, so a reader can use the columns of a memory-mapped trace
+ * in place.
+ */
+class TraceWriter {
+ public:
+  TraceWriter() = delete;
+  /**
+   * @throws std::invalid_argument if the file can't be created.
+   */
+  TraceWriter(const std::string& file, TraceHeader header_);
+
+  TraceWriter(TraceWriter&&) noexcept;
+  ~TraceWriter();
+
+  void add_frame(const datastream::FrameView& frame);
+  void add_frame(const datastream::TrackedFrame& frame);
+  /**
+   * Add a frame whose object IDs are decimal integers.
+   *
+   * @throws std::invalid_argument if an object ID isn't a decimal integer.
+   */
+  void add_frame(const datastream::Frame& frame);
+
+  /**
+   * Write the number of frames to the header and close the file. This is done by the
+   * destructor if it isn't called.
+   */
+  void close();
+
+  [[nodiscard]] const TraceHeader& get_header() const { return header; }
+
+ private:
+  struct Sink;
+
+  TraceHeader header;
+  std::unique_ptr<Sink> sink;
+};
+
+/**
+ * Reader for binary traces written by a TraceWriter.
+ *
+ * The trace is memory-mapped (where supported), so the frame views it produces point
+ * into the file, and opening the trace only reads its header. Otherwise, the whole file
+ * is read into memory.
+ */
+class TraceReader {
+ public:
+  TraceReader() = delete;
+  /**
+   * @throws std::invalid_argument if the file can't be opened or isn't a binary trace
+   * written on a machine with the same byte order.
+   */
+  explicit TraceReader(const std::string& file, bool memory_map = true);
+
+  TraceReader(TraceReader&&) noexcept;
+  ~TraceReader();
+
+  [[nodiscard]] const TraceHeader& get_header() const { return header; }
+
+  /**
+   * Read the next frame. The arrays of the view are valid as long as the reader is.
+   *
+   * @returns false at the end of the trace.
+   * @throws std::invalid_argument if the trace is truncated.
+   */
+  bool next(datastream::FrameView& frame);
+  bool next(datastream::TrackedFrame& frame);
+
+  /**
+   * Views of all the remaining frames, e.g., for `monitoring::evaluate_trace`.
+   */
+  std::vector<datastream::FrameView> views();
+
+ private:
+  struct Data;
+
+  TraceHeader header;
+  std::unique_ptr<Data> data;
+  /**
+   * Offset of the next frame record in the trace.
+   */
+  size_t offset = 0;
+};
+
+/**
+ * Convert a MOTChallenge results file to a binary trace.
+ *
+ * @returns the number of frames in the trace.
+ */
+size_t convert_mot(
+    const std::string& mot_file,
+    const std::string& trace_file,
+    MotOptions options);
+
+} // namespace percemon::io
+
+#endif /* end of include guard: __PERCEMON_IO_HPP__ */
@@ -4,7 +4,11 @@
 #define __PERCEMON_ITER_PRODUCT_HPP__
 
 #include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <iterator>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace percemon {
@@ -12,6 +16,10 @@ namespace iter_helpers {
 namespace details {
 /**
  * Product iterator for a single vector repeated k times.
+ *
+ * Each dereference copies the current elements into a new vector. To enumerate the
+ * tuples without copying or allocating, use `index_tuples` on the indices of the
+ * elements instead.
  */
 template <typename Iter>
 struct product_iterator {
@@ -126,6 +134,202 @@ constexpr auto product(Container&& iterable, size_t k = 1) {
   return details::product_range<Container, Iter>{iterable, k};
 }
 
+/**
+ * The tuples enumerated by `index_tuples`.
+ */
+enum class TupleMode {
+  /**
+   * All the tuples in `[0, n_0) x ... x [0, n_{k - 1})`.
+   */
+  Product,
+  /**
+   * The non-decreasing tuples in `[0, n)^k`, i.e., the k-sized combinations of
+   * `[0, n)` with repetition. If the tuples are bindings for a function that is
+   * symmetric in its arguments, the other tuples are permutations of these.
+   */
+  Multisets,
+  /**
+   * The increasing tuples in `[0, n)^k`, i.e., the k-sized subsets of `[0, n)`.
+   */
+  Subsets,
+};
+
+/**
+ * Enumeration of k-sized tuples of indices, in lexicographic order.
+ *
+ * The tuples are written into a vector owned by the caller (or the iterator), so
+ * stepping through them doesn't allocate. The tuples can also be accessed by their
+ * position, so that the enumeration can be split into contiguous parts.
+ */
+class index_tuples {
+ public:
+  /**
+   * Enumerate the tuples of `k = radices.size()` indices, where the `i`-th index is in
+   * `[0, radices[i])`. Unless `mode` is `Product`, all the radices must be equal.
+   */
+  explicit index_tuples(
+      std::vector<size_t> radices_,
+      TupleMode mode_ = TupleMode::Product) :
+      radices{std::move(radices_)}, mode{mode_} {
+    if (mode != TupleMode::Product &&
+        std::adjacent_find(radices.begin(), radices.end(), std::not_equal_to<>{}) !=
+            radices.end()) {
+      throw std::invalid_argument(
+          "Combinations of indices need the same number of choices for each index.");
+    }
+  }
+
+  /**
+   * Enumerate the tuples of `k` indices in `[0, n)`.
+   */
+  index_tuples(size_t n, size_t k, TupleMode mode_ = TupleMode::Product) :
+      index_tuples{std::vector<size_t>(k, n), mode_} {}
+
+  [[nodiscard]] size_t arity() const { return radices.size(); }
+  [[nodiscard]] TupleMode tuple_mode() const { return mode; }
+
+  /**
+   * Number of tuples in the enumeration.
+   */
+  [[nodiscard]] size_t size() const {
+    const size_t k = radices.size();
+    const size_t n = (k == 0) ? 0 : radices[0];
+    switch (mode) {
+      case TupleMode::Multisets: return (k == 0) ? 1 : binomial(n + k - 1, k);
+      case TupleMode::Subsets: return binomial(n, k);
+      case TupleMode::Product: break;
+    }
+    size_t ret = 1;
+    for (const size_t radix : radices) { ret *= radix; }
+    return ret;
+  }
+
+  /**
+   * Write the `index`-th tuple into `digits`, which must have `arity()` elements.
+   */
+  void nth(size_t index, std::vector<size_t>& digits) const {
+    const size_t k = radices.size();
+    if (k == 0) { return; }
+    switch (mode) {
+      case TupleMode::Product:
+        for (size_t i = k; i-- > 0;) {
+          digits[i] = index % radices[i];
+          index /= radices[i];
+        }
+        return;
+      case TupleMode::Subsets: nth_subset(radices[0], k, index, digits); return;
+      case TupleMode::Multisets:
+        // Adding `i` to the `i`-th index of a non-decreasing tuple in `[0, n)^k` gives
+        // an increasing tuple in `[0, n + k - 1)^k`, and vice versa.
+        nth_subset(radices[0] + k - 1, k, index, digits);
+        for (size_t i = 0; i < k; i++) { digits[i] -= i; }
+        return;
+    }
+  }
+
+  /**
+   * Advance `digits` to the next tuple, or return `false` if it is the last one.
+   */
+  bool next(std::vector<size_t>& digits) const {
+    const size_t k = radices.size();
+    for (size_t i = k; i-- > 0;) {
+      switch (mode) {
+        case TupleMode::Product:
+          if (++digits[i] < radices[i]) { return true; }
+          digits[i] = 0;
+          break;
+        case TupleMode::Multisets:
+          if (digits[i] + 1 < radices[i]) {
+            std::fill(digits.begin() + i, digits.end(), digits[i] + 1);
+            return true;
+          }
+          break;
+        case TupleMode::Subsets:
+          if (digits[i] + k < radices[i] + i) {
+            digits[i]++;
+            for (size_t j = i + 1; j < k; j++) { digits[j] = digits[j - 1] + 1; }
+            return true;
+          }
+          break;
+      }
+    }
+    return false;
+  }
+
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type   = std::ptrdiff_t;
+    using value_type        = std::vector<size_t>;
+    using pointer           = const std::vector<size_t>*;
+    using reference         = const std::vector<size_t>&;
+
+    reference operator*() const { return digits; }
+    pointer operator->() const { return &digits; }
+
+    iterator& operator++() {
+      if (!tuples->next(digits)) { tuples = nullptr; }
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const { return tuples == other.tuples; }
+    bool operator!=(const iterator& other) const { return tuples != other.tuples; }
+
+   private:
+    friend class index_tuples;
+    iterator() = default;
+    explicit iterator(const index_tuples* tuples_) :
+        tuples{tuples_}, digits(tuples_->arity()) {
+      tuples->nth(0, digits);
+    }
+
+    /**
+     * The enumeration, or null once the iterator is past the last tuple.
+     */
+    const index_tuples* tuples = nullptr;
+    std::vector<size_t> digits;
+  };
+
+  /**
+   * Iterate over the tuples. The iterator owns the tuple it points to, which is
+   * updated in place as it is incremented.
+   */
+  [[nodiscard]] iterator begin() const {
+    return (size() == 0) ? iterator{} : iterator{this};
+  }
+  [[nodiscard]] iterator end() const { return iterator{}; }
+
+ private:
+  std::vector<size_t> radices;
+  TupleMode mode;
+
+  static size_t binomial(size_t n, size_t k) {
+    if (k > n) { return 0; }
+    k          = std::min(k, n - k);
+    size_t ret = 1;
+    // Each partial product is a binomial coefficient, so the division is exact.
+    for (size_t i = 0; i < k; i++) { ret = ret * (n - i) / (i + 1); }
+    return ret;
+  }
+
+  static void
+  nth_subset(size_t n, size_t k, size_t index, std::vector<size_t>& digits) {
+    size_t first = 0;
+    for (size_t i = 0; i < k; i++) {
+      // Skip the subsets whose `i`-th index is smaller.
+      for (size_t c = first;; c++) {
+        const size_t count = binomial(n - c - 1, k - i - 1);
+        if (index < count) {
+          digits[i] = c;
+          first     = c + 1;
+          break;
+        }
+        index -= count;
+      }
+    }
+  }
+};
+
 } // namespace iter_helpers
 } // namespace percemon
 
@@ -5,17 +5,31 @@
 
 #include "percemon/ast.hpp"
 #include "percemon/datastream.hpp"
+#include "percemon/program.hpp"
 
 // TODO: Consider unordered_map if memory and hashing isn't an issue.
 #include <map>
 
-// TODO: Consider performance/space efficiency of deque vs vector.
-#include <deque>
-
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace percemon::monitoring {
 
+namespace details {
+struct AsyncState;
+class CandidateFilter;
+class ChangeTracker;
+class FrameBuffer;
+class IncrementalEngine;
+class Profiler;
+class ThreadPool;
+struct StreamState;
+} // namespace details
+
 /**
  * Returns if the formula is purely past-time. Only place where this can be true is in
  * the TimeBound and FrameBound constraints.
@@ -25,8 +39,12 @@ namespace percemon::monitoring {
 // bool is_past_time(const percemon::ast::Expr& expr);
 
 /**
- * Get the horizon for a formula in number of frames.  This function will throw an
- * exception if there are TimeBound constraints in the formula.
+ * Get the horizon for a formula in number of frames, i.e., the number of most recent
+ * frames needed to compute its robustness at the current frame.  This function will
+ * throw an exception if there are TimeBound constraints in the formula.
+ *
+ * The unbounded temporal operators, Since and BackTo range over the frames in the
+ * buffer, so they don't add to the horizon. The horizon is always at least 1.
  */
 std::optional<size_t> get_horizon(const percemon::ast::Expr& expr);
 
@@ -36,6 +54,241 @@ std::optional<size_t> get_horizon(const percemon::ast::Expr& expr);
  */
 std::optional<size_t> get_horizon(const percemon::ast::Expr& expr, double fps);
 
+/**
+ * Get the horizon of a compiled program, over all its roots.
+ *
+ * @param fps Frames per second of the stream, needed if the program has TimeBound
+ * instructions.
+ */
+size_t get_horizon(const Program& program, std::optional<double> fps = {});
+
+/**
+ * Get the horizon of each instruction in a compiled program: the number of most recent
+ * frames at which the value of the instruction can affect the robustness of a root.
+ *
+ * Operands of an And (Or) are only needed at the frames where its TimeBound and
+ * FrameBound operands may all be true (false), so the horizon of an instruction under a
+ * guard is bounded by the guard. The horizon is `0` for an instruction that is never
+ * needed, and empty for one that is needed at every frame in the buffer (under an
+ * unbounded temporal operator).
+ */
+std::vector<std::optional<size_t>>
+get_horizons(const Program& program, std::optional<double> fps = {});
+
+/**
+ * Horizon of a formula whose frames are buffered by their timestamps (see
+ * `BufferMode::Time`): the frames at most `seconds` older than the current frame, and
+ * the `frames - 1` frames before the oldest of them. Without a time bound, these are
+ * the last `frames` frames, as given by `get_horizon`.
+ */
+struct TimeHorizon {
+  size_t frames = 1;
+  std::optional<double> seconds = {};
+};
+
+/**
+ * Get the horizon of a compiled program over all its roots, where the TimeBound
+ * constraints bound the time since a frame instead of being converted to a number of
+ * frames, so that no frame rate is needed.
+ */
+TimeHorizon get_time_horizon(const Program& program);
+
+/**
+ * Get the horizon of each instruction as with `get_horizons`, where an instruction
+ * under a TimeBound guard is needed at every frame in the buffer (as its number of
+ * frames depends on the timestamps).
+ */
+std::vector<std::optional<size_t>> get_time_horizons(const Program& program);
+
+/**
+ * Strategy used by the OnlineMonitor to compute the robustness of the buffered frames.
+ */
+enum class EvalStrategy {
+  /**
+   * Re-evaluate every subformula over the entire buffer on each call to `eval`.
+   */
+  Recompute,
+  /**
+   * Maintain a table with a row for each subformula and a column for each frame in the
+   * horizon across calls to `eval`. Subformulas whose value at a frame depends only on
+   * that frame (and the objects bound to their ID variables), and the temporal
+   * operators over them, are evaluated only for the newly added frame, while
+   * quantifiers fold the rows of their bodies. Cheap subformulas that only need to be
+   * known at a few frames are computed again at those frames instead of being kept in
+   * the table.
+   */
+  Incremental
+};
+
+/**
+ * Representation of the signals of the subformulas when they are recomputed over the
+ * buffer, i.e., with EvalStrategy::Recompute. EvalStrategy::Incremental always stores
+ * robustness values in its table.
+ */
+enum class SignalMode {
+  /**
+   * Use Boolean signals if the formula is qualitative (see `is_qualitative`), and
+   * robustness signals otherwise. The monitors report the mode that was chosen in
+   * their options.
+   */
+  Auto,
+  /**
+   * Pack the signal of each subformula into a bitset with one bit per frame, so that
+   * the Boolean connectives work on 64 frames at a time, Previous is a shift, and the
+   * temporal operators are computed with shifts and bit scans.
+   */
+  Boolean,
+  /**
+   * Store the robustness of each subformula at each frame as a `double`.
+   */
+  Robustness
+};
+
+/**
+ * How the OnlineMonitor decides which frames to keep in its buffer.
+ */
+enum class BufferMode {
+  /**
+   * Keep the last `get_horizon(program, fps)` frames, where the TimeBound constraints
+   * are converted to a number of frames with the nominal frame rate of the monitor.
+   */
+  Frames,
+  /**
+   * Keep the frames within the time horizon of the formula (see `get_time_horizon`),
+   * which grows the buffer when the frames come in faster than the nominal frame rate
+   * and evicts them by their timestamps, so that the buffer holds the frames that the
+   * TimeBound constraints can actually select. The timestamps of the frames must not
+   * decrease.
+   */
+  Time
+};
+
+/**
+ * Check if the robustness of every instruction of the program can only be `+inf` or
+ * `-inf`, in which case it can be evaluated with `SignalMode::Boolean`.
+ */
+bool is_qualitative(const Program& program);
+
+/**
+ * If the library is built with `PERCEMON_PROFILING`, in which case an OnlineMonitor can
+ * record a profile of the instructions of its program (see `MonitorOptions::profile`).
+ * Otherwise, the instrumentation is compiled out.
+ */
+#if defined(PERCEMON_PROFILING)
+inline constexpr bool profiling_enabled = true;
+#else
+inline constexpr bool profiling_enabled = false;
+#endif
+
+/**
+ * Counters recorded for an instruction of the program while profiling.
+ */
+struct NodeProfile {
+  /**
+   * Number of times the signal (or, with EvalStrategy::Incremental, the row) of the
+   * instruction was computed.
+   */
+  size_t calls = 0;
+  /**
+   * Time spent computing the instruction, including and excluding the time spent in its
+   * operands. The time of the permutations evaluated by other threads is only counted
+   * in the instructions under the quantifier.
+   */
+  std::chrono::nanoseconds total_time{0}, self_time{0};
+  /**
+   * For quantifiers, the number of permutations of objects enumerated.
+   */
+  size_t permutations = 0;
+  /**
+   * Number of allocations from the region arena by the instruction, excluding its
+   * operands.
+   */
+  size_t allocations = 0;
+};
+
+/**
+ * Profile of a program, with the counters for each instruction.
+ */
+struct Profile {
+  /**
+   * Counters for each instruction in the program, or empty if the monitor isn't
+   * profiling.
+   */
+  std::vector<NodeProfile> nodes;
+};
+
+/**
+ * Format a report of the instructions that were evaluated, the most expensive first,
+ * annotated with the subformula that each instruction was compiled from.
+ */
+std::string format_profile(const Program& program, const Profile& profile);
+
+/**
+ * Options to configure an OnlineMonitor.
+ */
+struct MonitorOptions {
+  EvalStrategy strategy = EvalStrategy::Incremental;
+  /**
+   * Number of threads used to evaluate the permutations of objects in the outermost
+   * quantifiers of the formula, including the thread calling `eval`. If 0, the number
+   * of hardware threads is used, and if 1, quantifiers are evaluated serially.
+   */
+  size_t num_threads = 1;
+  /**
+   * Evaluate the subformulas only at the frames where they can affect the robustness at
+   * the current frame. The operands of And and Or are evaluated cheapest first, and are
+   * skipped at the frames where the result is already decided (`-inf` for And, `+inf`
+   * for Or), and quantifiers stop enumerating objects once the result is decided.
+   */
+  bool lazy = false;
+  /**
+   * Record a profile of the evaluation of each instruction (see `get_profile`). This is
+   * ignored unless `profiling_enabled`.
+   */
+  bool profile = false;
+  /**
+   * Representation of the signals with EvalStrategy::Recompute.
+   *
+   * @throws std::invalid_argument (from the constructor of the monitor) if
+   * `SignalMode::Boolean` is requested for a formula that isn't qualitative.
+   */
+  SignalMode signals = SignalMode::Auto;
+  /**
+   * How the frames are buffered. `BufferMode::Time` is only supported by the
+   * OnlineMonitor (and the AsyncOnlineMonitor).
+   *
+   * @throws std::invalid_argument (from the constructor of the other monitors and from
+   * `evaluate_trace`) for `BufferMode::Time`.
+   */
+  BufferMode buffer = BufferMode::Frames;
+  /**
+   * Most frames that a buffer indexed by time (see `BufferMode::Time`) may hold, which
+   * bounds its memory when the timestamps stop advancing (as every frame then stays in
+   * the time horizon). It is raised to the initial size of the buffer if smaller.
+   *
+   * @throws std::invalid_argument (from `add_frame`) for a frame that would make the
+   * buffer hold more frames, in which case the monitor is unchanged.
+   */
+  size_t max_buffered_frames = 1 << 16;
+  /**
+   * Return the previous robustness from `OnlineMonitor::eval`, without evaluating the
+   * formula, when the buffer only changed since then in what the formula doesn't read:
+   * the buffer is full of frames that are the same in the attributes and classes that
+   * the formula compares (and, with FrameBound constraints, have consecutive frame
+   * numbers). Formulas with TimeBound constraints are always evaluated.
+   */
+  bool skip_unchanged = false;
+};
+
+/**
+ * Number of calls to `OnlineMonitor::eval` that evaluated the formula, and that
+ * returned the previous robustness instead (see `MonitorOptions::skip_unchanged`).
+ */
+struct EvalCounts {
+  size_t evaluated = 0;
+  size_t skipped   = 0;
+};
+
 /**
  * Object representing the online monitor.
  */
@@ -46,38 +299,106 @@ struct OnlineMonitor {
       ast::Expr phi_,
       const double fps_,
       double x_boundary,
-      double y_boundary);
+      double y_boundary,
+      MonitorOptions options_ = {});
+
+  OnlineMonitor(OnlineMonitor&&) noexcept;
+  ~OnlineMonitor();
 
   /**
    * Add a new frame to the monitor buffer
+   *
+   * @throws std::invalid_argument with `BufferMode::Time`, if the frame is older than
+   * the last frame added.
    */
   void add_frame(const datastream::Frame& frame);
   void add_frame(datastream::Frame&& frame); // Efficient move semantics
+  /**
+   * Add a new frame with integer track IDs to the monitor buffer. The track ID `n`
+   * refers to the same object as the string ID `std::to_string(n)`.
+   */
+  void add_frame(const datastream::TrackedFrame& frame);
+  /**
+   * Add a frame whose objects are in arrays owned by the caller. Only the contents of
+   * the arrays are copied into the buffer, so once the buffer is full and has held as
+   * many objects, adding a frame doesn't allocate, even if its track IDs are new.
+   *
+   * @throws std::invalid_argument if the frame has duplicate track IDs.
+   */
+  void add_frame(const datastream::FrameView& frame);
 
   /**
    * Compute the robustness of the currently buffered frames.
    */
   double eval();
 
+  /**
+   * Save the state of the monitor, i.e., the frames in its buffer and, with
+   * `EvalStrategy::Incremental`, its table of subformula values, to a compact binary
+   * snapshot. The profile isn't saved.
+   */
+  [[nodiscard]] std::vector<char> checkpoint() const;
+  /**
+   * Replace the state of the monitor with a snapshot saved by `checkpoint`, e.g., by a
+   * monitor in another process, so that it continues from the same frames without
+   * replaying them. The snapshot must be from a monitor for the same formula, horizon
+   * and buffer mode, on a machine with the same byte order, but it may use another
+   * strategy.
+   *
+   * @throws std::invalid_argument if the snapshot is malformed or is for another
+   * formula, in which case the monitor is unchanged.
+   */
+  void restore(const std::vector<char>& snapshot);
+
+  /**
+   * Number of frames held by the buffer, which with `BufferMode::Time` is only the
+   * frames it starts with, as it grows to hold the frames in the time horizon.
+   */
   [[nodiscard]] size_t get_max_horizon() const { return max_horizon; }
   [[nodiscard]] size_t get_fps() const { return fps; };
   const ast::Expr& get_phi() { return phi; }
+  [[nodiscard]] const Program& get_program() const { return program; }
+  [[nodiscard]] const MonitorOptions& get_options() const { return options; }
+
+  /**
+   * Get the counters recorded since the monitor was created (or the profile was
+   * reset), which is empty if the monitor isn't profiling.
+   */
+  [[nodiscard]] Profile get_profile() const;
+  void reset_profile();
+
+  [[nodiscard]] EvalCounts get_eval_counts() const { return counts; }
+  /**
+   * Number of distinct objects in the buffered frames, each of which holds an entry in
+   * the table of object IDs of the monitor.
+   */
+  [[nodiscard]] size_t num_object_ids() const;
 
  private:
   /**
    * The formula being monitored
    */
   const ast::Expr phi;
+  /**
+   * The formula compiled to a program, which is what is actually evaluated.
+   */
+  const Program program;
   /**
    * Frames per second for the datastream
    */
   const double fps;
 
+  /**
+   * Options used to create the monitor
+   */
+  const MonitorOptions options;
+
   /**
    * A buffer containing the history of Frames required to compute robustness of phi
-   * efficiently.
+   * efficiently, stored in a ring of `max_horizon` columnar slots (or more, with
+   * `BufferMode::Time`).
    */
-  std::deque<datastream::Frame> buffer;
+  std::unique_ptr<details::FrameBuffer> buffer;
 
   /**
    * Maximum width of buffer.
@@ -88,8 +409,328 @@ struct OnlineMonitor {
    * Boundary for UNIVERSE
    */
   double universe_x, universe_y;
+
+  /**
+   * Workers for evaluating quantifiers in parallel, if `options.num_threads != 1`
+   */
+  std::unique_ptr<details::ThreadPool> pool;
+
+  /**
+   * Table of subformula robustness values, if using EvalStrategy::Incremental
+   */
+  std::unique_ptr<details::IncrementalEngine> engine;
+
+  /**
+   * Counters for the instructions of the program, if profiling
+   */
+  std::unique_ptr<details::Profiler> profiler;
+
+  /**
+   * Guards restricting the objects enumerated by the quantifiers
+   */
+  std::unique_ptr<details::CandidateFilter> filter;
+
+  /**
+   * Changes to the frames in what the formula reads, if `options.skip_unchanged`
+   */
+  std::unique_ptr<details::ChangeTracker> changes;
+  EvalCounts counts;
+
+  /**
+   * Create an empty buffer for the options of the monitor.
+   */
+  [[nodiscard]] std::unique_ptr<details::FrameBuffer> make_buffer() const;
+  /**
+   * Compute the robustness of the buffered frames.
+   */
+  double eval_buffer();
+};
+
+/**
+ * What an AsyncOnlineMonitor does with a frame when its queue is full.
+ */
+enum class Backpressure {
+  /**
+   * Wait in `add_frame` until the worker makes room for the frame.
+   */
+  Block,
+  /**
+   * Discard the frame, as if it wasn't in the stream.
+   */
+  Drop,
+  /**
+   * Wait for room like `Block`, but once the worker falls behind it adds all the queued
+   * frames to the monitor and only evaluates the robustness at the newest one, so that
+   * the results keep up with the stream.
+   */
+  Coalesce,
+};
+
+/**
+ * Options to configure the queue of an AsyncOnlineMonitor.
+ */
+struct AsyncOptions {
+  /**
+   * Number of frames that can be waiting for the worker.
+   */
+  size_t queue_capacity     = 64;
+  Backpressure backpressure = Backpressure::Block;
+};
+
+/**
+ * The robustness computed by an AsyncOnlineMonitor at a frame.
+ */
+struct AsyncResult {
+  size_t frame_num  = 0;
+  double timestamp  = 0.0;
+  double robustness = 0.0;
+};
+
+/**
+ * Online monitor that evaluates the formula on a worker thread, so that the thread
+ * adding the frames (e.g., the detector in a camera pipeline) doesn't wait for the
+ * evaluation.
+ *
+ * Frames are passed to the worker through a bounded lock-free queue, and the worker
+ * adds each frame to an OnlineMonitor and evaluates it. The results are passed to
+ * `on_result` on the worker thread, in the order of the frames, or, if no callback is
+ * given, are kept until they are collected with `take_results`.
+ *
+ * @note `add_frame` and `flush` must all be called from the same thread.
+ */
+class AsyncOnlineMonitor {
+ public:
+  using Callback = std::function<void(const AsyncResult&)>;
+
+  AsyncOnlineMonitor() = delete;
+  AsyncOnlineMonitor(
+      ast::Expr phi_,
+      double fps_,
+      double x_boundary,
+      double y_boundary,
+      MonitorOptions options_     = {},
+      AsyncOptions async_options_ = {},
+      Callback on_result_         = {});
+
+  AsyncOnlineMonitor(const AsyncOnlineMonitor&) = delete;
+  AsyncOnlineMonitor& operator=(const AsyncOnlineMonitor&) = delete;
+  /**
+   * Evaluate the frames that are still queued, and stop the worker.
+   */
+  ~AsyncOnlineMonitor();
+
+  /**
+   * Queue a frame for the worker. Returns `false` if the frame was dropped because the
+   * queue was full (with `Backpressure::Drop`).
+   *
+   * @throws The first exception thrown by the worker while adding or evaluating a
+   * frame, after which the worker discards the frames.
+   */
+  bool add_frame(const datastream::Frame& frame);
+  bool add_frame(datastream::Frame&& frame);
+  bool add_frame(const datastream::TrackedFrame& frame);
+  bool add_frame(datastream::TrackedFrame&& frame);
+
+  /**
+   * Wait until the worker is done with all the queued frames.
+   *
+   * @throws The first exception thrown by the worker, as in `add_frame`.
+   */
+  void flush();
+
+  /**
+   * Collect the results computed since the last call, if no callback was given.
+   */
+  std::vector<AsyncResult> take_results();
+
+  /**
+   * Number of frames dropped because the queue was full.
+   */
+  [[nodiscard]] size_t num_dropped() const;
+
+  [[nodiscard]] size_t get_max_horizon() const;
+  [[nodiscard]] const Program& get_program() const;
+  [[nodiscard]] const MonitorOptions& get_options() const;
+  [[nodiscard]] const AsyncOptions& get_async_options() const { return async_options; }
+
+ private:
+  const AsyncOptions async_options;
+  /**
+   * The monitor, the queue, and the worker thread.
+   */
+  std::unique_ptr<details::AsyncState> state;
+
+  template <typename FrameT>
+  bool push(FrameT&& frame);
 };
 
+/**
+ * Online monitor for several formulas on the same stream of frames.
+ *
+ * The formulas share one frame buffer, sized to the largest of their horizons, and are
+ * compiled into one program where structurally equal subformulas (e.g., the same
+ * `Class(id1) == PED` in several specs) are a single instruction. With
+ * `EvalStrategy::Incremental`, each shared instruction is then evaluated once per frame
+ * for all the formulas.
+ */
+class MonitorSet {
+ public:
+  MonitorSet() = delete;
+  /**
+   * @throws std::invalid_argument if any of the formulas doesn't have a bounded horizon,
+   * or can't be compiled.
+   */
+  MonitorSet(
+      std::vector<ast::Expr> phis_,
+      double fps_,
+      double x_boundary,
+      double y_boundary,
+      MonitorOptions options_ = {});
+
+  MonitorSet(MonitorSet&&) noexcept;
+  ~MonitorSet();
+
+  void add_frame(const datastream::Frame& frame);
+  void add_frame(datastream::Frame&& frame);
+  void add_frame(const datastream::TrackedFrame& frame);
+  void add_frame(const datastream::FrameView& frame);
+
+  /**
+   * Compute the robustness of each formula, in the order they were given, for the
+   * currently buffered frames.
+   */
+  std::vector<double> eval();
+
+  [[nodiscard]] size_t size() const { return phis.size(); }
+  [[nodiscard]] size_t get_max_horizon() const { return max_horizon; }
+  [[nodiscard]] const std::vector<ast::Expr>& get_phis() const { return phis; }
+  [[nodiscard]] const Program& get_program() const { return program; }
+  [[nodiscard]] const MonitorOptions& get_options() const { return options; }
+
+ private:
+  const std::vector<ast::Expr> phis;
+  const Program program;
+  const double fps;
+  const MonitorOptions options;
+
+  std::unique_ptr<details::FrameBuffer> buffer;
+  /**
+   * Horizon of each formula, which is the number of the most recent frames in the
+   * buffer that it is evaluated on.
+   */
+  std::vector<size_t> horizons;
+  size_t max_horizon;
+  double universe_x, universe_y;
+
+  std::unique_ptr<details::ThreadPool> pool;
+  std::unique_ptr<details::IncrementalEngine> engine;
+  std::unique_ptr<details::CandidateFilter> filter;
+};
+
+/**
+ * Online monitor for one formula on many independent streams of frames, e.g., one per
+ * camera feed.
+ *
+ * The formula is compiled once, and the state of each stream (its frame buffer and, for
+ * `EvalStrategy::Incremental`, its table of subformula values) is kept in one contiguous
+ * array. Frames are added to all the streams at once, and `eval_all` computes the
+ * robustness for all of them, spreading the streams over `options.num_threads` threads.
+ * Quantifiers within a stream are evaluated serially.
+ */
+class MultiStreamMonitor {
+ public:
+  MultiStreamMonitor() = delete;
+  MultiStreamMonitor(
+      ast::Expr phi_,
+      size_t num_streams,
+      double fps_,
+      double x_boundary,
+      double y_boundary,
+      MonitorOptions options_ = {});
+
+  MultiStreamMonitor(MultiStreamMonitor&&) noexcept;
+  ~MultiStreamMonitor();
+
+  /**
+   * Add the `i`th frame to the `i`th stream.
+   *
+   * @throws std::invalid_argument if there isn't exactly one frame per stream.
+   */
+  void add_frames(const std::vector<datastream::Frame>& frames);
+  void add_frames(const std::vector<datastream::TrackedFrame>& frames);
+
+  /**
+   * Add a frame to a single stream, for when the streams aren't in lockstep.
+   */
+  void add_frame(size_t stream, const datastream::Frame& frame);
+  void add_frame(size_t stream, const datastream::TrackedFrame& frame);
+  void add_frame(size_t stream, const datastream::FrameView& frame);
+
+  /**
+   * Compute the robustness of the currently buffered frames of each stream. Each stream
+   * must have at least one frame.
+   */
+  std::vector<double> eval_all();
+
+  [[nodiscard]] size_t num_streams() const;
+  [[nodiscard]] size_t get_max_horizon() const { return max_horizon; }
+  [[nodiscard]] const ast::Expr& get_phi() const { return phi; }
+  [[nodiscard]] const Program& get_program() const { return program; }
+  [[nodiscard]] const MonitorOptions& get_options() const { return options; }
+
+ private:
+  const ast::Expr phi;
+  const Program program;
+  const double fps;
+  const MonitorOptions options;
+
+  size_t max_horizon;
+  double universe_x, universe_y;
+
+  std::vector<details::StreamState> streams;
+  /**
+   * Workers that evaluate the streams, if `options.num_threads != 1`
+   */
+  std::unique_ptr<details::ThreadPool> pool;
+  std::unique_ptr<details::CandidateFilter> filter;
+};
+
+/**
+ * Compute the robustness signal of a recorded trace offline, i.e., the `i`th value is
+ * what `OnlineMonitor::eval` returns after the first `i + 1` frames are added.
+ *
+ * The trace is split into chunks that are evaluated in parallel on
+ * `options.num_threads` threads, where each chunk first replays the frames in the
+ * horizon before it. Quantifiers within a chunk are evaluated serially.
+ *
+ * @throws std::invalid_argument if the formula doesn't have a bounded horizon.
+ */
+std::vector<double> evaluate_trace(
+    const ast::Expr& phi,
+    const std::vector<datastream::Frame>& trace,
+    double fps,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options = {});
+std::vector<double> evaluate_trace(
+    const ast::Expr& phi,
+    const std::vector<datastream::TrackedFrame>& trace,
+    double fps,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options = {});
+/**
+ * Compute the robustness signal of a trace of frame views, e.g., of a memory-mapped
+ * binary trace (see `io::TraceReader::views`).
+ */
+std::vector<double> evaluate_trace(
+    const ast::Expr& phi,
+    const std::vector<datastream::FrameView>& trace,
+    double fps,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options = {});
+
 } // namespace percemon::monitoring
 
 #endif /* end of include guard: __PERCEMON_MONITORING_HPP__ */
@@ -5,6 +5,7 @@
 
 #include "percemon/ast.hpp"
 #include "percemon/datastream.hpp"
+#include "percemon/io.hpp"
 #include "percemon/monitoring.hpp"
 
 #endif /* end of include guard: __PERCEMON_PERCEMON_HPP__ */
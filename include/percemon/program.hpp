@@ -0,0 +1,226 @@
+/**
+ * A compiled representation of STQL formulas that is used by the monitors.
+ *
+ * The AST of a formula is lowered into a contiguous array of instructions in
+ * post-order, i.e., the operands of an instruction always appear before it in the
+ * array and the last instruction computes the value of the formula. Variables are
+ * resolved to integer slots, and the comparison operators are resolved to the kernels
+ * specialised for them when the program is run, so evaluating the program doesn't need
+ * to traverse shared pointers or look up variables by name.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_PROGRAM_HPP__
+#define __PERCEMON_PROGRAM_HPP__
+
+#include "percemon/ast.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace percemon::monitoring {
+
+enum class OpCode : std::uint8_t {
+  // Primitives and leaf predicates
+  Const,
+  TimeBound,
+  FrameBound,
+  CompareId,
+  CompareClass,
+  CompareProb,
+  CompareArea,
+  CompareLat,
+  CompareLon,
+  CompareED,
+  // Quantitative (robustness valued) operators
+  Exists,
+  Forall,
+  Not,
+  And,
+  Or,
+  Previous,
+  Always,
+  Sometimes,
+  Since,
+  BackTo,
+  CompareSpArea,
+  SpExists,
+  SpForall,
+  // Spatial (region valued) operators
+  EmptySet,
+  UniverseSet,
+  BBox,
+  Complement,
+  Intersect,
+  Union,
+  Interior,
+  Closure,
+  SpPrevious,
+  SpAlways,
+  SpSometimes,
+  SpSince,
+  SpBackTo,
+};
+
+/**
+ * Check if the instruction computes a region, rather than a robustness value.
+ */
+constexpr bool is_spatial(OpCode op) { return op >= OpCode::EmptySet; }
+
+/**
+ * A range of indices in `Program::operands`.
+ */
+struct OperandRange {
+  std::uint32_t offset = 0;
+  std::uint32_t size   = 0;
+};
+
+struct Instruction {
+  OpCode op;
+  /**
+   * The comparison in leaf predicates and CompareSpArea.
+   */
+  ast::ComparisonOp relation = ast::ComparisonOp::EQ;
+
+  /**
+   * Indices of the operands of the instruction in the program.
+   *
+   * For And and Or, the operands are ordered by increasing `cost`, so the TimeBound and
+   * FrameBound operands appear first.
+   */
+  OperandRange args = {};
+  /**
+   * Slots of the ID variables that are bound by a quantifier, or that are referenced by
+   * a leaf predicate (in the order `lhs`, `rhs`). If the RHS of a comparison is a
+   * literal, only the slot for the LHS is present.
+   */
+  OperandRange ids = {};
+  /**
+   * Slots of the ID variables that the value of the instruction depends on, in
+   * increasing order.
+   */
+  OperandRange free_ids = {};
+
+  /**
+   * Slot of the Var_x in a TimeBound or the Var_f in a FrameBound.
+   */
+  std::uint32_t var = 0;
+  /**
+   * Constant operand of the instruction:
+   *
+   * - Const: the robustness of the constant (`+inf` or `-inf`).
+   * - TimeBound and FrameBound: the bound.
+   * - Comparisons: the literal on the RHS, if any.
+   */
+  double constant = 0.0;
+  /**
+   * The reference points and multipliers for the object attributes in CompareProb,
+   * CompareArea, CompareLat, and CompareLon.
+   */
+  ast::CRT lhs_crt = ast::CRT::CT, rhs_crt = ast::CRT::CT;
+  double lhs_scale = 1.0, rhs_scale = 1.0;
+  /**
+   * Interval for the bounded Always and Sometimes, and the spatial temporal operators.
+   */
+  std::optional<ast::FrameInterval> interval = {};
+
+  /**
+   * If the value of the instruction at a frame depends only on that frame and the
+   * objects bound to `free_ids`.
+   */
+  bool frame_local = false;
+  /**
+   * A rough estimate of the cost of evaluating the instruction at a frame, relative to
+   * the cost of evaluating a leaf predicate.
+   */
+  double cost = 1.0;
+};
+
+struct Program {
+  /**
+   * A view over a range of operands.
+   */
+  struct Operands {
+    const size_t* first;
+    const size_t* last;
+
+    [[nodiscard]] const size_t* begin() const { return first; }
+    [[nodiscard]] const size_t* end() const { return last; }
+    [[nodiscard]] size_t size() const { return static_cast<size_t>(last - first); }
+    [[nodiscard]] bool empty() const { return first == last; }
+    size_t operator[](size_t i) const { return first[i]; }
+  };
+
+  /**
+   * Instructions in post-order.
+   */
+  std::vector<Instruction> code;
+  /**
+   * Storage for the `args`, `ids`, and `free_ids` of the instructions.
+   */
+  std::vector<size_t> operands;
+
+  /**
+   * Index of the instruction that computes the value of each formula in the program.
+   */
+  std::vector<size_t> roots;
+
+  /**
+   * Names of the ID, time, and frame variables assigned to each slot. ID slots are
+   * assigned to the variables of each formula in the order in which they are
+   * quantified, and are named after the first formula that uses them.
+   */
+  std::vector<std::string> id_slots, time_slots, frame_slots;
+
+  /**
+   * The subformula each instruction was compiled from, which is used to annotate
+   * reports about the instructions (e.g., `format_profile`). An instruction shared by
+   * several subformulas records the first one that was compiled.
+   */
+  using Source =
+      std::variant<std::monostate, ast::Expr, ast::TemporalBoundExpr, ast::SpatialExpr>;
+  std::vector<Source> sources;
+
+  /**
+   * The instruction computing the value of the (first) formula.
+   */
+  [[nodiscard]] size_t root() const { return roots.front(); }
+
+  [[nodiscard]] Operands args(const Instruction& ins) const { return get(ins.args); }
+  [[nodiscard]] Operands ids(const Instruction& ins) const { return get(ins.ids); }
+  [[nodiscard]] Operands free_ids(const Instruction& ins) const {
+    return get(ins.free_ids);
+  }
+
+ private:
+  [[nodiscard]] Operands get(OperandRange range) const {
+    const size_t* first = operands.data() + range.offset;
+    return Operands{first, first + range.size};
+  }
+};
+
+/**
+ * Compile the formula into a program.
+ *
+ * @throws std::invalid_argument if an ID variable is quantified multiple times, if the
+ * formula references an unbound ID variable or a time or frame variable that isn't
+ * pinned, or if a quantifier doesn't have a subformula.
+ */
+Program compile(const ast::Expr& phi);
+
+/**
+ * Compile several formulas into one program, with a root for each formula (in the same
+ * order). Structurally equal subformulas are compiled to the same instruction, so they
+ * are only evaluated once for all the formulas.
+ *
+ * @throws std::invalid_argument under the same conditions as compiling each formula.
+ */
+Program compile(const std::vector<ast::Expr>& phis);
+
+} // namespace percemon::monitoring
+
+#endif /* end of include guard: __PERCEMON_PROGRAM_HPP__ */
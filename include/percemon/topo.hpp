@@ -9,9 +9,11 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
+#include <iterator>
 #include <memory>
-#include <set>
+#include <memory_resource>
 #include <variant>
 #include <vector>
 
@@ -92,6 +94,55 @@ struct BoundingBox {
   }
 };
 
+/**
+ * Memory resource that the TopoUnions created on the current thread allocate from.
+ *
+ * This is the thread-local arena while an ArenaScope is active on the thread, and
+ * `std::pmr::new_delete_resource()` otherwise.
+ */
+std::pmr::memory_resource* region_resource();
+
+/**
+ * Number of allocations made from the arena of the current thread so far, which is
+ * only counted when the library is built with `PERCEMON_PROFILING` (and is 0
+ * otherwise).
+ */
+size_t arena_allocations();
+
+/**
+ * While an ArenaScope is alive, the TopoUnions created on the current thread allocate
+ * from a thread-local arena.
+ *
+ * Deallocating from the arena is a no-op, and the arena is reset wholesale when the
+ * outermost scope on the thread ends, so the regions created in the scope must not
+ * outlive it. Regions that need to be kept should be created in a nested HeapScope.
+ */
+class ArenaScope {
+ public:
+  ArenaScope();
+  ~ArenaScope();
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  std::pmr::memory_resource* previous;
+};
+
+/**
+ * While a HeapScope is alive, the TopoUnions created on the current thread allocate from
+ * the heap, even if an ArenaScope is active.
+ */
+class HeapScope {
+ public:
+  HeapScope();
+  ~HeapScope();
+  HeapScope(const HeapScope&) = delete;
+  HeapScope& operator=(const HeapScope&) = delete;
+
+ private:
+  std::pmr::memory_resource* previous;
+};
+
 struct TopoUnion {
   struct BBoxCmp {
     constexpr bool operator()(const BoundingBox& a, const BoundingBox& b) const {
@@ -110,41 +161,62 @@ struct TopoUnion {
     }
   };
 
-  using Set             = std::set<BoundingBox, BBoxCmp>;
+  /**
+   * The boxes are kept in a flat vector, sorted by `BBoxCmp` and without duplicates.
+   * The storage is taken from `region_resource()` when the union is created (or
+   * copied), and stays with the union when it is moved.
+   */
+  using Set             = std::pmr::vector<BoundingBox>;
   using value_type      = BoundingBox;
-  using reference       = BoundingBox&;
+  using reference       = const BoundingBox&;
   using const_reference = const BoundingBox&;
-  using iterator        = Set::iterator;
+  // Boxes can't be modified in place, as that could break the ordering.
+  using iterator        = Set::const_iterator;
   using const_iterator  = Set::const_iterator;
   using difference_type = Set::difference_type;
   using size_type       = Set::size_type;
 
-  TopoUnion()                 = default;
-  TopoUnion(const TopoUnion&) = default;
-  TopoUnion(TopoUnion&&)      = default;
+  TopoUnion() : regions{region_resource()} {}
+  TopoUnion(const TopoUnion& other) : regions{other.regions, region_resource()} {}
+  TopoUnion(TopoUnion&&) noexcept = default;
   TopoUnion& operator=(const TopoUnion&) = default;
   TopoUnion& operator=(TopoUnion&&) = default;
 
   template <typename Iter>
-  TopoUnion(Iter first, Iter last) : regions{first, last} {};
+  TopoUnion(Iter first, Iter last) : regions{first, last, region_resource()} {
+    // Like a std::set, keep the first of the boxes that compare equal.
+    std::stable_sort(regions.begin(), regions.end(), BBoxCmp{});
+    regions.erase(
+        std::unique(
+            regions.begin(),
+            regions.end(),
+            [](const BoundingBox& a, const BoundingBox& b) { return !BBoxCmp{}(a, b); }),
+        regions.end());
+  }
 
-  void insert(BoundingBox bbox) { regions.insert(bbox); }
+  void insert(const BoundingBox& bbox) {
+    const auto it = std::lower_bound(regions.begin(), regions.end(), bbox, BBoxCmp{});
+    if (it == regions.end() || BBoxCmp{}(bbox, *it)) { regions.insert(it, bbox); }
+  }
   void merge(const TopoUnion& other) {
-    std::merge(
+    if (other.regions.empty()) { return; }
+    auto merged = Set{regions.get_allocator()};
+    merged.reserve(regions.size() + other.regions.size());
+    std::set_union(
         regions.begin(),
         regions.end(),
         other.begin(),
         other.end(),
-        std::inserter(regions, regions.begin()),
+        std::back_inserter(merged),
         BBoxCmp{});
+    regions = std::move(merged);
   }
 
-  iterator begin() { return regions.begin(); }
   [[nodiscard]] const_iterator begin() const { return regions.begin(); }
-  iterator end() { return regions.end(); }
   [[nodiscard]] const_iterator end() const { return regions.end(); }
 
-  auto size() { return regions.size(); }
+  [[nodiscard]] size_type size() const { return regions.size(); }
+  [[nodiscard]] bool empty() const { return regions.empty(); }
 
  private:
   Set regions;
@@ -164,8 +236,73 @@ Region spatial_intersect(const std::vector<Region>&);
 Region spatial_union(const Region& lhs, const Region& rhs);
 Region spatial_union(const std::vector<Region>&);
 
+/**
+ * Simplify a union of boxes into pairwise disjoint boxes, using `decompose`.
+ */
 Region simplify_region(const Region& region);
 
+/**
+ * Area covered by the union of boxes, where overlapping areas are counted once.
+ *
+ * This sweeps a vertical line over the edges of the boxes with a segment tree over the y
+ * coordinates, and runs in O(n log n) time for n boxes.
+ */
+double union_area(const TopoUnion& region);
+
+/**
+ * Decompose the union into boxes with pairwise disjoint interiors that cover the same
+ * set. The result has a box for each maximal y interval covered in a vertical slab
+ * between box edges, and boxes in adjacent slabs with the same cover are joined.
+ *
+ * The boxes in the result are closed, and boxes with no area are dropped.
+ */
+TopoUnion decompose(const TopoUnion& region);
+
+// Batch kernels
+//
+// These work on boxes in struct-of-arrays form, and use AVX2 (selected at runtime on
+// x86) or NEON (on AArch64) when available, and a scalar loop otherwise. The spatial
+// operators switch to them for unions with more than a handful of boxes.
+
+/**
+ * Bounds of a collection of boxes, in struct-of-arrays form. The open and closed
+ * boundaries of the boxes are not stored.
+ */
+struct BoxArrays {
+  std::pmr::vector<double> xmin, xmax, ymin, ymax;
+
+  BoxArrays() :
+      xmin{region_resource()},
+      xmax{region_resource()},
+      ymin{region_resource()},
+      ymax{region_resource()} {}
+  explicit BoxArrays(const TopoUnion& region);
+
+  [[nodiscard]] size_t size() const { return xmin.size(); }
+  void resize(size_t n);
+  void push_back(const BoundingBox& bbox);
+};
+
+/**
+ * Compute the area of each box into `out`, which must hold `boxes.size()` values.
+ */
+void batch_areas(const BoxArrays& boxes, double* out);
+
+/**
+ * Intersect `bbox` with each of the `boxes`.
+ *
+ * The bounds of the intersections are written to `out`, which is resized to the number
+ * of boxes, and `mask[i]` is set to 1 if the `i`th intersection is nonempty, and 0
+ * otherwise, so `mask` must hold `boxes.size()` values. The bounds of empty
+ * intersections are unspecified. The boxes are assumed to have `xmin <= xmax` and `ymin
+ * <= ymax`.
+ */
+void batch_intersect(
+    const BoundingBox& bbox,
+    const BoxArrays& boxes,
+    BoxArrays& out,
+    std::uint8_t* mask);
+
 } // namespace percemon::topo
 
 #endif /* end of include guard: __PERCEMON_TOPO_HPP__ */
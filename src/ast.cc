@@ -360,10 +360,16 @@ ast::PreviousPtr Previous(const Expr& arg) {
 }
 
 ast::AlwaysPtr Always(const Expr& arg) { return std::make_shared<ast::Always>(arg); }
+ast::AlwaysPtr Always(const FrameInterval& i, const Expr& arg) {
+  return std::make_shared<ast::Always>(i, arg);
+}
 
 ast::SometimesPtr Sometimes(const Expr& arg) {
   return std::make_shared<ast::Sometimes>(arg);
 }
+ast::SometimesPtr Sometimes(const FrameInterval& i, const Expr& arg) {
+  return std::make_shared<ast::Sometimes>(i, arg);
+}
 
 ast::SincePtr Since(const Expr& a, const Expr& b) {
   return std::make_shared<ast::Since>(a, b);
@@ -0,0 +1,688 @@
+#include "percemon/io.hpp"
+#include "percemon/fmt.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#define PERCEMON_IO_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace percemon::io;
+namespace ds = percemon::datastream;
+
+namespace {
+
+/**
+ * A file mapped into memory (read only).
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+#if defined(PERCEMON_IO_MMAP)
+    if (addr != nullptr) { ::munmap(addr, length); }
+#endif
+  }
+
+  /**
+   * Map the file, or return false if it can't be mapped.
+   */
+  bool map(const std::string& path) {
+#if defined(PERCEMON_IO_MMAP)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st = {};
+    // Without the size (or for pipes and other special files, which report no size)
+    // the file is read in chunks instead.
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return false;
+    }
+    if (st.st_size <= 0) {
+      ::close(fd);
+      // Empty files can't be mapped, but there is nothing to read anyway.
+      return st.st_size == 0;
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void* ptr       = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) { return false; }
+    ::madvise(ptr, size, MADV_SEQUENTIAL);
+    addr   = ptr;
+    length = size;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+  }
+
+  [[nodiscard]] const char* data() const { return static_cast<const char*>(addr); }
+  [[nodiscard]] size_t size() const { return length; }
+
+ private:
+  void* addr    = nullptr;
+  size_t length = 0;
+};
+
+} // namespace
+
+/**
+ * The lines of a file, which is either memory-mapped or read in chunks.
+ */
+struct MotReader::Source {
+  MappedFile mapped;
+  /**
+   * The unconsumed part of the mapped file.
+   */
+  std::string_view rest;
+
+  // Chunked reads, where `chunk[pos, end)` hasn't been consumed yet.
+  std::ifstream file;
+  std::vector<char> chunk;
+  size_t pos = 0, end = 0;
+
+  Source(const std::string& path, const MotOptions& options) {
+    if (options.memory_map && mapped.map(path)) {
+      rest = std::string_view{mapped.data(), mapped.size()};
+      return;
+    }
+    file.open(path, std::ios::binary);
+    if (!file) {
+      throw std::invalid_argument(fmt::format("Could not open the file {}.", path));
+    }
+    chunk.resize(std::max<size_t>(options.chunk_size, 1));
+  }
+
+  /**
+   * Get the next line, without the line terminator.
+   */
+  bool next_line(std::string_view& line) {
+    if (!file.is_open()) {
+      if (rest.empty()) { return false; }
+      const size_t nl = rest.find('\n');
+      line            = rest.substr(0, nl);
+      rest = (nl == std::string_view::npos) ? std::string_view{} : rest.substr(nl + 1);
+      return true;
+    }
+    // Number of bytes after `pos` that don't have a line terminator.
+    size_t scanned = 0;
+    while (true) {
+      const char* first = chunk.data() + pos + scanned;
+      const auto nl =
+          static_cast<const char*>(std::memchr(first, '\n', end - pos - scanned));
+      if (nl != nullptr) {
+        const auto last = static_cast<size_t>(nl - chunk.data());
+        line            = std::string_view{chunk.data() + pos, last - pos};
+        pos             = last + 1;
+        return true;
+      }
+      scanned = end - pos;
+      if (!fill()) {
+        // The last line doesn't have a line terminator.
+        if (pos == end) { return false; }
+        line = std::string_view{chunk.data() + pos, end - pos};
+        pos  = end;
+        return true;
+      }
+    }
+  }
+
+ private:
+  /**
+   * Read more of the file after the unconsumed bytes, moving them to the front of the
+   * chunk (and growing it if they fill the chunk).
+   */
+  bool fill() {
+    if (pos > 0) {
+      std::memmove(chunk.data(), chunk.data() + pos, end - pos);
+      end -= pos;
+      pos = 0;
+    }
+    if (end == chunk.size()) { chunk.resize(2 * chunk.size()); }
+    if (!file) { return false; }
+    file.read(chunk.data() + end, static_cast<std::streamsize>(chunk.size() - end));
+    const auto count = static_cast<size_t>(file.gcount());
+    end += count;
+    return count > 0;
+  }
+};
+
+namespace {
+
+std::string_view trim(std::string_view str) {
+  const auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+  while (!str.empty() && is_space(str.front())) { str.remove_prefix(1); }
+  while (!str.empty() && is_space(str.back())) { str.remove_suffix(1); }
+  return str;
+}
+
+/**
+ * Split off the next comma-separated field of the line.
+ */
+std::string_view next_field(std::string_view& line) {
+  const size_t comma = line.find(',');
+  const auto field   = trim(line.substr(0, comma));
+  line = (comma == std::string_view::npos) ? std::string_view{} : line.substr(comma + 1);
+  return field;
+}
+
+template <typename T>
+bool parse_number(std::string_view field, T& value) {
+  if constexpr (std::is_floating_point_v<T>) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto last      = field.data() + field.size();
+    const auto [ptr, ec] = std::from_chars(field.data(), last, value);
+    return ec == std::errc{} && ptr == last;
+#else
+    // std::from_chars for floating point numbers isn't available in older standard
+    // libraries, and strtod needs a null terminated string.
+    char buf[64];
+    if (field.empty() || field.size() >= sizeof(buf)) { return false; }
+    std::memcpy(buf, field.data(), field.size());
+    buf[field.size()] = '\0';
+    char* last        = nullptr;
+    value             = std::strtod(buf, &last);
+    return last == buf + field.size();
+#endif
+  } else {
+    const auto last      = field.data() + field.size();
+    const auto [ptr, ec] = std::from_chars(field.data(), last, value);
+    return ec == std::errc{} && ptr == last;
+  }
+}
+
+size_t to_pixels(double x) { return static_cast<size_t>(std::max(0.0, x)); }
+
+/**
+ * Copy the view into the frame, reusing its storage.
+ */
+void to_tracked(const ds::FrameView& view, ds::TrackedFrame& frame) {
+  frame.timestamp = view.timestamp;
+  frame.frame_num = view.frame_num;
+  frame.size_x    = view.size_x;
+  frame.size_y    = view.size_y;
+  frame.objects.clear();
+  for (size_t i = 0; i < view.num_objects; i++) {
+    frame.objects.insert_or_assign(
+        view.ids[i], ds::Object{view.object_class[i], view.probability[i], view.bbox[i]});
+  }
+}
+
+} // namespace
+
+MotReader::MotReader(const std::string& file, MotOptions options_) :
+    options{options_}, source{std::make_unique<Source>(file, options)} {}
+
+MotReader::MotReader(MotReader&&) noexcept = default;
+MotReader::~MotReader()                    = default;
+
+bool MotReader::read_row() {
+  auto line = std::string_view{};
+  while (this->source->next_line(line)) {
+    this->line_num++;
+    if (trim(line).empty()) { continue; }
+
+    size_t frame       = 0;
+    std::int64_t track = 0;
+    double bb_left = 0, bb_top = 0, bb_width = 0, bb_height = 0, confidence = 0;
+    const bool ok = parse_number(next_field(line), frame) &&
+                    parse_number(next_field(line), track) &&
+                    parse_number(next_field(line), bb_left) &&
+                    parse_number(next_field(line), bb_top) &&
+                    parse_number(next_field(line), bb_width) &&
+                    parse_number(next_field(line), bb_height) &&
+                    parse_number(next_field(line), confidence);
+    if (!ok) {
+      throw std::invalid_argument(
+          fmt::format("Malformed MOT row at line {}.", this->line_num));
+    }
+    // Detections that aren't assigned to a track are each a distinct object.
+    const auto id = (track >= 0) ? static_cast<ds::TrackId>(track)
+                                 : FIRST_UNASSIGNED_ID + this->num_unassigned++;
+    this->pending = Row{
+        frame,
+        id,
+        confidence,
+        ds::BoundingBox{
+            to_pixels(bb_left),
+            to_pixels(bb_left + bb_width),
+            to_pixels(bb_top),
+            to_pixels(bb_top + bb_height)}};
+    return true;
+  }
+  return false;
+}
+
+bool MotReader::next(ds::FrameView& frame) {
+  if (!this->has_pending) { this->has_pending = this->read_row(); }
+  if (!this->has_pending) { return false; }
+  if (this->pending.frame < this->frame_num) {
+    throw std::invalid_argument(fmt::format(
+        "Row at line {} is for frame {}, but the frames must be in increasing order (starting at 1).",
+        this->line_num,
+        this->pending.frame));
+  }
+
+  this->ids.clear();
+  this->object_class.clear();
+  this->probability.clear();
+  this->bbox.clear();
+  // Frames before the frame of the pending row don't have any objects.
+  while (this->has_pending && this->pending.frame == this->frame_num) {
+    this->ids.push_back(this->pending.id);
+    this->object_class.push_back(this->options.object_class);
+    this->probability.push_back(this->pending.confidence);
+    this->bbox.push_back(this->pending.bbox);
+    this->has_pending = this->read_row();
+  }
+  this->keep_last_rows();
+
+  frame = ds::FrameView{
+      static_cast<double>(this->frame_num - 1) / this->options.fps,
+      this->frame_num,
+      this->options.frame_width,
+      this->options.frame_height,
+      this->ids.size(),
+      this->ids.data(),
+      this->object_class.data(),
+      this->probability.data(),
+      this->bbox.data()};
+  this->frame_num++;
+  return true;
+}
+
+void MotReader::keep_last_rows() {
+  // Sorted by ID and then by row, so that the last row of an ID ends its run.
+  this->order.clear();
+  for (size_t i = 0; i < this->ids.size(); i++) {
+    this->order.emplace_back(this->ids[i], i);
+  }
+  std::sort(this->order.begin(), this->order.end());
+  const auto same_id = [](const auto& a, const auto& b) { return a.first == b.first; };
+  if (std::adjacent_find(this->order.begin(), this->order.end(), same_id) ==
+      this->order.end()) {
+    return;
+  }
+
+  this->replaced.assign(this->ids.size(), false);
+  for (size_t k = 0; k + 1 < this->order.size(); k++) {
+    if (this->order[k].first == this->order[k + 1].first) {
+      this->replaced[this->order[k].second] = true;
+    }
+  }
+  size_t n = 0;
+  for (size_t i = 0; i < this->ids.size(); i++) {
+    if (this->replaced[i]) { continue; }
+    this->ids[n]          = this->ids[i];
+    this->object_class[n] = this->object_class[i];
+    this->probability[n]  = this->probability[i];
+    this->bbox[n]         = this->bbox[i];
+    n++;
+  }
+  this->ids.resize(n);
+  this->object_class.resize(n);
+  this->probability.resize(n);
+  this->bbox.resize(n);
+}
+
+bool MotReader::next(ds::TrackedFrame& frame) {
+  auto view = ds::FrameView{};
+  if (!this->next(view)) { return false; }
+  to_tracked(view, frame);
+  return true;
+}
+
+std::vector<ds::TrackedFrame>
+percemon::io::read_mot(const std::string& file, MotOptions options) {
+  auto reader = MotReader{file, options};
+  auto ret    = std::vector<ds::TrackedFrame>{};
+  // The rows are bucketed by their frame, so they don't need to be in frame order.
+  while (reader.read_row()) {
+    const auto& row = reader.pending;
+    if (row.frame == 0) {
+      throw std::invalid_argument(fmt::format(
+          "Row at line {} is for frame 0, but the frames are numbered from 1.",
+          reader.line_num));
+    }
+    while (ret.size() < row.frame) {
+      const size_t frame_num = ret.size() + 1;
+      ret.push_back(ds::TrackedFrame{
+          static_cast<double>(frame_num - 1) / options.fps,
+          frame_num,
+          options.frame_width,
+          options.frame_height,
+          {}});
+    }
+    ret[row.frame - 1].objects.insert_or_assign(
+        row.id, ds::Object{options.object_class, row.confidence, row.bbox});
+  }
+  return ret;
+}
+
+// Binary traces
+
+namespace {
+
+// The columns of a memory-mapped trace are used in place.
+static_assert(sizeof(ds::TrackId) == 8);
+static_assert(sizeof(int) == 4, "binary traces store the classes as int32");
+static_assert(
+    sizeof(ds::BoundingBox) == 4 * sizeof(std::uint64_t),
+    "binary traces store the bounding boxes as 4 x uint64");
+
+constexpr char TRACE_MAGIC[8]            = {'P', 'M', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr std::uint32_t TRACE_VERSION    = 1;
+constexpr std::uint32_t TRACE_BYTE_ORDER = 0x01020304;
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  double fps;
+  std::uint64_t frame_width, frame_height, num_frames;
+};
+
+struct RecordHeader {
+  double timestamp;
+  std::uint64_t frame_num;
+  std::uint64_t num_objects;
+  /**
+   * Size of the record in bytes, including this header.
+   */
+  std::uint64_t size;
+};
+
+constexpr size_t NUM_FRAMES_OFFSET = offsetof(FileHeader, num_frames);
+
+/**
+ * Number of zero bytes after the classes of `n` objects, to align the next record.
+ */
+constexpr size_t class_padding(size_t n) { return (8 - (n * sizeof(int)) % 8) % 8; }
+
+/**
+ * Size of the columns of an object in a record, without the padding.
+ */
+constexpr size_t OBJECT_SIZE =
+    sizeof(ds::TrackId) + sizeof(double) + sizeof(ds::BoundingBox) + sizeof(int);
+
+/**
+ * Size of the record of a frame with `n` objects.
+ */
+constexpr size_t record_size(size_t n) {
+  return sizeof(RecordHeader) +
+         n * (sizeof(ds::TrackId) + sizeof(double) + sizeof(ds::BoundingBox)) +
+         n * sizeof(int) + class_padding(n);
+}
+
+} // namespace
+
+struct TraceWriter::Sink {
+  std::ofstream file;
+  size_t num_frames = 0;
+
+  // Scratch space for the columns of frames that aren't views.
+  std::vector<ds::TrackId> ids;
+  std::vector<int> object_class;
+  std::vector<double> probability;
+  std::vector<ds::BoundingBox> bbox;
+
+  void clear() {
+    ids.clear();
+    object_class.clear();
+    probability.clear();
+    bbox.clear();
+  }
+
+  void push_back(ds::TrackId id, const ds::Object& obj) {
+    ids.push_back(id);
+    object_class.push_back(obj.object_class);
+    probability.push_back(obj.probability);
+    bbox.push_back(obj.bbox);
+  }
+
+  template <typename FrameT>
+  [[nodiscard]] ds::FrameView view(const FrameT& frame) const {
+    return ds::FrameView{
+        frame.timestamp,
+        frame.frame_num,
+        frame.size_x,
+        frame.size_y,
+        ids.size(),
+        ids.data(),
+        object_class.data(),
+        probability.data(),
+        bbox.data()};
+  }
+
+  void write(const void* ptr, size_t size) {
+    file.write(static_cast<const char*>(ptr), static_cast<std::streamsize>(size));
+  }
+};
+
+TraceWriter::TraceWriter(const std::string& file, TraceHeader header_) :
+    header{header_}, sink{std::make_unique<Sink>()} {
+  this->header.num_frames = 0;
+  this->sink->file.open(file, std::ios::binary | std::ios::trunc);
+  if (!this->sink->file) {
+    throw std::invalid_argument(fmt::format("Could not create the file {}.", file));
+  }
+  auto file_header = FileHeader{
+      {},
+      TRACE_VERSION,
+      TRACE_BYTE_ORDER,
+      this->header.fps,
+      this->header.frame_width,
+      this->header.frame_height,
+      0};
+  std::memcpy(file_header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  this->sink->write(&file_header, sizeof(file_header));
+}
+
+TraceWriter::TraceWriter(TraceWriter&&) noexcept = default;
+
+TraceWriter::~TraceWriter() {
+  try {
+    this->close();
+  } catch (...) {
+    // Destructors can't throw, and the file is unusable anyway.
+  }
+}
+
+void TraceWriter::add_frame(const ds::FrameView& frame) {
+  const size_t n    = frame.num_objects;
+  const auto record = RecordHeader{frame.timestamp, frame.frame_num, n, record_size(n)};
+  auto& out         = *(this->sink);
+  out.write(&record, sizeof(record));
+  out.write(frame.ids, n * sizeof(ds::TrackId));
+  out.write(frame.probability, n * sizeof(double));
+  out.write(frame.bbox, n * sizeof(ds::BoundingBox));
+  out.write(frame.object_class, n * sizeof(int));
+  const std::uint64_t zeros = 0;
+  out.write(&zeros, class_padding(n));
+  if (!out.file) { throw std::runtime_error("Could not write to the binary trace."); }
+  out.num_frames++;
+}
+
+void TraceWriter::add_frame(const ds::TrackedFrame& frame) {
+  this->sink->clear();
+  for (const auto& [id, obj] : frame.objects) { this->sink->push_back(id, obj); }
+  this->add_frame(this->sink->view(frame));
+}
+
+void TraceWriter::add_frame(const ds::Frame& frame) {
+  this->sink->clear();
+  for (const auto& [name, obj] : frame.objects) {
+    auto id = ds::TrackId{};
+    if (!parse_number(std::string_view{name}, id)) {
+      throw std::invalid_argument(fmt::format(
+          "Object ID \"{}\" can't be stored in a binary trace, as it isn't an integer.",
+          name));
+    }
+    this->sink->push_back(id, obj);
+  }
+  this->add_frame(this->sink->view(frame));
+}
+
+void TraceWriter::close() {
+  if (!this->sink || !this->sink->file.is_open()) { return; }
+  auto& out               = *(this->sink);
+  this->header.num_frames = out.num_frames;
+  const auto num_frames   = static_cast<std::uint64_t>(out.num_frames);
+  out.file.seekp(static_cast<std::streamoff>(NUM_FRAMES_OFFSET));
+  out.write(&num_frames, sizeof(num_frames));
+  out.file.close();
+  if (!out.file) { throw std::runtime_error("Could not write to the binary trace."); }
+}
+
+struct TraceReader::Data {
+  MappedFile mapped;
+  /**
+   * The contents of the file, if it isn't mapped, in 8-byte words so that the columns
+   * are aligned.
+   */
+  std::vector<std::uint64_t> owned;
+
+  const char* base = nullptr;
+  size_t size      = 0;
+};
+
+TraceReader::TraceReader(const std::string& file, bool memory_map) :
+    data{std::make_unique<Data>()} {
+  auto& d = *(this->data);
+  if (memory_map && d.mapped.map(file)) {
+    d.base = d.mapped.data();
+    d.size = d.mapped.size();
+  } else {
+    auto in = std::ifstream{file, std::ios::binary};
+    if (!in) {
+      throw std::invalid_argument(fmt::format("Could not open the file {}.", file));
+    }
+    // The size of a stream that isn't a regular file isn't meaningful (e.g., it is the
+    // largest offset for a directory).
+    auto error       = std::error_code{};
+    const auto bytes = std::filesystem::file_size(file, error);
+    if (error) {
+      throw std::invalid_argument(fmt::format("Could not read the file {}.", file));
+    }
+    d.size = static_cast<size_t>(bytes);
+    d.owned.resize((d.size + 7) / 8);
+    in.read(
+        reinterpret_cast<char*>(d.owned.data()), static_cast<std::streamsize>(d.size));
+    if (!in || in.gcount() != static_cast<std::streamsize>(d.size)) {
+      throw std::invalid_argument(fmt::format("Could not read the file {}.", file));
+    }
+    d.base = reinterpret_cast<const char*>(d.owned.data());
+  }
+
+  auto file_header = FileHeader{};
+  if (d.size >= sizeof(FileHeader)) {
+    std::memcpy(&file_header, d.base, sizeof(FileHeader));
+  }
+  if (d.size < sizeof(FileHeader) ||
+      std::memcmp(file_header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+    throw std::invalid_argument(fmt::format("{} isn't a binary trace.", file));
+  }
+  if (file_header.version != TRACE_VERSION ||
+      file_header.byte_order != TRACE_BYTE_ORDER) {
+    throw std::invalid_argument(fmt::format(
+        "Binary trace {} has an unsupported version or byte order.", file));
+  }
+  this->header = TraceHeader{
+      file_header.fps,
+      static_cast<size_t>(file_header.frame_width),
+      static_cast<size_t>(file_header.frame_height),
+      static_cast<size_t>(file_header.num_frames)};
+  this->offset = sizeof(FileHeader);
+}
+
+TraceReader::TraceReader(TraceReader&&) noexcept = default;
+TraceReader::~TraceReader()                      = default;
+
+bool TraceReader::next(ds::FrameView& frame) {
+  const auto& d = *(this->data);
+  if (this->offset == d.size) { return false; }
+
+  const size_t remaining = d.size - this->offset;
+  auto record            = RecordHeader{};
+  if (remaining >= sizeof(RecordHeader)) {
+    std::memcpy(&record, d.base + this->offset, sizeof(RecordHeader));
+  }
+  // The number of objects is bounded by the bytes left before computing the size of the
+  // record, which could otherwise wrap around and match a corrupt size.
+  const bool fits =
+      remaining >= sizeof(RecordHeader) &&
+      record.num_objects <= (remaining - sizeof(RecordHeader)) / OBJECT_SIZE;
+  const size_t n = fits ? static_cast<size_t>(record.num_objects) : 0;
+  if (!fits || record.size != record_size(n) || remaining < record.size) {
+    throw std::invalid_argument(
+        fmt::format("Binary trace is truncated at byte {}.", this->offset));
+  }
+
+  // The columns are in place in the trace.
+  const char* ptr = d.base + this->offset + sizeof(RecordHeader);
+  const auto ids  = reinterpret_cast<const ds::TrackId*>(ptr);
+  const auto prob = reinterpret_cast<const double*>(ptr + n * sizeof(ds::TrackId));
+  const auto bbox = reinterpret_cast<const ds::BoundingBox*>(
+      ptr + n * (sizeof(ds::TrackId) + sizeof(double)));
+  const auto cls = reinterpret_cast<const int*>(
+      ptr + n * (sizeof(ds::TrackId) + sizeof(double) + sizeof(ds::BoundingBox)));
+  frame = ds::FrameView{
+      record.timestamp,
+      static_cast<size_t>(record.frame_num),
+      this->header.frame_width,
+      this->header.frame_height,
+      n,
+      ids,
+      cls,
+      prob,
+      bbox};
+  this->offset += record.size;
+  return true;
+}
+
+bool TraceReader::next(ds::TrackedFrame& frame) {
+  auto view = ds::FrameView{};
+  if (!this->next(view)) { return false; }
+  to_tracked(view, frame);
+  return true;
+}
+
+std::vector<ds::FrameView> TraceReader::views() {
+  auto ret = std::vector<ds::FrameView>{};
+  ret.reserve(this->header.num_frames);
+  auto view = ds::FrameView{};
+  while (this->next(view)) { ret.push_back(view); }
+  return ret;
+}
+
+size_t percemon::io::convert_mot(
+    const std::string& mot_file,
+    const std::string& trace_file,
+    MotOptions options) {
+  auto reader = MotReader{mot_file, options};
+  auto writer = TraceWriter{
+      trace_file, TraceHeader{options.fps, options.frame_width, options.frame_height}};
+  auto frame = ds::FrameView{};
+  while (reader.next(frame)) { writer.add_frame(frame); }
+  writer.close();
+  return writer.get_header().num_frames;
+}
@@ -0,0 +1,241 @@
+#include "percemon/monitoring.hpp"
+
+#include "monitoring/spsc_queue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+namespace ds = percemon::datastream;
+
+// The producer (the thread adding frames) and the worker only synchronize through the
+// queue while frames are flowing. A side that has to wait (the worker for a frame, or
+// the producer for room in the queue or for a flush) sets its `waiting` flag and then
+// checks the queue again, under the mutex, before sleeping, while the other side
+// updates the queue and then checks the flag. As these are all sequentially
+// consistent, either the sleeper sees the update or the other side sees the flag and
+// wakes it up, so the other side only takes the mutex when someone is asleep.
+
+namespace percemon::monitoring::details {
+
+using QueuedFrame = std::variant<std::monostate, ds::Frame, ds::TrackedFrame>;
+
+struct AsyncState {
+  OnlineMonitor monitor;
+  const Backpressure backpressure;
+  const AsyncOnlineMonitor::Callback on_result;
+  SpscQueue<QueuedFrame> queue;
+
+  /**
+   * Number of frames queued by the producer, and the number that the worker is done
+   * with (evaluated, coalesced, or discarded after an error).
+   */
+  std::atomic<size_t> num_queued = 0, num_done = 0;
+  std::atomic<size_t> num_dropped = 0;
+
+  std::mutex mtx;
+  std::condition_variable worker_cv, producer_cv;
+  std::atomic<bool> worker_waiting = false, producer_waiting = false;
+  /**
+   * Set (under `mtx`) when the monitor is destroyed.
+   */
+  bool stopping = false;
+  /**
+   * The first exception thrown by the worker, which is written under `mtx` before
+   * `failed` is set.
+   */
+  std::exception_ptr error = nullptr;
+  std::atomic<bool> failed = false;
+
+  std::mutex results_mtx;
+  std::vector<AsyncResult> results;
+
+  std::thread worker;
+
+  AsyncState(
+      OnlineMonitor&& monitor_,
+      const AsyncOptions& options,
+      AsyncOnlineMonitor::Callback on_result_) :
+      monitor{std::move(monitor_)},
+      backpressure{options.backpressure},
+      on_result{std::move(on_result_)},
+      queue{options.queue_capacity} {
+    this->worker = std::thread{[this]() { this->work(); }};
+  }
+
+  ~AsyncState() {
+    {
+      const std::lock_guard<std::mutex> lock{this->mtx};
+      this->stopping = true;
+    }
+    this->worker_cv.notify_one();
+    this->worker.join();
+  }
+
+  AsyncState(const AsyncState&) = delete;
+  AsyncState& operator=(const AsyncState&) = delete;
+
+  /**
+   * Queue a frame, waiting for room unless the frame can be dropped. Only the producer
+   * may call this.
+   */
+  bool push(QueuedFrame& frame) {
+    this->rethrow();
+    while (!this->queue.try_push(frame)) {
+      if (this->backpressure == Backpressure::Drop) {
+        this->num_dropped++;
+        return false;
+      }
+      this->wait_producer([&]() { return !this->queue.full() || this->failed.load(); });
+      this->rethrow();
+    }
+    this->num_queued++;
+    if (this->worker_waiting.load()) {
+      const std::lock_guard<std::mutex> lock{this->mtx};
+      this->worker_cv.notify_one();
+    }
+    return true;
+  }
+
+  void flush() {
+    this->wait_producer([&]() {
+      return this->num_done.load() == this->num_queued.load() || this->failed.load();
+    });
+    this->rethrow();
+  }
+
+  void rethrow() {
+    if (!this->failed.load()) { return; }
+    const std::lock_guard<std::mutex> lock{this->mtx};
+    std::rethrow_exception(this->error);
+  }
+
+  template <typename Predicate>
+  void wait_producer(Predicate&& ready) {
+    auto lock = std::unique_lock<std::mutex>{this->mtx};
+    this->producer_waiting.store(true);
+    this->producer_cv.wait(lock, ready);
+    this->producer_waiting.store(false);
+  }
+
+  void work() {
+    auto frame = QueuedFrame{};
+    for (;;) {
+      if (!this->queue.try_pop(frame)) {
+        auto lock = std::unique_lock<std::mutex>{this->mtx};
+        this->worker_waiting.store(true);
+        this->worker_cv.wait(
+            lock, [&]() { return !this->queue.empty() || this->stopping; });
+        this->worker_waiting.store(false);
+        // The frames queued before the monitor was destroyed are still evaluated.
+        if (this->queue.empty()) { return; }
+        continue;
+      }
+
+      if (!this->failed.load()) {
+        // A worker that is behind only evaluates the newest of the queued frames.
+        const bool evaluate =
+            this->backpressure != Backpressure::Coalesce || this->queue.empty();
+        this->process(frame, evaluate);
+      }
+      frame = std::monostate{};
+      this->num_done++;
+      if (this->producer_waiting.load()) {
+        const std::lock_guard<std::mutex> lock{this->mtx};
+        this->producer_cv.notify_one();
+      }
+    }
+  }
+
+  void process(QueuedFrame& queued, bool evaluate) {
+    try {
+      auto result = AsyncResult{};
+      std::visit(
+          [&](auto& frame) {
+            using T = std::decay_t<decltype(frame)>;
+            if constexpr (!std::is_same_v<T, std::monostate>) {
+              result.frame_num = frame.frame_num;
+              result.timestamp = frame.timestamp;
+              this->monitor.add_frame(frame);
+            }
+          },
+          queued);
+      if (!evaluate) { return; }
+
+      result.robustness = this->monitor.eval();
+      if (this->on_result) {
+        this->on_result(result);
+      } else {
+        const std::lock_guard<std::mutex> lock{this->results_mtx};
+        this->results.push_back(result);
+      }
+    } catch (...) {
+      const std::lock_guard<std::mutex> lock{this->mtx};
+      this->error = std::current_exception();
+      this->failed.store(true);
+    }
+  }
+};
+
+} // namespace percemon::monitoring::details
+
+AsyncOnlineMonitor::AsyncOnlineMonitor(
+    ast::Expr phi_,
+    double fps_,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options_,
+    AsyncOptions async_options_,
+    Callback on_result_) :
+    async_options{async_options_},
+    state{std::make_unique<details::AsyncState>(
+        OnlineMonitor{std::move(phi_), fps_, x_boundary, y_boundary, options_},
+        async_options_,
+        std::move(on_result_))} {}
+
+AsyncOnlineMonitor::~AsyncOnlineMonitor() = default;
+
+template <typename FrameT>
+bool AsyncOnlineMonitor::push(FrameT&& frame) {
+  auto queued = details::QueuedFrame{std::forward<FrameT>(frame)};
+  return this->state->push(queued);
+}
+
+bool AsyncOnlineMonitor::add_frame(const ds::Frame& frame) { return this->push(frame); }
+bool AsyncOnlineMonitor::add_frame(ds::Frame&& frame) {
+  return this->push(std::move(frame));
+}
+bool AsyncOnlineMonitor::add_frame(const ds::TrackedFrame& frame) {
+  return this->push(frame);
+}
+bool AsyncOnlineMonitor::add_frame(ds::TrackedFrame&& frame) {
+  return this->push(std::move(frame));
+}
+
+void AsyncOnlineMonitor::flush() { this->state->flush(); }
+
+std::vector<AsyncResult> AsyncOnlineMonitor::take_results() {
+  const std::lock_guard<std::mutex> lock{this->state->results_mtx};
+  return std::exchange(this->state->results, {});
+}
+
+size_t AsyncOnlineMonitor::num_dropped() const {
+  return this->state->num_dropped.load();
+}
+
+size_t AsyncOnlineMonitor::get_max_horizon() const {
+  return this->state->monitor.get_max_horizon();
+}
+const Program& AsyncOnlineMonitor::get_program() const {
+  return this->state->monitor.get_program();
+}
+const MonitorOptions& AsyncOnlineMonitor::get_options() const {
+  return this->state->monitor.get_options();
+}
@@ -0,0 +1,299 @@
+/**
+ * Boolean semantics of the STQL operators on packed signals.
+ *
+ * Every leaf predicate evaluates to `+inf` or `-inf`, so the robustness of a formula
+ * without quantitative subformulas is a Boolean signal. A `BitSignal` stores one bit
+ * per frame, aligned with the frame buffer like the signals in `semantics.hpp` (bit 0
+ * is the oldest buffered frame), so that the Boolean connectives work on 64 frames at
+ * a time and the temporal operators become shifts and bit scans over the words.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_BIT_SIGNAL_HPP__
+#define __PERCEMON_MONITORING_BIT_SIGNAL_HPP__
+
+#include "monitoring/semantics.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+class BitSignal {
+ public:
+  using Word                        = std::uint64_t;
+  static constexpr size_t WORD_BITS = 64;
+
+  BitSignal() = default;
+  /**
+   * Create a signal of `n` frames, all set to `value`.
+   */
+  BitSignal(size_t n_, bool value) :
+      words((n_ + WORD_BITS - 1) / WORD_BITS, value ? ~Word{0} : Word{0}), n{n_} {
+    this->clear_tail();
+  }
+
+  /**
+   * Pack a robustness signal, where a frame is set if its robustness is positive.
+   */
+  static BitSignal from_robustness(const std::vector<double>& rho) {
+    auto ret = BitSignal(rho.size(), false);
+    for (size_t t = 0; t < rho.size(); t++) { ret.set(t, rho[t] > 0); }
+    return ret;
+  }
+
+  [[nodiscard]] size_t size() const { return n; }
+  [[nodiscard]] size_t num_words() const { return words.size(); }
+
+  [[nodiscard]] Word word(size_t i) const { return words[i]; }
+  /**
+   * Set the `i`-th word. The bits after the last frame must be cleared with
+   * `clear_tail` once the words are written.
+   */
+  void set_word(size_t i, Word w) { words[i] = w; }
+
+  [[nodiscard]] bool test(size_t t) const {
+    return ((words[t / WORD_BITS] >> (t % WORD_BITS)) & 1) != 0;
+  }
+  [[nodiscard]] bool back() const { return test(n - 1); }
+
+  void set(size_t t, bool value) {
+    const Word bit = Word{1} << (t % WORD_BITS);
+    if (value) {
+      words[t / WORD_BITS] |= bit;
+    } else {
+      words[t / WORD_BITS] &= ~bit;
+    }
+  }
+
+  /**
+   * Set the frames in `[first, last)` to `value`.
+   */
+  void fill(size_t first, size_t last, bool value) {
+    for (; first < last && first % WORD_BITS != 0; first++) { set(first, value); }
+    for (; first + WORD_BITS <= last; first += WORD_BITS) {
+      words[first / WORD_BITS] = value ? ~Word{0} : Word{0};
+    }
+    for (; first < last; first++) { set(first, value); }
+  }
+
+  /**
+   * Index of the first frame set to `value`, or `size()` if there is none.
+   */
+  [[nodiscard]] size_t find_first(bool value) const {
+    for (size_t i = 0; i < words.size(); i++) {
+      const Word w = value ? words[i] : ~words[i];
+      if (w != 0) { return std::min(n, i * WORD_BITS + count_trailing_zeros(w)); }
+    }
+    return n;
+  }
+
+  [[nodiscard]] bool all() const { return find_first(false) == n; }
+  [[nodiscard]] bool none() const { return find_first(true) == n; }
+
+  void flip() {
+    for (auto& w : words) { w = ~w; }
+    this->clear_tail();
+  }
+
+  BitSignal& operator&=(const BitSignal& other) {
+    for (size_t i = 0; i < words.size(); i++) { words[i] &= other.words[i]; }
+    return *this;
+  }
+
+  BitSignal& operator|=(const BitSignal& other) {
+    for (size_t i = 0; i < words.size(); i++) { words[i] |= other.words[i]; }
+    return *this;
+  }
+
+  /**
+   * Clear the bits of the last word that are after the last frame, so that the words
+   * can be compared and scanned directly.
+   */
+  void clear_tail() {
+    if (const size_t r = n % WORD_BITS; r != 0) { words.back() &= low_mask(r); }
+  }
+
+  /**
+   * Mask of the lowest `r < WORD_BITS` bits of a word.
+   */
+  static constexpr Word low_mask(size_t r) { return (Word{1} << r) - 1; }
+
+ private:
+  std::vector<Word> words;
+  size_t n = 0;
+
+  static size_t count_trailing_zeros(Word w) {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctzll(w));
+#else
+    size_t ret = 0;
+    for (; (w & 1) == 0; w >>= 1) { ret++; }
+    return ret;
+#endif
+  }
+};
+
+/**
+ * Output iterator setting the frames of a BitSignal from robustness values, so that
+ * the leaf predicates in `semantics.hpp` can write directly into a packed signal.
+ */
+class BitInserter {
+ public:
+  using iterator_category = std::output_iterator_tag;
+  using value_type        = void;
+  using difference_type   = std::ptrdiff_t;
+  using pointer           = void;
+  using reference         = void;
+
+  BitInserter(BitSignal& signal_, size_t t_) : signal{&signal_}, t{t_} {}
+
+  BitInserter& operator=(double rho) {
+    signal->set(t, rho > 0);
+    return *this;
+  }
+  BitInserter& operator*() { return *this; }
+  BitInserter& operator++() {
+    t++;
+    return *this;
+  }
+  BitInserter operator++(int) {
+    auto ret = *this;
+    t++;
+    return ret;
+  }
+
+ private:
+  BitSignal* signal;
+  size_t t;
+};
+
+// Point-wise operations on packed signals, with the same names as their robustness
+// counterparts so that the quantifier reductions work on both.
+
+inline BitSignal negate(BitSignal x) {
+  x.flip();
+  return x;
+}
+
+inline void elementwise_min(BitSignal& acc, const BitSignal& x) { acc &= x; }
+
+inline void elementwise_max(BitSignal& acc, const BitSignal& x) { acc |= x; }
+
+inline bool prune_decided(Demand& demand, const BitSignal& acc, double decided) {
+  const bool value = decided > 0;
+  bool any         = false;
+  for (size_t t = 0; t < demand.size(); t++) {
+    demand[t] = demand[t] && acc.test(t) != value;
+    any       = any || demand[t];
+  }
+  return any;
+}
+
+/**
+ * The signal `x` delayed by `k` frames, where the first `k` frames are set to `fill`.
+ */
+inline BitSignal shifted(const BitSignal& x, size_t k, bool fill) {
+  constexpr size_t W = BitSignal::WORD_BITS;
+  auto ret           = BitSignal(x.size(), fill);
+  if (k >= x.size()) { return ret; }
+  const size_t q = k / W, r = k % W;
+  for (size_t i = q; i < ret.num_words(); i++) {
+    auto w = x.word(i - q) << r;
+    if (r != 0 && i > q) { w |= x.word(i - q - 1) >> (W - r); }
+    // The bits of the first shifted word before `k`.
+    if (i == q && fill) { w |= BitSignal::low_mask(r); }
+    ret.set_word(i, w);
+  }
+  ret.clear_tail();
+  return ret;
+}
+
+// Temporal operators on packed signals.
+
+inline BitSignal previous(const BitSignal& x) { return shifted(x, 1, false); }
+
+/**
+ * Fold `x` with AND (if `identity` is set) or OR over the window `w` at each frame,
+ * where frames with an empty window get `identity`.
+ *
+ * The fold over the last `width` frames is built by doubling: after folding in a copy
+ * shifted by `covered` frames, each frame holds the fold over twice as many frames, so
+ * a window costs `O(log(width))` passes over the words.
+ */
+inline BitSignal window_fold(const BitSignal& x, const FrameWindow& w, bool identity) {
+  if (w.empty()) { return BitSignal(x.size(), identity); }
+  const size_t width = std::min(w.last - w.first, x.size());
+  auto acc           = x;
+  for (size_t covered = 1; covered < width;) {
+    const size_t step = std::min(covered, width - covered);
+    if (identity) {
+      acc &= shifted(acc, step, identity);
+    } else {
+      acc |= shifted(acc, step, identity);
+    }
+    covered += step;
+  }
+  return shifted(acc, w.first, identity);
+}
+
+inline BitSignal
+always(BitSignal x, const std::optional<ast::FrameInterval>& interval) {
+  if (interval.has_value()) { return window_fold(x, frame_window(*interval), true); }
+  // Everything from the first frame that isn't set is false.
+  x.fill(x.find_first(false), x.size(), false);
+  return x;
+}
+
+inline BitSignal
+sometimes(BitSignal x, const std::optional<ast::FrameInterval>& interval) {
+  if (interval.has_value()) { return window_fold(x, frame_window(*interval), false); }
+  // Everything from the first frame that is set is true.
+  x.fill(x.find_first(true), x.size(), true);
+  return x;
+}
+
+/**
+ * Boolean version of `since`, i.e., the recurrence
+ *
+ *   s[t] = y[t] | (x[t] & s[t - 1]) | !(y[0] | ... | y[t]),  with s[-1] = true.
+ *
+ * With `g = y | !(y[0] | ... | y[t])` the frames that generate a true value and
+ * `p = x & !g` the frames that propagate the previous one, `s[t] = g[t] | (p[t] &
+ * s[t - 1])` is the carry out of bit `t` of the sum `(g | p) + g + s[-1]`. So each word
+ * is one addition, with the carry out of the word's last bit into the next one.
+ */
+inline BitSignal since(const BitSignal& x, const BitSignal& y) {
+  using Word = BitSignal::Word;
+  auto g     = sometimes(y, std::nullopt);
+  g.flip();
+  g |= y;
+
+  auto ret   = BitSignal(x.size(), false);
+  Word carry = 1;
+  for (size_t i = 0; i < ret.num_words(); i++) {
+    const Word gen      = g.word(i);
+    const Word prop     = x.word(i) & ~gen;
+    const Word a        = gen | prop;
+    const Word sum      = a + gen + carry;
+    const Word carry_in = sum ^ a ^ gen; // Bit `t` is the carry into bit `t`.
+    const Word s        = gen | (prop & carry_in);
+    ret.set_word(i, s);
+    carry = s >> (BitSignal::WORD_BITS - 1);
+  }
+  ret.clear_tail();
+  return ret;
+}
+
+inline BitSignal backto(const BitSignal& x, const BitSignal& y) {
+  return negate(since(negate(x), negate(y)));
+}
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_BIT_SIGNAL_HPP__ */
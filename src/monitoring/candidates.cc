@@ -0,0 +1,435 @@
+#include "monitoring/candidates.hpp"
+
+#include "monitoring/semantics.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+using namespace percemon::monitoring::details;
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+/**
+ * Slack, in pixels, when bounding the position of an object from a guard, so that
+ * rounding in the scaled comparison can't drop an object that passes the guard.
+ */
+constexpr double POSITION_SLACK = 1.0;
+
+bool is_object_predicate(const Instruction& ins, const Program& program) {
+  switch (ins.op) {
+    case OpCode::CompareClass:
+    case OpCode::CompareProb:
+    case OpCode::CompareArea:
+    case OpCode::CompareLat:
+    case OpCode::CompareLon:
+      // Comparisons against a literal.
+      return program.ids(ins).size() == 1;
+    default: return false;
+  }
+}
+
+ast::ComparisonOp negated(ast::ComparisonOp op) {
+  switch (op) {
+    case ast::ComparisonOp::GE: return ast::ComparisonOp::LT;
+    case ast::ComparisonOp::GT: return ast::ComparisonOp::LE;
+    case ast::ComparisonOp::LE: return ast::ComparisonOp::GT;
+    case ast::ComparisonOp::LT: return ast::ComparisonOp::GE;
+    case ast::ComparisonOp::EQ: return ast::ComparisonOp::NE;
+    case ast::ComparisonOp::NE: return ast::ComparisonOp::EQ;
+  }
+  return op;
+}
+
+bool is_position(const Instruction& ins) {
+  return ins.op == OpCode::CompareLat || ins.op == OpCode::CompareLon;
+}
+
+/**
+ * The class that a guard requires the object to have, if any.
+ */
+std::optional<int> class_of(const Instruction& ins, bool value) {
+  if (ins.op != OpCode::CompareClass) { return {}; }
+  const bool equal = ins.relation == ast::ComparisonOp::EQ;
+  if (equal != value) { return {}; }
+  return static_cast<int>(ins.constant);
+}
+
+/**
+ * Check if the predicate holds for the object at index `i` in the frame, which is
+ * evaluated the same as in `eval_compare_class` and `eval_compare_attribute`.
+ */
+bool holds(const Instruction& ins, const FrameColumns& frame, size_t i) {
+  if (ins.op == OpCode::CompareClass) {
+    return visit_equality(ins.relation, [&](const auto op) {
+      return op(frame.object_class[i], static_cast<int>(ins.constant));
+    });
+  }
+  return visit_attributes(ins, [&](const auto lhs_of, const auto) {
+    return visit_relation(ins.relation, [&](const auto op) {
+      return op(lhs_of(frame, i), ins.constant);
+    });
+  });
+}
+
+/**
+ * Rectangle containing a point of the box of every object passing the guards.
+ */
+struct Rect {
+  double xlo = -INF, xhi = INF, ylo = -INF, yhi = INF;
+};
+
+/**
+ * Narrow `rect` by a guard on the position of an object. Every reference point of a
+ * box (its sides or center) is within the box, so a bound on it is a bound on the
+ * extent of the box that must overlap the rectangle.
+ */
+void narrow(Rect& rect, const Instruction& ins, bool value) {
+  const double scale = ins.lhs_scale;
+  if (scale == 0) { return; }
+  const double bound = ins.constant / scale;
+  auto op            = value ? ins.relation : negated(ins.relation);
+  if (scale < 0) {
+    // Dividing by a negative scale flips the inequality.
+    switch (op) {
+      case ast::ComparisonOp::GE: op = ast::ComparisonOp::LE; break;
+      case ast::ComparisonOp::GT: op = ast::ComparisonOp::LT; break;
+      case ast::ComparisonOp::LE: op = ast::ComparisonOp::GE; break;
+      case ast::ComparisonOp::LT: op = ast::ComparisonOp::GT; break;
+      default: break;
+    }
+  }
+
+  double lo = -INF, hi = INF;
+  switch (op) {
+    case ast::ComparisonOp::GE:
+    case ast::ComparisonOp::GT: lo = bound - POSITION_SLACK; break;
+    case ast::ComparisonOp::LE:
+    case ast::ComparisonOp::LT: hi = bound + POSITION_SLACK; break;
+    case ast::ComparisonOp::EQ:
+      lo = bound - POSITION_SLACK;
+      hi = bound + POSITION_SLACK;
+      break;
+    case ast::ComparisonOp::NE: return;
+  }
+  if (ins.op == OpCode::CompareLat) {
+    rect.xlo = std::max(rect.xlo, lo);
+    rect.xhi = std::min(rect.xhi, hi);
+  } else {
+    rect.ylo = std::max(rect.ylo, lo);
+    rect.yhi = std::min(rect.yhi, hi);
+  }
+}
+
+ast::ComparisonOp mirrored(ast::ComparisonOp op) {
+  switch (op) {
+    case ast::ComparisonOp::GE: return ast::ComparisonOp::LE;
+    case ast::ComparisonOp::GT: return ast::ComparisonOp::LT;
+    case ast::ComparisonOp::LE: return ast::ComparisonOp::GE;
+    case ast::ComparisonOp::LT: return ast::ComparisonOp::GT;
+    default: return op;
+  }
+}
+
+/**
+ * Interns the structure of the instructions with their ID slots renamed, so that two
+ * subformulas get the same key if they are equal up to the order of the operands of
+ * the commutative operators and the sides of the comparisons between two objects.
+ */
+class StructureKeys {
+ public:
+  explicit StructureKeys(const Program& program_) : program{program_} {}
+
+  /**
+   * Key of the instruction at `idx` after renaming each ID slot `s` to `rename[s]`.
+   * The keys from the same table can be compared across renamings.
+   */
+  size_t key(size_t idx, const std::vector<size_t>& rename) {
+    this->memo.assign(program.code.size(), std::nullopt);
+    return this->key_of(idx, rename);
+  }
+
+ private:
+  using Structure = std::tuple<
+      OpCode,
+      ast::ComparisonOp,
+      std::uint32_t,
+      double,
+      ast::CRT,
+      ast::CRT,
+      double,
+      double,
+      std::optional<std::tuple<size_t, size_t, int>>,
+      std::vector<size_t>,
+      std::vector<size_t>>;
+
+  const Program& program;
+  std::map<Structure, size_t> interned;
+  std::vector<std::optional<size_t>> memo;
+
+  size_t key_of(size_t idx, const std::vector<size_t>& rename) {
+    if (const auto& key = this->memo[idx]) { return *key; }
+    const auto& ins = program.code[idx];
+
+    auto ids = std::vector<size_t>{};
+    for (const size_t slot : program.ids(ins)) { ids.push_back(rename[slot]); }
+    auto relation = ins.relation;
+    auto crts     = std::make_pair(ins.lhs_crt, ins.rhs_crt);
+    auto scales   = std::make_pair(ins.lhs_scale, ins.rhs_scale);
+    const bool is_leaf = ins.op < OpCode::Exists;
+    if (is_leaf && ids.size() == 2 && ids[0] > ids[1]) {
+      // Write the comparison between two objects with the lower slot on the LHS.
+      std::swap(ids[0], ids[1]);
+      std::swap(crts.first, crts.second);
+      std::swap(scales.first, scales.second);
+      relation = mirrored(relation);
+    }
+
+    auto args = std::vector<size_t>{};
+    for (const size_t arg : program.args(ins)) {
+      args.push_back(this->key_of(arg, rename));
+    }
+    switch (ins.op) {
+      case OpCode::And:
+      case OpCode::Or:
+      case OpCode::Intersect:
+      case OpCode::Union: std::sort(args.begin(), args.end()); break;
+      default: break;
+    }
+
+    auto interval = std::optional<std::tuple<size_t, size_t, int>>{};
+    if (ins.interval.has_value()) {
+      interval = std::make_tuple(
+          ins.interval->low, ins.interval->high, static_cast<int>(ins.interval->bound));
+    }
+    const auto structure = Structure{
+        ins.op,
+        relation,
+        ins.var,
+        ins.constant,
+        crts.first,
+        crts.second,
+        scales.first,
+        scales.second,
+        interval,
+        std::move(ids),
+        std::move(args)};
+    const auto [it, _] = this->interned.try_emplace(structure, this->interned.size());
+    this->memo[idx]    = it->second;
+    return it->second;
+  }
+};
+
+/**
+ * Check if the operands of the body of the quantifier at `idx` require the ID
+ * variables to be bound to different objects, i.e., if a binding of two of them to the
+ * same object makes the body `-inf` (`+inf` for a Forall) at every frame.
+ */
+bool requires_distinct(const Program& program, const Instruction& ins) {
+  const bool is_exists = ins.op == OpCode::Exists;
+  const auto ids       = program.ids(ins);
+  const size_t body    = program.args(ins)[0];
+  const size_t k       = ids.size();
+
+  auto operands         = std::vector<size_t>{body};
+  const auto& body_ins  = program.code[body];
+  const auto combinator = is_exists ? OpCode::And : OpCode::Or;
+  if (body_ins.op == combinator) {
+    const auto args = program.args(body_ins);
+    operands.assign(args.begin(), args.end());
+  }
+
+  const auto slot_of = [&](size_t slot) {
+    return static_cast<size_t>(std::find(ids.begin(), ids.end(), slot) - ids.begin());
+  };
+  auto distinct = std::vector<bool>(k * k, false);
+  for (size_t arg : operands) {
+    // An operand of an Exists must be false, and one of a Forall true, if the objects
+    // are the same.
+    auto same_is = ast::ComparisonOp::NE;
+    if (program.code[arg].op == OpCode::Not) {
+      arg     = program.args(program.code[arg])[0];
+      same_is = ast::ComparisonOp::EQ;
+    }
+    const auto& pred = program.code[arg];
+    if (pred.op != OpCode::CompareId) { continue; }
+    if ((pred.relation == same_is) != is_exists) { continue; }
+    const auto pair = program.ids(pred);
+    const size_t a = slot_of(pair[0]), b = slot_of(pair[1]);
+    if (a < k && b < k) {
+      distinct[a * k + b] = true;
+      distinct[b * k + a] = true;
+    }
+  }
+  for (size_t a = 0; a < k; a++) {
+    for (size_t b = a + 1; b < k; b++) {
+      if (!distinct[a * k + b]) { return false; }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+CandidateFilter::CandidateFilter(
+    const Program& program,
+    const std::vector<std::optional<size_t>>& horizons) :
+    guards(program.code.size()),
+    modes(program.code.size(), iter_helpers::TupleMode::Product) {
+  auto keys     = StructureKeys{program};
+  auto identity = std::vector<size_t>(program.id_slots.size());
+  std::iota(identity.begin(), identity.end(), 0);
+  for (size_t idx = 0; idx < program.code.size(); idx++) {
+    const auto& ins = program.code[idx];
+    if (ins.op != OpCode::Exists && ins.op != OpCode::Forall) { continue; }
+    const auto ids = program.ids(ins);
+    if (ids.size() < 2) { continue; }
+
+    // The transpositions of the first variable with each of the others generate all
+    // the permutations of the variables.
+    const size_t body     = program.args(ins)[0];
+    const size_t original = keys.key(body, identity);
+    bool symmetric        = true;
+    for (size_t i = 1; i < ids.size() && symmetric; i++) {
+      auto rename = identity;
+      std::swap(rename[ids[0]], rename[ids[i]]);
+      symmetric = keys.key(body, rename) == original;
+    }
+    if (symmetric) {
+      this->modes[idx] = requires_distinct(program, ins)
+                             ? iter_helpers::TupleMode::Subsets
+                             : iter_helpers::TupleMode::Multisets;
+    }
+  }
+
+  for (size_t idx = 0; idx < program.code.size() && idx < horizons.size(); idx++) {
+    const auto& ins = program.code[idx];
+    if (ins.op != OpCode::Exists && ins.op != OpCode::Forall) { continue; }
+    // The values at the older frames must be kept for the temporal operators.
+    if (!horizons[idx].has_value() || *horizons[idx] > 1) { continue; }
+
+    const bool is_exists = ins.op == OpCode::Exists;
+    const auto ids       = program.ids(ins);
+    const size_t body    = program.args(ins)[0];
+
+    // The operands of the And (Or) in the body, or the body itself.
+    auto operands         = std::vector<size_t>{body};
+    const auto& body_ins  = program.code[body];
+    const auto combinator = is_exists ? OpCode::And : OpCode::Or;
+    if (body_ins.op == combinator) {
+      const auto args = program.args(body_ins);
+      operands.assign(args.begin(), args.end());
+    }
+
+    auto& quantifier_guards = this->guards[idx];
+    quantifier_guards.resize(ids.size());
+    for (size_t arg : operands) {
+      // An operand of an Exists must be true, and one of a Forall must be false.
+      bool value = is_exists;
+      if (program.code[arg].op == OpCode::Not) {
+        arg   = program.args(program.code[arg])[0];
+        value = !value;
+      }
+      const auto& pred = program.code[arg];
+      if (!is_object_predicate(pred, program)) { continue; }
+      const auto slot = std::find(ids.begin(), ids.end(), program.ids(pred)[0]);
+      if (slot == ids.end()) { continue; } // Bound by an enclosing quantifier.
+
+      const auto i = static_cast<size_t>(std::distance(ids.begin(), slot));
+      quantifier_guards[i].push_back(Guard{arg, value});
+    }
+
+    // The objects of a variable with a class are listed from its partition, and the
+    // grid is only used for the others.
+    for (const auto& var_guards : quantifier_guards) {
+      bool has_class = false, has_position = false;
+      for (const auto& guard : var_guards) {
+        const auto& pred = program.code[guard.ins];
+        has_class        = has_class || class_of(pred, guard.value).has_value();
+        has_position     = has_position || is_position(pred);
+      }
+      if (has_class) {
+        this->partitioned = true;
+      } else if (has_position) {
+        this->positional = true;
+      }
+    }
+  }
+}
+
+iter_helpers::index_tuples CandidateFilter::select(
+    const Program& program,
+    size_t idx,
+    const FrameSpan& trace,
+    std::vector<std::vector<size_t>>& candidates) const {
+  const auto& frame      = trace.back();
+  const auto* grid       = trace.grid();
+  const auto* partitions = trace.partitions();
+  const size_t k         = program.ids(program.code[idx]).size();
+  candidates.resize(k);
+
+  auto radices = std::vector<size_t>(k);
+  for (size_t i = 0; i < k; i++) {
+    auto& objects = candidates[i];
+    objects.clear();
+    const bool guarded = idx < this->guards.size() && !this->guards[idx].empty();
+    const auto* var_guards = guarded ? &this->guards[idx][i] : nullptr;
+
+    auto object_class = std::optional<int>{};
+    auto rect         = Rect{};
+    bool positioned   = false;
+    if (var_guards != nullptr) {
+      for (const auto& guard : *var_guards) {
+        const auto& pred = program.code[guard.ins];
+        if (const auto c = class_of(pred, guard.value)) { object_class = c; }
+        if (is_position(pred)) {
+          narrow(rect, pred, guard.value);
+          positioned = true;
+        }
+      }
+    }
+    if (object_class.has_value() && partitions != nullptr) {
+      partitions->query(*object_class, objects);
+    } else if (positioned && grid != nullptr) {
+      grid->query(rect.xlo, rect.xhi, rect.ylo, rect.yhi, objects);
+    } else {
+      objects.resize(frame.size());
+      std::iota(objects.begin(), objects.end(), 0);
+    }
+
+    if (var_guards != nullptr) {
+      objects.erase(
+          std::remove_if(
+              objects.begin(),
+              objects.end(),
+              [&](const size_t obj) {
+                return !std::all_of(
+                    var_guards->begin(), var_guards->end(), [&](const Guard& guard) {
+                      return holds(program.code[guard.ins], frame, obj) == guard.value;
+                    });
+              }),
+          objects.end());
+    }
+    radices[i] = objects.size();
+  }
+
+  // The combinations only cover the bindings if all the variables can be bound to the
+  // same objects, which is the case when their guards are symmetric.
+  const auto mode = (idx < this->modes.size()) ? this->modes[idx]
+                                                : iter_helpers::TupleMode::Product;
+  const bool same_objects =
+      std::adjacent_find(
+          candidates.begin(), candidates.end(), std::not_equal_to<>{}) ==
+      candidates.end();
+  if (mode == iter_helpers::TupleMode::Product || !same_objects) {
+    return iter_helpers::index_tuples{std::move(radices)};
+  }
+  return iter_helpers::index_tuples{std::move(radices), mode};
+}
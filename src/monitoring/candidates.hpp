@@ -0,0 +1,97 @@
+/**
+ * Pruning of the objects enumerated by the quantifiers.
+ *
+ * A quantifier whose value is only needed at the current frame (see `get_horizons`)
+ * only has to enumerate the bindings for which its body can change the result there.
+ * If the body of an Exists is a conjunction, a binding that falsifies one of the
+ * conjuncts at the current frame gives `-inf`, and similarly a binding that satisfies
+ * a disjunct of the body of a Forall gives `+inf`. The operands that only compare an
+ * attribute of one of the bound objects against a literal are used as guards: each ID
+ * variable is only bound to the objects in the current frame that pass its guards.
+ * When a guard fixes the class of an object (e.g., `Class(id1) == 1`), the objects are
+ * listed from the ClassIndex of the frame, and otherwise, when the guards bound the
+ * position of an object (CompareLat and CompareLon), they are looked up in the
+ * GridIndex of the frame, instead of scanning all of them.
+ *
+ * Independently of the horizons, if the body of a quantifier is symmetric in its ID
+ * variables (it is the same formula after swapping any two of them), permuting a
+ * binding doesn't change the robustness of the body, so only the bindings in which
+ * the indices of the objects are non-decreasing are enumerated. If the body also
+ * requires the variables to be bound to different objects (e.g., an operand
+ * `id1 != id2` of the And in an Exists), only the increasing ones are enumerated.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_CANDIDATES_HPP__
+#define __PERCEMON_MONITORING_CANDIDATES_HPP__
+
+#include "monitoring/frame_buffer.hpp"
+
+#include "percemon/iter/product.hpp"
+#include "percemon/program.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+class CandidateFilter {
+ public:
+  CandidateFilter() = default;
+  /**
+   * Find the guards of the quantifiers in the program, given the horizon of each
+   * instruction.
+   */
+  CandidateFilter(
+      const Program& program,
+      const std::vector<std::optional<size_t>>& horizons);
+
+  /**
+   * If any of the guards bound the position of the objects, in which case the frame
+   * buffer should index their boxes.
+   */
+  [[nodiscard]] bool uses_positions() const { return positional; }
+  /**
+   * If any of the guards fix the class of the objects, in which case the frame buffer
+   * should partition them by class.
+   */
+  [[nodiscard]] bool uses_classes() const { return partitioned; }
+
+  /**
+   * Compute, for each ID variable of the quantifier at `idx`, the indices (in the
+   * arrays of `frame`) of the objects that it can be bound to, and return the bindings
+   * to enumerate, where each tuple has the position of the object in the list of each
+   * variable. The objects are from the current frame of `trace`.
+   */
+  [[nodiscard]] iter_helpers::index_tuples select(
+      const Program& program,
+      size_t idx,
+      const FrameSpan& trace,
+      std::vector<std::vector<size_t>>& candidates) const;
+
+ private:
+  /**
+   * A predicate on one object, and the value it must have at the current frame.
+   */
+  struct Guard {
+    size_t ins;
+    bool value;
+  };
+
+  /**
+   * For each instruction that is a quantifier, the guards of each of its ID variables.
+   */
+  std::vector<std::vector<std::vector<Guard>>> guards;
+  /**
+   * For each instruction that is a quantifier, how the bindings are enumerated if the
+   * variables can be bound to the same objects.
+   */
+  std::vector<iter_helpers::TupleMode> modes;
+  bool positional  = false;
+  bool partitioned = false;
+};
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_CANDIDATES_HPP__ */
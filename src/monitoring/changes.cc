@@ -0,0 +1,135 @@
+#include "monitoring/changes.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+using namespace percemon::monitoring::details;
+
+namespace {
+
+/**
+ * The class that stands for all the classes that aren't compared against.
+ */
+constexpr int OTHER_CLASS = std::numeric_limits<int>::min();
+
+} // namespace
+
+void FrameReads::add(const FrameReads& other) {
+  this->timestamps    = this->timestamps || other.timestamps;
+  this->frame_nums    = this->frame_nums || other.frame_nums;
+  this->probabilities = this->probabilities || other.probabilities;
+  this->boxes         = this->boxes || other.boxes;
+  this->all_classes   = this->all_classes || other.all_classes;
+  auto classes_ = std::vector<int>{};
+  std::set_union(
+      this->classes.begin(),
+      this->classes.end(),
+      other.classes.begin(),
+      other.classes.end(),
+      std::back_inserter(classes_));
+  this->classes = std::move(classes_);
+}
+
+std::vector<FrameReads>
+percemon::monitoring::details::get_reads(const Program& program) {
+  auto ret = std::vector<FrameReads>(program.code.size());
+  // Operands appear before the instructions using them.
+  for (size_t idx = 0; idx < program.code.size(); idx++) {
+    const auto& ins = program.code[idx];
+    auto& reads     = ret[idx];
+    switch (ins.op) {
+      case OpCode::TimeBound: reads.timestamps = true; break;
+      case OpCode::FrameBound: reads.frame_nums = true; break;
+      case OpCode::CompareClass:
+        if (ins.ids.size > 1) {
+          reads.all_classes = true;
+        } else {
+          reads.classes.push_back(static_cast<int>(ins.constant));
+        }
+        break;
+      case OpCode::CompareProb: reads.probabilities = true; break;
+      case OpCode::CompareArea:
+      case OpCode::CompareLat:
+      case OpCode::CompareLon:
+      case OpCode::CompareED:
+      case OpCode::BBox: reads.boxes = true; break;
+      default: break;
+    }
+    for (const size_t arg : program.args(ins)) { reads.add(ret[arg]); }
+  }
+  return ret;
+}
+
+ChangeTracker::ChangeTracker(const Program& program) {
+  const auto reads_ = get_reads(program);
+  for (const size_t root : program.roots) { this->reads.add(reads_[root]); }
+}
+
+int ChangeTracker::class_of(int object_class) const {
+  if (this->reads.all_classes) { return object_class; }
+  const bool compared = std::binary_search(
+      this->reads.classes.begin(), this->reads.classes.end(), object_class);
+  return compared ? object_class : OTHER_CLASS;
+}
+
+bool ChangeTracker::same(const FrameColumns& a, const FrameColumns& b) const {
+  if (a.ids != b.ids) { return false; }
+  if (this->reads.frame_nums && b.frame_num != a.frame_num + 1) { return false; }
+  if (this->reads.probabilities && a.probability != b.probability) { return false; }
+  if (this->reads.boxes &&
+      (a.xmin != b.xmin || a.xmax != b.xmax || a.ymin != b.ymin || a.ymax != b.ymax)) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (this->class_of(a.object_class[i]) != this->class_of(b.object_class[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ChangeTracker::settled(const FrameBuffer& buffer) const {
+  return buffer.size() == buffer.capacity() && this->run >= buffer.size();
+}
+
+void ChangeTracker::add_frame(const FrameBuffer& buffer) {
+  if (this->reads.timestamps) { return; }
+  const auto& frame = buffer.back();
+  if (this->run > 0 && this->same(this->last, frame)) {
+    this->run++;
+  } else {
+    this->run = 1;
+    this->run_id++;
+  }
+  this->last = frame;
+}
+
+std::optional<double> ChangeTracker::cached(const FrameBuffer& buffer) const {
+  if (!this->entry.has_value() || this->entry->run_id != this->run_id ||
+      !this->settled(buffer)) {
+    return {};
+  }
+  return this->entry->robustness;
+}
+
+void ChangeTracker::record(const FrameBuffer& buffer, double robustness) {
+  if (this->settled(buffer)) {
+    this->entry = Entry{this->run_id, robustness};
+  } else {
+    this->entry.reset();
+  }
+}
+
+void ChangeTracker::reset(const FrameBuffer& buffer) {
+  this->entry.reset();
+  this->run_id++;
+  this->run = 0;
+  if (!buffer.empty() && !this->reads.timestamps) {
+    this->last = buffer.back();
+    this->run  = 1;
+  }
+}
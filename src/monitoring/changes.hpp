@@ -0,0 +1,113 @@
+/**
+ * Detection of the frames that don't change anything a formula reads.
+ *
+ * The attributes of the objects that each subformula reads are found from the leaf
+ * predicates under it. For the classes, when they are only compared against literals,
+ * a change between two classes that aren't any of the literals doesn't change any
+ * comparison, so only the literal classes are told apart.
+ *
+ * When the frames of a stream repeat (e.g., from a static camera), the robustness at a
+ * frame only depends on which frames are in the buffer up to the attributes that the
+ * formula reads. If the buffer is full at two evaluations, and the frames added in
+ * between (and the ones before them, back to the start of both buffers) are all the
+ * same in what the formula reads, the buffers are the same to the formula, so the
+ * robustness is the same. Frame bounds also read the frame numbers, which must then
+ * be consecutive, and formulas with time bounds are always evaluated, as
+ * `x - C_TIME` changes with the timestamps of the frames.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_CHANGES_HPP__
+#define __PERCEMON_MONITORING_CHANGES_HPP__
+
+#include "monitoring/frame_buffer.hpp"
+
+#include "percemon/program.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+/**
+ * What a subformula reads from the frames, besides the IDs of the objects in them.
+ */
+struct FrameReads {
+  bool timestamps    = false;
+  bool frame_nums    = false;
+  bool probabilities = false;
+  bool boxes         = false;
+  /**
+   * If classes are compared between objects, in which case every class matters, and
+   * otherwise, the literal classes that are compared against, in increasing order.
+   */
+  bool all_classes = false;
+  std::vector<int> classes;
+
+  void add(const FrameReads& other);
+};
+
+/**
+ * Get what each instruction of the program reads from the frames, including its
+ * operands.
+ */
+std::vector<FrameReads> get_reads(const Program& program);
+
+class ChangeTracker {
+ public:
+  ChangeTracker() = delete;
+  explicit ChangeTracker(const Program& program);
+
+  /**
+   * Compare the frame that was just added to the back of the buffer with the frame
+   * added before it.
+   */
+  void add_frame(const FrameBuffer& buffer);
+
+  /**
+   * The robustness recorded for an earlier buffer that is the same as `buffer` in what
+   * the formula reads, if any.
+   */
+  [[nodiscard]] std::optional<double> cached(const FrameBuffer& buffer) const;
+  /**
+   * Record the robustness computed for the buffer.
+   */
+  void record(const FrameBuffer& buffer, double robustness);
+
+  /**
+   * Forget the frames seen, after the frames in the buffer were replaced.
+   */
+  void reset(const FrameBuffer& buffer);
+
+ private:
+  FrameReads reads;
+
+  /**
+   * Copy of the last frame added, which may have been evicted from the buffer.
+   */
+  FrameColumns last;
+  /**
+   * Number of frames, up to the last one, that are the same in what the formula reads,
+   * and a counter identifying them, that changes when a frame breaks the run.
+   */
+  size_t run    = 0;
+  size_t run_id = 0;
+
+  struct Entry {
+    size_t run_id;
+    double robustness;
+  };
+  std::optional<Entry> entry;
+
+  [[nodiscard]] bool same(const FrameColumns& a, const FrameColumns& b) const;
+  [[nodiscard]] int class_of(int object_class) const;
+  /**
+   * If the buffer is full of frames from the current run.
+   */
+  [[nodiscard]] bool settled(const FrameBuffer& buffer) const;
+};
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_CHANGES_HPP__ */
@@ -0,0 +1,113 @@
+#include "percemon/monitoring.hpp"
+
+#include "monitoring/candidates.hpp"
+#include "monitoring/changes.hpp"
+#include "monitoring/frame_buffer.hpp"
+#include "monitoring/incremental.hpp"
+#include "monitoring/snapshot.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+
+// A snapshot is a header, followed by the frames in the buffer (with the table of
+// object IDs), and a section with the table of the incremental engine, which is empty
+// if the monitor doesn't have one.
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'P', 'M', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr std::uint32_t SNAPSHOT_VERSION    = 3;
+constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  /**
+   * Hash of the program of the monitor and its buffer mode, to check that a snapshot
+   * is restored into a monitor for the same formula.
+   */
+  std::uint64_t program;
+  std::uint64_t max_horizon;
+};
+
+std::uint64_t fingerprint(const Program& program, BufferMode mode) {
+  std::uint64_t seed = static_cast<std::uint64_t>(mode);
+  const auto mix     = [&](std::uint64_t h) {
+    seed ^= h + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+  };
+  for (const auto& ins : program.code) {
+    mix(static_cast<std::uint64_t>(ins.op));
+    mix(static_cast<std::uint64_t>(ins.relation));
+    for (const size_t arg : program.args(ins)) { mix(arg); }
+    mix(ins.args.size);
+    for (const size_t id : program.ids(ins)) { mix(id); }
+    mix(ins.ids.size);
+    mix(ins.var);
+    mix(std::hash<double>{}(ins.constant));
+    mix(static_cast<std::uint64_t>(ins.lhs_crt));
+    mix(static_cast<std::uint64_t>(ins.rhs_crt));
+    mix(std::hash<double>{}(ins.lhs_scale));
+    mix(std::hash<double>{}(ins.rhs_scale));
+    if (ins.interval.has_value()) {
+      mix(ins.interval->low);
+      mix(ins.interval->high);
+      mix(static_cast<std::uint64_t>(ins.interval->bound));
+    }
+  }
+  for (const size_t root : program.roots) { mix(root); }
+  return seed;
+}
+
+} // namespace
+
+std::vector<char> OnlineMonitor::checkpoint() const {
+  auto header = SnapshotHeader{
+      {},
+      SNAPSHOT_VERSION,
+      SNAPSHOT_BYTE_ORDER,
+      fingerprint(this->program, this->options.buffer),
+      this->max_horizon};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+
+  auto snapshot = std::vector<char>{};
+  auto out      = details::SnapshotWriter{snapshot};
+  out.write(header);
+  this->buffer->save(out);
+  const size_t section = out.begin_section();
+  if (this->engine) { this->engine->save(out, *(this->buffer)); }
+  out.end_section(section);
+  return snapshot;
+}
+
+void OnlineMonitor::restore(const std::vector<char>& snapshot) {
+  auto in = details::SnapshotReader{snapshot};
+  if (snapshot.size() < sizeof(SnapshotHeader)) {
+    throw std::invalid_argument("Not a snapshot of an online monitor.");
+  }
+  const auto header = in.read<SnapshotHeader>();
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+    throw std::invalid_argument("Not a snapshot of an online monitor.");
+  }
+  if (header.version != SNAPSHOT_VERSION || header.byte_order != SNAPSHOT_BYTE_ORDER) {
+    throw std::invalid_argument("Snapshot has an unsupported version or byte order.");
+  }
+  if (header.program != fingerprint(this->program, this->options.buffer) ||
+      header.max_horizon != this->max_horizon) {
+    throw std::invalid_argument("Snapshot is of a monitor for a different formula.");
+  }
+
+  // The new buffer only replaces the current one once the whole snapshot is read.
+  auto buffer_ = this->make_buffer();
+  buffer_->load(in);
+  auto table = in.read_section();
+  in.finish();
+  if (this->engine) { this->engine->load(table, *buffer_); }
+  this->buffer = std::move(buffer_);
+  if (this->changes) { this->changes->reset(*(this->buffer)); }
+}
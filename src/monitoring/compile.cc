@@ -0,0 +1,500 @@
+#include "percemon/program.hpp"
+
+#include "percemon/fmt.hpp"
+#include "percemon/utils.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <variant>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+
+namespace {
+
+constexpr double TOP    = std::numeric_limits<double>::infinity();
+constexpr double BOTTOM = -TOP;
+
+/**
+ * Number of objects assumed to be in a frame when estimating the cost of quantifiers.
+ */
+constexpr double OBJECTS_PER_FRAME = 8.0;
+
+size_t slot_for(std::vector<std::string>& slots, const std::string& name) {
+  auto it = std::find(slots.begin(), slots.end(), name);
+  if (it == slots.end()) {
+    slots.push_back(name);
+    return slots.size() - 1;
+  }
+  return static_cast<size_t>(it - slots.begin());
+}
+
+/**
+ * The parts of an instruction that determine its value, i.e., everything except the
+ * properties derived from its operands.
+ */
+struct InstructionKey {
+  OpCode op;
+  ast::ComparisonOp relation;
+  std::vector<size_t> args, ids;
+  std::uint32_t var;
+  double constant;
+  ast::CRT lhs_crt, rhs_crt;
+  double lhs_scale, rhs_scale;
+  std::optional<ast::FrameInterval> interval;
+
+  [[nodiscard]] auto tie() const {
+    return std::tie(
+        op, relation, args, ids, var, constant, lhs_crt, rhs_crt, lhs_scale, rhs_scale);
+  }
+
+  bool operator==(const InstructionKey& other) const {
+    const auto same_interval = [](const auto& a, const auto& b) {
+      if (!a.has_value() || !b.has_value()) { return a.has_value() == b.has_value(); }
+      return a->low == b->low && a->high == b->high && a->bound == b->bound;
+    };
+    return tie() == other.tie() && same_interval(interval, other.interval);
+  }
+};
+
+struct InstructionKeyHash {
+  size_t operator()(const InstructionKey& key) const {
+    size_t seed     = 0;
+    const auto mix = [&](size_t h) { seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+    mix(static_cast<size_t>(key.op));
+    mix(static_cast<size_t>(key.relation));
+    for (const size_t arg : key.args) { mix(arg); }
+    mix(key.args.size());
+    for (const size_t id : key.ids) { mix(id); }
+    mix(key.var);
+    mix(std::hash<double>{}(key.constant));
+    mix(std::hash<double>{}(key.lhs_scale));
+    mix(std::hash<double>{}(key.rhs_scale));
+    if (key.interval.has_value()) { mix(key.interval->low ^ (key.interval->high << 16)); }
+    return seed;
+  }
+};
+
+/**
+ * Lowers STQL formulas into a program in post-order, and assigns a slot to each
+ * distinct variable name.
+ *
+ * Instructions are hash-consed: an instruction that is structurally equal to one already
+ * in the program (same operation, operands and constants) is not added again, so equal
+ * subformulas, including the ones in different formulas, share one instruction.
+ */
+struct Lowering {
+  Program program;
+
+  /**
+   * Names of the ID variables of the formula being lowered, for each slot. The slots
+   * are assigned in the order in which the variables are quantified, so that equal
+   * subformulas of different formulas use the same slots, even if their variables have
+   * different names.
+   */
+  std::vector<std::string> id_names;
+  std::unordered_map<InstructionKey, size_t, InstructionKeyHash> interned;
+
+  /**
+   * ID variables bound by the enclosing quantifiers.
+   */
+  std::vector<std::string> scope;
+  /**
+   * Time and frame variables pinned by the enclosing Pins.
+   */
+  std::vector<std::string> pinned_x, pinned_f;
+
+  size_t lower(const ast::Expr& e) { return annotate(std::visit(*this, e), e); }
+  size_t lower(const ast::TemporalBoundExpr& e) {
+    return annotate(std::visit(*this, e), e);
+  }
+  size_t lower(const ast::SpatialExpr& e) { return annotate(std::visit(*this, e), e); }
+
+  size_t operator()(const ast::Const& e) {
+    auto ins     = Instruction{OpCode::Const};
+    ins.constant = (e.value) ? TOP : BOTTOM;
+    return push(ins);
+  }
+
+  size_t operator()(const ast::TimeBound& e) {
+    if (std::find(pinned_x.begin(), pinned_x.end(), e.x.name) == pinned_x.end()) {
+      throw std::invalid_argument(
+          fmt::format("Time variable {} is not pinned in the formula.", e.x.name));
+    }
+    auto ins     = Instruction{OpCode::TimeBound, e.op};
+    ins.var      = static_cast<std::uint32_t>(slot_for(program.time_slots, e.x.name));
+    ins.constant = e.bound;
+    return push(ins);
+  }
+
+  size_t operator()(const ast::FrameBound& e) {
+    if (std::find(pinned_f.begin(), pinned_f.end(), e.f.name) == pinned_f.end()) {
+      throw std::invalid_argument(
+          fmt::format("Frame variable {} is not pinned in the formula.", e.f.name));
+    }
+    auto ins     = Instruction{OpCode::FrameBound, e.op};
+    ins.var      = static_cast<std::uint32_t>(slot_for(program.frame_slots, e.f.name));
+    ins.constant = static_cast<double>(e.bound);
+    return push(ins);
+  }
+
+  size_t operator()(const ast::CompareId& e) {
+    return push(Instruction{OpCode::CompareId, e.op}, {}, {slot_of(e.lhs), slot_of(e.rhs)});
+  }
+
+  size_t operator()(const ast::CompareClass& e) {
+    auto ins = Instruction{OpCode::CompareClass, e.op};
+    auto ids = std::vector<size_t>{slot_of(e.lhs.id)};
+    std::visit(
+        utils::overloaded{
+            [&](const int c) { ins.constant = c; },
+            [&](const ast::Class& c) { ids.push_back(slot_of(c.id)); }},
+        e.rhs);
+    return push(ins, {}, ids);
+  }
+
+  size_t operator()(const ast::CompareProb& e) {
+    return attribute(OpCode::CompareProb, e);
+  }
+  size_t operator()(const ast::CompareArea& e) {
+    return attribute(OpCode::CompareArea, e);
+  }
+  size_t operator()(const ast::CompareLat& e) {
+    return attribute(OpCode::CompareLat, e);
+  }
+  size_t operator()(const ast::CompareLon& e) {
+    return attribute(OpCode::CompareLon, e);
+  }
+
+  size_t operator()(const ast::CompareED& e) {
+    auto ins     = Instruction{OpCode::CompareED, e.op};
+    ins.constant = e.rhs;
+    return push(ins);
+  }
+
+  size_t operator()(const ast::ExistsPtr& e) { return quantifier(OpCode::Exists, e); }
+  size_t operator()(const ast::ForallPtr& e) { return quantifier(OpCode::Forall, e); }
+  size_t operator()(const ast::PinPtr& e) { return pin(*e); }
+
+  size_t operator()(const ast::NotPtr& e) { return unary(OpCode::Not, e->arg); }
+
+  size_t operator()(const ast::AndPtr& e) { return nary(OpCode::And, e); }
+  size_t operator()(const ast::OrPtr& e) { return nary(OpCode::Or, e); }
+
+  size_t operator()(const ast::PreviousPtr& e) {
+    return unary(OpCode::Previous, e->arg);
+  }
+  size_t operator()(const ast::AlwaysPtr& e) {
+    auto ins     = Instruction{OpCode::Always};
+    ins.interval = e->interval;
+    return push(ins, {lower(e->arg)});
+  }
+  size_t operator()(const ast::SometimesPtr& e) {
+    auto ins     = Instruction{OpCode::Sometimes};
+    ins.interval = e->interval;
+    return push(ins, {lower(e->arg)});
+  }
+  size_t operator()(const ast::SincePtr& e) {
+    return binary(Instruction{OpCode::Since}, e->args);
+  }
+  size_t operator()(const ast::BackToPtr& e) {
+    return binary(Instruction{OpCode::BackTo}, e->args);
+  }
+
+  size_t operator()(const ast::CompareSpAreaPtr& e) {
+    auto ins  = Instruction{OpCode::CompareSpArea, e->op};
+    auto args = std::vector<size_t>{lower(e->lhs.arg)};
+    std::visit(
+        utils::overloaded{
+            [&](const double c) { ins.constant = c; },
+            [&](const ast::SpArea& a) { args.push_back(lower(a.arg)); }},
+        e->rhs);
+    return push(ins, args);
+  }
+  size_t operator()(const ast::SpExistsPtr& e) {
+    return unary(OpCode::SpExists, e->arg);
+  }
+  size_t operator()(const ast::SpForallPtr& e) {
+    return unary(OpCode::SpForall, e->arg);
+  }
+
+  size_t operator()(const ast::EmptySet&) { return push(Instruction{OpCode::EmptySet}); }
+  size_t operator()(const ast::UniverseSet&) {
+    return push(Instruction{OpCode::UniverseSet});
+  }
+  size_t operator()(const ast::BBox& e) {
+    return push(Instruction{OpCode::BBox}, {}, {slot_of(e.id)});
+  }
+  size_t operator()(const ast::ComplementPtr& e) {
+    return unary(OpCode::Complement, e->arg);
+  }
+  size_t operator()(const ast::IntersectPtr& e) {
+    auto args = std::vector<size_t>{};
+    for (const auto& arg : e->args) { args.push_back(lower(arg)); }
+    return push(Instruction{OpCode::Intersect}, args);
+  }
+  size_t operator()(const ast::UnionPtr& e) {
+    auto args = std::vector<size_t>{};
+    for (const auto& arg : e->args) { args.push_back(lower(arg)); }
+    return push(Instruction{OpCode::Union}, args);
+  }
+  size_t operator()(const ast::InteriorPtr& e) {
+    return unary(OpCode::Interior, e->arg);
+  }
+  size_t operator()(const ast::ClosurePtr& e) { return unary(OpCode::Closure, e->arg); }
+  size_t operator()(const ast::SpPreviousPtr& e) {
+    return unary(OpCode::SpPrevious, e->arg);
+  }
+  size_t operator()(const ast::SpAlwaysPtr& e) {
+    auto ins     = Instruction{OpCode::SpAlways};
+    ins.interval = e->interval;
+    return push(ins, {lower(e->arg)});
+  }
+  size_t operator()(const ast::SpSometimesPtr& e) {
+    auto ins     = Instruction{OpCode::SpSometimes};
+    ins.interval = e->interval;
+    return push(ins, {lower(e->arg)});
+  }
+  size_t operator()(const ast::SpSincePtr& e) {
+    auto ins     = Instruction{OpCode::SpSince};
+    ins.interval = e->interval;
+    return binary(ins, e->args);
+  }
+  size_t operator()(const ast::SpBackToPtr& e) {
+    auto ins     = Instruction{OpCode::SpBackTo};
+    ins.interval = e->interval;
+    return binary(ins, e->args);
+  }
+
+ private:
+  /**
+   * Record `e` as the source of the instruction at `idx`, unless the instruction was
+   * already lowered from another (e.g., innermost or earlier) subformula.
+   */
+  template <typename E>
+  size_t annotate(size_t idx, const E& e) {
+    auto& source = program.sources.at(idx);
+    if (std::holds_alternative<std::monostate>(source)) { source = e; }
+    return idx;
+  }
+
+  size_t slot_of(const ast::Var_id& id) const {
+    if (std::find(scope.begin(), scope.end(), id.name) == scope.end()) {
+      throw std::invalid_argument(fmt::format(
+          "ID variable {} is not bound by any quantifier in the formula.", id.name));
+    }
+    auto it = std::find(id_names.begin(), id_names.end(), id.name);
+    return static_cast<size_t>(it - id_names.begin());
+  }
+
+  template <typename Comparison>
+  size_t attribute(OpCode op, const Comparison& e) {
+    auto ins      = Instruction{op, e.op};
+    ins.lhs_scale = e.lhs.scale;
+    if constexpr (utils::is_one_of_v<Comparison, ast::CompareLat, ast::CompareLon>) {
+      ins.lhs_crt = e.lhs.crt;
+    }
+
+    auto ids = std::vector<size_t>{slot_of(e.lhs.id)};
+    std::visit(
+        utils::overloaded{
+            [&](const double c) { ins.constant = c; },
+            [&](const auto& attr) {
+              using T = std::decay_t<decltype(attr)>;
+              ids.push_back(slot_of(attr.id));
+              ins.rhs_scale = attr.scale;
+              if constexpr (utils::is_one_of_v<T, ast::Lat, ast::Lon>) {
+                ins.rhs_crt = attr.crt;
+              }
+            }},
+        e.rhs);
+    return push(ins, {}, ids);
+  }
+
+  template <typename Quantifier>
+  size_t quantifier(OpCode op, const std::shared_ptr<Quantifier>& e) {
+    // Check if they are already in scope. This will imply that someone is using the
+    // same variable name again. This is an error.
+    for (auto&& id : e->ids) {
+      if (std::find(scope.begin(), scope.end(), id.name) != scope.end()) {
+        throw std::invalid_argument(fmt::format(
+            "{} seems to be created multiple times in the formula. This is not valid.",
+            id));
+      }
+    }
+
+    auto ids = std::vector<size_t>{};
+    for (auto&& id : e->ids) {
+      const size_t slot = slot_for(id_names, id.name);
+      if (slot == program.id_slots.size()) { program.id_slots.push_back(id.name); }
+      ids.push_back(slot);
+      scope.push_back(id.name);
+    }
+
+    size_t arg = 0;
+    if (e->pinned_at.has_value()) {
+      arg = pin(*(e->pinned_at));
+    } else if (e->phi.has_value()) {
+      arg = lower(*(e->phi));
+    } else {
+      throw std::invalid_argument("Quantifier doesn't have a subformula.");
+    }
+
+    scope.resize(scope.size() - e->ids.size());
+    return push(Instruction{op}, {arg}, ids);
+  }
+
+  /**
+   * Pins always refer to the current frame, so the pinned subformula is lowered in
+   * place of the Pin.
+   */
+  size_t pin(const ast::Pin& e) {
+    if (e.x.has_value()) {
+      slot_for(program.time_slots, e.x->name);
+      pinned_x.push_back(e.x->name);
+    }
+    if (e.f.has_value()) {
+      slot_for(program.frame_slots, e.f->name);
+      pinned_f.push_back(e.f->name);
+    }
+    const size_t ret = lower(e.phi);
+    if (e.x.has_value()) { pinned_x.pop_back(); }
+    if (e.f.has_value()) { pinned_f.pop_back(); }
+    return ret;
+  }
+
+  template <typename Arg>
+  size_t unary(OpCode op, const Arg& arg) {
+    return push(Instruction{op}, {lower(arg)});
+  }
+
+  template <typename Arg>
+  size_t binary(Instruction ins, const std::pair<Arg, Arg>& args) {
+    auto lhs = lower(args.first);
+    auto rhs = lower(args.second);
+    return push(ins, {lhs, rhs});
+  }
+
+  template <typename Op>
+  size_t nary(OpCode op, const std::shared_ptr<Op>& e) {
+    auto args = std::vector<size_t>{};
+    for (const auto& arg : e->temporal_bound_args) { args.push_back(lower(arg)); }
+    for (const auto& arg : e->args) { args.push_back(lower(arg)); }
+    // Evaluate the cheap operands first, so that lazy evaluation can skip the rest. Ties
+    // are broken by the position in the program, so that the operands are in the same
+    // order (and the instruction can be shared) regardless of how the formula lists them.
+    std::sort(args.begin(), args.end(), [&](const size_t a, const size_t b) {
+      return std::make_pair(program.code[a].cost, a) < std::make_pair(program.code[b].cost, b);
+    });
+    return push(Instruction{op}, args);
+  }
+
+  OperandRange append(const std::vector<size_t>& values) {
+    auto range = OperandRange{
+        static_cast<std::uint32_t>(program.operands.size()),
+        static_cast<std::uint32_t>(values.size())};
+    program.operands.insert(program.operands.end(), values.begin(), values.end());
+    return range;
+  }
+
+  size_t push(
+      Instruction ins,
+      const std::vector<size_t>& args = {},
+      const std::vector<size_t>& ids  = {}) {
+    auto key = InstructionKey{
+        ins.op,
+        ins.relation,
+        args,
+        ids,
+        ins.var,
+        ins.constant,
+        ins.lhs_crt,
+        ins.rhs_crt,
+        ins.lhs_scale,
+        ins.rhs_scale,
+        ins.interval};
+    if (const auto it = interned.find(key); it != interned.end()) { return it->second; }
+
+    bool pointwise = false;
+    switch (ins.op) {
+      case OpCode::Const:
+      case OpCode::CompareId:
+      case OpCode::CompareClass:
+      case OpCode::CompareProb:
+      case OpCode::CompareArea:
+      case OpCode::CompareLat:
+      case OpCode::CompareLon:
+      case OpCode::CompareED:
+      case OpCode::EmptySet:
+      case OpCode::UniverseSet:
+      case OpCode::BBox: ins.frame_local = true; break;
+      case OpCode::Not:
+      case OpCode::And:
+      case OpCode::Or:
+      case OpCode::CompareSpArea:
+      case OpCode::SpExists:
+      case OpCode::SpForall:
+      case OpCode::Complement:
+      case OpCode::Intersect:
+      case OpCode::Union:
+      case OpCode::Interior:
+      case OpCode::Closure: pointwise = true; break;
+      default: ins.frame_local = false;
+    }
+
+    const bool is_quantifier = ins.op == OpCode::Exists || ins.op == OpCode::Forall;
+
+    auto free_ids = std::vector<size_t>{};
+    if (!is_quantifier) { free_ids = ids; }
+    ins.cost = (args.empty()) ? 1.0 : 0.0;
+    for (const size_t arg : args) {
+      const auto& sub = program.code.at(arg);
+      ins.cost += sub.cost;
+      for (const size_t slot : program.free_ids(sub)) { free_ids.push_back(slot); }
+      if (pointwise) { pointwise = sub.frame_local; }
+    }
+    if (is_quantifier) {
+      free_ids.erase(
+          std::remove_if(
+              free_ids.begin(),
+              free_ids.end(),
+              [&](const size_t slot) {
+                return std::find(ids.begin(), ids.end(), slot) != ids.end();
+              }),
+          free_ids.end());
+    }
+    if (is_quantifier) {
+      for (size_t i = 0; i < ids.size(); i++) { ins.cost *= OBJECTS_PER_FRAME; }
+    }
+    std::sort(free_ids.begin(), free_ids.end());
+    free_ids.erase(std::unique(free_ids.begin(), free_ids.end()), free_ids.end());
+
+    ins.args        = append(args);
+    ins.ids         = append(ids);
+    ins.free_ids    = append(free_ids);
+    ins.frame_local = ins.frame_local || pointwise;
+    program.code.push_back(ins);
+    program.sources.emplace_back();
+    interned.emplace(std::move(key), program.code.size() - 1);
+    return program.code.size() - 1;
+  }
+};
+
+} // namespace
+
+Program percemon::monitoring::compile(const ast::Expr& phi) {
+  return compile(std::vector<ast::Expr>{phi});
+}
+
+Program percemon::monitoring::compile(const std::vector<ast::Expr>& phis) {
+  auto lowering = Lowering{};
+  for (const auto& phi : phis) {
+    lowering.id_names.clear();
+    lowering.program.roots.push_back(lowering.lower(phi));
+  }
+  return std::move(lowering.program);
+}
@@ -1,1127 +1,1079 @@
-#include "percemon/ast.hpp"
 #include "percemon/exception.hh"
 #include "percemon/fmt.hpp"
-#include "percemon/iter.hpp"
 #include "percemon/monitoring.hpp"
 #include "percemon/topo.hpp"
-#include "percemon/utils.hpp"
+
+#include "monitoring/bit_signal.hpp"
+#include "monitoring/candidates.hpp"
+#include "monitoring/changes.hpp"
+#include "monitoring/frame_buffer.hpp"
+#include "monitoring/incremental.hpp"
+#include "monitoring/profiler.hpp"
+#include "monitoring/semantics.hpp"
+#include "monitoring/thread_pool.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <deque>
-#include <functional>
-#include <itertools.hpp>
-#include <map>
-#include <numeric>
+#include <iterator>
+#include <type_traits>
 
 using namespace percemon;
 using namespace percemon::monitoring;
-namespace ds     = percemon::datastream;
-namespace utiter = percemon::iter_helpers;
-
-namespace {
-
-// TODO: Revisit if this can be configurable.
-constexpr double TOP    = std::numeric_limits<double>::infinity();
-constexpr double BOTTOM = -TOP;
-
-constexpr double bool_to_robustness(const bool v) { return (v) ? TOP : BOTTOM; }
-
-inline std::function<bool(double, double)> get_relational_fn(ast::ComparisonOp op) {
-  switch (op) {
-    case ast::ComparisonOp::GE: return std::greater_equal<double>{}; break;
-    case ast::ComparisonOp::GT: return std::greater<double>{}; break;
-    case ast::ComparisonOp::LE: return std::less_equal<double>{}; break;
-    case ast::ComparisonOp::LT: return std::less<double>{}; break;
-    default:
-      throw std::invalid_argument(
-          "Malformed expression. `==` and `!=` are not relational operations.");
-  }
-}
-
-inline std::function<bool(double, double)> get_equality_fn(ast::ComparisonOp op) {
-  switch (op) {
-    case ast::ComparisonOp::EQ: return std::equal_to<double>{}; break;
-    case ast::ComparisonOp::NE: return std::not_equal_to<double>{}; break;
-    default:
-      throw std::invalid_argument(
-          "Malformed expression. `<`,`<=`,`>`,`>=` are not equality operations.");
-  }
-}
+namespace ds = percemon::datastream;
 
-constexpr double get_lateral_distance(const topo::BoundingBox& bbox, const CRT crt) {
-  switch (crt) {
-    // Based on partial ordering defined in paper.
-    case ast::CRT::CT: return (bbox.xmax + bbox.xmin) / 2; break;
-    case ast::CRT::RM: return bbox.xmax; break; // Bottom Right
-    case ast::CRT::LM: return bbox.xmin; break; // Top Left
-    case ast::CRT::TM: return bbox.xmax; break; // Top Right
-    case ast::CRT::BM: return bbox.xmin; break; // Bottom left
-    default: return 0;
-  }
-}
+using details::BOTTOM;
+using details::TOP;
 
-constexpr double
-get_longidutnal_distance(const topo::BoundingBox& bbox, const CRT crt) {
-  switch (crt) {
-    // Based on partial ordering defined in paper.
-    case ast::CRT::CT: return (bbox.ymax + bbox.ymin) / 2; break;
-    case ast::CRT::TM: return bbox.ymin; break; // Top Right
-    case ast::CRT::BM: return bbox.ymax; break; // Bottom left
-    case ast::CRT::LM: return bbox.ymin; break; // Top Left
-    case ast::CRT::RM: return bbox.ymax; break; // Bottom Right
-    default: return 0;
-  }
-}
+namespace {
 
 struct RobustnessOp {
   // This version will be incredibly inefficient runtime-wise but will probably be very
   // space efficient, as there are minimal new structures being created, and RAII will
   // handle destruction of various intermediate vectors.
   //
-  // TODO: This can be greatly improved by compromising a little bit on space
-  // efficiency.
-  //
-  // How to improve this?
-  // ====================
-  //
-  // At every call of eval, only one frame has been added. Thus, if we store a table
-  // with a row for each subformula and a column for each frame in the bounded horizon,
-  // we can use a super efficient DP formulation (especially if we encode the DP
-  // recursion as some task graph formulation, thereby allowing easy parallelization).
-  //
-  // Why can't we do it now?
-  // =======================
-  //
-  // Expr is of type std::variant, in which, some variants are not pointers. I tried to
-  // do a std::shared_ptr<const Expr>, but for some reason, I kept getting compiler
-  // errors. I think a workaround for this will be to define all variants as some form
-  // of std::shared_ptr, while exposing functional interfaces to directly create
-  // pointers (instead of using std::make_shared).
-  //
-  const std::deque<ds::Frame>& trace;
-  const double fps;
+  // See `details::IncrementalEngine` (used by EvalStrategy::Incremental) for the
+  // version that stores a table with a row for each subformula and a column for each
+  // frame in the bounded horizon, and only computes the column for the newly added
+  // frame on each call of eval.
+  const Program& program;
+  const details::FrameSpan trace;
   const topo::BoundingBox universe;
 
   /**
-   * Maintain a map from Var_x and Var_f to size_t (double gets converted using fps)
+   * If not null, the permutations in the outermost quantifiers are evaluated in
+   * parallel, with each worker using its own copy of this object.
+   */
+  details::ThreadPool* pool;
+
+  /**
+   * If the subformulas should be evaluated lazily, i.e., only at the frames where their
+   * value can affect the robustness at the current frame.
+   */
+  bool lazy;
+
+  /**
+   * If not null, the evaluation of each instruction is recorded in the profiler.
+   */
+  details::Profiler* profiler;
+
+  /**
+   * If not null, the objects that the quantifiers bind are pruned with these guards.
    */
-  std::map<std::string, double> var_map;
+  const details::CandidateFilter* filter;
 
   /**
-   * Maintain a map from Var_id to an actual object ID in frame
+   * Values of the Var_x and Var_f in each slot.
    */
-  std::map<std::string, std::string> obj_map;
+  std::vector<double> times, frames;
+
+  /**
+   * Interned object ID bound to each Var_id slot.
+   */
+  std::vector<details::ObjectId> binding;
 
   RobustnessOp(
-      const std::deque<ds::Frame>& buffer,
-      const double fps_,
-      topo::BoundingBox universe_) :
-      trace{buffer}, fps{fps_}, universe{universe_} {};
+      const Program& program_,
+      const details::FrameSpan& buffer,
+      topo::BoundingBox universe_,
+      details::ThreadPool* pool_                = nullptr,
+      bool lazy_                                = false,
+      details::Profiler* profiler_              = nullptr,
+      const details::CandidateFilter* filter_ = nullptr) :
+      program{program_},
+      trace{buffer},
+      universe{universe_},
+      pool{pool_},
+      lazy{lazy_},
+      profiler{profiler_},
+      filter{filter_},
+      // Pins always refer to the current frame.
+      times(program.time_slots.size(), buffer.back().timestamp),
+      frames(program.frame_slots.size(), static_cast<double>(buffer.back().frame_num)),
+      binding(program.id_slots.size(), 0) {}
 
-  std::vector<double> eval(const ast::Expr& e) { return std::visit(*this, e); }
+  /**
+   * Compute the robustness signal of the instruction at `idx` in the program, at least
+   * at the demanded frames.
+   */
+  std::vector<double> eval(size_t idx, const details::Demand& demand);
 
-  std::vector<double> eval(const ast::TemporalBoundExpr& e) {
-    return std::visit(*this, e);
-  }
+  /**
+   * Compute the regions for the spatial instruction at `idx` in the program, at least
+   * at the demanded frames.
+   */
+  std::vector<topo::Region> eval_regions(size_t idx, const details::Demand& demand);
 
-  std::vector<topo::Region> eval(const ast::SpatialExpr& expr) {
-    return std::visit(*this, expr);
-  }
+  /**
+   * Compute the signal of the instruction at `idx` in the program as a bitset, at least
+   * at the demanded frames. The program must be qualitative.
+   */
+  details::BitSignal eval_bits(size_t idx, const details::Demand& demand);
 
-  std::vector<double> operator()(const ast::Const e);
-  std::vector<double> operator()(const ast::TimeBound& e);
-  std::vector<double> operator()(const ast::FrameBound& e);
-  std::vector<double> operator()(const ast::CompareId& e);
-  std::vector<double> operator()(const ast::CompareProb& e);
-  std::vector<double> operator()(const ast::CompareClass& e);
-  std::vector<double> operator()(const ast::CompareED& e);
-  std::vector<double> operator()(const ast::CompareLat& e);
-  std::vector<double> operator()(const ast::CompareLon& e);
-  std::vector<double> operator()(const ast::CompareArea& e);
-
-  std::vector<double> operator()(const ast::ExistsPtr& e);
-  std::vector<double> operator()(const ast::ForallPtr& e);
-  std::vector<double> operator()(const ast::PinPtr& e);
-  std::vector<double> operator()(const ast::NotPtr& e);
-  std::vector<double> operator()(const ast::AndPtr& e);
-  std::vector<double> operator()(const ast::OrPtr& e);
-  std::vector<double> operator()(const ast::PreviousPtr& e);
-  std::vector<double> operator()(const ast::AlwaysPtr& e);
-  std::vector<double> operator()(const ast::SometimesPtr& e);
-  std::vector<double> operator()(const ast::SincePtr& e);
-  std::vector<double> operator()(const ast::BackToPtr& e);
-
-  std::vector<double> operator()(const ast::CompareSpAreaPtr&);
-  std::vector<double> operator()(const ast::SpExistsPtr&);
-  std::vector<double> operator()(const ast::SpForallPtr&);
-
-  std::vector<double> operator()(const ast::SpArea&);
-
-  std::vector<topo::Region> operator()(const ast::EmptySet&);
-  std::vector<topo::Region> operator()(const ast::UniverseSet&);
-  std::vector<topo::Region> operator()(const ast::BBox&);
-  std::vector<topo::Region> operator()(const ast::ComplementPtr&);
-  std::vector<topo::Region> operator()(const ast::IntersectPtr&);
-  std::vector<topo::Region> operator()(const ast::UnionPtr&);
-  std::vector<topo::Region> operator()(const ast::InteriorPtr&);
-  std::vector<topo::Region> operator()(const ast::ClosurePtr&);
-  std::vector<topo::Region> operator()(const ast::SpPreviousPtr& e);
-  std::vector<topo::Region> operator()(const ast::SpAlwaysPtr& e);
-  std::vector<topo::Region> operator()(const ast::SpSometimesPtr& e);
-  std::vector<topo::Region> operator()(const ast::SpSincePtr& e);
-  std::vector<topo::Region> operator()(const ast::SpBackToPtr& e);
-};
-} // namespace
+  /**
+   * Compute the robustness of the instruction at `idx` at the current frame, with the
+   * signals in the given representation.
+   */
+  double eval_current(size_t idx, SignalMode signals) {
+    const auto demand = details::root_demand(this->trace.size(), this->lazy);
+    if (signals == SignalMode::Boolean) {
+      return details::bool_to_robustness(this->eval_bits(idx, demand).back());
+    }
+    return this->eval(idx, demand).back();
+  }
 
-OnlineMonitor::OnlineMonitor(
-    ast::Expr phi_,
-    const double fps_,
-    double x_boundary,
-    double y_boundary) :
-    phi{std::move(phi_)}, fps{fps_}, universe_x{x_boundary}, universe_y{y_boundary} {
-  // Set up the horizon. This will throw if phi is unbounded.
-  if (auto opt_hrz = get_horizon(phi, fps)) {
-    this->max_horizon = (*opt_hrz == 0) ? 1 : *opt_hrz;
-  } else {
-    throw std::invalid_argument(fmt::format(
-        "Given STQL expression doesn't have a bounded horizon. Cannot perform online monitoring for this formula."));
+ private:
+  template <typename Signal>
+  Signal eval_signal(size_t idx, const details::Demand& demand) {
+    if constexpr (std::is_same_v<Signal, details::BitSignal>) {
+      return this->eval_bits(idx, demand);
+    } else {
+      return this->eval(idx, demand);
+    }
   }
-}
 
-void OnlineMonitor::add_frame(const datastream::Frame& frame) {
-  this->buffer.push_back(frame);
-  if (this->buffer.size() > this->max_horizon) { this->buffer.pop_front(); }
-}
-void OnlineMonitor::add_frame(datastream::Frame&& frame) {
-  this->buffer.push_back(std::move(frame));
-  if (this->buffer.size() > this->max_horizon) { this->buffer.pop_front(); }
-}
+  template <typename Signal>
+  Signal quantify(size_t idx, const details::Demand& demand);
+  std::vector<double> areas(size_t idx, const details::Demand& demand);
 
-double OnlineMonitor::eval() {
-  // Trace will be traversed in reverse, so the semantics can remain the same as the
-  // future semantics. Plus, the back of the returned vector should have the robustness
-  // at the current time.
+  /**
+   * Get the object ID bound to the Var_id on the RHS of a comparison, or `nullptr` if
+   * the RHS is a literal.
+   */
+  const details::ObjectId* rhs_id(const Instruction& ins) const {
+    const auto ids = this->program.ids(ins);
+    return (ids.size() > 1) ? &(this->binding[ids[1]]) : nullptr;
+  }
+};
 
-  auto rho_op = RobustnessOp{
-      this->buffer,
-      this->fps,
-      topo::BoundingBox{0, 0, this->universe_x, this->universe_y}};
-  auto rho = rho_op.eval(this->phi);
-  return rho.back();
+topo::BoundingBox universe_of(const double x_boundary, const double y_boundary) {
+  return topo::BoundingBox{0, 0, x_boundary, y_boundary};
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::Const e) {
-  return std::vector(this->trace.size(), bool_to_robustness(e.value));
+/**
+ * Compile the formulas, after rewriting them with `ast::simplify`.
+ */
+Program compile_simplified(const std::vector<ast::Expr>& phis) {
+  auto simplified = std::vector<ast::Expr>{};
+  simplified.reserve(phis.size());
+  for (const auto& phi : phis) { simplified.push_back(ast::simplify(phi)); }
+  return compile(simplified);
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::TimeBound& e) {
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
-  for (const ds::Frame& f : this->trace) {
-    // TODO: Check if evaluating against timestamp is correct.
-    // TODO: Timestamp should be elapsed time from beginning of monitoring.
-    switch (e.op) {
-      case ast::ComparisonOp::LT:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.x)) - f.timestamp < e.bound));
-        break;
-      case ast::ComparisonOp::LE:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.x)) - f.timestamp <= e.bound));
-        break;
-      case ast::ComparisonOp::GT:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.x)) - f.timestamp > e.bound));
-        break;
-      case ast::ComparisonOp::GE:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.x)) - f.timestamp >= e.bound));
-        break;
-      default: throw std::logic_error("unreachable as EQ and NE are not possible");
-    }
+/**
+ * Replace `SignalMode::Auto` in the options with the mode used for the program.
+ */
+MonitorOptions resolve_signals(const Program& program, MonitorOptions options) {
+  const bool qualitative = is_qualitative(program);
+  if (options.signals == SignalMode::Auto) {
+    options.signals = qualitative ? SignalMode::Boolean : SignalMode::Robustness;
+  } else if (options.signals == SignalMode::Boolean && !qualitative) {
+    throw std::invalid_argument(
+        "Cannot monitor a formula with quantitative subformulas using Boolean signals.");
   }
-  return ret;
+  return options;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::FrameBound& e) {
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
-
-  for (const ds::Frame& f : this->trace) {
-    // TODO: Check if evaluating against frame_num is correct.
-    switch (e.op) {
-      case ast::ComparisonOp::LT:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.f)) - f.frame_num < e.bound));
-        break;
-      case ast::ComparisonOp::LE:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.f)) - f.frame_num <= e.bound));
-        break;
-      case ast::ComparisonOp::GT:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.f)) - f.frame_num > e.bound));
-        break;
-      case ast::ComparisonOp::GE:
-        ret.push_back(bool_to_robustness(
-            this->var_map.at(fmt::to_string(e.f)) - f.frame_num >= e.bound));
-        break;
-      default: throw std::logic_error("unreachable as EQ and NE are not possible");
-    }
+/**
+ * Check that the frames aren't buffered by time, which only the OnlineMonitor supports.
+ */
+void require_frame_buffer(const MonitorOptions& options, const char* monitor) {
+  if (options.buffer == BufferMode::Time) {
+    throw std::invalid_argument(
+        fmt::format("{} doesn't support buffering the frames by time.", monitor));
   }
-  return ret;
 }
+} // namespace
 
-std::vector<double> RobustnessOp::operator()(const ast::CompareId& e) {
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
+bool percemon::monitoring::is_qualitative(const Program& program) {
+  // Every predicate is converted to `+inf` or `-inf` by `bool_to_robustness`, and the
+  // remaining operators only take the min or max of their operands.
+  return std::all_of(program.code.begin(), program.code.end(), [](const auto& ins) {
+    return ins.op != OpCode::Const || ins.constant == TOP || ins.constant == BOTTOM;
+  });
+}
 
-  for ([[maybe_unused]] const auto& f : this->trace) {
-    // Get the object ID associated with each ID ins CompareId.
-    const auto obj_id1 = this->obj_map.at(fmt::to_string(e.lhs));
-    const auto obj_id2 = this->obj_map.at(fmt::to_string(e.rhs));
-    // TODO: Ask Mohammad if the ID constraints are correctly evaluated. Paper is
-    // vague. Do I have to check bounding boxes and other things too?
-    switch (e.op) {
-      case ast::ComparisonOp::EQ:
-        ret.push_back(bool_to_robustness(obj_id1 == obj_id2));
-        break;
-      case ast::ComparisonOp::NE:
-        ret.push_back(bool_to_robustness(obj_id1 != obj_id2));
-        break;
-      default:
-        throw std::logic_error("unreachable as constraint can only be EQ and NE");
-    }
+OnlineMonitor::OnlineMonitor(
+    ast::Expr phi_,
+    const double fps_,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options_) :
+    phi{std::move(phi_)},
+    program{compile(ast::simplify(phi))},
+    fps{fps_},
+    options{resolve_signals(program, options_)},
+    universe_x{x_boundary},
+    universe_y{y_boundary} {
+  // Set up the horizon.
+  auto horizons = std::vector<std::optional<size_t>>{};
+  if (this->options.buffer == BufferMode::Time) {
+    this->max_horizon = get_time_horizon(this->program).frames;
+    horizons          = get_time_horizons(this->program);
+  } else {
+    this->max_horizon = get_horizon(this->program, fps);
+    horizons          = get_horizons(this->program, fps);
   }
 
-  return ret;
-}
+  this->filter = std::make_unique<details::CandidateFilter>(this->program, horizons);
+  this->buffer = this->make_buffer();
 
-std::vector<double> RobustnessOp::operator()(const ast::CompareClass& e) {
-  using variant_id = std::variant<int, std::string>;
-
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
+  if (this->options.num_threads != 1) {
+    this->pool = std::make_unique<details::ThreadPool>(this->options.num_threads);
+  }
 
-  // Get tentative IDs to lookup for each frame.
-  const std::string& id1 = this->obj_map.at(fmt::to_string(e.lhs.id));
-  const variant_id id2   = std::visit(
-      utils::overloaded{
-          [](const int i) -> variant_id { return i; },
-          [&](const ast::Class& c) -> variant_id {
-            return this->obj_map.at(fmt::to_string(c.id));
-          }},
-      e.rhs);
-
-  for (const auto& f : this->trace) { // For each frame in trace,
-
-    // Check if ID1 is there in the frame.
-    const auto class1_it = f.objects.find(id1);
-    if (class1_it == f.objects.end()) { // If ID isn't in the frame: -inf
-      ret.push_back(BOTTOM);
-      continue;
-    }
-    // Get the class of the ID1 if it is there in frame.
-    int class1 = class1_it->second.object_class;
-
-    // Check if ID2 is there in the frame.
-    int class2 = -1;
-    if (auto p_int = std::get_if<int>(&id2)) {
-      // If we are comparing against a class literal, just assign it.
-      class2 = *p_int;
-    } else if (auto p_str = std::get_if<std::string>(&id2)) {
-      // If we are comparing against another class function, check if ID2 is there in
-      // the frame.
-      const auto class2_it = f.objects.find(*p_str);
-      if (class2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
-      } else {
-        class2 = class2_it->second.object_class;
-      }
-    }
+  if (profiling_enabled && this->options.profile) {
+    this->profiler = std::make_unique<details::Profiler>(this->program.code.size());
+  }
 
-    switch (e.op) {
-      case ast::ComparisonOp::EQ:
-        ret.push_back(bool_to_robustness(class1 == class2));
-        break;
-      case ast::ComparisonOp::NE:
-        ret.push_back(bool_to_robustness(class1 != class2));
-        break;
-      default:
-        throw std::logic_error("unreachable as constraint can only be EQ and NE");
-    }
+  if (this->options.strategy == EvalStrategy::Incremental) {
+    this->engine = std::make_unique<details::IncrementalEngine>(
+        this->program,
+        this->max_horizon,
+        horizons,
+        universe_of(this->universe_x, this->universe_y),
+        this->pool.get(),
+        this->options.lazy,
+        this->profiler.get(),
+        this->filter.get());
   }
 
-  assert(ret.size() == this->trace.size());
-  return ret;
+  if (this->options.skip_unchanged) {
+    this->changes = std::make_unique<details::ChangeTracker>(this->program);
+  }
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::CompareProb& e) {
-  using variant_id = std::variant<double, std::string>;
+OnlineMonitor::OnlineMonitor(OnlineMonitor&&) noexcept = default;
+OnlineMonitor::~OnlineMonitor()                         = default;
+
+std::unique_ptr<details::FrameBuffer> OnlineMonitor::make_buffer() const {
+  const bool positions = this->filter->uses_positions();
+  const bool classes   = this->filter->uses_classes();
+  if (this->options.buffer == BufferMode::Time) {
+    return std::make_unique<details::FrameBuffer>(
+        get_time_horizon(this->program),
+        this->options.max_buffered_frames,
+        positions,
+        classes);
+  }
+  return std::make_unique<details::FrameBuffer>(this->max_horizon, positions, classes);
+}
 
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
+void OnlineMonitor::add_frame(const datastream::Frame& frame) {
+  // The ring buffer drops the oldest frame once it holds `max_horizon` frames.
+  this->buffer->push_back(frame);
+  if (this->engine) { this->engine->add_frame(); }
+  if (this->changes) { this->changes->add_frame(*(this->buffer)); }
+}
+void OnlineMonitor::add_frame(datastream::Frame&& frame) {
+  // The contents of the frame are copied into the columns of the buffer anyway.
+  this->add_frame(static_cast<const datastream::Frame&>(frame));
+}
+void OnlineMonitor::add_frame(const datastream::TrackedFrame& frame) {
+  this->buffer->push_back(frame);
+  if (this->engine) { this->engine->add_frame(); }
+  if (this->changes) { this->changes->add_frame(*(this->buffer)); }
+}
+void OnlineMonitor::add_frame(const datastream::FrameView& frame) {
+  this->buffer->push_back(frame);
+  if (this->engine) { this->engine->add_frame(); }
+  if (this->changes) { this->changes->add_frame(*(this->buffer)); }
+}
 
-  // Get tentative IDs to lookup for each frame.
-  const std::string& id1      = this->obj_map.at(fmt::to_string(e.lhs.id));
-  const variant_id id2_holder = std::visit(
-      utils::overloaded{
-          [](double i) -> variant_id { return i; },
-          [&](const ast::Prob& a) -> variant_id {
-            return this->obj_map.at(fmt::to_string(a.id));
-          }},
-      e.rhs);
-  std::function<bool(double, double)> op = get_relational_fn(e.op);
-
-  for (const auto& f : this->trace) { // For each frame in trace,
-
-    // Check if ID1 is there in the frame.
-    const auto id1_it = f.objects.find(id1);
-    if (id1_it == f.objects.end()) { // If ID isn't in the frame: -inf
-      ret.push_back(BOTTOM);
-      continue;
-    }
-    auto prob1 = id1_it->second.probability * e.lhs.scale;
-
-    // Check if ID2 is needed and exists and get the comparing prob.
-    double prob2 = 0;
-    if (auto prob2_ptr = std::get_if<Prob>(&(e.rhs))) {
-      // We already have ID. Get it
-      const std::string& id2 =
-          std::get<std::string>(id2_holder); // The holder must hold strin.
-      // Check if it exists in the frame.
-      auto id2_it = f.objects.find(id2);
-      if (id2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
-      }
-      // Just need to refer to the scale.
-      prob2 = id2_it->second.probability * prob2_ptr->scale;
-    } else {
-      prob2 = std::get<double>(e.rhs);
+double OnlineMonitor::eval() {
+  if (this->changes) {
+    if (const auto rob = this->changes->cached(*(this->buffer))) {
+      this->counts.skipped++;
+      return *rob;
     }
-    ret.push_back(bool_to_robustness(op(prob1, prob2)));
   }
-
-  assert(ret.size() == this->trace.size());
-  return ret;
+  const double rob = this->eval_buffer();
+  this->counts.evaluated++;
+  if (this->changes) { this->changes->record(*(this->buffer), rob); }
+  return rob;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::CompareArea& e) {
-  using variant_id = std::variant<double, std::string>;
+double OnlineMonitor::eval_buffer() {
+  // All the intermediate regions are allocated from the arena, which is reset once the
+  // robustness is computed.
+  const topo::ArenaScope arena_scope{};
+  if (this->engine) { return this->engine->eval(this->program, *(this->buffer)); }
 
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
+  // Trace will be traversed in reverse, so the semantics can remain the same as the
+  // future semantics. Plus, the back of the returned vector should have the robustness
+  // at the current time.
 
-  // Get tentative IDs to lookup for each frame.
-  const std::string& id1      = this->obj_map.at(fmt::to_string(e.lhs.id));
-  const variant_id id2_holder = std::visit(
-      utils::overloaded{
-          [](double i) -> variant_id { return i; },
-          [&](const ast::AreaOf& a) -> variant_id {
-            return this->obj_map.at(fmt::to_string(a.id));
-          }},
-      e.rhs);
-  std::function<bool(double, double)> op = get_relational_fn(e.op);
-
-  for (const auto& f : this->trace) { // For each frame in trace,
-
-    // Check if ID1 is there in the frame.
-    const auto id1_it = f.objects.find(id1);
-    if (id1_it == f.objects.end()) { // If ID isn't in the frame: -inf
-      ret.push_back(BOTTOM);
-      continue;
-    }
-    auto bbox1 = topo::BoundingBox{id1_it->second.bbox};
-    auto area1 = topo::area(bbox1) * e.lhs.scale;
-    // Check if ID2 is needed and exists and get the comparing area.
-    double area2 = 0;
-    if (auto area2_ptr = std::get_if<AreaOf>(&(e.rhs))) {
-      // We already have ID. Get it
-      const std::string& id2 =
-          std::get<std::string>(id2_holder); // The holder must hold strin.
-      // Check if it exists in the frame.
-      auto id2_it = f.objects.find(id2);
-      if (id2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
-      }
-      auto bbox2 = topo::BoundingBox{id2_it->second.bbox};
-      // Just need to refer to the scale.
-      area2 = topo::area(bbox2) * area2_ptr->scale;
-    } else {
-      area2 = std::get<double>(e.rhs);
-    }
-    ret.push_back(bool_to_robustness(op(area1, area2)));
-  }
+  auto rho_op = RobustnessOp{
+      this->program,
+      *(this->buffer),
+      universe_of(this->universe_x, this->universe_y),
+      this->pool.get(),
+      this->options.lazy,
+      this->profiler.get(),
+      this->filter.get()};
+  return rho_op.eval_current(this->program.root(), this->options.signals);
+}
 
-  assert(ret.size() == this->trace.size());
-  return ret;
+Profile OnlineMonitor::get_profile() const {
+  if (this->profiler == nullptr) { return Profile{}; }
+  return this->profiler->snapshot();
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::CompareED& e) {
-  // TODO!!!
-  throw not_implemented_error(
-      "Semantics for comparing Euclidean distances between objects hasn't been implemented due to ambiguities in the formalization.");
+void OnlineMonitor::reset_profile() {
+  if (this->profiler != nullptr) { this->profiler->reset(); }
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::CompareLat& expr) {
-  using variant_id = std::variant<double, std::string>;
+size_t OnlineMonitor::num_object_ids() const { return this->buffer->id_table().size(); }
 
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
+std::vector<double> RobustnessOp::eval(const size_t idx, const details::Demand& demand) {
+  const details::NodeTimer timer{this->profiler, idx};
+  const auto& ins = this->program.code[idx];
+  const auto args = this->program.args(ins);
+  const auto ids  = this->program.ids(ins);
+  const size_t n  = this->trace.size();
 
-  // Get tentative IDs to lookup for each frame.
-  const std::string& id1      = this->obj_map.at(fmt::to_string(expr.lhs.id));
-  const variant_id id2_holder = std::visit(
-      utils::overloaded{
-          [](double i) -> variant_id { return i; },
-          [&](const auto& a) -> variant_id {
-            return this->obj_map.at(fmt::to_string(a.id));
-          }},
-      expr.rhs);
-  std::function<bool(double, double)> op = get_relational_fn(expr.op);
-
-  for (const auto& f : this->trace) { // For each frame in trace,
-
-    // Check if ID1 is there in the frame.
-    const auto id1_it = f.objects.find(id1);
-    if (id1_it == f.objects.end()) { // If ID isn't in the frame: -inf
-      ret.push_back(BOTTOM);
-      continue;
-    }
-    auto bbox1         = topo::BoundingBox{id1_it->second.bbox};
-    auto lat_distance1 = get_lateral_distance(bbox1, expr.lhs.crt) * expr.lhs.scale;
-
-    // Check if ID2 is needed and exists and get the comparing area.
-    double distance2 = 0;
-    if (auto rhs_lon_ptr = std::get_if<Lon>(&(expr.rhs))) {
-      // We already have ID. Get it
-      const std::string& id2 =
-          std::get<std::string>(id2_holder); // The holder must hold strin.
-      // Check if it exists in the frame.
-      auto id2_it = f.objects.find(id2);
-      if (id2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
-      }
-      auto bbox2 = topo::BoundingBox{id2_it->second.bbox};
-      // Just need to refer to the scale.
-      distance2 =
-          get_longidutnal_distance(bbox2, rhs_lon_ptr->crt) * rhs_lon_ptr->scale;
-    } else if (auto rhs_lat_ptr = std::get_if<Lat>(&(expr.rhs))) {
-      // We already have ID. Get it
-      const std::string& id2 =
-          std::get<std::string>(id2_holder); // The holder must hold strin.
-      // Check if it exists in the frame.
-      auto id2_it = f.objects.find(id2);
-      if (id2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
+  // Leaf predicates are only evaluated at the runs of demanded frames.
+  auto ret       = std::vector<double>{};
+  const auto out = [&](const size_t t) { return std::next(ret.begin(), t); };
+
+  switch (ins.op) {
+    case OpCode::Const: return std::vector<double>(n, ins.constant);
+    case OpCode::TimeBound:
+      ret = std::vector<double>(n, BOTTOM);
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_time_bound(
+            ins, this->times[ins.var], this->trace, first, last, out(first));
+      });
+      break;
+    case OpCode::FrameBound:
+      ret = std::vector<double>(n, BOTTOM);
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_frame_bound(
+            ins, this->frames[ins.var], this->trace, first, last, out(first));
+      });
+      break;
+    case OpCode::CompareId:
+      // Get the object ID associated with each ID ins CompareId.
+      return std::vector<double>(
+          n,
+          details::eval_compare_id(
+              ins, this->binding[ids[0]], this->binding[ids[1]]));
+    case OpCode::CompareClass:
+      ret = std::vector<double>(n, BOTTOM);
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_compare_class(
+            ins,
+            this->binding[ids[0]],
+            rhs_id(ins),
+            this->trace,
+            first,
+            last,
+            out(first));
+      });
+      break;
+    case OpCode::CompareProb:
+    case OpCode::CompareArea:
+    case OpCode::CompareLat:
+    case OpCode::CompareLon:
+      ret = std::vector<double>(n, BOTTOM);
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_compare_attribute(
+            ins,
+            this->binding[ids[0]],
+            rhs_id(ins),
+            this->trace,
+            first,
+            last,
+            out(first));
+      });
+      break;
+    case OpCode::CompareED:
+      // TODO!!!
+      throw not_implemented_error(
+          "Semantics for comparing Euclidean distances between objects hasn't been implemented due to ambiguities in the formalization.");
+    case OpCode::Exists:
+    case OpCode::Forall: return this->quantify<std::vector<double>>(idx, demand);
+    case OpCode::Not: return details::negate(this->eval(args[0], demand));
+    case OpCode::And:
+    case OpCode::Or: {
+      // Compute min (or max) across the robustness signals of sub formulas. When lazy,
+      // the frames at which the result is already decided are not demanded from the
+      // remaining operands.
+      const bool is_and    = ins.op == OpCode::And;
+      const double decided = is_and ? BOTTOM : TOP;
+      ret                  = std::vector<double>(n, is_and ? TOP : BOTTOM);
+      auto sub_demand      = demand;
+      for (const size_t arg : args) {
+        if (is_and) {
+          details::elementwise_min(ret, this->eval(arg, sub_demand));
+        } else {
+          details::elementwise_max(ret, this->eval(arg, sub_demand));
+        }
+        if (this->lazy && !details::prune_decided(sub_demand, ret, decided)) { break; }
       }
-      auto bbox2 = topo::BoundingBox{id2_it->second.bbox};
-      // Just need to refer to the scale.
-      distance2 = get_lateral_distance(bbox2, rhs_lon_ptr->crt) * rhs_lat_ptr->scale;
-    } else {
-      distance2 = std::get<double>(expr.rhs);
+    } break;
+    case OpCode::Previous:
+      return details::previous(this->eval(args[0], details::demand_previous(demand)));
+    case OpCode::Always:
+      return details::always(
+          this->eval(args[0], details::demand_window(demand, ins.interval)), ins.interval);
+    case OpCode::Sometimes:
+      return details::sometimes(
+          this->eval(args[0], details::demand_window(demand, ins.interval)), ins.interval);
+    case OpCode::Since: {
+      const auto sub_demand = details::demand_prefix(demand);
+      const auto x          = this->eval(args[0], sub_demand);
+      const auto y          = this->eval(args[1], sub_demand);
+      return details::since(x, y);
     }
-    ret.push_back(bool_to_robustness(op(lat_distance1, distance2)));
-  }
-
-  assert(ret.size() == this->trace.size());
-  return ret;
-}
-std::vector<double> RobustnessOp::operator()(const ast::CompareLon& expr) {
-  using variant_id = std::variant<double, std::string>;
-
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
-
-  // Get tentative IDs to lookup for each frame.
-  const std::string& id1      = this->obj_map.at(fmt::to_string(expr.lhs.id));
-  const variant_id id2_holder = std::visit(
-      utils::overloaded{
-          [](double i) -> variant_id { return i; },
-          [&](const auto& a) -> variant_id {
-            return this->obj_map.at(fmt::to_string(a.id));
-          }},
-      expr.rhs);
-  std::function<bool(double, double)> op = get_relational_fn(expr.op);
-
-  for (const auto& f : this->trace) { // For each frame in trace,
-
-    // Check if ID1 is there in the frame.
-    const auto id1_it = f.objects.find(id1);
-    if (id1_it == f.objects.end()) { // If ID isn't in the frame: -inf
-      ret.push_back(BOTTOM);
-      continue;
+    case OpCode::BackTo: {
+      const auto sub_demand = details::demand_prefix(demand);
+      auto x                = this->eval(args[0], sub_demand);
+      auto y                = this->eval(args[1], sub_demand);
+      return details::backto(std::move(x), std::move(y));
     }
-    auto bbox1         = topo::BoundingBox{id1_it->second.bbox};
-    auto lon_distance1 = get_longidutnal_distance(bbox1, expr.lhs.crt) * expr.lhs.scale;
-
-    // Check if ID2 is needed and exists and get the comparing area.
-    double distance2 = 0;
-    if (auto rhs_lon_ptr = std::get_if<Lon>(&(expr.rhs))) {
-      // We already have ID. Get it
-      const std::string& id2 =
-          std::get<std::string>(id2_holder); // The holder must hold strin.
-      // Check if it exists in the frame.
-      auto id2_it = f.objects.find(id2);
-      if (id2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
-      }
-      auto bbox2 = topo::BoundingBox{id2_it->second.bbox};
-      // Just need to refer to the scale.
-      distance2 =
-          get_longidutnal_distance(bbox2, rhs_lon_ptr->crt) * rhs_lon_ptr->scale;
-    } else if (auto rhs_lat_ptr = std::get_if<Lat>(&(expr.rhs))) {
-      // We already have ID. Get it
-      const std::string& id2 =
-          std::get<std::string>(id2_holder); // The holder must hold strin.
-      // Check if it exists in the frame.
-      auto id2_it = f.objects.find(id2);
-      if (id2_it == f.objects.end()) { // ID2 not in frame: -inf
-        ret.push_back(BOTTOM);
-        continue;
+    case OpCode::CompareSpArea: {
+      // Get subformula robustness
+      auto rob     = this->areas(args[0], demand);
+      auto rhs_rob = (args.size() > 1) ? this->areas(args[1], demand)
+                                       : std::vector<double>(n, ins.constant);
+      assert(rob.size() == rhs_rob.size());
+      ret = details::compare_areas(ins.relation, std::move(rob), rhs_rob);
+    } break;
+    case OpCode::SpExists:
+      ret.reserve(n);
+      for (auto&& region : this->eval_regions(args[0], demand)) {
+        ret.push_back(details::is_nonempty(region));
       }
-      auto bbox2 = topo::BoundingBox{id2_it->second.bbox};
-      // Just need to refer to the scale.
-      distance2 = get_lateral_distance(bbox2, rhs_lon_ptr->crt) * rhs_lat_ptr->scale;
-    } else {
-      distance2 = std::get<double>(expr.rhs);
-    }
-    ret.push_back(bool_to_robustness(op(lon_distance1, distance2)));
+      break;
+    case OpCode::SpForall: throw not_implemented_error("SpForall semantics");
+    default: throw std::logic_error("Spatial instruction evaluated as robustness.");
   }
 
-  assert(ret.size() == this->trace.size());
+  assert(ret.size() == n);
   return ret;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::ExistsPtr& e) {
+template <typename Signal>
+Signal RobustnessOp::quantify(const size_t idx, const details::Demand& demand) {
   // This is hard...
   // Need to iterate over all k-sized, repeated permutations of IDs in the Frame,
   // where k = number of IDs in the Exists quantifier.  Moreover, I need to assign
-  // the Var_id to each permutation in the map.  This cannot be parallelized yet as
-  // the current class holds the context for sub-formulas. Look into Task Graph for
-  // parallelization.
+  // the Var_id to each permutation in the slots.  As the current object holds the
+  // context for sub-formulas, the parallel version gives each worker its own copy.
+  // If the sub-formula is symmetric in the IDs, only the combinations are enumerated.
 
   // Overview:
   //
   // For each permutation of id values:
-  //    Update the obj_var map
+  //    Update the binding of the slots
   //    Compute robustness vector for sub-formula.
-  //    Maintain a running element-wise max
-
-  // Get the list of variable names
-  const auto& ids = e->ids;
-  // Check if they are already in the map. This will imply that someone is using the
-  // same variable name again. This is an error.
-  for (auto&& id : ids) {
-    if (this->obj_map.find(fmt::to_string(id)) != std::end(this->obj_map)) {
-      throw std::invalid_argument(fmt::format(
-          "{} seems to be created multiple times in the formula. This is not valid.",
-          id));
-    }
-  }
+  //    Maintain a running element-wise max (or min for Forall)
+  //    If lazy, stop once the running max (min) is TOP (BOTTOM) at the demanded frames
+  const auto& ins      = this->program.code[idx];
+  const auto ids       = this->program.ids(ins);
+  const size_t body    = this->program.args(ins)[0];
+  const bool is_exists = ins.op == OpCode::Exists;
+  const double decided = is_exists ? TOP : BOTTOM;
 
   const size_t n = std::size(trace);
   const size_t k = std::size(ids); // Number of Var_id declared in this scope.
 
-  auto running_max = std::vector<double>(n, BOTTOM);
-
-  const auto& cur_frame = this->trace.back(); // Reference to the current frame.
-  for (const auto& permutation : utiter::product(
-           cur_frame.objects,
-           k)) { // For every k-sized permutation (with repetition) of objects in
-                 // frame
-    // Populate the obj_map
-    for (auto&& [i, entry] : iter::enumerate(permutation)) {
-      this->obj_map[fmt::to_string(ids.at(i))] = entry.first;
+  // Objects in the current frame that each Var_id can be bound to.
+  const auto& frame = this->trace.back();
+  auto candidates   = std::vector<std::vector<size_t>>{};
+  static const auto no_guards = details::CandidateFilter{};
+  const auto& filter = (this->filter != nullptr) ? *(this->filter) : no_guards;
+  const auto bindings = filter.select(this->program, idx, this->trace, candidates);
+  const auto bind = [&](RobustnessOp& op, const std::vector<size_t>& choice) {
+    for (size_t i = 0; i < k; i++) {
+      op.binding[ids[i]] = frame.ids[candidates[i][choice[i]]];
     }
-    // Compute robustness of subformula.
-    auto sub_rob =
-        (e->pinned_at.has_value())
-            ? this->eval(ast::Expr{std::make_shared<ast::Pin>(*(e->pinned_at))})
-            : this->eval(*(e->phi));
-    // Do elementwise max with running_max
-    for (auto&& [a, b] : iter::zip(running_max, sub_rob)) { a = std::max(a, b); }
-  }
-
-  // Remove the Var_id in obj_map as they are out of scope.
-  for (auto&& id : ids) { obj_map.erase(fmt::to_string(id)); }
-  return running_max;
-}
+  };
 
-std::vector<double> RobustnessOp::operator()(const ast::ForallPtr& e) {
-  // See notes in Exists, and replace any reference to "max" with "min".
-  // Get the list of variable names
-  const auto& ids = e->ids;
-  // Check if they are already in the map. This will imply that someone is using the
-  // same variable name again. This is an error.
-  for (auto&& id : ids) {
-    if (this->obj_map.find(fmt::to_string(id)) != std::end(this->obj_map)) {
-      throw std::invalid_argument(fmt::format(
-          "{} seems to be created multiple times in the formula. This is not valid.",
-          id));
+  auto ret = [&]() {
+    if constexpr (std::is_same_v<Signal, details::BitSignal>) {
+      return details::BitSignal(n, !is_exists);
+    } else {
+      return std::vector<double>(n, is_exists ? BOTTOM : TOP);
     }
+  }();
+
+  if (this->pool != nullptr) {
+    // Nested quantifiers in the workers are evaluated serially.
+    auto workers = std::vector<RobustnessOp>(this->pool->size(), *this);
+    for (auto& worker : workers) { worker.pool = nullptr; }
+    return details::reduce_product(
+        *(this->pool),
+        bindings,
+        is_exists,
+        std::move(ret),
+        (this->lazy) ? &demand : nullptr,
+        [&](const size_t worker,
+            const std::vector<size_t>& choice,
+            const details::Demand& sub_demand) {
+          // The regions computed for a permutation don't outlive it.
+          const topo::ArenaScope arena_scope{};
+          auto& op = workers[worker];
+          bind(op, choice);
+          details::count_permutation(this->profiler, idx);
+          return op.eval_signal<Signal>(body, sub_demand);
+        });
   }
 
-  const size_t n = std::size(trace);
-  const size_t k = std::size(ids); // Number of Var_id declared in this scope.
-
-  auto running_min = std::vector<double>(n, TOP);
-
-  const auto& cur_frame = this->trace.back(); // Reference to the current frame.
-  for (const auto& permutation : utiter::product(
-           cur_frame.objects,
-           k)) { // For every k-sized permutation (with repetition) of objects in
-                 // frame
-    // Populate the obj_map
-    for (auto&& [i, entry] : iter::enumerate(permutation)) {
-      this->obj_map[fmt::to_string(ids.at(i))] = entry.first;
-    }
+  auto sub_demand = demand;
+  for (const auto& choice : bindings) { // For every binding of the candidates
+    // Populate the binding
+    bind(*this, choice);
+    details::count_permutation(this->profiler, idx);
     // Compute robustness of subformula.
-    auto sub_rob =
-        (e->pinned_at.has_value())
-            ? this->eval(ast::Expr{std::make_shared<ast::Pin>(*(e->pinned_at))})
-            : this->eval(*(e->phi));
-    // Do elementwise min with running_min
-    for (auto&& [a, b] : iter::zip(running_min, sub_rob)) { a = std::min(a, b); }
+    const auto sub_rob = this->eval_signal<Signal>(body, sub_demand);
+    if (is_exists) {
+      details::elementwise_max(ret, sub_rob);
+    } else {
+      details::elementwise_min(ret, sub_rob);
+    }
+    if (this->lazy && !details::prune_decided(sub_demand, ret, decided)) { break; }
   }
 
-  // Remove the Var_id in obj_map as they are out of scope.
-  for (auto&& id : ids) { obj_map.erase(fmt::to_string(id)); }
-  return running_min;
+  return ret;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::PinPtr& e) {
-  // Just update the Var_x and/or Var_f.
-  if (e->x.has_value()) {
-    this->var_map[fmt::to_string(*(e->x))] = this->trace.back().timestamp;
+details::BitSignal
+RobustnessOp::eval_bits(const size_t idx, const details::Demand& demand) {
+  const auto& ins = this->program.code[idx];
+  // The spatial predicates compare the regions of their operands, so they are
+  // evaluated as robustness and packed.
+  if (ins.op == OpCode::CompareSpArea || ins.op == OpCode::SpExists) {
+    return details::BitSignal::from_robustness(this->eval(idx, demand));
   }
-  if (e->f.has_value()) {
-    this->var_map[fmt::to_string(*(e->f))] = this->trace.back().frame_num;
+
+  const details::NodeTimer timer{this->profiler, idx};
+  const auto args = this->program.args(ins);
+  const auto ids  = this->program.ids(ins);
+  const size_t n  = this->trace.size();
+
+  // Leaf predicates are only evaluated at the runs of demanded frames.
+  auto ret       = details::BitSignal(n, false);
+  const auto out = [&](const size_t t) { return details::BitInserter{ret, t}; };
+
+  switch (ins.op) {
+    case OpCode::Const: return details::BitSignal(n, ins.constant > 0);
+    case OpCode::TimeBound:
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_time_bound(
+            ins, this->times[ins.var], this->trace, first, last, out(first));
+      });
+      break;
+    case OpCode::FrameBound:
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_frame_bound(
+            ins, this->frames[ins.var], this->trace, first, last, out(first));
+      });
+      break;
+    case OpCode::CompareId:
+      return details::BitSignal(
+          n,
+          details::eval_compare_id(ins, this->binding[ids[0]], this->binding[ids[1]]) >
+              0);
+    case OpCode::CompareClass:
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_compare_class(
+            ins,
+            this->binding[ids[0]],
+            rhs_id(ins),
+            this->trace,
+            first,
+            last,
+            out(first));
+      });
+      break;
+    case OpCode::CompareProb:
+    case OpCode::CompareArea:
+    case OpCode::CompareLat:
+    case OpCode::CompareLon:
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_compare_attribute(
+            ins,
+            this->binding[ids[0]],
+            rhs_id(ins),
+            this->trace,
+            first,
+            last,
+            out(first));
+      });
+      break;
+    case OpCode::CompareED:
+      throw not_implemented_error(
+          "Semantics for comparing Euclidean distances between objects hasn't been implemented due to ambiguities in the formalization.");
+    case OpCode::Exists:
+    case OpCode::Forall: return this->quantify<details::BitSignal>(idx, demand);
+    case OpCode::Not: return details::negate(this->eval_bits(args[0], demand));
+    case OpCode::And:
+    case OpCode::Or: {
+      const bool is_and    = ins.op == OpCode::And;
+      const double decided = is_and ? BOTTOM : TOP;
+      ret                  = details::BitSignal(n, is_and);
+      auto sub_demand      = demand;
+      for (const size_t arg : args) {
+        if (is_and) {
+          ret &= this->eval_bits(arg, sub_demand);
+        } else {
+          ret |= this->eval_bits(arg, sub_demand);
+        }
+        if ((is_and) ? ret.none() : ret.all()) { break; }
+        if (this->lazy && !details::prune_decided(sub_demand, ret, decided)) { break; }
+      }
+    } break;
+    case OpCode::Previous:
+      return details::previous(
+          this->eval_bits(args[0], details::demand_previous(demand)));
+    case OpCode::Always:
+      return details::always(
+          this->eval_bits(args[0], details::demand_window(demand, ins.interval)),
+          ins.interval);
+    case OpCode::Sometimes:
+      return details::sometimes(
+          this->eval_bits(args[0], details::demand_window(demand, ins.interval)),
+          ins.interval);
+    case OpCode::Since:
+    case OpCode::BackTo: {
+      const auto sub_demand = details::demand_prefix(demand);
+      const auto x          = this->eval_bits(args[0], sub_demand);
+      const auto y          = this->eval_bits(args[1], sub_demand);
+      return (ins.op == OpCode::Since) ? details::since(x, y) : details::backto(x, y);
+    }
+    case OpCode::SpForall: throw not_implemented_error("SpForall semantics");
+    default: throw std::logic_error("Spatial instruction evaluated as robustness.");
   }
-  return this->eval(e->phi);
-}
 
-std::vector<double> RobustnessOp::operator()(const ast::NotPtr& e) {
-  auto rob = this->eval(e->arg);
-  for (auto&& r : rob) { r = -1 * r; }
-  return rob;
+  return ret;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::AndPtr& e) {
-  // Populate robustness signals of sub formulas
-  auto subformula_robs = std::vector<std::vector<double>>{};
-  for (const auto& sub_expr : e->temporal_bound_args) {
-    auto sub_rho = this->eval(sub_expr);
-    subformula_robs.push_back(sub_rho);
-  }
-  for (const auto& sub_expr : e->args) {
-    auto sub_rho = this->eval(sub_expr);
-    subformula_robs.push_back(sub_rho);
-  }
-
-  // Compute min across the returned robustness values.
-  auto ret       = std::vector<double>{};
-  const size_t n = std::size(this->trace);
-  for (const size_t i : iter::range(n)) {
-    double rval_i = TOP;
-    for (const auto& rvec : subformula_robs) { rval_i = std::min(rvec.at(i), rval_i); }
-    ret.push_back(rval_i);
-  }
+std::vector<double> RobustnessOp::areas(const size_t idx, const details::Demand& demand) {
+  auto ret = std::vector<double>{};
+  ret.reserve(this->trace.size());
 
+  for (auto&& reg : this->eval_regions(idx, demand)) { ret.push_back(topo::area(reg)); }
   return ret;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::OrPtr& e) {
-  // Populate robustness signals of sub formulas
-  auto subformula_robs = std::vector<std::vector<double>>{};
-  for (const auto& sub_expr : e->temporal_bound_args) {
-    auto sub_rho = this->eval(sub_expr);
-    subformula_robs.push_back(sub_rho);
-  }
-  for (const auto& sub_expr : e->args) {
-    auto sub_rho = this->eval(sub_expr);
-    subformula_robs.push_back(sub_rho);
-  }
+std::vector<topo::Region>
+RobustnessOp::eval_regions(const size_t idx, const details::Demand& demand) {
+  const details::NodeTimer timer{this->profiler, idx};
+  const auto& ins = this->program.code[idx];
+  const auto args = this->program.args(ins);
+  const size_t n  = this->trace.size();
 
-  // Compute max across the returned robustness values.
-  auto ret       = std::vector<double>{};
-  const size_t n = std::size(this->trace);
-  for (const size_t i : iter::range(n)) {
-    double rval_i = BOTTOM;
-    for (const auto& rvec : subformula_robs) { rval_i = std::max(rvec.at(i), rval_i); }
-    ret.push_back(rval_i);
+  auto ret = std::vector<topo::Region>{};
+  switch (ins.op) {
+    case OpCode::EmptySet: return std::vector<topo::Region>(n, topo::Empty{});
+    case OpCode::UniverseSet: return std::vector<topo::Region>(n, topo::Universe{});
+    case OpCode::BBox: {
+      ret            = std::vector<topo::Region>(n, topo::Empty{});
+      const auto id = this->binding[this->program.ids(ins)[0]];
+      details::for_each_run(demand, [&](const size_t first, const size_t last) {
+        details::eval_bbox(id, this->trace, first, last, std::next(ret.begin(), first));
+      });
+    } break;
+    case OpCode::Complement:
+      ret = this->eval_regions(args[0], demand);
+      for (auto&& region : ret) {
+        region = topo::spatial_complement(region, this->universe);
+      }
+      break;
+    case OpCode::Intersect:
+      // Compute intersection across the regions of each subformula.
+      ret = std::vector<topo::Region>(n, topo::Universe{});
+      for (const size_t arg : args) {
+        const auto sub_regions = this->eval_regions(arg, demand);
+        for (size_t i = 0; i < n; i++) {
+          ret[i] = topo::spatial_intersect(ret[i], sub_regions.at(i));
+        }
+      }
+      break;
+    case OpCode::Union:
+      // Compute union across the regions of each subformula.
+      ret = std::vector<topo::Region>(n, topo::Empty{});
+      for (const size_t arg : args) {
+        const auto sub_regions = this->eval_regions(arg, demand);
+        for (size_t i = 0; i < n; i++) {
+          ret[i] = topo::spatial_union(ret[i], sub_regions.at(i));
+        }
+      }
+      break;
+    case OpCode::Interior:
+      ret = this->eval_regions(args[0], demand);
+      for (auto&& region : ret) { region = topo::interior(region); }
+      break;
+    case OpCode::Closure:
+      ret = this->eval_regions(args[0], demand);
+      for (auto&& region : ret) { region = topo::closure(region); }
+      break;
+    case OpCode::SpPrevious:
+      return details::sp_previous(
+          this->eval_regions(args[0], details::demand_previous(demand)));
+    case OpCode::SpAlways:
+      ret = details::sp_always(
+          this->eval_regions(args[0], details::demand_window(demand, ins.interval)),
+          ins.interval);
+      break;
+    case OpCode::SpSometimes:
+      ret = details::sp_sometimes(
+          this->eval_regions(args[0], details::demand_window(demand, ins.interval)),
+          ins.interval);
+      break;
+    case OpCode::SpSince: {
+      const auto sub_demand = details::demand_prefix(demand);
+      ret                   = details::sp_since(
+          this->eval_regions(args[0], sub_demand), this->eval_regions(args[1], sub_demand));
+    } break;
+    case OpCode::SpBackTo: {
+      const auto sub_demand = details::demand_prefix(demand);
+      ret                   = details::sp_backto(
+          this->eval_regions(args[0], sub_demand), this->eval_regions(args[1], sub_demand));
+    } break;
+    default: throw std::logic_error("Robustness instruction evaluated as regions.");
   }
 
+  assert(ret.size() == n);
   return ret;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::PreviousPtr& e) {
-  // Get subformula robustness for horizon
-  auto rho = this->eval(e->arg);
-  // Iterate from the back and keep updating
-  for (auto i = std::rbegin(rho); i != std::rend(rho); i++) {
-    if (std::next(i) != std::rend(rho)) {
-      *i = *std::next(i);
+MonitorSet::MonitorSet(
+    std::vector<ast::Expr> phis_,
+    const double fps_,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options_) :
+    phis{std::move(phis_)},
+    program{compile_simplified(phis)},
+    fps{fps_},
+    options{resolve_signals(program, options_)},
+    max_horizon{1},
+    universe_x{x_boundary},
+    universe_y{y_boundary} {
+  require_frame_buffer(this->options, "MonitorSet");
+  for (const auto& phi : this->phis) {
+    if (auto opt_hrz = get_horizon(ast::simplify(phi), fps)) {
+      // Each formula sees as many frames as it would in its own OnlineMonitor.
+      this->horizons.push_back((*opt_hrz == 0) ? 1 : *opt_hrz);
+      this->max_horizon = std::max(this->max_horizon, this->horizons.back());
     } else {
-      *i = BOTTOM;
+      throw std::invalid_argument(fmt::format(
+          "Given STQL expression doesn't have a bounded horizon. Cannot perform online monitoring for this formula."));
     }
   }
-  return rho;
-}
 
-std::vector<double> RobustnessOp::operator()(const ast::AlwaysPtr& e) {
-  // Just do min across the entire horizon, and hope that the bounds hold.
-  // TODO: Verify this.
-  auto rho = this->eval(e->arg);
-  // DP-style min, start from the front
-  double running_min = TOP;
-  for (auto&& i : rho) {
-    running_min = std::min(i, running_min);
-    i           = running_min;
-  }
-  return rho;
-}
+  const auto horizons = get_horizons(this->program, fps);
+  this->filter = std::make_unique<details::CandidateFilter>(this->program, horizons);
+  this->buffer = std::make_unique<details::FrameBuffer>(
+      this->max_horizon,
+      this->filter->uses_positions(),
+      this->filter->uses_classes());
 
-std::vector<double> RobustnessOp::operator()(const ast::SometimesPtr& e) {
-  // Just do max across the entire horizon, and hope that the bounds hold.
-  // TODO: Verify this.
-  auto rho = this->eval(e->arg);
-  // DP-style max, start from the front
-  double running_max = BOTTOM;
-  for (auto&& i : rho) {
-    running_max = std::max(i, running_max);
-    i           = running_max;
+  if (this->options.num_threads != 1) {
+    this->pool = std::make_unique<details::ThreadPool>(this->options.num_threads);
   }
-  return rho;
-}
-
-std::vector<double> RobustnessOp::operator()(const ast::SincePtr& e) {
-  // Ported from signal-temporal-logic:
-  //  Unbounded Until but parse the signal in reverse order.
-  //  Since the actual loop computes Until robustness DP-style in reverse, we have
-  //  to do it from front.
-  const auto x = this->eval(e->args.first);
-  const auto y = this->eval(e->args.second);
-
-  auto rob = std::vector<double>{};
-
-  double prev      = TOP;
-  double max_right = BOTTOM;
 
-  for (const auto&& [i, j] : iter::zip(x, y)) {
-    max_right = std::max(max_right, j);
-    prev      = std::max({j, std::min(i, prev), -max_right});
-    rob.push_back(prev);
+  if (this->options.strategy == EvalStrategy::Incremental) {
+    this->engine = std::make_unique<details::IncrementalEngine>(
+        this->program,
+        this->max_horizon,
+        horizons,
+        universe_of(this->universe_x, this->universe_y),
+        this->pool.get(),
+        this->options.lazy,
+        nullptr,
+        this->filter.get());
   }
-
-  return rob;
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::BackToPtr& e) {
-  // phi1 BackTo phi2 is the dual for Since.
-  // phi1 B phi1 === ~(~phi1 S ~phi2)
-  // TODO: VERIFY!!!
-  auto x = this->eval(e->args.first);      // Get rho(phi1)
-  for (auto&& rob : x) { rob = -1 * rob; } // Get rho(~phi1)
-
-  auto y = this->eval(e->args.second);     // Get rho(phi2)
-  for (auto&& rob : y) { rob = -1 * rob; } // Get rho(~phi2)
-
-  // Get since.
-  auto rob = std::vector<double>{};
+MonitorSet::MonitorSet(MonitorSet&&) noexcept = default;
+MonitorSet::~MonitorSet()                      = default;
 
-  double prev      = TOP;
-  double max_right = BOTTOM;
-
-  for (const auto&& [i, j] : iter::zip(x, y)) {
-    max_right = std::max(max_right, j);
-    prev      = std::max({j, std::min(i, prev), -max_right});
-    rob.push_back(-prev); // Negate on the fly
-  }
-
-  return rob;
+void MonitorSet::add_frame(const datastream::Frame& frame) {
+  this->buffer->push_back(frame);
+  if (this->engine) { this->engine->add_frame(); }
 }
-
-std::vector<double> RobustnessOp::operator()(const ast::CompareSpAreaPtr& expr) {
-  // Get subformula robustness
-  auto rob     = this->operator()(expr->lhs);
-  auto rhs_rob = std::visit(
-      utils::overloaded{
-          [n = this->trace.size()](const double a) {
-            return std::vector<double>(n, a);
-          },
-          [&](const ast::SpArea& a) {
-            return this->operator()(a);
-          }},
-      expr->rhs);
-
-  assert(rob.size() == rhs_rob.size());
-
-  const auto op = get_relational_fn(expr->op);
-
-  for (auto&& [left, right] : iter::zip(rob, rhs_rob)) {
-    bool r = op(left, right);
-    left   = bool_to_robustness(r);
-  }
-
-  assert(rob.size() == this->trace.size());
-  return rob;
+void MonitorSet::add_frame(datastream::Frame&& frame) {
+  this->add_frame(static_cast<const datastream::Frame&>(frame));
 }
-
-std::vector<double> RobustnessOp::operator()(const ast::SpExistsPtr& expr) {
-  auto rob = std::vector<double>{};
-  rob.reserve(this->trace.size());
-
-  auto sub_regions = this->eval(expr->arg);
-
-  for (auto&& region : sub_regions) {
-    auto simplified = topo::simplify_region(region);
-    rob.push_back(bool_to_robustness(!std::holds_alternative<topo::Empty>(simplified)));
-  }
-
-  assert(rob.size() == this->trace.size());
-  return rob;
+void MonitorSet::add_frame(const datastream::TrackedFrame& frame) {
+  this->buffer->push_back(frame);
+  if (this->engine) { this->engine->add_frame(); }
 }
-
-std::vector<double> RobustnessOp::operator()(const ast::SpForallPtr&) {
-  throw not_implemented_error("SpForall semantics");
+void MonitorSet::add_frame(const datastream::FrameView& frame) {
+  this->buffer->push_back(frame);
+  if (this->engine) { this->engine->add_frame(); }
 }
 
-std::vector<double> RobustnessOp::operator()(const ast::SpArea& expr) {
-  auto ret = std::vector<double>{};
-  ret.reserve(this->trace.size());
+std::vector<double> MonitorSet::eval() {
+  const topo::ArenaScope arena_scope{};
+  if (this->engine) {
+    return this->engine->eval_all(this->program, *(this->buffer), this->horizons);
+  }
 
-  auto sub_region_vec = this->eval(expr.arg);
-  for (auto&& reg : sub_region_vec) { ret.push_back(topo::area(reg)); }
+  auto ret = std::vector<double>{};
+  ret.reserve(this->program.roots.size());
+  for (size_t i = 0; i < this->program.roots.size(); i++) {
+    const auto trace = details::FrameSpan{*(this->buffer), this->horizons[i]};
+    auto rho_op      = RobustnessOp{
+        this->program,
+        trace,
+        universe_of(this->universe_x, this->universe_y),
+        this->pool.get(),
+        this->options.lazy,
+        nullptr,
+        this->filter.get()};
+    ret.push_back(rho_op.eval_current(this->program.roots[i], this->options.signals));
+  }
   return ret;
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::EmptySet&) {
-  auto vec = std::vector<topo::Region>(this->trace.size(), topo::Empty{});
-  assert(vec.size() == this->trace.size());
-  return vec;
-}
-
-std::vector<topo::Region> RobustnessOp::operator()(const ast::UniverseSet&) {
-  auto vec = std::vector<topo::Region>(this->trace.size(), topo::Universe{});
-  assert(vec.size() == this->trace.size());
-  return vec;
-}
-
-std::vector<topo::Region> RobustnessOp::operator()(const ast::BBox& expr) {
-  auto vec = std::vector<topo::Region>{};
-  vec.reserve(this->trace.size());
-
-  auto id = this->obj_map.at(fmt::to_string(expr.id));
-
-  for (auto&& frame : this->trace) {
-    // Check if ID is in frame.
-    auto iter = frame.objects.find(id);
-    if (iter != frame.objects.end()) {
-      vec.emplace_back(topo::BoundingBox{iter->second.bbox});
-    } else {
-      vec.emplace_back(topo::Empty{});
+namespace percemon::monitoring::details {
+
+/**
+ * State of one of the streams in a MultiStreamMonitor.
+ */
+struct StreamState {
+  FrameBuffer buffer;
+  std::optional<IncrementalEngine> engine;
+  const CandidateFilter* filter;
+
+  StreamState(
+      const Program& program,
+      size_t horizon,
+      const std::vector<std::optional<size_t>>& horizons,
+      const topo::BoundingBox& universe,
+      const MonitorOptions& options,
+      const CandidateFilter& filter_) :
+      buffer{horizon, filter_.uses_positions(), filter_.uses_classes()},
+      filter{&filter_} {
+    if (options.strategy == EvalStrategy::Incremental) {
+      engine.emplace(
+          program, horizon, horizons, universe, nullptr, options.lazy, nullptr, filter);
     }
   }
 
-  assert(vec.size() == this->trace.size());
-  return vec;
-}
-
-std::vector<topo::Region> RobustnessOp::operator()(const ast::ComplementPtr& expr) {
-  auto rob = this->eval(expr->arg);
-
-  for (auto&& region : rob) {
-    region = topo::spatial_complement(region, this->universe);
+  void add_frame(const datastream::Frame& frame) {
+    buffer.push_back(frame);
+    if (engine) { engine->add_frame(); }
+  }
+  void add_frame(const datastream::TrackedFrame& frame) {
+    buffer.push_back(frame);
+    if (engine) { engine->add_frame(); }
+  }
+  void add_frame(const datastream::FrameView& frame) {
+    buffer.push_back(frame);
+    if (engine) { engine->add_frame(); }
   }
 
-  assert(rob.size() == this->trace.size());
-  return rob;
-}
-
-std::vector<topo::Region> RobustnessOp::operator()(const ast::IntersectPtr& expr) {
-  std::vector<std::vector<topo::Region>> sub_regions;
-
-  // Initialize region vec to each subformula.
-  for (auto&& sub_expr : expr->args) { sub_regions.push_back(this->eval(sub_expr)); }
+  /**
+   * Compute the robustness at the last frame in the buffer, without parallelizing the
+   * quantifiers.
+   */
+  double eval(
+      const Program& program,
+      const topo::BoundingBox& universe,
+      const MonitorOptions& options) {
+    // The regions computed for a stream don't outlive its evaluation.
+    const topo::ArenaScope arena_scope{};
+    if (engine) { return engine->eval(program, buffer); }
+    auto rho_op =
+        RobustnessOp{program, buffer, universe, nullptr, options.lazy, nullptr, filter};
+    return rho_op.eval_current(program.root(), options.signals);
+  }
+};
 
-  // Compute intersection across the
-  auto rob       = std::vector<topo::Region>{};
-  const size_t n = this->trace.size();
+} // namespace percemon::monitoring::details
 
-  for (const size_t i : iter::range(n)) {
-    topo::Region reg = topo::Universe{};
-    for (const auto& region_vec : sub_regions) {
-      reg = topo::spatial_intersect(reg, region_vec.at(i));
-    }
-    rob.push_back(reg);
+MultiStreamMonitor::MultiStreamMonitor(
+    ast::Expr phi_,
+    size_t num_streams_,
+    const double fps_,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options_) :
+    phi{std::move(phi_)},
+    program{compile(ast::simplify(phi))},
+    fps{fps_},
+    options{resolve_signals(program, options_)},
+    universe_x{x_boundary},
+    universe_y{y_boundary} {
+  require_frame_buffer(this->options, "MultiStreamMonitor");
+  this->max_horizon = get_horizon(this->program, fps);
+
+  this->streams.reserve(num_streams_);
+  const auto universe = universe_of(this->universe_x, this->universe_y);
+  const auto horizons = get_horizons(this->program, fps);
+  this->filter = std::make_unique<details::CandidateFilter>(this->program, horizons);
+  for (size_t i = 0; i < num_streams_; i++) {
+    this->streams.emplace_back(
+        this->program,
+        this->max_horizon,
+        horizons,
+        universe,
+        this->options,
+        *(this->filter));
   }
 
-  assert(rob.size() == this->trace.size());
-  return rob;
+  if (this->options.num_threads != 1) {
+    this->pool = std::make_unique<details::ThreadPool>(this->options.num_threads);
+  }
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::UnionPtr& expr) {
-  std::vector<std::vector<topo::Region>> sub_regions;
-
-  // Initialize region vec to each subformula.
-  for (auto&& sub_expr : expr->args) { sub_regions.push_back(this->eval(sub_expr)); }
+MultiStreamMonitor::MultiStreamMonitor(MultiStreamMonitor&&) noexcept = default;
+MultiStreamMonitor::~MultiStreamMonitor()                              = default;
 
-  // Compute unionion across the
-  auto rob       = std::vector<topo::Region>{};
-  const size_t n = this->trace.size();
+size_t MultiStreamMonitor::num_streams() const { return this->streams.size(); }
 
-  for (const size_t i : iter::range(n)) {
-    topo::Region reg = topo::Empty{};
-    for (const auto& region_vec : sub_regions) {
-      reg = topo::spatial_union(reg, region_vec.at(i));
-    }
-    rob.push_back(reg);
+void MultiStreamMonitor::add_frames(const std::vector<datastream::Frame>& frames) {
+  if (frames.size() != this->streams.size()) {
+    throw std::invalid_argument(fmt::format(
+        "Expected one frame for each of the {} streams, got {} frames.",
+        this->streams.size(),
+        frames.size()));
   }
-
-  assert(rob.size() == this->trace.size());
-  return rob;
+  for (size_t i = 0; i < frames.size(); i++) { this->streams[i].add_frame(frames[i]); }
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::InteriorPtr& expr) {
-  auto rob = this->eval(expr->arg);
-  for (auto&& region : rob) { region = topo::interior(region); }
-  assert(rob.size() == this->trace.size());
-  return rob;
+void MultiStreamMonitor::add_frames(const std::vector<datastream::TrackedFrame>& frames) {
+  if (frames.size() != this->streams.size()) {
+    throw std::invalid_argument(fmt::format(
+        "Expected one frame for each of the {} streams, got {} frames.",
+        this->streams.size(),
+        frames.size()));
+  }
+  for (size_t i = 0; i < frames.size(); i++) { this->streams[i].add_frame(frames[i]); }
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::ClosurePtr& expr) {
-  auto rob = this->eval(expr->arg);
-  for (auto&& region : rob) { region = topo::closure(region); }
-  assert(rob.size() == this->trace.size());
-  return rob;
+void MultiStreamMonitor::add_frame(size_t stream, const datastream::Frame& frame) {
+  this->streams.at(stream).add_frame(frame);
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::SpPreviousPtr& e) {
-  auto sub = this->eval(e->arg);
-  // Iterate from the back and keep updating
-  for (auto i = std::rbegin(sub); i != std::rend(sub); i++) {
-    if (std::next(i) != std::rend(sub)) {
-      *i = *std::next(i);
-    } else {
-      *i = topo::Empty{};
-    }
-  }
-  return sub;
+void MultiStreamMonitor::add_frame(size_t stream, const datastream::TrackedFrame& frame) {
+  this->streams.at(stream).add_frame(frame);
 }
 
-namespace {
-constexpr size_t interval_size(const FrameInterval& expr) {
-  switch (expr.bound) {
-    case FrameInterval::OPEN: return expr.high - 1;
-    case FrameInterval::LOPEN:
-    case FrameInterval::ROPEN: return expr.high;
-    case FrameInterval::CLOSED: return expr.high + 1;
-  }
+void MultiStreamMonitor::add_frame(size_t stream, const datastream::FrameView& frame) {
+  this->streams.at(stream).add_frame(frame);
 }
 
-} // namespace
-
-std::vector<topo::Region> RobustnessOp::operator()(const ast::SpAlwaysPtr& e) {
-  auto sub   = this->eval(e->arg);
-  auto width = this->trace.size();
-  if (e->interval.has_value()) {
-    width = std::min(interval_size(*(e->interval)), width);
-  }
+std::vector<double> MultiStreamMonitor::eval_all() {
+  auto ret            = std::vector<double>(this->streams.size(), BOTTOM);
+  const auto universe = universe_of(this->universe_x, this->universe_y);
 
-  auto ret = std::vector<topo::Region>{};
-  ret.reserve(this->trace.size());
-  {
-    // Fill up the first "width" -1  amount with running intersection
-    topo::Region running_intersection = topo::Universe{};
-    for (auto i : iter::range(width - 1)) {
-      running_intersection = topo::spatial_intersect(running_intersection, sub.at(i));
-      ret.push_back(running_intersection);
-    }
-  }
+  const auto eval_stream = [&](size_t, size_t i) {
+    ret[i] = this->streams[i].eval(this->program, universe, this->options);
+  };
 
-  // Now we need to maintain a sliding window of stuff.
-  for (auto&& window : iter::sliding_window(sub, width)) {
-    // Compute intersection in each window and push it to the back of ret.
-    // TODO: Optimize
-    topo::Region running_intersection = topo::Universe{};
-    for (auto&& r : window) {
-      running_intersection = topo::spatial_intersect(running_intersection, r);
-    }
-    ret.push_back(running_intersection);
+  if (this->pool) {
+    this->pool->run(this->streams.size(), eval_stream);
+  } else {
+    for (size_t i = 0; i < this->streams.size(); i++) { eval_stream(0, i); }
   }
-
-  assert(ret.size() == this->trace.size());
   return ret;
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::SpSometimesPtr& e) {
-  auto sub   = this->eval(e->arg);
-  auto width = this->trace.size();
-  if (e->interval.has_value()) {
-    width = std::min(interval_size(*(e->interval)), width);
-  }
+namespace {
 
-  auto ret = std::vector<topo::Region>{};
-  ret.reserve(this->trace.size());
-  {
-    // Fill up the first "width" -1  amount with running union
-    topo::Region running_union = topo::Empty{};
-    for (auto i : iter::range(width - 1)) {
-      running_union = topo::spatial_union(running_union, sub.at(i));
-      ret.push_back(running_union);
-    }
+/**
+ * Evaluate the frames of the trace in `[first, last)`, as the online monitor would,
+ * after replaying the `horizon - 1` frames before `first` to fill the buffer.
+ */
+template <typename FrameT>
+void evaluate_chunk(
+    const Program& program,
+    const std::vector<FrameT>& trace,
+    size_t horizon,
+    const std::vector<std::optional<size_t>>& horizons,
+    const topo::BoundingBox& universe,
+    const MonitorOptions& options,
+    const details::CandidateFilter& filter,
+    size_t first,
+    size_t last,
+    std::vector<double>& out) {
+  auto state =
+      details::StreamState{program, horizon, horizons, universe, options, filter};
+  for (size_t i = (first + 1 > horizon) ? first + 1 - horizon : 0; i < last; i++) {
+    state.add_frame(trace[i]);
+    if (i >= first) { out[i] = state.eval(program, universe, options); }
   }
+}
 
-  // Now we need to maintain a sliding window of stuff.
-  for (auto&& window : iter::sliding_window(sub, width)) {
-    // Compute union in each window and push it to the back of ret.
-    // TODO: Optimize
-    topo::Region running_union = topo::Universe{};
-    for (auto&& r : window) { running_union = topo::spatial_union(running_union, r); }
-    ret.push_back(running_union);
+template <typename FrameT>
+std::vector<double> evaluate_trace_impl(
+    const ast::Expr& phi,
+    const std::vector<FrameT>& trace,
+    const double fps,
+    double x_boundary,
+    double y_boundary,
+    const MonitorOptions& options_) {
+  require_frame_buffer(options_, "evaluate_trace");
+  const auto program   = compile(ast::simplify(phi));
+  const auto options   = resolve_signals(program, options_);
+  const size_t horizon = get_horizon(program, fps);
+  const auto horizons  = get_horizons(program, fps);
+  const auto universe  = universe_of(x_boundary, y_boundary);
+  const auto filter    = details::CandidateFilter{program, horizons};
+
+  auto ret       = std::vector<double>(trace.size(), BOTTOM);
+  const size_t n = trace.size();
+  if (n == 0) { return ret; }
+
+  auto pool = std::unique_ptr<details::ThreadPool>{};
+  if (options.num_threads != 1) {
+    pool = std::make_unique<details::ThreadPool>(options.num_threads);
+  }
+  // Each chunk replays `horizon - 1` frames of the previous one, so chunks are kept at
+  // least a few horizons long for the overlap to be a small part of the work.
+  const size_t workers    = pool ? pool->size() : 1;
+  const size_t num_chunks = std::max<size_t>(1, std::min(workers, n / (4 * horizon)));
+  const size_t chunk_size = (n + num_chunks - 1) / num_chunks;
+
+  const auto run_chunk = [&](size_t, size_t c) {
+    const size_t first = c * chunk_size;
+    const size_t last  = std::min(n, first + chunk_size);
+    evaluate_chunk(
+        program, trace, horizon, horizons, universe, options, filter, first, last, ret);
+  };
+  if (pool && num_chunks > 1) {
+    pool->run(num_chunks, run_chunk);
+  } else {
+    for (size_t c = 0; c < num_chunks; c++) { run_chunk(0, c); }
   }
-
-  assert(ret.size() == this->trace.size());
   return ret;
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::SpSincePtr& e) {
-  auto lhs = this->eval(e->args.first);
-  auto rhs = this->eval(e->args.second);
-
-  // TODO: Deal with bounded.
-  auto vec = std::vector<topo::Region>{};
+} // namespace
 
-  topo::Region prev = topo::Universe{};
-  for (const auto&& [i, j] : iter::zip(lhs, rhs)) {
-    auto tmp = topo::spatial_intersect(i, prev);
-    prev     = topo::spatial_union(tmp, j);
-    vec.push_back(prev);
-  }
-  assert(vec.size() == this->trace.size());
-  return vec;
+std::vector<double> percemon::monitoring::evaluate_trace(
+    const ast::Expr& phi,
+    const std::vector<datastream::Frame>& trace,
+    const double fps,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options) {
+  return evaluate_trace_impl(phi, trace, fps, x_boundary, y_boundary, options);
 }
 
-std::vector<topo::Region> RobustnessOp::operator()(const ast::SpBackToPtr& e) {
-  auto lhs = this->eval(e->args.first);
-  auto rhs = this->eval(e->args.second);
-
-  // TODO: Deal with bounded.
-  auto vec = std::vector<topo::Region>{};
+std::vector<double> percemon::monitoring::evaluate_trace(
+    const ast::Expr& phi,
+    const std::vector<datastream::TrackedFrame>& trace,
+    const double fps,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options) {
+  return evaluate_trace_impl(phi, trace, fps, x_boundary, y_boundary, options);
+}
 
-  topo::Region prev = topo::Empty{};
-  for (const auto&& [i, j] : iter::zip(lhs, rhs)) {
-    auto tmp = topo::spatial_union(i, prev);
-    prev     = topo::spatial_intersect(tmp, j);
-    vec.push_back(prev);
-  }
-  assert(vec.size() == this->trace.size());
-  return vec;
+std::vector<double> percemon::monitoring::evaluate_trace(
+    const ast::Expr& phi,
+    const std::vector<datastream::FrameView>& trace,
+    const double fps,
+    double x_boundary,
+    double y_boundary,
+    MonitorOptions options) {
+  return evaluate_trace_impl(phi, trace, fps, x_boundary, y_boundary, options);
 }
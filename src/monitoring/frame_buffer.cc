@@ -0,0 +1,554 @@
+#include "monitoring/frame_buffer.hpp"
+#include "monitoring/snapshot.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+using namespace percemon::monitoring::details;
+namespace ds = percemon::datastream;
+
+namespace {
+
+/**
+ * Get the track ID whose decimal form (without leading zeros) is `name`, if any.
+ */
+std::optional<ds::TrackId> parse_track(const std::string& name) {
+  if (name.empty() || (name[0] == '0' && name.size() > 1)) { return {}; }
+  auto track           = ds::TrackId{0};
+  const auto last      = name.data() + name.size();
+  const auto [ptr, ec] = std::from_chars(name.data(), last, track);
+  if (ec != std::errc{} || ptr != last) { return {}; }
+  return track;
+}
+
+/**
+ * Insert the key into the map, reusing a spare node if there is one.
+ */
+template <typename Map, typename Key>
+void insert_reusing(
+    Map& map,
+    std::vector<typename Map::node_type>& spare,
+    const Key& key,
+    ObjectId id) {
+  if (spare.empty()) {
+    map.emplace(key, id);
+    return;
+  }
+  auto node = std::move(spare.back());
+  spare.pop_back();
+  node.key()    = key;
+  node.mapped() = id;
+  map.insert(std::move(node));
+}
+
+} // namespace
+
+ObjectId IdTable::intern(const std::string& name) {
+  // Decimal strings are the same objects as their track IDs.
+  if (const auto track = parse_track(name)) { return this->intern(*track); }
+  const auto it = this->ids.find(name);
+  if (it != this->ids.end()) {
+    this->acquire(it->second);
+    return it->second;
+  }
+  const ObjectId id      = this->assign();
+  this->entries[id].name = name;
+  insert_reusing(this->ids, this->spare_names, name, id);
+  return id;
+}
+
+ObjectId IdTable::intern(ds::TrackId track) {
+  const auto it = this->tracks.find(track);
+  if (it != this->tracks.end()) {
+    this->acquire(it->second);
+    return it->second;
+  }
+  const ObjectId id       = this->assign();
+  this->entries[id].track = track;
+  insert_reusing(this->tracks, this->spare_tracks, track, id);
+  return id;
+}
+
+ObjectId IdTable::assign() {
+  ObjectId id = 0;
+  if (!this->free_ids.empty()) {
+    id = this->free_ids.back();
+    this->free_ids.pop_back();
+  } else if (this->entries.size() <= std::numeric_limits<ObjectId>::max()) {
+    id = static_cast<ObjectId>(this->entries.size());
+    this->entries.emplace_back();
+  } else {
+    throw std::invalid_argument(
+        "Too many distinct objects in the buffered frames to assign them IDs");
+  }
+  this->entries[id].refs = 1;
+  this->entries[id].live = true;
+  return id;
+}
+
+void IdTable::release(ObjectId id) {
+  if (--this->entries[id].refs == 0) { this->free(id); }
+}
+
+void IdTable::release_unused() {
+  for (size_t id = 0; id < this->entries.size(); id++) {
+    if (this->entries[id].refs == 0) { this->free(static_cast<ObjectId>(id)); }
+  }
+}
+
+void IdTable::free(ObjectId id) {
+  auto& entry = this->entries[id];
+  if (entry.live && entry.track.has_value()) {
+    this->spare_tracks.push_back(this->tracks.extract(*entry.track));
+  } else if (entry.live) {
+    this->spare_names.push_back(this->ids.extract(entry.name));
+  }
+  // The name keeps its storage for the next object ID.
+  entry.name.clear();
+  entry.track.reset();
+  entry.refs = 0;
+  entry.live = false;
+  this->free_ids.push_back(id);
+}
+
+std::vector<ObjectId> IdTable::saved_ids() const {
+  auto ret  = std::vector<ObjectId>(this->entries.size(), NOT_SAVED);
+  auto next = ObjectId{0};
+  for (size_t id = 0; id < this->entries.size(); id++) {
+    if (this->entries[id].live) { ret[id] = next++; }
+  }
+  return ret;
+}
+
+void IdTable::save(SnapshotWriter& out) const {
+  out.write<std::uint64_t>(this->size());
+  for (const auto& entry : this->entries) {
+    if (!entry.live) { continue; }
+    out.write<std::uint8_t>(entry.track.has_value());
+    if (entry.track.has_value()) {
+      out.write<std::uint64_t>(*entry.track);
+    } else {
+      out.write(entry.name);
+    }
+  }
+}
+
+void IdTable::load(SnapshotReader& in) {
+  auto table_          = IdTable{};
+  const auto num_names = in.read<std::uint64_t>();
+  if (num_names > std::uint64_t{std::numeric_limits<ObjectId>::max()} + 1) {
+    throw std::invalid_argument("Snapshot has too many object IDs.");
+  }
+  for (std::uint64_t i = 0; i < num_names; i++) {
+    const auto id = static_cast<ObjectId>(i);
+    auto& entry   = table_.entries.emplace_back();
+    entry.live    = true;
+    bool valid    = false;
+    if (in.read<std::uint8_t>() != 0) {
+      entry.track = in.read<std::uint64_t>();
+      valid       = table_.tracks.emplace(*entry.track, id).second;
+    } else {
+      // Strings that are track IDs are only saved as tracks.
+      entry.name = in.read_string();
+      valid      = !parse_track(entry.name) &&
+                   table_.ids.emplace(entry.name, id).second;
+    }
+    if (!valid) {
+      throw std::invalid_argument("Snapshot has malformed or duplicate object IDs.");
+    }
+  }
+  *this = std::move(table_);
+}
+
+void FrameColumns::clear() {
+  this->ids.clear();
+  this->object_class.clear();
+  this->probability.clear();
+  this->xmin.clear();
+  this->xmax.clear();
+  this->ymin.clear();
+  this->ymax.clear();
+}
+
+void FrameColumns::push_back(ObjectId id, const ds::Object& obj) {
+  this->push_back(id, obj.object_class, obj.probability, obj.bbox);
+}
+
+void FrameColumns::push_back(
+    ObjectId id,
+    int object_class_,
+    double probability_,
+    const ds::BoundingBox& bbox_) {
+  this->ids.push_back(id);
+  this->object_class.push_back(object_class_);
+  this->probability.push_back(probability_);
+  this->xmin.push_back(bbox_.xmin);
+  this->xmax.push_back(bbox_.xmax);
+  this->ymin.push_back(bbox_.ymin);
+  this->ymax.push_back(bbox_.ymax);
+}
+
+namespace {
+
+/**
+ * Largest number of cells along each side of a GridIndex.
+ */
+constexpr size_t MAX_GRID_SIDE = 64;
+
+} // namespace
+
+void GridIndex::build(const FrameColumns& frame) {
+  const size_t n = frame.size();
+  // About one object per cell, if they are spread out.
+  const auto side = std::clamp<size_t>(
+      static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n)))),
+      1,
+      MAX_GRID_SIDE);
+  this->cols = side;
+  this->rows = side;
+
+  // Boxes aren't necessarily clipped to the frame.
+  size_t width = frame.size_x, height = frame.size_y;
+  for (size_t i = 0; i < n; i++) {
+    width  = std::max(width, frame.xmax[i] + 1);
+    height = std::max(height, frame.ymax[i] + 1);
+  }
+  this->cell_width  = static_cast<double>(std::max<size_t>(width, 1)) / this->cols;
+  this->cell_height = static_cast<double>(std::max<size_t>(height, 1)) / this->rows;
+
+  // Count the objects in each cell, then place them with the prefix sums.
+  const auto for_each_cell = [&](size_t i, auto&& fn) {
+    const size_t c0 = this->col_of(frame.xmin[i]), c1 = this->col_of(frame.xmax[i]);
+    const size_t r0 = this->row_of(frame.ymin[i]), r1 = this->row_of(frame.ymax[i]);
+    for (size_t r = r0; r <= r1; r++) {
+      for (size_t c = c0; c <= c1; c++) { fn(r * this->cols + c); }
+    }
+  };
+  this->offsets.assign(this->cols * this->rows + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    for_each_cell(i, [&](size_t cell) { this->offsets[cell + 1]++; });
+  }
+  for (size_t cell = 1; cell < this->offsets.size(); cell++) {
+    this->offsets[cell] += this->offsets[cell - 1];
+  }
+  this->entries.resize(this->offsets.back());
+  for (size_t i = 0; i < n; i++) {
+    // Each cell is filled from its start, and `offsets[cell]` is restored below.
+    for_each_cell(i, [&](size_t cell) { this->entries[this->offsets[cell]++] = i; });
+  }
+  for (size_t cell = this->offsets.size() - 1; cell > 0; cell--) {
+    this->offsets[cell] = this->offsets[cell - 1];
+  }
+  this->offsets[0] = 0;
+}
+
+void GridIndex::query(
+    double xlo,
+    double xhi,
+    double ylo,
+    double yhi,
+    std::vector<size_t>& out) const {
+  if (this->cols == 0 || xlo > xhi || ylo > yhi) { return; }
+  const size_t first = out.size();
+  const size_t c0 = this->col_of(xlo), c1 = this->col_of(xhi);
+  const size_t r0 = this->row_of(ylo), r1 = this->row_of(yhi);
+  for (size_t r = r0; r <= r1; r++) {
+    for (size_t c = c0; c <= c1; c++) {
+      const size_t cell = r * this->cols + c;
+      out.insert(
+          out.end(),
+          std::next(this->entries.begin(), this->offsets[cell]),
+          std::next(this->entries.begin(), this->offsets[cell + 1]));
+    }
+  }
+  // Objects overlapping several of the cells are listed once.
+  const auto begin = std::next(out.begin(), first);
+  std::sort(begin, out.end());
+  out.erase(std::unique(begin, out.end()), out.end());
+}
+
+size_t GridIndex::col_of(double x) const {
+  if (!(x > 0)) { return 0; }
+  return std::min(this->cols - 1, static_cast<size_t>(std::min(
+                                      x / this->cell_width,
+                                      static_cast<double>(this->cols))));
+}
+
+size_t GridIndex::row_of(double y) const {
+  if (!(y > 0)) { return 0; }
+  return std::min(this->rows - 1, static_cast<size_t>(std::min(
+                                      y / this->cell_height,
+                                      static_cast<double>(this->rows))));
+}
+
+void ClassIndex::build(const FrameColumns& frame) {
+  // Sorting by class, then index, keeps the objects of each class in order.
+  this->scratch.clear();
+  for (size_t i = 0; i < frame.size(); i++) {
+    this->scratch.emplace_back(frame.object_class[i], i);
+  }
+  std::sort(this->scratch.begin(), this->scratch.end());
+
+  this->classes.clear();
+  this->offsets.clear();
+  this->entries.clear();
+  for (const auto& [object_class, i] : this->scratch) {
+    if (this->classes.empty() || this->classes.back() != object_class) {
+      this->classes.push_back(object_class);
+      this->offsets.push_back(this->entries.size());
+    }
+    this->entries.push_back(i);
+  }
+  this->offsets.push_back(this->entries.size());
+}
+
+void ClassIndex::query(int object_class, std::vector<size_t>& out) const {
+  const auto it =
+      std::lower_bound(this->classes.begin(), this->classes.end(), object_class);
+  if (it == this->classes.end() || *it != object_class) { return; }
+  const auto c = static_cast<size_t>(it - this->classes.begin());
+  out.insert(
+      out.end(),
+      std::next(this->entries.begin(), this->offsets[c]),
+      std::next(this->entries.begin(), this->offsets[c + 1]));
+}
+
+FrameBuffer::FrameBuffer(size_t capacity, bool index_boxes, bool index_classes) :
+    indexed{index_boxes}, partitioned{index_classes} {
+  if (capacity == 0) {
+    throw std::invalid_argument("Frame buffer must have a capacity of at least 1");
+  }
+  this->slots.resize(capacity);
+}
+
+FrameBuffer::FrameBuffer(
+    const TimeHorizon& horizon,
+    size_t max_frames_,
+    bool index_boxes,
+    bool index_classes) :
+    FrameBuffer{horizon.frames, index_boxes, index_classes} {
+  this->by_time    = horizon;
+  this->max_frames = std::max(max_frames_, horizon.frames);
+}
+
+FrameColumns& FrameBuffer::next_slot(double timestamp) {
+  if (this->by_time.has_value()) {
+    // The frame was checked by `check_push`, so the buffer has room for it once the
+    // expired frames are dropped.
+    const size_t expired = this->num_expired(timestamp);
+    for (size_t i = 0; i < expired; i++) { this->pop_front(); }
+    if (this->count == this->slots.size()) { this->grow(); }
+  } else if (this->count == this->slots.size()) {
+    // Overwrite the oldest frame.
+    this->pop_front();
+  }
+  if (!this->empty() && timestamp < this->back().timestamp) { this->descents++; }
+  return this->slots[(this->start + this->count++) % this->slots.size()];
+}
+
+void FrameBuffer::check_push(double timestamp) const {
+  if (!this->by_time.has_value()) { return; }
+  if (!this->empty() && timestamp < this->back().timestamp) {
+    throw std::invalid_argument(
+        "Frames must be added in the order of their timestamps to a buffer indexed by "
+        "time");
+  }
+  if (this->count - this->num_expired(timestamp) == this->max_frames) {
+    throw std::invalid_argument(
+        "Buffer indexed by time can't hold more than " +
+        std::to_string(this->max_frames) +
+        " frames (the timestamps of the frames may have stopped advancing)");
+  }
+}
+
+void FrameBuffer::pop_front() {
+  if (this->count > 1 && (*this)[1].timestamp < (*this)[0].timestamp) {
+    this->descents--;
+  }
+  for (const ObjectId id : (*this)[0].ids) { this->table.release(id); }
+  this->start = (this->start + 1) % this->slots.size();
+  this->count--;
+}
+
+size_t FrameBuffer::num_expired(double timestamp) const {
+  // Offsets are counted from the new frame. As the timestamps don't decrease, the
+  // frames within the time bound are the ones after the first of them.
+  size_t keep = this->by_time->frames - 1;
+  if (const auto& seconds = this->by_time->seconds) {
+    size_t lo = 0, hi = this->count;
+    while (lo < hi) {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (timestamp - (*this)[mid].timestamp > *seconds) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    keep += this->count - lo;
+  }
+  return this->count > keep ? this->count - keep : 0;
+}
+
+void FrameBuffer::grow() {
+  // Unroll the ring, so that the new slots come after the newest frame.
+  std::rotate(
+      this->slots.begin(),
+      std::next(this->slots.begin(), static_cast<std::ptrdiff_t>(this->start)),
+      this->slots.end());
+  this->start = 0;
+  this->slots.resize(std::min(2 * this->slots.size(), this->max_frames));
+}
+
+void FrameBuffer::push_back(const ds::Frame& frame) { this->push(frame); }
+void FrameBuffer::push_back(const ds::TrackedFrame& frame) { this->push(frame); }
+
+void FrameBuffer::push_back(const ds::FrameView& frame) {
+  this->check_push(frame.timestamp);
+  this->view_scratch.clear();
+  for (size_t i = 0; i < frame.num_objects; i++) {
+    this->view_scratch.emplace_back(this->table.intern(frame.ids[i]), i);
+  }
+  std::sort(this->view_scratch.begin(), this->view_scratch.end());
+  const auto dup = std::adjacent_find(
+      this->view_scratch.begin(), this->view_scratch.end(), [](const auto& a, const auto& b) {
+        return a.first == b.first;
+      });
+  if (dup != this->view_scratch.end()) {
+    for (const auto& [id, i] : this->view_scratch) { this->table.release(id); }
+    throw std::invalid_argument(
+        "Frame view has multiple objects with the track ID " +
+        std::to_string(frame.ids[dup->second]));
+  }
+
+  auto& slot     = this->next_slot(frame.timestamp);
+  slot.timestamp = frame.timestamp;
+  slot.frame_num = frame.frame_num;
+  slot.size_x    = frame.size_x;
+  slot.size_y    = frame.size_y;
+  slot.clear();
+  for (const auto& [id, i] : this->view_scratch) {
+    slot.push_back(id, frame.object_class[i], frame.probability[i], frame.bbox[i]);
+  }
+  this->index_back();
+}
+
+template <typename FrameT>
+void FrameBuffer::push(const FrameT& frame) {
+  this->check_push(frame.timestamp);
+  this->scratch.clear();
+  for (const auto& [key, obj] : frame.objects) {
+    this->scratch.emplace_back(this->table.intern(key), &obj);
+  }
+  std::sort(this->scratch.begin(), this->scratch.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+
+  auto& slot     = this->next_slot(frame.timestamp);
+  slot.timestamp = frame.timestamp;
+  slot.frame_num = frame.frame_num;
+  slot.size_x    = frame.size_x;
+  slot.size_y    = frame.size_y;
+  slot.clear();
+  for (const auto& [id, obj] : this->scratch) { slot.push_back(id, *obj); }
+  this->index_back();
+}
+
+void FrameBuffer::index_back() {
+  if (this->indexed) { this->index.build(this->back()); }
+  if (this->partitioned) { this->classes.build(this->back()); }
+}
+
+void FrameBuffer::save(SnapshotWriter& out) const {
+  const auto saved = this->table.saved_ids();
+  auto ids         = std::vector<ObjectId>{};
+  out.write<std::uint64_t>(this->count);
+  for (size_t i = 0; i < this->count; i++) {
+    const auto& frame = (*this)[i];
+    out.write(frame.timestamp);
+    out.write<std::uint64_t>(frame.frame_num);
+    out.write<std::uint64_t>(frame.size_x);
+    out.write<std::uint64_t>(frame.size_y);
+    ids.clear();
+    for (const ObjectId id : frame.ids) { ids.push_back(saved[id]); }
+    out.write_array(ids);
+    out.write_array(frame.object_class);
+    out.write_array(frame.probability);
+    out.write_array(frame.xmin);
+    out.write_array(frame.xmax);
+    out.write_array(frame.ymin);
+    out.write_array(frame.ymax);
+  }
+  this->table.save(out);
+}
+
+void FrameBuffer::load(SnapshotReader& in) {
+  const auto num_frames = in.read<std::uint64_t>();
+  const size_t limit =
+      this->by_time.has_value() ? this->max_frames : this->slots.size();
+  if (num_frames > limit) {
+    throw std::invalid_argument("Snapshot has more frames than the buffer can hold.");
+  }
+
+  // The slots are only overwritten once the whole snapshot is read.
+  auto frames = std::vector<FrameColumns>(num_frames);
+  for (auto& frame : frames) {
+    frame.timestamp = in.read<double>();
+    frame.frame_num = static_cast<size_t>(in.read<std::uint64_t>());
+    frame.size_x    = static_cast<size_t>(in.read<std::uint64_t>());
+    frame.size_y    = static_cast<size_t>(in.read<std::uint64_t>());
+    in.read_array(frame.ids);
+    in.read_array(frame.object_class);
+    in.read_array(frame.probability);
+    in.read_array(frame.xmin);
+    in.read_array(frame.xmax);
+    in.read_array(frame.ymin);
+    in.read_array(frame.ymax);
+    const size_t n = frame.ids.size();
+    if (frame.object_class.size() != n || frame.probability.size() != n ||
+        frame.xmin.size() != n || frame.xmax.size() != n || frame.ymin.size() != n ||
+        frame.ymax.size() != n) {
+      throw std::invalid_argument(
+          "Snapshot has a frame with columns of unequal sizes.");
+    }
+  }
+  auto table_ = IdTable{};
+  table_.load(in);
+
+  // The objects must be sorted by their ID, for `FrameColumns::find`.
+  for (const auto& frame : frames) {
+    for (size_t i = 0; i < frame.size(); i++) {
+      const bool sorted = i == 0 || frame.ids[i - 1] < frame.ids[i];
+      if (!table_.contains(frame.ids[i]) || !sorted) {
+        throw std::invalid_argument("Snapshot has a frame with malformed object IDs.");
+      }
+      table_.acquire(frame.ids[i]);
+    }
+  }
+  table_.release_unused();
+
+  size_t descents_ = 0;
+  for (size_t i = 1; i < frames.size(); i++) {
+    if (frames[i].timestamp < frames[i - 1].timestamp) { descents_++; }
+  }
+  if (this->by_time.has_value() && descents_ > 0) {
+    throw std::invalid_argument(
+        "Snapshot has frames out of the order of their timestamps.");
+  }
+
+  if (frames.size() > this->slots.size()) { this->slots.resize(frames.size()); }
+  for (size_t i = 0; i < this->slots.size(); i++) {
+    if (i < frames.size()) {
+      this->slots[i] = std::move(frames[i]);
+    } else {
+      this->slots[i].clear();
+    }
+  }
+  this->start = 0;
+  this->count    = frames.size();
+  this->descents = descents_;
+  this->table    = std::move(table_);
+  if (this->count > 0) { this->index_back(); }
+}
@@ -0,0 +1,445 @@
+/**
+ * The buffer of frames used by the monitors.
+ *
+ * Instead of a `std::deque<datastream::Frame>`, where each frame holds a
+ * `std::map<std::string, Object>`, the buffer is a preallocated ring of `capacity`
+ * slots that store the objects in each frame in struct-of-arrays form. The object IDs
+ * are interned to dense integers once, when the frame is added, so that the leaf
+ * predicates only compare integers and read from contiguous arrays. As the slots (and
+ * their arrays) are reused when the ring rotates, adding a frame doesn't allocate once
+ * the arrays are large enough for the number of objects in the frames. Adding a
+ * `datastream::FrameView` only copies the arrays of the view into the slot, so it
+ * doesn't allocate at all once the buffer has held as many objects, even if the objects
+ * have new track IDs (see `IdTable`).
+ *
+ * A buffer indexed by time (for `BufferMode::Time`) instead evicts the frames that are
+ * out of its time horizon, and doubles the ring when it is full of frames within it.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_FRAME_BUFFER_HPP__
+#define __PERCEMON_MONITORING_FRAME_BUFFER_HPP__
+
+#include "percemon/datastream.hpp"
+#include "percemon/monitoring.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+/**
+ * Dense integer assigned to an object ID.
+ */
+using ObjectId = std::uint32_t;
+
+class SnapshotReader;
+class SnapshotWriter;
+
+/**
+ * Table assigning a dense integer to each object ID in the frames buffered by a
+ * monitor. Each integer counts the buffered frames that reference it, and once none do,
+ * it is freed and reused for the next new object ID, so that the table is bounded by
+ * the objects in the buffer rather than by all the objects seen.
+ */
+class IdTable {
+ public:
+  /**
+   * Get the integer assigned to `name`, assigning a free one if it is new, and count a
+   * reference to it.
+   *
+   * @throws std::invalid_argument if every integer is in use.
+   */
+  ObjectId intern(const std::string& name);
+  /**
+   * Get the integer assigned to the track ID, which is the same as the one for its
+   * decimal string, and count a reference to it. Track IDs aren't formatted as strings,
+   * so this doesn't allocate once the table has held as many objects.
+   */
+  ObjectId intern(datastream::TrackId track);
+
+  /**
+   * Count another reference to an integer in use.
+   */
+  void acquire(ObjectId id) { entries[id].refs++; }
+  /**
+   * Drop a reference to an integer, freeing it if it was the last.
+   */
+  void release(ObjectId id);
+
+  /**
+   * Number of integers in use.
+   */
+  [[nodiscard]] size_t size() const { return entries.size() - free_ids.size(); }
+  /**
+   * One past the largest integer assigned so far.
+   */
+  [[nodiscard]] size_t capacity() const { return entries.size(); }
+  [[nodiscard]] bool contains(ObjectId id) const {
+    return id < entries.size() && entries[id].live;
+  }
+
+  /**
+   * Marks the free integers in `saved_ids`.
+   */
+  static constexpr ObjectId NOT_SAVED = std::numeric_limits<ObjectId>::max();
+  /**
+   * The integer that each integer is renumbered to in a snapshot, which only has the
+   * integers in use: their rank among them, or `NOT_SAVED` for the free ones. As the
+   * order is kept, the objects of a frame stay sorted by their ID.
+   */
+  [[nodiscard]] std::vector<ObjectId> saved_ids() const;
+
+  /**
+   * Write the object IDs of the integers in use, which are renumbered by `saved_ids`.
+   */
+  void save(SnapshotWriter& out) const;
+  /**
+   * Replace the table with the one saved in a snapshot, where no integer has any
+   * references. The references of the buffered frames must then be counted with
+   * `acquire`, and the rest freed with `release_unused`.
+   *
+   * @throws std::invalid_argument if the snapshot is malformed.
+   */
+  void load(SnapshotReader& in);
+  /**
+   * Free the integers that have no references.
+   */
+  void release_unused();
+
+ private:
+  /**
+   * An object ID, which is either a track ID (including the strings that are the
+   * decimal form of one) or a string.
+   */
+  struct Entry {
+    std::optional<datastream::TrackId> track;
+    std::string name;
+    size_t refs = 0;
+    bool live   = false;
+  };
+
+  using NameMap  = std::unordered_map<std::string, ObjectId>;
+  using TrackMap = std::unordered_map<datastream::TrackId, ObjectId>;
+
+  NameMap ids;
+  TrackMap tracks;
+  std::vector<Entry> entries;
+  /**
+   * Integers that were freed, which are reused before new ones are assigned.
+   */
+  std::vector<ObjectId> free_ids;
+  /**
+   * Nodes extracted from the maps for the freed integers, which are reused for the new
+   * object IDs, so that interning them doesn't allocate once the table has held as
+   * many objects.
+   */
+  std::vector<NameMap::node_type> spare_names;
+  std::vector<TrackMap::node_type> spare_tracks;
+
+  /**
+   * Assign a free integer, with one reference.
+   */
+  ObjectId assign();
+  void free(ObjectId id);
+};
+
+/**
+ * The contents of a frame, with the objects stored in struct-of-arrays form and sorted
+ * by their interned ID.
+ */
+struct FrameColumns {
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  double timestamp = 0.0;
+  size_t frame_num = 0;
+  size_t size_x = 0, size_y = 0;
+
+  std::vector<ObjectId> ids;
+  std::vector<int> object_class;
+  std::vector<double> probability;
+  std::vector<size_t> xmin, xmax, ymin, ymax;
+
+  [[nodiscard]] size_t size() const { return ids.size(); }
+
+  /**
+   * Index of the object with the given ID in the arrays, or `npos` if it isn't in the
+   * frame.
+   */
+  [[nodiscard]] size_t find(ObjectId id) const {
+    const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+    return (it != ids.end() && *it == id) ? static_cast<size_t>(it - ids.begin()) : npos;
+  }
+
+  [[nodiscard]] datastream::BoundingBox bbox(size_t i) const {
+    return datastream::BoundingBox{xmin[i], xmax[i], ymin[i], ymax[i]};
+  }
+
+  /**
+   * Remove the objects, keeping the allocated storage.
+   */
+  void clear();
+  void push_back(ObjectId id, const datastream::Object& obj);
+  void push_back(
+      ObjectId id,
+      int object_class,
+      double probability,
+      const datastream::BoundingBox& bbox);
+};
+
+/**
+ * Uniform grid over the bounding boxes of the objects in a frame, so that the objects
+ * near a rectangle can be found without checking every object. Each object is listed
+ * in all the cells that its box overlaps.
+ */
+class GridIndex {
+ public:
+  /**
+   * Index the objects in the frame, reusing the storage of the previous frame.
+   */
+  void build(const FrameColumns& frame);
+
+  /**
+   * Append the indices (in the arrays of the indexed frame) of the objects whose boxes
+   * may intersect `[xlo, xhi] x [ylo, yhi]` to `out`, in increasing order. Every object
+   * whose box intersects the rectangle is included, along with some of the objects in
+   * the same cells.
+   */
+  void query(double xlo, double xhi, double ylo, double yhi, std::vector<size_t>& out)
+      const;
+
+ private:
+  size_t cols = 0, rows = 0;
+  double cell_width = 1.0, cell_height = 1.0;
+  /**
+   * The objects in cell `c` (in row-major order) are `entries[offsets[c]]` to
+   * `entries[offsets[c + 1] - 1]`.
+   */
+  std::vector<size_t> offsets, entries;
+
+  [[nodiscard]] size_t col_of(double x) const;
+  [[nodiscard]] size_t row_of(double y) const;
+};
+
+/**
+ * Partition of the objects in a frame by their class, so that the objects of a class
+ * can be listed without checking every object.
+ */
+class ClassIndex {
+ public:
+  /**
+   * Index the objects in the frame, reusing the storage of the previous frame.
+   */
+  void build(const FrameColumns& frame);
+
+  /**
+   * Append the indices (in the arrays of the indexed frame) of the objects of the
+   * class to `out`, in increasing order.
+   */
+  void query(int object_class, std::vector<size_t>& out) const;
+
+ private:
+  /**
+   * The distinct classes in the frame, in increasing order. The objects of
+   * `classes[c]` are `entries[offsets[c]]` to `entries[offsets[c + 1] - 1]`.
+   */
+  std::vector<int> classes;
+  std::vector<size_t> offsets, entries;
+  std::vector<std::pair<int, size_t>> scratch;
+};
+
+class FrameBuffer {
+ public:
+  FrameBuffer() = delete;
+  /**
+   * Create a buffer that holds the last `capacity` frames. If `index_boxes`, the
+   * bounding boxes of the objects in the current frame are indexed in a GridIndex, and
+   * if `index_classes`, the objects are partitioned by class in a ClassIndex.
+   */
+  explicit FrameBuffer(
+      size_t capacity,
+      bool index_boxes   = false,
+      bool index_classes = false);
+  /**
+   * Create a buffer that holds the frames in the time horizon, from the timestamp of
+   * the newest frame, starting with room for `horizon.frames` frames and growing to at
+   * most `max_frames` frames.
+   */
+  FrameBuffer(
+      const TimeHorizon& horizon,
+      size_t max_frames,
+      bool index_boxes   = false,
+      bool index_classes = false);
+
+  /**
+   * Add a frame to the back of the buffer, overwriting the frame at the front if the
+   * buffer is full.
+   *
+   * @throws std::invalid_argument if the buffer is indexed by time and the frame is
+   * older than the frame at the back, or the buffer would hold more than `max_frames`
+   * frames.
+   */
+  void push_back(const datastream::Frame& frame);
+  void push_back(const datastream::TrackedFrame& frame);
+  /**
+   * Add a frame whose objects are in the caller's arrays. This doesn't allocate once the
+   * slots are large enough for the objects and the table of object IDs for the objects
+   * in the buffer.
+   *
+   * @throws std::invalid_argument if the frame has duplicate track IDs, in which case
+   * the buffer is unchanged.
+   */
+  void push_back(const datastream::FrameView& frame);
+
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] size_t capacity() const { return slots.size(); }
+  [[nodiscard]] bool empty() const { return count == 0; }
+  /**
+   * If the timestamps of the frames in the buffer don't decrease, so that the frames
+   * within a time bound of the current frame can be found by binary search.
+   */
+  [[nodiscard]] bool ordered() const { return descents == 0; }
+
+  /**
+   * The `i`th oldest frame in the buffer.
+   */
+  const FrameColumns& operator[](size_t i) const {
+    return slots[(start + i) % slots.size()];
+  }
+  [[nodiscard]] const FrameColumns& back() const { return (*this)[count - 1]; }
+
+  [[nodiscard]] const IdTable& id_table() const { return table; }
+
+  /**
+   * Write the frames in the buffer, from the oldest, and the table of object IDs to a
+   * snapshot, where the IDs are renumbered by `IdTable::saved_ids`, so that its size
+   * only depends on the objects in the buffer.
+   */
+  void save(SnapshotWriter& out) const;
+  /**
+   * Replace the frames and the table of object IDs with the ones saved in a snapshot.
+   *
+   * @throws std::invalid_argument if the snapshot is malformed, or has more frames than
+   * the capacity of the buffer (unless it is indexed by time) or, if the buffer is
+   * indexed by time, frames out of order.
+   */
+  void load(SnapshotReader& in);
+
+  /**
+   * Index of the boxes in the current frame, or `nullptr` if they aren't indexed.
+   */
+  [[nodiscard]] const GridIndex* grid() const { return (indexed) ? &index : nullptr; }
+  /**
+   * Partition of the objects in the current frame by class, or `nullptr` if they
+   * aren't partitioned.
+   */
+  [[nodiscard]] const ClassIndex* partitions() const {
+    return (partitioned) ? &classes : nullptr;
+  }
+
+ private:
+  std::vector<FrameColumns> slots;
+  /**
+   * Index of the slot with the oldest frame.
+   */
+  size_t start = 0;
+  size_t count = 0;
+  /**
+   * Number of consecutive frames in the buffer whose timestamps decrease.
+   */
+  size_t descents = 0;
+  std::optional<TimeHorizon> by_time;
+  /**
+   * Most frames a buffer indexed by time can hold.
+   */
+  size_t max_frames = 0;
+
+  IdTable table;
+
+  bool indexed;
+  GridIndex index;
+  bool partitioned;
+  ClassIndex classes;
+
+  /**
+   * Scratch space for sorting the objects in a frame by their interned ID.
+   */
+  std::vector<std::pair<ObjectId, const datastream::Object*>> scratch;
+  /**
+   * Scratch space for sorting the objects in a FrameView, by their index in the view.
+   */
+  std::vector<std::pair<ObjectId, size_t>> view_scratch;
+
+  /**
+   * Make room for a frame with the given timestamp, and get the slot for it.
+   */
+  FrameColumns& next_slot(double timestamp);
+  /**
+   * Check that a frame with the given timestamp can be added.
+   *
+   * @throws std::invalid_argument if the buffer is indexed by time, and the frame is
+   * older than the frame at the back or the buffer can't grow to hold it.
+   */
+  void check_push(double timestamp) const;
+  /**
+   * Drop the frame at the front, and its references to the object IDs.
+   */
+  void pop_front();
+  /**
+   * Number of frames at the front that are out of the time horizon of a frame with the
+   * given timestamp.
+   */
+  [[nodiscard]] size_t num_expired(double timestamp) const;
+  void grow();
+  /**
+   * Index the frame that was just written to the back of the buffer.
+   */
+  void index_back();
+
+  template <typename FrameT>
+  void push(const FrameT& frame);
+};
+
+/**
+ * View of the most recent frames in a buffer, which is how the monitors see the history
+ * of a formula whose horizon is shorter than the buffer.
+ */
+class FrameSpan {
+ public:
+  /**
+   * View of all the frames in the buffer.
+   */
+  FrameSpan(const FrameBuffer& buffer_) : FrameSpan{buffer_, buffer_.size()} {}
+  /**
+   * View of the last `count` frames in the buffer (or all of them, if there are fewer).
+   */
+  FrameSpan(const FrameBuffer& buffer_, size_t count_) :
+      buffer{&buffer_},
+      count{std::min(count_, buffer_.size())},
+      offset{buffer_.size() - count} {}
+
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] bool empty() const { return count == 0; }
+
+  const FrameColumns& operator[](size_t i) const { return (*buffer)[offset + i]; }
+  [[nodiscard]] const FrameColumns& back() const { return buffer->back(); }
+  [[nodiscard]] const GridIndex* grid() const { return buffer->grid(); }
+  [[nodiscard]] const ClassIndex* partitions() const { return buffer->partitions(); }
+  [[nodiscard]] bool ordered() const { return buffer->ordered(); }
+
+ private:
+  const FrameBuffer* buffer;
+  size_t count;
+  size_t offset;
+};
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_FRAME_BUFFER_HPP__ */
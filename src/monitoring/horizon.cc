@@ -1,310 +1,426 @@
-
 #include "percemon/monitoring.hpp"
 
+#include "monitoring/semantics.hpp"
+
 #include <algorithm>
-#include <numeric>
+#include <cmath>
+#include <limits>
 #include <optional>
 #include <stdexcept>
-#include <variant>
+#include <utility>
+#include <vector>
 
-#include "percemon/utils.hpp"
+using namespace percemon;
+using namespace percemon::monitoring;
 
-using namespace percemon::ast;
-namespace utils = percemon::utils;
+// The horizon of a formula is the number of frames, back from the current one, that the
+// monitor needs to buffer to compute the robustness at the current frame.
+//
+// Pins always refer to the current frame, so a guard `f - C_FRAME ~ c` (or
+// `x - C_TIME ~ c`) evaluated at a frame constrains the offset of the frame from the
+// current frame. For each instruction, we compute the oldest offset at which its value
+// can affect the robustness of a root, top-down from the roots (which are only needed
+// at offset 0):
+//
+// - Previous shifts the offsets of its operand by 1, and the bounded temporal operators
+//   by the last frame in their interval.
+// - The unbounded temporal operators, Since and BackTo range over all the frames in the
+//   buffer, so their operands are needed at all offsets. These don't make the buffer
+//   any longer, as the operators range over whatever the rest of the formula keeps.
+// - The operands of an And are only needed at the offsets where its guards may all be
+//   true, as it is decided (BOTTOM) elsewhere, and the operands of an Or where its
+//   guards may all be false. This is what bounds a `G (guard => phi)` or
+//   `F (guard & phi)` to the frames in the guard.
+//
+// The sets of offsets at which the guards may be true (or false) are computed exactly
+// for frame bounds, assuming consecutive frame numbers, and rounded outward for time
+// bounds, assuming `fps` frames per second. Frames dropped from the stream only make
+// the offset of a frame smaller than its distance in frame numbers (or time), so the
+// offsets are then over-approximated.
+//
+// Without a frame rate (for `BufferMode::Time`), the time bounds are kept as sets of
+// times since the frame instead, and a window under a time guard is counted from the
+// oldest frame within the guard, with the buffer keeping the frames by their
+// timestamps. The offsets and times of a guard are each over-approximated on their own,
+// with the constraints of the other kind taken as possibly true or false anywhere.
 
 namespace {
 
-constexpr std::optional<size_t> max(std::optional<size_t> x, std::optional<size_t> y) {
-  if (x.has_value() && y.has_value()) {
-    return std::make_optional(std::max(*x, *y));
-  } else {
-    return {};
-  }
-}
-
-constexpr std::optional<size_t>
-add_horizons(std::optional<size_t> x, std::optional<size_t> y) {
-  // Adds horizon lengths
-  // TODO: verify...
-  if (x.has_value() && y.has_value()) {
-    // if both are bounded, just add them
-    return std::make_optional(*x + *y);
-  } else if (x.has_value()) {
-    // Example of x => y or x & y, should bound the horizon with x
-    return x;
-  } else if (y.has_value()) {
-    // Example of y => x or y & x, should bound the horizon with y
-    return y;
+constexpr size_t INF    = std::numeric_limits<size_t>::max();
+constexpr double FOREVER = std::numeric_limits<double>::infinity();
+
+/**
+ * Tolerance, in frames, when converting time bounds to offsets, as the differences of
+ * timestamps are off by rounding errors.
+ */
+constexpr double TIME_TOLERANCE = 1e-6;
+
+/**
+ * A set of offsets from the current frame, as sorted and disjoint closed intervals.
+ * The last interval is unbounded if it ends at INF.
+ */
+using OffsetSet = std::vector<std::pair<size_t, size_t>>;
+
+OffsetSet all_offsets() { return OffsetSet{{0, INF}}; }
+
+OffsetSet complement(const OffsetSet& set) {
+  auto ret   = OffsetSet{};
+  size_t lo  = 0;
+  bool ended = false;
+  for (const auto& [first, last] : set) {
+    if (first > lo) { ret.emplace_back(lo, first - 1); }
+    if (last == INF) {
+      ended = true;
+      break;
+    }
+    lo = last + 1;
   }
-  // Both are unbounded.
-  return {};
+  if (!ended) { ret.emplace_back(lo, INF); }
+  return ret;
 }
 
-constexpr std::optional<size_t>
-interval_intersection(std::optional<size_t> x, std::optional<size_t> y) {
-  if (x.has_value() && y.has_value()) {
-    // NOTE: max is a safe/conservative bet, instead of computing
-    // the actual intercestion of [0, x] & [0, y] = [0, min(x,y)]...
-    // TODO: Check...
-    return std::make_optional(std::max(*x, *y));
-  } else if (x.has_value()) {
-    // Here, x is bounded but y isn't. Which implies the formula is bounded by x
-    return x;
-  } else if (y.has_value()) {
-    // Likewise for a bounded y
-    return y;
+/**
+ * A set of times since the current frame, in seconds, as sorted and disjoint closed
+ * intervals. The last interval is unbounded if it ends at FOREVER.
+ */
+using TimeSet = std::vector<std::pair<double, double>>;
+
+TimeSet all_times() { return TimeSet{{0.0, FOREVER}}; }
+
+template <typename Set>
+Set intersect(const Set& a, const Set& b) {
+  auto ret = Set{};
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    const auto lo = std::max(a[i].first, b[j].first);
+    const auto hi = std::min(a[i].second, b[j].second);
+    if (lo <= hi) { ret.emplace_back(lo, hi); }
+    if (a[i].second < b[j].second) {
+      i++;
+    } else {
+      j++;
+    }
   }
-  // Else none are bounded.
-  return {};
+  return ret;
 }
 
-constexpr std::optional<size_t>
-interval_union(std::optional<size_t> x, std::optional<size_t> y) {
-  // Same as max.
-  return max(x, y);
+OffsetSet unite(const OffsetSet& a, const OffsetSet& b) {
+  return complement(intersect(complement(a), complement(b)));
 }
 
-// TODO: Revisit this to see if this sound.
-// Monitorable formula is, implicitly, G(phi)
-//
-// {x,f} . G( c1 < x - CTIME < c2 => phi )
-// --> Pin(x,f) -> Always -> OR(phi, ~(x-CTIME < c2 & x - CTIME > c1))
-// --> Horizon = c2
-//
-// {x,f} . ( x - CTIME < c3 => phi1 )
-// --> Horizon should be 0
-// --> Outputted horizon should be c2
-
-struct HorizonCompute {
-  std::optional<double> fps = {};
-
-  HorizonCompute() = default;
-  HorizonCompute(double fps_) : fps{fps_} {};
-
-  std::optional<size_t> eval(const TemporalBoundExpr& expr) {
-    return std::visit([&](const auto e) { return (*this)(e); }, expr);
-  }
-
-  std::optional<size_t> eval(const Expr& expr) {
-    return std::visit([&](const auto e) { return (*this)(e); }, expr);
+TimeSet unite(const TimeSet& a, const TimeSet& b) {
+  auto all = a;
+  all.insert(all.end(), b.begin(), b.end());
+  std::sort(all.begin(), all.end());
+  auto ret = TimeSet{};
+  for (const auto& [lo, hi] : all) {
+    if (!ret.empty() && lo <= ret.back().second) {
+      ret.back().second = std::max(ret.back().second, hi);
+    } else {
+      ret.emplace_back(lo, hi);
+    }
   }
+  return ret;
+}
 
-  std::optional<size_t> eval(const SpatialExpr& expr) {
-    return std::visit([&](const auto e) { return this->operator()(e); }, expr);
-  }
+/**
+ * Offsets at which a guard may be true, and at which it may be false.
+ */
+struct GuardSets {
+  OffsetSet may_true, may_false;
+  /**
+   * Times since the frame at which the guard may be true, and at which it may be false,
+   * for the time bounds that aren't converted to offsets.
+   */
+  TimeSet may_true_time = all_times(), may_false_time = all_times();
+};
 
-  std::optional<size_t> eval(const SpArea& expr) { return this->eval(expr.arg); }
-  std::optional<size_t> eval(const FrameInterval& expr) {
-    switch (expr.bound) {
-      case FrameInterval::OPEN: return expr.high - 1;
-      case FrameInterval::LOPEN:
-      case FrameInterval::ROPEN: return expr.high;
-      case FrameInterval::CLOSED: return expr.high + 1;
+/**
+ * The offsets at which an instruction can affect the robustness of a root: all the
+ * offsets up to `oldest`, or (if `open`) all the offsets in the buffer, where the
+ * formula needs at least `oldest + 1` frames for the operators ranging over the buffer.
+ * With `seconds`, the offsets are counted from the oldest frame at most `seconds` older
+ * than the current frame, instead of from the current frame.
+ */
+struct Window {
+  bool needed   = false;
+  size_t oldest = 0;
+  bool open     = false;
+  std::optional<double> seconds = {};
+
+  void join(const Window& other) {
+    if (!other.needed) { return; }
+    if (!this->needed) {
+      *this = other;
+      return;
+    }
+    this->oldest = std::max(this->oldest, other.oldest);
+    this->open   = this->open || other.open;
+    if (other.seconds.has_value()) {
+      this->seconds = std::max(this->seconds.value_or(0.0), *other.seconds);
     }
   }
+};
 
-  std::optional<size_t> operator()(const TimeBound& expr) {
-    if (!fps.has_value()) {
-      throw std::invalid_argument(
-          "Cannot compute Frame horizon for formula containing TimeBound without giving fps");
+struct HorizonAnalysis {
+  const Program& program;
+  std::optional<double> fps;
+  /**
+   * If the time bounds are kept as times since the frame, instead of being converted
+   * to offsets with `fps`.
+   */
+  bool by_time;
+
+  /**
+   * For the instructions that are boolean combinations of TimeBound and FrameBound
+   * constraints (and constants), the offsets where they may be true or false.
+   */
+  std::vector<std::optional<GuardSets>> guards;
+  std::vector<Window> windows;
+
+  HorizonAnalysis(
+      const Program& program_,
+      std::optional<double> fps_,
+      bool by_time_ = false) :
+      program{program_},
+      fps{fps_},
+      by_time{by_time_},
+      guards(program_.code.size()),
+      windows(program_.code.size()) {
+    // Operands appear before the instructions using them.
+    for (size_t idx = 0; idx < program.code.size(); idx++) {
+      this->guards[idx] = this->guard_sets(program.code[idx]);
     }
-    auto fps_val = *fps;
-    // bound is going to be positive. Switch on op
-    switch (expr.op) {
-      case ComparisonOp::LT: // x - CTIME < c ===> c
-        return std::make_optional(size_t(expr.bound * fps_val));
-      case ComparisonOp::LE: // x - CTIME <= c ===> c + 1
-        return std::make_optional(1 + size_t(expr.bound * fps_val));
-      default: // c <= x - CTIME or c < x - CTIME ===> Unbounded
-        return {};
+    for (const size_t root : program.roots) {
+      this->windows[root].join(Window{true, 0});
     }
-  }
-  std::optional<size_t> operator()(const FrameBound& expr) {
-    // bound is going to be positive. Switch on op
-    switch (expr.op) {
-      case ComparisonOp::LT: // f - CFRAME < c ===> c
-        return std::make_optional(expr.bound);
-      case ComparisonOp::LE: // f - CFRAME <= c ===> c + 1
-        return std::make_optional(1 + expr.bound);
-      default: // c <= f - CFRANE or c < f - CFRAME ===> Unbounded
-        return {};
+    for (size_t idx = program.code.size(); idx-- > 0;) {
+      if (this->windows[idx].needed) { this->propagate(idx); }
     }
   }
-  std::optional<size_t> operator()(const ExistsPtr& expr) {
-    if (auto& pin = expr->pinned_at) {
-      return this->eval(pin->phi);
-    } else {
-      return this->eval(*(expr->phi));
+
+  [[nodiscard]] std::optional<GuardSets> guard_sets(const Instruction& ins) const {
+    switch (ins.op) {
+      case OpCode::Const:
+        return (ins.constant > 0) ? GuardSets{all_offsets(), {}, all_times(), {}}
+                                  : GuardSets{{}, all_offsets(), {}, all_times()};
+      case OpCode::FrameBound: return frame_bound(ins);
+      case OpCode::TimeBound: return time_bound(ins);
+      case OpCode::Not: {
+        const auto& arg = this->guards[program.args(ins)[0]];
+        if (!arg.has_value()) { return {}; }
+        return GuardSets{
+            arg->may_false, arg->may_true, arg->may_false_time, arg->may_true_time};
+      }
+      case OpCode::And:
+      case OpCode::Or: {
+        const bool is_and = ins.op == OpCode::And;
+        auto ret = GuardSets{all_offsets(), all_offsets()};
+        (is_and ? ret.may_false : ret.may_true).clear();
+        (is_and ? ret.may_false_time : ret.may_true_time).clear();
+        for (const size_t arg : program.args(ins)) {
+          const auto& sets = this->guards[arg];
+          if (!sets.has_value()) { return {}; }
+          if (is_and) {
+            ret.may_true       = intersect(ret.may_true, sets->may_true);
+            ret.may_false      = unite(ret.may_false, sets->may_false);
+            ret.may_true_time  = intersect(ret.may_true_time, sets->may_true_time);
+            ret.may_false_time = unite(ret.may_false_time, sets->may_false_time);
+          } else {
+            ret.may_true       = unite(ret.may_true, sets->may_true);
+            ret.may_false      = intersect(ret.may_false, sets->may_false);
+            ret.may_true_time  = unite(ret.may_true_time, sets->may_true_time);
+            ret.may_false_time = intersect(ret.may_false_time, sets->may_false_time);
+          }
+        }
+        return ret;
+      }
+      default: return {};
     }
   }
-  std::optional<size_t> operator()(const ForallPtr& expr) {
-    if (auto& pin = expr->pinned_at) {
-      return this->eval(pin->phi);
-    } else {
-      return this->eval(*(expr->phi));
+
+  static GuardSets frame_bound(const Instruction& ins) {
+    // The bound is a non-negative integer.
+    const auto c     = static_cast<size_t>(ins.constant);
+    const auto up_to = [](size_t last) { return OffsetSet{{0, last}}; };
+    auto below       = OffsetSet{};
+    switch (ins.relation) {
+      case ast::ComparisonOp::LT:
+      case ast::ComparisonOp::GE: below = (c == 0) ? OffsetSet{} : up_to(c - 1); break;
+      case ast::ComparisonOp::LE:
+      case ast::ComparisonOp::GT: below = up_to(c); break;
+      default: throw std::logic_error("FrameBound with an equality constraint.");
     }
-  }
-  std::optional<size_t> operator()(const PinPtr& expr) { return this->eval(expr->phi); }
-  std::optional<size_t> operator()(const NotPtr& e) { return this->eval(e->arg); }
-  std::optional<size_t> operator()(const AndPtr& expr) {
-    auto hrz1 = std::optional<size_t>{};
-    for (const auto& e : expr->args) {
-      const auto rhrz = this->eval(e);
-      hrz1            = interval_intersection(hrz1, rhrz);
+    const bool upper = ins.relation == ast::ComparisonOp::LT ||
+                       ins.relation == ast::ComparisonOp::LE;
+    return upper ? GuardSets{below, complement(below)}
+                 : GuardSets{complement(below), below};
+  }
+
+  [[nodiscard]] GuardSets time_bound(const Instruction& ins) const {
+    const bool upper = ins.relation == ast::ComparisonOp::LT ||
+                       ins.relation == ast::ComparisonOp::LE;
+    if (this->by_time) {
+      // The bound itself is on both sides.
+      const double c   = std::max(0.0, ins.constant);
+      const auto below = TimeSet{{0.0, c}};
+      const auto above = TimeSet{{c, FOREVER}};
+      return upper ? GuardSets{all_offsets(), all_offsets(), below, above}
+                   : GuardSets{all_offsets(), all_offsets(), above, below};
     }
-
-    // Does an intersection of the intervals from each temporal bound
-    auto hrz2 = std::optional<size_t>{};
-    for (const auto& e : expr->temporal_bound_args) {
-      const auto rhrz = this->eval(e);
-      hrz2            = interval_intersection(hrz2, rhrz);
+    if (!this->fps.has_value()) {
+      throw std::invalid_argument(
+          "Cannot compute Frame horizon for formula containing TimeBound without giving fps");
+    }
+    // The offsets where the time since the frame may be below or above the bound,
+    // rounded outward.
+    const double frames = ins.constant * (*this->fps);
+    const auto last_below =
+        static_cast<size_t>(std::max(0.0, std::floor(frames + TIME_TOLERANCE)));
+    const auto first_above =
+        static_cast<size_t>(std::max(0.0, std::ceil(frames - TIME_TOLERANCE)));
+    const auto below = OffsetSet{{0, last_below}};
+    const auto above = OffsetSet{{first_above, INF}};
+    return upper ? GuardSets{below, above} : GuardSets{above, below};
+  }
+
+  void propagate(size_t idx) {
+    const auto& ins    = program.code[idx];
+    const auto args    = program.args(ins);
+    const auto& window = this->windows[idx];
+
+    const auto shifted = [&](size_t offset) {
+      return Window{true, window.oldest + offset, window.open, window.seconds};
+    };
+    const auto bounded_by = [&](const std::optional<ast::FrameInterval>& interval) {
+      if (!interval.has_value()) {
+        return Window{true, window.oldest, true, window.seconds};
+      }
+      const auto frames = details::frame_window(*interval);
+      return frames.empty() ? Window{} : shifted(frames.last - 1);
+    };
+
+    switch (ins.op) {
+      case OpCode::Previous:
+      case OpCode::SpPrevious: this->windows[args[0]].join(shifted(1)); break;
+      case OpCode::Always:
+      case OpCode::Sometimes:
+      case OpCode::SpAlways:
+      case OpCode::SpSometimes:
+        this->windows[args[0]].join(bounded_by(ins.interval));
+        break;
+      case OpCode::Since:
+      case OpCode::BackTo:
+      case OpCode::SpSince:
+      case OpCode::SpBackTo:
+        // The bounds of SpSince and SpBackTo aren't used by their semantics yet.
+        for (const size_t arg : args) {
+          this->windows[arg].join(Window{true, window.oldest, true, window.seconds});
+        }
+        break;
+      case OpCode::And:
+      case OpCode::Or: this->propagate_guarded(ins, window); break;
+      default:
+        for (const size_t arg : args) { this->windows[arg].join(window); }
+        break;
     }
-
-    // TODO: verify...
-    return add_horizons(hrz1, hrz2);
   }
 
-  std::optional<size_t> operator()(const OrPtr& expr) {
-    auto hrz1 = std::optional<size_t>{};
-    for (const auto& e : expr->args) {
-      const auto rhrz = this->eval(e);
-      hrz1            = add_horizons(hrz1, rhrz);
+  void propagate_guarded(const Instruction& ins, const Window& window) {
+    // The offsets at which the result isn't decided by the guards.
+    const bool is_and = ins.op == OpCode::And;
+    auto undecided    = all_offsets();
+    auto undecided_time = all_times();
+    for (const size_t arg : program.args(ins)) {
+      if (const auto& sets = this->guards[arg]) {
+        undecided = intersect(undecided, is_and ? sets->may_true : sets->may_false);
+        undecided_time = intersect(
+            undecided_time, is_and ? sets->may_true_time : sets->may_false_time);
+      }
     }
 
-    auto hrz2 = std::optional<size_t>{};
-    for (const auto& e : expr->temporal_bound_args) {
-      const auto rhrz = this->eval(e);
-      hrz2            = interval_union(hrz2, rhrz);
+    auto sub = window;
+    if (undecided.empty() || undecided_time.empty()) {
+      sub = Window{};
+    } else if (const size_t last = undecided.back().second; last != INF) {
+      // A window counted from a time bound may be longer than `last` frames.
+      const bool longer = window.open || window.seconds.has_value();
+      sub = Window{true, longer ? last : std::min(window.oldest, last), false};
+    } else if (const double until = undecided_time.back().second; until != FOREVER) {
+      // Either window holds the frames where the result isn't decided.
+      const bool longer = window.open || window.seconds.value_or(-1.0) >= until;
+      if (longer) { sub = Window{true, 0, false, until}; }
     }
-
-    return add_horizons(hrz1, hrz2);
-  }
-
-  std::optional<size_t> operator()(const PreviousPtr& e) {
-    const auto sub_hrz = this->eval(e->arg);
-    return (sub_hrz.has_value()) ? std::make_optional(1 + *sub_hrz)
-                                 : std::make_optional<size_t>();
-  }
-  std::optional<size_t> operator()(const AlwaysPtr& expr) {
-    return this->eval(expr->arg);
-  }
-  std::optional<size_t> operator()(const SometimesPtr& expr) {
-    return this->eval(expr->arg);
-  }
-  std::optional<size_t> operator()(const SincePtr& expr) {
-    const auto [a, b] = expr->args;
-    // TODO: Verify this.
-    const auto lhrz = this->eval(a);
-    const auto rhrz = this->eval(b);
-    return max(lhrz, rhrz);
-  }
-
-  std::optional<size_t> operator()(const BackToPtr& expr) {
-    const auto [a, b] = expr->args;
-    // TODO: Verify this.
-    const auto lhrz = this->eval(a);
-    const auto rhrz = this->eval(b);
-    return max(lhrz, rhrz);
-  }
-
-  std::optional<size_t> operator()(const CompareSpAreaPtr& expr) {
-    const auto lhs_hrz = this->eval(expr->lhs);
-    const auto rhs_hrz = std::visit(
-        utils::overloaded{
-            [](const double) -> std::optional<size_t> { return 0; },
-            [&](const SpArea& e) {
-              return this->eval(e);
-            }},
-        expr->rhs);
-    return max(lhs_hrz, rhs_hrz);
-  }
-
-  std::optional<size_t> operator()(const ComplementPtr& expr) {
-    return this->eval(expr->arg);
-  }
-
-  std::optional<size_t> operator()(const IntersectPtr& expr) {
-    auto hrz1 = std::optional<size_t>{};
-    for (const auto& e : expr->args) {
-      const auto rhrz = this->eval(e);
-      hrz1            = max(hrz1, rhrz);
+    for (const size_t arg : program.args(ins)) {
+      this->windows[arg].join(this->guards[arg].has_value() ? window : sub);
     }
-    return hrz1;
   }
+};
 
-  std::optional<size_t> operator()(const UnionPtr& expr) {
-    auto hrz1 = std::optional<size_t>{};
-    for (const auto& e : expr->args) {
-      const auto rhrz = this->eval(e);
-      hrz1            = max(hrz1, rhrz);
-    }
-    return hrz1;
-  }
-  std::optional<size_t> operator()(const InteriorPtr& expr) {
-    return this->eval(expr->arg);
-  }
-  std::optional<size_t> operator()(const ClosurePtr& expr) {
-    return this->eval(expr->arg);
-  }
-  std::optional<size_t> operator()(const SpExistsPtr& expr) {
-    return this->eval(expr->arg);
-  }
-  std::optional<size_t> operator()(const SpForallPtr& expr) {
-    return this->eval(expr->arg);
-  }
-  std::optional<size_t> operator()(const SpPreviousPtr& e) {
-    const auto sub_hrz = this->eval(e->arg);
-    return (sub_hrz.has_value()) ? std::make_optional(1 + *sub_hrz)
-                                 : std::make_optional<size_t>();
-  }
+} // namespace
 
-  std::optional<size_t> operator()(const SpAlwaysPtr& e) {
-    const auto sub_hrz = this->eval(e->arg);
-    if (e->interval.has_value()) {
-      return add_horizons(sub_hrz, this->eval(*(e->interval)));
-    }
-    return sub_hrz;
-  }
-  std::optional<size_t> operator()(const SpSometimesPtr& e) {
-    const auto sub_hrz = this->eval(e->arg);
-    if (e->interval.has_value()) {
-      return add_horizons(sub_hrz, this->eval(*(e->interval)));
+std::vector<std::optional<size_t>>
+percemon::monitoring::get_horizons(const Program& program, std::optional<double> fps) {
+  const auto analysis = HorizonAnalysis{program, fps};
+  auto ret            = std::vector<std::optional<size_t>>{};
+  ret.reserve(program.code.size());
+  for (const auto& window : analysis.windows) {
+    if (!window.needed) {
+      ret.emplace_back(0);
+    } else if (window.open) {
+      ret.emplace_back();
+    } else {
+      ret.emplace_back(window.oldest + 1);
     }
-    return sub_hrz;
   }
+  return ret;
+}
 
-  std::optional<size_t> operator()(const SpSincePtr& e) {
-    const auto [a, b]  = e->args;
-    const auto sub_hrz = max(this->eval(a), this->eval(b));
-    if (e->interval.has_value()) {
-      return add_horizons(sub_hrz, this->eval(*(e->interval)));
-    }
-    return sub_hrz;
+size_t
+percemon::monitoring::get_horizon(const Program& program, std::optional<double> fps) {
+  const auto analysis = HorizonAnalysis{program, fps};
+  size_t ret          = 1;
+  for (const auto& window : analysis.windows) {
+    if (window.needed) { ret = std::max(ret, window.oldest + 1); }
   }
+  return ret;
+}
 
-  std::optional<size_t> operator()(const SpBackToPtr& e) {
-    const auto [a, b]  = e->args;
-    const auto sub_hrz = max(this->eval(a), this->eval(b));
-    if (e->interval.has_value()) {
-      return add_horizons(sub_hrz, this->eval(*(e->interval)));
+std::vector<std::optional<size_t>>
+percemon::monitoring::get_time_horizons(const Program& program) {
+  const auto analysis = HorizonAnalysis{program, std::nullopt, true};
+  auto ret            = std::vector<std::optional<size_t>>{};
+  ret.reserve(program.code.size());
+  for (const auto& window : analysis.windows) {
+    if (!window.needed) {
+      ret.emplace_back(0);
+    } else if (window.open || window.seconds.has_value()) {
+      ret.emplace_back();
+    } else {
+      ret.emplace_back(window.oldest + 1);
     }
-    return sub_hrz;
   }
+  return ret;
+}
 
-  // Set default horizon to 0
-  template <typename T>
-  std::optional<size_t> operator()(const T& expr) {
-    return 0;
+TimeHorizon percemon::monitoring::get_time_horizon(const Program& program) {
+  const auto analysis = HorizonAnalysis{program, std::nullopt, true};
+  auto ret            = TimeHorizon{};
+  for (const auto& window : analysis.windows) {
+    if (!window.needed) { continue; }
+    ret.frames = std::max(ret.frames, window.oldest + 1);
+    if (window.seconds.has_value()) {
+      ret.seconds = std::max(ret.seconds.value_or(0.0), *window.seconds);
+    }
   }
-};
-} // namespace
+  return ret;
+}
 
-std::optional<size_t> percemon::monitoring::get_horizon(const Expr& expr) {
-  auto hrz_op = HorizonCompute{};
-  return hrz_op.eval(expr);
+std::optional<size_t> percemon::monitoring::get_horizon(const ast::Expr& expr) {
+  return get_horizon(compile(expr), std::nullopt);
 }
 
-std::optional<size_t> percemon::monitoring::get_horizon(const Expr& expr, double fps) {
-  auto hrz_op = HorizonCompute{fps};
-  return hrz_op.eval(expr);
+std::optional<size_t>
+percemon::monitoring::get_horizon(const ast::Expr& expr, double fps) {
+  return get_horizon(compile(expr), fps);
 }
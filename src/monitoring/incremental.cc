@@ -0,0 +1,956 @@
+#include "monitoring/incremental.hpp"
+#include "monitoring/candidates.hpp"
+#include "monitoring/profiler.hpp"
+#include "monitoring/semantics.hpp"
+#include "monitoring/snapshot.hpp"
+#include "monitoring/thread_pool.hpp"
+
+#include "percemon/exception.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+using namespace percemon::monitoring::details;
+namespace ds = percemon::datastream;
+
+namespace {
+
+/**
+ * Lock the mutex only if the quantifiers are evaluated in parallel, as the locks cost
+ * more than most of the rows they guard.
+ */
+std::unique_lock<std::mutex> lock_if(bool parallel, std::mutex& mtx) {
+  return parallel ? std::unique_lock{mtx} : std::unique_lock<std::mutex>{};
+}
+
+template <typename T>
+std::vector<T> window(const std::vector<T>& values, size_t first, size_t last) {
+  auto ret = std::vector<T>{};
+  ret.reserve(last - first);
+  for (size_t t = first; t < last; t++) { ret.push_back(values[t % values.size()]); }
+  return ret;
+}
+
+/**
+ * Cost of looking up a row, relative to the cost of evaluating a leaf predicate.
+ */
+constexpr double ROW_COST = 4.0;
+
+constexpr bool is_temporal(OpCode op) {
+  return op >= OpCode::Previous && op <= OpCode::BackTo;
+}
+
+/**
+ * Fold of the operands of a temporal operator over consecutive frames.
+ *
+ * Always and Sometimes only use `value`, the min (max) of the operand over the frames.
+ * For Since, the frames map the state of `since` before them, i.e., the robustness `p`
+ * so far and the max `m` of the RHS since the front of the span, to the robustness
+ * `max(value, min(min_lhs, p), min(rest, -m))` after them, where `max_rhs` is the max
+ * of the RHS over the frames. As `p = TOP` and `m = BOTTOM` before the front of the
+ * span, the robustness at the end of a window from the front is
+ * `max(value, min_lhs, rest)`. BackTo is the same fold over the negated operands.
+ */
+struct Summary {
+  double value;
+  double min_lhs = TOP;
+  double rest    = BOTTOM;
+  double max_rhs = BOTTOM;
+};
+
+Summary empty_summary(OpCode op) {
+  return Summary{(op == OpCode::Always) ? TOP : BOTTOM};
+}
+
+Summary summary_of(OpCode op, double lhs, double rhs) {
+  switch (op) {
+    case OpCode::Since: return Summary{rhs, lhs, -rhs, rhs};
+    case OpCode::BackTo: return Summary{-rhs, -lhs, rhs, -rhs};
+    default: return Summary{lhs};
+  }
+}
+
+/**
+ * Fold the frames of `older` followed by the frames of `newer`.
+ */
+Summary combine(OpCode op, const Summary& older, const Summary& newer) {
+  switch (op) {
+    case OpCode::Always: return Summary{std::min(older.value, newer.value)};
+    case OpCode::Sometimes: return Summary{std::max(older.value, newer.value)};
+    default:
+      return Summary{
+          std::max(newer.value, std::min(newer.min_lhs, older.value)),
+          std::min(older.min_lhs, newer.min_lhs),
+          std::max(std::min(newer.min_lhs, older.rest),
+                   std::min(newer.rest, -older.max_rhs)),
+          std::max(older.max_rhs, newer.max_rhs)};
+  }
+}
+
+double robustness_of(OpCode op, const Summary& fold) {
+  switch (op) {
+    case OpCode::Since: return std::max({fold.value, fold.min_lhs, fold.rest});
+    case OpCode::BackTo: return -std::max({fold.value, fold.min_lhs, fold.rest});
+    default: return fold.value;
+  }
+}
+
+} // namespace
+
+/**
+ * The fold is kept as a queue made of two stacks (see `sliding_fold`): new frames are
+ * folded into the back, and when the front runs out, the back is moved to the front
+ * storing the suffix folds. Hence, sliding the window by a frame costs an amortized
+ * constant number of folds.
+ */
+struct IncrementalEngine::Window {
+  OpCode op;
+  /**
+   * Frames of the operands in the fold.
+   */
+  size_t first = 0, end = 0;
+  /**
+   * Suffix folds of the oldest frames, with the oldest at the back.
+   */
+  std::vector<Summary> front = {};
+  /**
+   * The newest frames, and their fold.
+   */
+  std::vector<Summary> back = {};
+  Summary back_fold         = empty_summary(op);
+
+  void clear(size_t t) {
+    first = end = t;
+    front.clear();
+    back.clear();
+    back_fold = empty_summary(op);
+  }
+
+  void push(const Summary& frame) {
+    back.push_back(frame);
+    back_fold = combine(op, back_fold, frame);
+    end++;
+  }
+
+  void pop() {
+    if (front.empty()) {
+      auto fold = empty_summary(op);
+      for (auto it = back.rbegin(); it != back.rend(); it++) {
+        fold = combine(op, *it, fold);
+        front.push_back(fold);
+      }
+      back.clear();
+      back_fold = empty_summary(op);
+    }
+    front.pop_back();
+    first++;
+  }
+
+  [[nodiscard]] Summary fold() const {
+    return (front.empty()) ? back_fold : combine(op, front.back(), back_fold);
+  }
+};
+
+IncrementalEngine::IncrementalEngine(
+    const Program& program_,
+    size_t max_horizon,
+    const std::vector<std::optional<size_t>>& horizons_,
+    const topo::BoundingBox& universe_,
+    ThreadPool* pool_,
+    bool lazy_,
+    Profiler* profiler_,
+    const CandidateFilter* filter_) :
+    capacity{max_horizon},
+    horizons{horizons_},
+    universe{universe_},
+    pool{pool_},
+    lazy{lazy_},
+    profiler{profiler_},
+    filter{filter_} {
+  this->times  = std::vector<double>(program_.time_slots.size(), 0.0);
+  this->frames = std::vector<double>(program_.frame_slots.size(), 0.0);
+
+  const auto& code = program_.code;
+  this->horizons.resize(code.size());
+  this->row_capacity = this->row_capacities(this->capacity);
+  this->robustness_table.resize(code.size());
+  this->region_table.resize(code.size());
+  this->table_mtx = std::make_unique<std::mutex[]>(code.size());
+
+  // The temporal operators are stable where their windows are within the spans of the
+  // roots at the frames they are needed, so that they don't depend on the front of the
+  // span, except for the unbounded ones (which are then only needed at the current
+  // frame).
+  const auto in_horizon = [&](size_t idx) { return this->horizons[idx].has_value(); };
+  const auto current_only = [&](size_t idx) {
+    return in_horizon(idx) && *(this->horizons[idx]) <= 1;
+  };
+  // Rows only pay off for the values needed at older frames, and looking a row up costs
+  // about as much as evaluating a few leaf predicates, so the cheap instructions are
+  // computed again at each frame they are needed instead.
+  const auto worth_a_row = [&](size_t idx) {
+    if (current_only(idx)) { return false; }
+    return !in_horizon(idx) || is_spatial(code[idx].op) ||
+           code[idx].cost * static_cast<double>(*(this->horizons[idx]) - 1) > ROW_COST;
+  };
+  this->stable.assign(code.size(), false);
+  this->tabled.assign(code.size(), false);
+  this->spans.assign(code.size(), false);
+  for (size_t idx = 0; idx < code.size(); idx++) {
+    const auto& ins = code[idx];
+    const auto args = program_.args(ins);
+    const auto is_stable   = [&](size_t arg) { return this->stable[arg]; };
+    const bool over_stable = std::all_of(args.begin(), args.end(), is_stable);
+    const bool unbounded = (ins.op == OpCode::Always || ins.op == OpCode::Sometimes)
+                               ? !ins.interval.has_value()
+                               : (ins.op == OpCode::Since || ins.op == OpCode::BackTo);
+    switch (ins.op) {
+      case OpCode::Not:
+      case OpCode::And:
+      case OpCode::Or: this->stable[idx] = over_stable; break;
+      case OpCode::Previous:
+      case OpCode::Always:
+      case OpCode::Sometimes:
+      case OpCode::Since:
+      case OpCode::BackTo:
+        this->stable[idx] =
+            over_stable && (unbounded ? current_only(idx) : in_horizon(idx));
+        break;
+      default: this->stable[idx] = ins.frame_local;
+    }
+    if (!this->stable[idx]) {
+      for (const size_t arg : args) {
+        this->tabled[arg] =
+            this->tabled[arg] || (this->stable[arg] && worth_a_row(arg));
+      }
+      continue;
+    }
+    const auto spans_buffer = [&](size_t arg) { return this->spans[arg]; };
+    this->spans[idx] = unbounded || std::any_of(args.begin(), args.end(), spans_buffer);
+    if (is_temporal(ins.op)) {
+      // The operators are folded from the rows of their operands.
+      this->tabled[idx] = true;
+      for (const size_t arg : args) { this->tabled[arg] = true; }
+    }
+  }
+}
+
+IncrementalEngine::IncrementalEngine(IncrementalEngine&&) noexcept            = default;
+IncrementalEngine& IncrementalEngine::operator=(IncrementalEngine&&) noexcept = default;
+IncrementalEngine::~IncrementalEngine()                                       = default;
+
+std::vector<size_t> IncrementalEngine::row_capacities(size_t capacity_) const {
+  // Instructions under an unbounded temporal operator are needed at every frame, and
+  // the rows hold at least the current frame.
+  auto ret = std::vector<size_t>(this->horizons.size(), capacity_);
+  for (size_t idx = 0; idx < this->horizons.size(); idx++) {
+    if (this->horizons[idx].has_value()) {
+      ret[idx] = std::clamp<size_t>(*this->horizons[idx], 1, capacity_);
+    }
+  }
+  return ret;
+}
+
+void IncrementalEngine::begin_eval(const Program& program_, const FrameBuffer& buffer_) {
+  if (buffer_.capacity() > this->capacity) {
+    // The columns of the rows are at their frame modulo the size of the row, so the
+    // rows can't just be extended.
+    this->capacity     = buffer_.capacity();
+    this->row_capacity = this->row_capacities(this->capacity);
+    for (auto& rows : this->robustness_table) { rows.clear(); }
+    for (auto& rows : this->region_table) { rows.clear(); }
+  }
+  this->program = &program_;
+  this->buffer  = &buffer_;
+  this->front   = this->num_frames - buffer_.size();
+  // Pins always refer to the current frame.
+  std::fill(this->times.begin(), this->times.end(), buffer_.back().timestamp);
+  std::fill(
+      this->frames.begin(),
+      this->frames.end(),
+      static_cast<double>(buffer_.back().frame_num));
+  this->closed_values.resize(program_.code.size());
+  this->closed_ready.assign(program_.code.size(), false);
+}
+
+double IncrementalEngine::eval_root(size_t root, const FrameSpan& trace_) {
+  if (!this->trace.has_value() || this->trace->size() != trace_.size()) {
+    // The signals of a formula only cover the frames in its own span.
+    std::fill(this->closed_ready.begin(), this->closed_ready.end(), false);
+  }
+  this->trace       = trace_;
+  this->trace_front = this->num_frames - trace_.size();
+
+  auto ctx = Context{std::vector<ObjectId>(this->program->id_slots.size(), 0)};
+  auto rho = this->robustness(root, ctx, root_demand(trace_.size(), this->lazy));
+  return rho.back();
+}
+
+double IncrementalEngine::eval(const Program& program_, const FrameBuffer& buffer_) {
+  this->begin_eval(program_, buffer_);
+  const double rho = this->eval_root(program_.root(), FrameSpan{buffer_});
+  this->collect_garbage();
+  return rho;
+}
+
+std::vector<double> IncrementalEngine::eval_all(
+    const Program& program_,
+    const FrameBuffer& buffer_,
+    const std::vector<size_t>& horizons) {
+  this->begin_eval(program_, buffer_);
+  auto ret = std::vector<double>{};
+  ret.reserve(program_.roots.size());
+  for (size_t i = 0; i < program_.roots.size(); i++) {
+    ret.push_back(this->eval_root(program_.roots[i], FrameSpan{buffer_, horizons[i]}));
+  }
+  this->collect_garbage();
+  return ret;
+}
+
+const IncrementalEngine::Key&
+IncrementalEngine::key_of(const Instruction& ins, Context& ctx) const {
+  const auto free_ids = this->program->free_ids(ins);
+  ctx.key.clear();
+  for (const size_t slot : free_ids) { ctx.key.push_back(ctx.binding[slot]); }
+  return ctx.key;
+}
+
+IncrementalEngine::Row<double>& IncrementalEngine::robustness_row(size_t idx, Context& ctx) {
+  const auto& ins = this->program->code[idx];
+  assert(this->tabled[idx] && !is_spatial(ins.op));
+
+  const auto& key      = key_of(ins, ctx);
+  Row<double>* row_ptr = nullptr;
+  {
+    auto lock           = lock_if(this->pool != nullptr, this->table_mtx[idx]);
+    auto [it, inserted] = this->robustness_table[idx].try_emplace(key);
+    row_ptr             = &(it->second);
+    if (inserted) { row_ptr->values.resize(this->row_capacity[idx]); }
+  }
+  auto& row = *row_ptr;
+  // Rows only depend on rows of the operands, which appear earlier in the program, so
+  // holding the lock while computing the operands can't deadlock.
+  auto row_lock = lock_if(this->pool != nullptr, row.mtx);
+
+  // Compute the columns for the frames that were added since the row was last updated,
+  // and that are within the horizon of the instruction. The current frame is computed
+  // again for another span if the value depends on it.
+  const size_t last = this->num_frames;
+  size_t first      = std::max(
+      {row.end, this->front, last - std::min(last, row.values.size())});
+  if (this->spans[idx] && row.front != this->trace_front) {
+    first = std::min(first, last - 1);
+  }
+  if (first >= last) { return row; }
+  const NodeTimer timer{this->profiler, idx};
+
+  if (is_temporal(ins.op)) {
+    this->fold_columns(idx, ctx, row, first, last);
+  } else {
+    for (size_t t = first; t < last; t++) {
+      row.values[t % row.values.size()] = this->compute_at(idx, ctx, t);
+    }
+  }
+  row.end   = last;
+  row.front = this->trace_front;
+  return row;
+}
+
+IncrementalEngine::Row<topo::Region>& IncrementalEngine::region_row(size_t idx, Context& ctx) {
+  const auto& ins = this->program->code[idx];
+  assert(this->tabled[idx] && is_spatial(ins.op));
+
+  const auto& key            = key_of(ins, ctx);
+  Row<topo::Region>* row_ptr = nullptr;
+  {
+    auto lock           = lock_if(this->pool != nullptr, this->table_mtx[idx]);
+    auto [it, inserted] = this->region_table[idx].try_emplace(key);
+    row_ptr             = &(it->second);
+    if (inserted) { row_ptr->values.resize(this->row_capacity[idx]); }
+  }
+  auto& row = *row_ptr;
+  // Rows only depend on rows of the operands, which appear earlier in the program, so
+  // holding the lock while computing the operands can't deadlock.
+  auto row_lock = lock_if(this->pool != nullptr, row.mtx);
+
+  // Compute the columns for the frames that were added since the row was last updated,
+  // and that are within the horizon of the instruction.
+  const size_t last  = this->num_frames;
+  const size_t first = std::max(
+      {row.end, this->front, last - std::min(last, row.values.size())});
+  if (first >= last) { return row; }
+  const NodeTimer timer{this->profiler, idx};
+
+  // The rows are kept across calls to eval, so they can't use the arena.
+  const topo::HeapScope heap_scope{};
+  for (size_t t = first; t < last; t++) {
+    row.values[t % row.values.size()] = this->compute_region_at(idx, ctx, t);
+  }
+  row.end = last;
+  return row;
+}
+
+void IncrementalEngine::fold_columns(
+    size_t idx,
+    Context& ctx,
+    Row<double>& row,
+    size_t first,
+    size_t last) {
+  const auto& ins = this->program->code[idx];
+  const auto args = this->program->args(ins);
+  const auto& lhs = this->robustness_row(args[0], ctx);
+  const auto* rhs = (args.size() > 1) ? &(this->robustness_row(args[1], ctx)) : nullptr;
+  const auto at   = [](const Row<double>& r, size_t t) {
+    return r.values[t % r.values.size()];
+  };
+
+  if (ins.op == OpCode::Previous) {
+    for (size_t t = first; t < last; t++) {
+      row.values[t % row.values.size()] = (t > this->front) ? at(lhs, t - 1) : BOTTOM;
+    }
+    return;
+  }
+
+  if (row.window == nullptr) { row.window = std::make_unique<Window>(Window{ins.op}); }
+  auto& fold = *(row.window);
+  for (size_t t = first; t < last; t++) {
+    // Frames `[lo, hi)` of the operands in the window of the column, which is clipped
+    // to the buffer like the signals are clipped to the span (the unbounded operators
+    // range over the whole span).
+    size_t lo = this->trace_front;
+    size_t hi = t + 1;
+    if (ins.interval.has_value()) {
+      const auto w = frame_window(*ins.interval);
+      hi           = (t + 1 >= w.first) ? t + 1 - w.first : 0;
+      lo           = std::max(this->front, (t + 1 >= w.last) ? t + 1 - w.last : 0);
+    }
+    auto& value = row.values[t % row.values.size()];
+    if (hi <= lo) {
+      value = empty_summary(ins.op).value;
+      continue;
+    }
+
+    // Consecutive columns slide the window, and anything else refolds it.
+    if (fold.first > lo || fold.end < lo || fold.end > hi) { fold.clear(lo); }
+    for (; fold.end < hi;) {
+      const size_t s = fold.end;
+      fold.push(summary_of(ins.op, at(lhs, s), (rhs != nullptr) ? at(*rhs, s) : 0.0));
+    }
+    while (fold.first < lo) { fold.pop(); }
+    value = robustness_of(ins.op, fold.fold());
+  }
+}
+
+double IncrementalEngine::robustness_at(size_t idx, Context& ctx, size_t t) {
+  if (this->tabled[idx]) {
+    const auto& row = this->robustness_row(idx, ctx);
+    return row.values[t % row.values.size()];
+  }
+  const NodeTimer timer{this->profiler, idx};
+  return this->compute_at(idx, ctx, t);
+}
+
+topo::Region IncrementalEngine::region_at(size_t idx, Context& ctx, size_t t) {
+  if (this->tabled[idx]) {
+    const auto& row = this->region_row(idx, ctx);
+    return row.values[t % row.values.size()];
+  }
+  const NodeTimer timer{this->profiler, idx};
+  return this->compute_region_at(idx, ctx, t);
+}
+
+double IncrementalEngine::compute_at(size_t idx, Context& ctx, size_t t) {
+  const auto& ins    = this->program->code[idx];
+  const auto args    = this->program->args(ins);
+  const auto ids     = this->program->ids(ins);
+  const size_t frame = t - this->front;
+  const auto rhs_id  = [&]() -> const ObjectId* {
+    return (ids.size() > 1) ? &(ctx.binding[ids[1]]) : nullptr;
+  };
+
+  double value = 0.0;
+  switch (ins.op) {
+    case OpCode::Const: return ins.constant;
+    case OpCode::CompareId:
+      return eval_compare_id(ins, ctx.binding[ids[0]], ctx.binding[ids[1]]);
+    case OpCode::CompareClass: {
+      eval_compare_class(
+          ins,
+          ctx.binding[ids[0]],
+          rhs_id(),
+          *(this->buffer),
+          frame,
+          frame + 1,
+          &value);
+      return value;
+    }
+    case OpCode::CompareProb:
+    case OpCode::CompareArea:
+    case OpCode::CompareLat:
+    case OpCode::CompareLon: {
+      eval_compare_attribute(
+          ins,
+          ctx.binding[ids[0]],
+          rhs_id(),
+          *(this->buffer),
+          frame,
+          frame + 1,
+          &value);
+      return value;
+    }
+    case OpCode::CompareED:
+      throw not_implemented_error(
+          "Semantics for comparing Euclidean distances between objects hasn't been implemented due to ambiguities in the formalization.");
+    case OpCode::Not: return -1 * this->robustness_at(args[0], ctx, t);
+    case OpCode::And:
+    case OpCode::Or: {
+      // The remaining operands can't change a decided value.
+      const bool is_and    = ins.op == OpCode::And;
+      const double decided = is_and ? BOTTOM : TOP;
+      value                = is_and ? TOP : BOTTOM;
+      for (const size_t arg : args) {
+        const double arg_value = this->robustness_at(arg, ctx, t);
+        value = is_and ? std::min(arg_value, value) : std::max(arg_value, value);
+        if (value == decided) { break; }
+      }
+      return value;
+    }
+    case OpCode::CompareSpArea: {
+      const double lhs_area = topo::area(this->region_at(args[0], ctx, t));
+      const double rhs_area = (args.size() > 1)
+                                  ? topo::area(this->region_at(args[1], ctx, t))
+                                  : ins.constant;
+      visit_relation(ins.relation, [&](const auto op) {
+        value = bool_to_robustness(op(lhs_area, rhs_area));
+      });
+      return value;
+    }
+    case OpCode::SpExists: return is_nonempty(this->region_at(args[0], ctx, t));
+    case OpCode::SpForall: throw not_implemented_error("SpForall semantics");
+    default: throw std::logic_error("Instruction can't be computed at a frame.");
+  }
+}
+
+topo::Region IncrementalEngine::compute_region_at(size_t idx, Context& ctx, size_t t) {
+  const auto& ins = this->program->code[idx];
+  const auto args = this->program->args(ins);
+
+  switch (ins.op) {
+    case OpCode::EmptySet: return topo::Empty{};
+    case OpCode::UniverseSet: return topo::Universe{};
+    case OpCode::BBox: {
+      const size_t frame = t - this->front;
+      auto value         = topo::Region{topo::Empty{}};
+      eval_bbox(
+          ctx.binding[this->program->ids(ins)[0]],
+          *(this->buffer),
+          frame,
+          frame + 1,
+          &value);
+      return value;
+    }
+    case OpCode::Complement:
+      return topo::spatial_complement(this->region_at(args[0], ctx, t), this->universe);
+    case OpCode::Intersect:
+    case OpCode::Union: {
+      const bool is_intersect = ins.op == OpCode::Intersect;
+      topo::Region reg        = is_intersect ? topo::Region{topo::Universe{}}
+                                             : topo::Region{topo::Empty{}};
+      for (const size_t arg : args) {
+        const auto arg_reg = this->region_at(arg, ctx, t);
+        reg = is_intersect ? topo::spatial_intersect(reg, arg_reg)
+                           : topo::spatial_union(reg, arg_reg);
+      }
+      return reg;
+    }
+    case OpCode::Interior: return topo::interior(this->region_at(args[0], ctx, t));
+    case OpCode::Closure: return topo::closure(this->region_at(args[0], ctx, t));
+    default: throw std::logic_error("Instruction can't be computed at a frame.");
+  }
+}
+
+std::vector<double>
+IncrementalEngine::robustness(size_t idx, Context& ctx, const Demand& demand) {
+  const auto& ins = this->program->code[idx];
+  assert(!is_spatial(ins.op));
+  const size_t n = this->trace->size();
+  if (this->stable[idx]) {
+    if (this->lazy && !any_demanded(demand)) { return std::vector<double>(n, BOTTOM); }
+    if (this->tabled[idx]) {
+      const auto& row = this->robustness_row(idx, ctx);
+      return window(row.values, this->trace_front, this->num_frames);
+    }
+    auto ret = std::vector<double>(n, BOTTOM);
+    for (size_t i = n - std::min(n, this->row_capacity[idx]); i < n; i++) {
+      ret[i] = this->robustness_at(idx, ctx, this->trace_front + i);
+    }
+    return ret;
+  }
+
+  // When evaluating lazily, the signals are only valid at the demanded frames, so they
+  // can't be reused. Workers don't share the values, to avoid locking.
+  if (!this->lazy && !ctx.in_worker && ins.free_ids.size == 0) {
+    if (!this->closed_ready[idx]) {
+      this->closed_values[idx] = this->compute_robustness(idx, ctx, demand);
+      this->closed_ready[idx]  = true;
+    }
+    return this->closed_values[idx];
+  }
+  return this->compute_robustness(idx, ctx, demand);
+}
+
+std::vector<double>
+IncrementalEngine::compute_robustness(size_t idx, Context& ctx, const Demand& demand) {
+  const NodeTimer timer{this->profiler, idx};
+  const auto& ins = this->program->code[idx];
+  const size_t n  = this->trace->size();
+  const auto args = this->program->args(ins);
+
+  switch (ins.op) {
+    case OpCode::TimeBound: {
+      auto ret = std::vector<double>{};
+      ret.reserve(n);
+      eval_time_bound(
+          ins, this->times[ins.var], *(this->trace), 0, n, std::back_inserter(ret));
+      return ret;
+    }
+    case OpCode::FrameBound: {
+      auto ret = std::vector<double>{};
+      ret.reserve(n);
+      eval_frame_bound(
+          ins, this->frames[ins.var], *(this->trace), 0, n, std::back_inserter(ret));
+      return ret;
+    }
+    case OpCode::Exists:
+    case OpCode::Forall: return this->quantify(idx, ctx, demand);
+    case OpCode::Not: return negate(this->robustness(args[0], ctx, demand));
+    case OpCode::And:
+    case OpCode::Or: {
+      // Operands are skipped at the frames where the result is already decided.
+      const bool is_and    = ins.op == OpCode::And;
+      const double decided = is_and ? BOTTOM : TOP;
+      auto ret             = std::vector<double>(n, is_and ? TOP : BOTTOM);
+      auto sub_demand      = demand;
+      for (const size_t arg : args) {
+        if (is_and) {
+          elementwise_min(ret, this->robustness(arg, ctx, sub_demand));
+        } else {
+          elementwise_max(ret, this->robustness(arg, ctx, sub_demand));
+        }
+        if (this->lazy && !prune_decided(sub_demand, ret, decided)) { break; }
+      }
+      return ret;
+    }
+    case OpCode::Previous:
+      return previous(this->robustness(args[0], ctx, demand_previous(demand)));
+    case OpCode::Always:
+      return always(
+          this->robustness(args[0], ctx, demand_window(demand, ins.interval)),
+          ins.interval);
+    case OpCode::Sometimes:
+      return sometimes(
+          this->robustness(args[0], ctx, demand_window(demand, ins.interval)),
+          ins.interval);
+    case OpCode::Since: {
+      const auto sub_demand = demand_prefix(demand);
+      const auto x          = this->robustness(args[0], ctx, sub_demand);
+      const auto y          = this->robustness(args[1], ctx, sub_demand);
+      return since(x, y);
+    }
+    case OpCode::BackTo: {
+      const auto sub_demand = demand_prefix(demand);
+      auto x                = this->robustness(args[0], ctx, sub_demand);
+      auto y                = this->robustness(args[1], ctx, sub_demand);
+      return backto(std::move(x), std::move(y));
+    }
+    case OpCode::CompareSpArea: {
+      auto lhs = std::vector<double>{};
+      lhs.reserve(n);
+      for (auto&& reg : this->regions(args[0], ctx, demand)) { lhs.push_back(topo::area(reg)); }
+      auto rhs = std::vector<double>{};
+      if (args.size() > 1) {
+        rhs.reserve(n);
+        for (auto&& reg : this->regions(args[1], ctx, demand)) { rhs.push_back(topo::area(reg)); }
+      } else {
+        rhs = std::vector<double>(n, ins.constant);
+      }
+      return compare_areas(ins.relation, std::move(lhs), rhs);
+    }
+    case OpCode::SpExists: {
+      auto ret = std::vector<double>{};
+      ret.reserve(n);
+      for (auto&& reg : this->regions(args[0], ctx, demand)) { ret.push_back(is_nonempty(reg)); }
+      return ret;
+    }
+    case OpCode::SpForall: throw not_implemented_error("SpForall semantics");
+    default: throw std::logic_error("Unexpected instruction in robustness table.");
+  }
+}
+
+std::vector<topo::Region>
+IncrementalEngine::regions(size_t idx, Context& ctx, const Demand& demand) {
+  const auto& ins = this->program->code[idx];
+  assert(is_spatial(ins.op));
+  const size_t n = this->trace->size();
+  if (ins.frame_local) {
+    if (this->lazy && !any_demanded(demand)) {
+      return std::vector<topo::Region>(n, topo::Empty{});
+    }
+    if (!this->tabled[idx]) {
+      const auto region = this->region_at(idx, ctx, this->num_frames - 1);
+      return std::vector<topo::Region>(n, region);
+    }
+    return window(this->region_row(idx, ctx).values, this->trace_front, this->num_frames);
+  }
+
+  const NodeTimer timer{this->profiler, idx};
+  const auto args = this->program->args(ins);
+
+  switch (ins.op) {
+    case OpCode::Complement: {
+      auto ret = this->regions(args[0], ctx, demand);
+      for (auto&& reg : ret) { reg = topo::spatial_complement(reg, this->universe); }
+      return ret;
+    }
+    case OpCode::Intersect: {
+      auto ret = std::vector<topo::Region>(n, topo::Universe{});
+      for (const size_t arg : args) {
+        const auto sub = this->regions(arg, ctx, demand);
+        for (size_t i = 0; i < n; i++) { ret[i] = topo::spatial_intersect(ret[i], sub[i]); }
+      }
+      return ret;
+    }
+    case OpCode::Union: {
+      auto ret = std::vector<topo::Region>(n, topo::Empty{});
+      for (const size_t arg : args) {
+        const auto sub = this->regions(arg, ctx, demand);
+        for (size_t i = 0; i < n; i++) { ret[i] = topo::spatial_union(ret[i], sub[i]); }
+      }
+      return ret;
+    }
+    case OpCode::Interior: {
+      auto ret = this->regions(args[0], ctx, demand);
+      for (auto&& reg : ret) { reg = topo::interior(reg); }
+      return ret;
+    }
+    case OpCode::Closure: {
+      auto ret = this->regions(args[0], ctx, demand);
+      for (auto&& reg : ret) { reg = topo::closure(reg); }
+      return ret;
+    }
+    case OpCode::SpPrevious:
+      return sp_previous(this->regions(args[0], ctx, demand_previous(demand)));
+    case OpCode::SpAlways:
+      return sp_always(
+          this->regions(args[0], ctx, demand_window(demand, ins.interval)), ins.interval);
+    case OpCode::SpSometimes:
+      return sp_sometimes(
+          this->regions(args[0], ctx, demand_window(demand, ins.interval)), ins.interval);
+    case OpCode::SpSince: {
+      const auto sub_demand = demand_prefix(demand);
+      return sp_since(
+          this->regions(args[0], ctx, sub_demand), this->regions(args[1], ctx, sub_demand));
+    }
+    case OpCode::SpBackTo: {
+      const auto sub_demand = demand_prefix(demand);
+      return sp_backto(
+          this->regions(args[0], ctx, sub_demand), this->regions(args[1], ctx, sub_demand));
+    }
+    default: throw std::logic_error("Unexpected instruction in region table.");
+  }
+}
+
+std::vector<double>
+IncrementalEngine::quantify(size_t idx, Context& ctx, const Demand& demand) {
+  // Iterate over all k-sized, repeated permutations of IDs in the current frame, where k
+  // is the number of IDs in the quantifier, and bind each of them to the ID variable
+  // slots (only the combinations if the body is symmetric in them). Rows of subformulas
+  // that only depend on the bound IDs are reused across calls to eval, so only the
+  // current frame needs to be evaluated for them.
+  const auto& ins      = this->program->code[idx];
+  const auto ids       = this->program->ids(ins);
+  const size_t body    = this->program->args(ins)[0];
+  const bool is_exists = ins.op == OpCode::Exists;
+  const size_t k       = ids.size();
+  const double decided = is_exists ? TOP : BOTTOM;
+
+  auto ret = std::vector<double>(this->trace->size(), is_exists ? BOTTOM : TOP);
+
+  // Objects in the current frame that each ID variable can be bound to.
+  const auto& frame = this->trace->back();
+  auto candidates   = std::vector<std::vector<size_t>>{};
+  static const auto no_guards = CandidateFilter{};
+  const auto& guards = (this->filter != nullptr) ? *(this->filter) : no_guards;
+  const auto bindings =
+      guards.select(*(this->program), idx, *(this->trace), candidates);
+  const auto bind = [&](Context& bound, const std::vector<size_t>& choice) {
+    for (size_t i = 0; i < k; i++) {
+      bound.binding[ids[i]] = frame.ids[candidates[i][choice[i]]];
+    }
+  };
+
+  if (this->pool != nullptr && !ctx.in_worker) {
+    // Each worker gets its own copy of the bindings of the enclosing scope.
+    auto workers = std::vector<Context>(this->pool->size(), Context{ctx.binding, true});
+    return reduce_product(
+        *(this->pool),
+        bindings,
+        is_exists,
+        std::move(ret),
+        (this->lazy) ? &demand : nullptr,
+        [&](const size_t worker,
+            const std::vector<size_t>& choice,
+            const Demand& sub_demand) {
+          // The regions computed for a permutation don't outlive it.
+          const topo::ArenaScope arena_scope{};
+          auto& worker_ctx = workers[worker];
+          bind(worker_ctx, choice);
+          count_permutation(this->profiler, idx);
+          return this->robustness(body, worker_ctx, sub_demand);
+        });
+  }
+
+  // The columns of a stable body are folded in place from its row, at the frames in its
+  // horizon (the others can't affect the robustness at the current frame).
+  const auto fold = [&](size_t t, double value) {
+    auto& acc = ret[t - this->trace_front];
+    acc       = is_exists ? std::max(acc, value) : std::min(acc, value);
+  };
+  const size_t last = this->num_frames;
+  auto sub_demand   = demand;
+  for (const auto& choice : bindings) {
+    bind(ctx, choice);
+    count_permutation(this->profiler, idx);
+    if (!this->stable[body]) {
+      const auto sub_rob = this->robustness(body, ctx, sub_demand);
+      if (is_exists) {
+        elementwise_max(ret, sub_rob);
+      } else {
+        elementwise_min(ret, sub_rob);
+      }
+    } else if (this->lazy && !any_demanded(sub_demand)) {
+      break;
+    } else if (this->tabled[body]) {
+      const auto& row = this->robustness_row(body, ctx);
+      for (size_t t = last - std::min(last - this->trace_front, row.values.size());
+           t < last;
+           t++) {
+        fold(t, row.values[t % row.values.size()]);
+      }
+    } else {
+      const size_t cap = this->row_capacity[body];
+      for (size_t t = last - std::min(last - this->trace_front, cap); t < last; t++) {
+        fold(t, this->robustness_at(body, ctx, t));
+      }
+    }
+    if (this->lazy && !prune_decided(sub_demand, ret, decided)) { break; }
+  }
+
+  return ret;
+}
+
+void IncrementalEngine::collect_garbage() {
+  // Only sweep the table once every horizon, as the rows for the objects in the current
+  // frame are all live anyway.
+  if (this->num_frames % this->capacity != 0) { return; }
+
+  const auto is_stale = [&](const auto& entry) {
+    return entry.second.end <= this->front;
+  };
+  for (auto& rows : this->robustness_table) {
+    for (auto it = rows.begin(); it != rows.end();) {
+      it = is_stale(*it) ? rows.erase(it) : std::next(it);
+    }
+  }
+  for (auto& rows : this->region_table) {
+    for (auto it = rows.begin(); it != rows.end();) {
+      it = is_stale(*it) ? rows.erase(it) : std::next(it);
+    }
+  }
+}
+
+void IncrementalEngine::save(SnapshotWriter& out, const FrameBuffer& buffer_) const {
+  const auto saved   = buffer_.id_table().saved_ids();
+  const size_t front_ = this->num_frames - std::min(this->num_frames, buffer_.size());
+  // Rows whose objects are no longer in the buffer end before its front, like the other
+  // rows swept by `collect_garbage`.
+  const auto is_live = [&](const Key& key, const Row<double>& row) {
+    return row.end > front_ && std::all_of(key.begin(), key.end(), [&](ObjectId id) {
+             return saved[id] != IdTable::NOT_SAVED;
+           });
+  };
+
+  out.write<std::uint64_t>(this->num_frames);
+  out.write<std::uint64_t>(this->capacity);
+  out.write<std::uint64_t>(this->robustness_table.size());
+  auto key_ = Key{};
+  for (size_t idx = 0; idx < this->robustness_table.size(); idx++) {
+    // The rows over the unbounded temporal operators only hold the current frame, for
+    // whichever span was last evaluated, and are recomputed instead.
+    const auto& rows    = this->robustness_table[idx];
+    const auto live     = [&](const auto& entry) {
+      return is_live(entry.first, entry.second);
+    };
+    const auto num_live =
+        (this->spans[idx]) ? 0 : std::count_if(rows.begin(), rows.end(), live);
+    out.write<std::uint64_t>(static_cast<std::uint64_t>(num_live));
+    for (const auto& [key, row] : rows) {
+      if (this->spans[idx] || !is_live(key, row)) { continue; }
+      key_.clear();
+      for (const ObjectId id : key) { key_.push_back(saved[id]); }
+      out.write_array(key_);
+      out.write<std::uint64_t>(row.end);
+      out.write_array(row.values);
+    }
+  }
+}
+
+void IncrementalEngine::load(SnapshotReader& in, const FrameBuffer& buffer_) {
+  const size_t num_buffered = buffer_.size();
+  auto table = std::vector<std::unordered_map<Key, Row<double>, KeyHash>>(
+      this->robustness_table.size());
+  size_t capacity_ = std::max(this->capacity, buffer_.capacity());
+  if (in.done()) {
+    this->num_frames = num_buffered;
+  } else {
+    const auto num_frames_ = static_cast<size_t>(in.read<std::uint64_t>());
+    const auto saved       = static_cast<size_t>(in.read<std::uint64_t>());
+    if (num_frames_ < num_buffered || saved == 0 ||
+        in.read<std::uint64_t>() != this->robustness_table.size()) {
+      throw std::invalid_argument("Snapshot of the table doesn't match the monitor.");
+    }
+    // Rows saved by a monitor whose buffer has since grown are checked, and dropped.
+    const bool keep    = saved >= capacity_;
+    capacity_          = std::max(capacity_, saved);
+    const auto lengths = this->row_capacities(saved);
+    for (size_t idx = 0; idx < table.size(); idx++) {
+      const auto num_rows = in.read<std::uint64_t>();
+      for (std::uint64_t i = 0; i < num_rows; i++) {
+        auto key = Key{};
+        in.read_array(key);
+        const bool known = std::all_of(key.begin(), key.end(), [&](ObjectId id) {
+          return buffer_.id_table().contains(id);
+        });
+        auto& row = table[idx][std::move(key)];
+        row.end   = static_cast<size_t>(in.read<std::uint64_t>());
+        in.read_array(row.values);
+        if (!known || row.values.size() != lengths[idx] || row.end > num_frames_) {
+          throw std::invalid_argument(
+              "Snapshot of the table doesn't match the monitor.");
+        }
+      }
+      if (!keep) { table[idx].clear(); }
+    }
+    in.finish();
+    this->num_frames = num_frames_;
+  }
+
+  this->capacity         = capacity_;
+  this->row_capacity     = this->row_capacities(capacity_);
+  this->robustness_table = std::move(table);
+  for (auto& rows : this->region_table) { rows.clear(); }
+}
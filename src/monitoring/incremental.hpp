@@ -0,0 +1,326 @@
+/**
+ * Incremental evaluation of STQL formulas for the OnlineMonitor.
+ *
+ * The engine runs on the compiled program for the formula. An instruction is stable if
+ * its value at a frame doesn't depend on the current frame, i.e., if it is frame-local
+ * (its value at a frame only depends on the contents of that frame and the objects
+ * bound to its ID variables), or a Not, And, Or, Previous, Always, Sometimes, Since or
+ * BackTo over stable operands. For the stable instructions that are needed at several
+ * frames, we keep a ring-buffer row of values (one column per frame in the horizon) for
+ * each binding of their free variables, and temporal operators also keep the running
+ * fold of their operands over their window. When a new frame is added, only the column
+ * for that frame needs to be computed, at a cost independent of the horizon, while the
+ * rest of the row is reused from the previous calls to `eval`. Cheap instructions that
+ * are needed at only a few frames skip the rows, and are recomputed at those frames.
+ *
+ * The values of the remaining instructions at older frames depend on the current frame
+ * (quantifiers bind the objects in the current frame, and TimeBound and FrameBound
+ * constraints use the pins at the current frame), so these are recomputed on each call
+ * to `eval` using the same semantics as `EvalStrategy::Recompute`, but
+ * only at the frames in the horizon of the instruction: a quantifier over a stable body
+ * folds the columns in the rows of the body. The ones that don't depend on any ID
+ * variable are only computed once per call, even if they are shared by several parents
+ * or formulas.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_INCREMENTAL_HPP__
+#define __PERCEMON_MONITORING_INCREMENTAL_HPP__
+
+#include "monitoring/frame_buffer.hpp"
+#include "monitoring/semantics.hpp"
+
+#include "percemon/datastream.hpp"
+#include "percemon/program.hpp"
+#include "percemon/topo.hpp"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+class CandidateFilter;
+class Profiler;
+class SnapshotReader;
+class SnapshotWriter;
+class ThreadPool;
+
+class IncrementalEngine {
+ public:
+  IncrementalEngine() = delete;
+  /**
+   * @param program      Compiled formula to monitor.
+   * @param max_horizon  Maximum number of frames in the buffer of the monitor. If the
+   *                     buffer grows past it (see `BufferMode::Time`), the table is
+   *                     cleared and its rows resized, and they are recomputed from the
+   *                     buffer.
+   * @param horizons     Horizon of each instruction (see `get_horizons`), to size the
+   *                     rows of the instruction. If empty, all rows hold `max_horizon`
+   *                     frames.
+   * @param universe     Bounding box for the UNIVERSE.
+   * @param pool         If not null, the permutations of objects in the outermost
+   *                     quantifiers are evaluated in parallel on this pool.
+   * @param lazy         If subformulas are only evaluated at the frames where they can
+   *                     affect the robustness at the current frame.
+   * @param profiler     If not null, the computation of each row and signal is recorded
+   *                     in this profiler.
+   * @param filter       If not null, the objects enumerated by the quantifiers are
+   *                     pruned with its guards.
+   */
+  IncrementalEngine(
+      const Program& program,
+      size_t max_horizon,
+      const std::vector<std::optional<size_t>>& horizons,
+      const topo::BoundingBox& universe,
+      ThreadPool* pool              = nullptr,
+      bool lazy                     = false,
+      Profiler* profiler            = nullptr,
+      const CandidateFilter* filter = nullptr);
+  IncrementalEngine(IncrementalEngine&&) noexcept;
+  IncrementalEngine& operator=(IncrementalEngine&&) noexcept;
+  ~IncrementalEngine();
+
+  /**
+   * Notify that a frame was added to the back of the buffer (and a frame possibly
+   * removed from the front).
+   */
+  void add_frame() { num_frames++; }
+
+  /**
+   * Compute the robustness at the current (last) frame in the buffer.
+   */
+  double eval(const Program& program, const FrameBuffer& buffer);
+  /**
+   * Compute the robustness of each of the roots of the program at the current frame,
+   * where the `i`th root is evaluated on the last `horizons[i]` frames in the buffer.
+   */
+  std::vector<double> eval_all(
+      const Program& program,
+      const FrameBuffer& buffer,
+      const std::vector<size_t>& horizons);
+
+  /**
+   * Write the number of frames added, the capacity and the rows of robustness values to
+   * a snapshot, for the buffer saved with it. Only the rows with values for the frames
+   * in the buffer are saved, with their keys renumbered as the objects in the buffer
+   * (see `IdTable::saved_ids`).
+   * The rows of regions aren't saved, and are recomputed from the buffer when they are
+   * needed.
+   */
+  void save(SnapshotWriter& out, const FrameBuffer& buffer) const;
+  /**
+   * Replace the table with the one saved in a snapshot, for the buffer it is restored
+   * with. An empty snapshot (or one whose rows are too short for the buffer) leaves the
+   * table empty, with the frames in the buffer as the only ones added.
+   *
+   * @throws std::invalid_argument if the snapshot is malformed or was saved for a
+   * different program, in which case the table is unchanged.
+   */
+  void load(SnapshotReader& in, const FrameBuffer& buffer);
+
+ private:
+  /**
+   * Running fold of the operands of a temporal operator over a window of frames.
+   */
+  struct Window;
+
+  template <typename T>
+  struct Row {
+    /**
+     * Ring-buffer of values, where the value for the `i`th frame added to the monitor
+     * is at `i % values.size()`. Rows only hold the frames within the horizon of their
+     * instruction, as the values at older frames are never used.
+     */
+    std::vector<T> values;
+    /**
+     * One past the index of the last frame for which the value is computed.
+     */
+    size_t end = 0;
+    /**
+     * Front of the span that the last column was computed for, for the instructions
+     * over an unbounded temporal operator (see `spans`).
+     */
+    size_t front = 0;
+    /**
+     * Fold of the operands over the window of the last column, for temporal operators.
+     * It isn't saved in snapshots, and is refolded from the rows of the operands when
+     * it is missing.
+     */
+    std::unique_ptr<Window> window;
+    /**
+     * Guards the computation of new columns when quantifiers are evaluated in parallel.
+     */
+    std::mutex mtx;
+  };
+
+  /**
+   * Object IDs bound to the free variables of an instruction.
+   */
+  using Key = std::vector<ObjectId>;
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t seed = key.size();
+      for (const ObjectId id : key) {
+        seed ^= id + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      }
+      return seed;
+    }
+  };
+
+  /**
+   * State of a worker evaluating the program.
+   */
+  struct Context {
+    /**
+     * Interned object IDs currently bound to each ID variable slot.
+     */
+    std::vector<ObjectId> binding;
+    /**
+     * If this context belongs to a worker in the thread pool, in which case nested
+     * quantifiers are evaluated serially.
+     */
+    bool in_worker = false;
+    /**
+     * Key of the row being looked up, which is only copied into the table when the row
+     * is inserted.
+     */
+    Key key = {};
+  };
+
+  size_t capacity;
+  std::vector<std::optional<size_t>> horizons;
+  /**
+   * Number of frames held in the rows of each instruction.
+   */
+  std::vector<size_t> row_capacity;
+  /**
+   * If the instruction is stable (see above), so that its values at older frames are
+   * kept across calls to `eval`.
+   */
+  std::vector<bool> stable;
+  /**
+   * If the stable instruction has rows in the table: the temporal operators, their
+   * operands, and the instructions that a parent that isn't stable needs at older
+   * frames. The others are computed at the frames where they are needed.
+   */
+  std::vector<bool> tabled;
+  /**
+   * If the value of the stable instruction depends on the front of the span of the
+   * root being evaluated, as for the unbounded temporal operators (and the stable
+   * instructions over them), which are then only needed at the current frame.
+   */
+  std::vector<bool> spans;
+  topo::BoundingBox universe;
+  ThreadPool* pool;
+  bool lazy;
+  Profiler* profiler;
+  const CandidateFilter* filter;
+
+  /**
+   * Total number of frames added to the monitor.
+   */
+  size_t num_frames = 0;
+
+  /**
+   * Rows of each tabled instruction, for each binding of its free variables. These are
+   * what make the values of the stable subformulas and regions at a frame computed
+   * once, for as long as the frame is in the buffer.
+   */
+  std::vector<std::unordered_map<Key, Row<double>, KeyHash>> robustness_table;
+  std::vector<std::unordered_map<Key, Row<topo::Region>, KeyHash>> region_table;
+  /**
+   * Guards the insertion of rows for each instruction in the tables.
+   */
+  std::unique_ptr<std::mutex[]> table_mtx;
+
+  // State for the current call to eval.
+
+  const Program* program    = nullptr;
+  const FrameBuffer* buffer = nullptr;
+  /**
+   * Index of the frame at the front of the buffer. The rows are computed for all the
+   * frames in the buffer.
+   */
+  size_t front = 0;
+  /**
+   * Frames seen by the root being evaluated, and the index of the first one. The
+   * signals of the instructions that aren't frame-local only cover these frames.
+   */
+  std::optional<FrameSpan> trace;
+  size_t trace_front = 0;
+  /**
+   * Values of the pinned time and frame variables.
+   */
+  std::vector<double> times, frames;
+  /**
+   * Signals of the instructions that don't depend on any ID variable, which have been
+   * computed for the current span in the current call to eval.
+   */
+  std::vector<std::vector<double>> closed_values;
+  std::vector<bool> closed_ready;
+
+  /**
+   * Number of frames held in the rows of each instruction, for rows of at most
+   * `capacity_` frames.
+   */
+  [[nodiscard]] std::vector<size_t> row_capacities(size_t capacity_) const;
+
+  void begin_eval(const Program& program, const FrameBuffer& buffer);
+  double eval_root(size_t root, const FrameSpan& trace);
+
+  /**
+   * Get the key of the row of the instruction for the current binding, in `ctx.key`.
+   */
+  const Key& key_of(const Instruction& ins, Context& ctx) const;
+
+  Row<double>& robustness_row(size_t idx, Context& ctx);
+  Row<topo::Region>& region_row(size_t idx, Context& ctx);
+  /**
+   * Compute the new columns `[first, last)` of the row of a temporal operator, by
+   * sliding the fold of its operands over the window of each column.
+   */
+  void fold_columns(
+      size_t idx,
+      Context& ctx,
+      Row<double>& row,
+      size_t first,
+      size_t last);
+
+  /**
+   * Get the value of the stable instruction at `idx` at the `t`th frame added to the
+   * monitor, which must be in the horizon of the instruction. Instructions without
+   * rows are computed directly, from the values of their operands at that frame.
+   */
+  double robustness_at(size_t idx, Context& ctx, size_t t);
+  topo::Region region_at(size_t idx, Context& ctx, size_t t);
+  double compute_at(size_t idx, Context& ctx, size_t t);
+  topo::Region compute_region_at(size_t idx, Context& ctx, size_t t);
+
+  /**
+   * Compute the signal for the instruction at `idx`, at least at the demanded frames in
+   * the horizon of the instruction.
+   *
+   * Rows for stable instructions that aren't demanded at any frame are left as is, and
+   * the missing columns are computed the next time the row is demanded.
+   */
+  std::vector<double> robustness(size_t idx, Context& ctx, const Demand& demand);
+  std::vector<double> compute_robustness(size_t idx, Context& ctx, const Demand& demand);
+  std::vector<topo::Region> regions(size_t idx, Context& ctx, const Demand& demand);
+
+  std::vector<double> quantify(size_t idx, Context& ctx, const Demand& demand);
+
+  /**
+   * Remove rows that don't have values for any of the frames in the buffer.
+   */
+  void collect_garbage();
+};
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_INCREMENTAL_HPP__ */
@@ -0,0 +1,196 @@
+#include "monitoring/profiler.hpp"
+
+#include "percemon/fmt.hpp"
+#include "percemon/topo.hpp"
+#include "percemon/utils.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <variant>
+
+using namespace percemon;
+using namespace percemon::monitoring;
+using namespace percemon::monitoring::details;
+
+namespace {
+
+/**
+ * Longest annotation printed for an instruction.
+ */
+constexpr size_t MAX_SOURCE_WIDTH = 72;
+
+const char* name_of(OpCode op) {
+  switch (op) {
+    case OpCode::Const: return "Const";
+    case OpCode::TimeBound: return "TimeBound";
+    case OpCode::FrameBound: return "FrameBound";
+    case OpCode::CompareId: return "CompareId";
+    case OpCode::CompareClass: return "CompareClass";
+    case OpCode::CompareProb: return "CompareProb";
+    case OpCode::CompareArea: return "CompareArea";
+    case OpCode::CompareLat: return "CompareLat";
+    case OpCode::CompareLon: return "CompareLon";
+    case OpCode::CompareED: return "CompareED";
+    case OpCode::Exists: return "Exists";
+    case OpCode::Forall: return "Forall";
+    case OpCode::Not: return "Not";
+    case OpCode::And: return "And";
+    case OpCode::Or: return "Or";
+    case OpCode::Previous: return "Previous";
+    case OpCode::Always: return "Always";
+    case OpCode::Sometimes: return "Sometimes";
+    case OpCode::Since: return "Since";
+    case OpCode::BackTo: return "BackTo";
+    case OpCode::CompareSpArea: return "CompareSpArea";
+    case OpCode::SpExists: return "SpExists";
+    case OpCode::SpForall: return "SpForall";
+    case OpCode::EmptySet: return "EmptySet";
+    case OpCode::UniverseSet: return "UniverseSet";
+    case OpCode::BBox: return "BBox";
+    case OpCode::Complement: return "Complement";
+    case OpCode::Intersect: return "Intersect";
+    case OpCode::Union: return "Union";
+    case OpCode::Interior: return "Interior";
+    case OpCode::Closure: return "Closure";
+    case OpCode::SpPrevious: return "SpPrevious";
+    case OpCode::SpAlways: return "SpAlways";
+    case OpCode::SpSometimes: return "SpSometimes";
+    case OpCode::SpSince: return "SpSince";
+    case OpCode::SpBackTo: return "SpBackTo";
+  }
+  return "?";
+}
+
+std::string source_of(const Program& program, size_t idx) {
+  auto source = std::string{};
+  if (idx < program.sources.size()) {
+    source = std::visit(
+        utils::overloaded{
+            [](const std::monostate&) { return std::string{}; },
+            [](const auto& e) { return fmt::format("{}", e); }},
+        program.sources[idx]);
+  }
+  if (source.empty()) { return name_of(program.code[idx].op); }
+  if (source.size() > MAX_SOURCE_WIDTH) {
+    source.resize(MAX_SOURCE_WIDTH - 3);
+    source += "...";
+  }
+  return source;
+}
+
+double to_ms(std::chrono::nanoseconds time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+} // namespace
+
+void Profiler::record(
+    size_t idx,
+    std::chrono::nanoseconds total,
+    std::chrono::nanoseconds self,
+    size_t allocations) {
+  auto& node = this->nodes[idx];
+  node.calls.fetch_add(1, std::memory_order_relaxed);
+  node.total_ns.fetch_add(total.count(), std::memory_order_relaxed);
+  node.self_ns.fetch_add(self.count(), std::memory_order_relaxed);
+  node.allocations.fetch_add(allocations, std::memory_order_relaxed);
+}
+
+Profile Profiler::snapshot() const {
+  auto profile = Profile{};
+  profile.nodes.reserve(this->nodes.size());
+  for (const auto& node : this->nodes) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    auto& out              = profile.nodes.emplace_back();
+    out.calls              = node.calls.load(relaxed);
+    out.total_time         = std::chrono::nanoseconds{node.total_ns.load(relaxed)};
+    out.self_time          = std::chrono::nanoseconds{node.self_ns.load(relaxed)};
+    out.permutations       = node.permutations.load(relaxed);
+    out.allocations        = node.allocations.load(relaxed);
+  }
+  return profile;
+}
+
+void Profiler::reset() {
+  for (auto& node : this->nodes) {
+    node.calls        = 0;
+    node.total_ns     = 0;
+    node.self_ns      = 0;
+    node.permutations = 0;
+    node.allocations  = 0;
+  }
+}
+
+#if defined(PERCEMON_PROFILING)
+
+thread_local NodeTimer* NodeTimer::current = nullptr;
+
+NodeTimer::NodeTimer(Profiler* profiler_, size_t idx_) : profiler{profiler_}, idx{idx_} {
+  if (this->profiler == nullptr) { return; }
+  this->parent            = current;
+  current                 = this;
+  this->start_allocations = topo::arena_allocations();
+  this->start             = Clock::now();
+}
+
+NodeTimer::~NodeTimer() {
+  if (this->profiler == nullptr) { return; }
+  const auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - this->start);
+  const size_t allocations = topo::arena_allocations() - this->start_allocations;
+  this->profiler->record(
+      this->idx,
+      total,
+      total - this->children_time,
+      allocations - this->children_allocations);
+
+  current = this->parent;
+  if (this->parent != nullptr) {
+    this->parent->children_time += total;
+    this->parent->children_allocations += allocations;
+  }
+}
+
+#endif
+
+std::string percemon::monitoring::format_profile(
+    const Program& program,
+    const Profile& profile) {
+  if (profile.nodes.empty()) { return "No profile was recorded.\n"; }
+
+  // Instructions that were evaluated, the ones with the most self time first.
+  auto order = std::vector<size_t>(std::min(profile.nodes.size(), program.code.size()));
+  std::iota(order.begin(), order.end(), 0);
+  order.erase(
+      std::remove_if(
+          order.begin(),
+          order.end(),
+          [&](const size_t idx) { return profile.nodes[idx].calls == 0; }),
+      order.end());
+  std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+    return profile.nodes[a].self_time > profile.nodes[b].self_time;
+  });
+
+  auto out = fmt::format(
+      "{:>5} {:>10} {:>12} {:>12} {:>12} {:>12}  {}\n",
+      "node",
+      "calls",
+      "total (ms)",
+      "self (ms)",
+      "permutations",
+      "allocations",
+      "subformula");
+  for (const size_t idx : order) {
+    const auto& node = profile.nodes[idx];
+    out += fmt::format(
+        "{:>5} {:>10} {:>12.3f} {:>12.3f} {:>12} {:>12}  {}\n",
+        idx,
+        node.calls,
+        to_ms(node.total_time),
+        to_ms(node.self_time),
+        node.permutations,
+        node.allocations,
+        source_of(program, idx));
+  }
+  return out;
+}
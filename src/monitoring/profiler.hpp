@@ -0,0 +1,105 @@
+/**
+ * Counters for profiling the evaluation of the instructions of a program.
+ *
+ * The monitors open a `NodeTimer` for each instruction they compute, which records the
+ * time spent in the instruction and the allocations it made from the region arena. The
+ * timers on a thread form a stack, so the time and allocations of an instruction are
+ * subtracted from its parent to get the self time and allocations of the parent. Unless
+ * the library is built with `PERCEMON_PROFILING`, the timers are empty and every hook
+ * compiles to nothing.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_PROFILER_HPP__
+#define __PERCEMON_MONITORING_PROFILER_HPP__
+
+#include "percemon/monitoring.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+class Profiler {
+ public:
+  Profiler() = delete;
+  /**
+   * Create the counters for a program with `num_nodes` instructions.
+   */
+  explicit Profiler(size_t num_nodes) : nodes(num_nodes) {}
+
+  void record(
+      size_t idx,
+      std::chrono::nanoseconds total,
+      std::chrono::nanoseconds self,
+      size_t allocations);
+  void add_permutations(size_t idx, size_t count) {
+    nodes[idx].permutations.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] Profile snapshot() const;
+  void reset();
+
+ private:
+  /**
+   * The counters are updated by the workers evaluating permutations in parallel.
+   */
+  struct Counters {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::int64_t> total_ns{0}, self_ns{0};
+    std::atomic<std::uint64_t> permutations{0}, allocations{0};
+  };
+  std::vector<Counters> nodes;
+};
+
+#if defined(PERCEMON_PROFILING)
+
+/**
+ * Records the evaluation of an instruction from construction to destruction, if the
+ * profiler isn't null.
+ */
+class NodeTimer {
+ public:
+  NodeTimer(Profiler* profiler_, size_t idx_);
+  ~NodeTimer();
+  NodeTimer(const NodeTimer&) = delete;
+  NodeTimer& operator=(const NodeTimer&) = delete;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  Profiler* profiler;
+  size_t idx;
+  Clock::time_point start;
+  size_t start_allocations = 0;
+  /**
+   * Time and allocations of the instructions timed while this one is the innermost.
+   */
+  std::chrono::nanoseconds children_time{0};
+  size_t children_allocations = 0;
+  NodeTimer* parent           = nullptr;
+
+  static thread_local NodeTimer* current;
+};
+
+inline void count_permutation(Profiler* profiler, size_t idx) {
+  if (profiler != nullptr) { profiler->add_permutations(idx, 1); }
+}
+
+#else
+
+class NodeTimer {
+ public:
+  NodeTimer(Profiler*, size_t) {}
+};
+
+inline void count_permutation(Profiler*, size_t) {}
+
+#endif
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_PROFILER_HPP__ */
@@ -0,0 +1,691 @@
+/**
+ * Quantitative semantics of the STQL operators, shared by the monitoring engines.
+ *
+ * Every signal here is aligned with the frame buffer of the monitor: the front of a
+ * vector holds the value at the oldest buffered frame and the back holds the value at
+ * the current frame.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_SEMANTICS_HPP__
+#define __PERCEMON_MONITORING_SEMANTICS_HPP__
+
+#include "monitoring/frame_buffer.hpp"
+
+#include "percemon/ast.hpp"
+#include "percemon/datastream.hpp"
+#include "percemon/program.hpp"
+#include "percemon/topo.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+// TODO: Revisit if this can be configurable.
+constexpr double TOP    = std::numeric_limits<double>::infinity();
+constexpr double BOTTOM = -TOP;
+
+constexpr double bool_to_robustness(const bool v) { return (v) ? TOP : BOTTOM; }
+
+/**
+ * Call `fn` with the function object for the comparison, so that kernels can be
+ * specialised for each comparison instead of calling a type-erased function for each
+ * value.
+ */
+template <typename Fn>
+decltype(auto) visit_relation(ast::ComparisonOp op, Fn&& fn) {
+  switch (op) {
+    case ast::ComparisonOp::GE: return fn(std::greater_equal<double>{});
+    case ast::ComparisonOp::GT: return fn(std::greater<double>{});
+    case ast::ComparisonOp::LE: return fn(std::less_equal<double>{});
+    case ast::ComparisonOp::LT: return fn(std::less<double>{});
+    case ast::ComparisonOp::EQ: return fn(std::equal_to<double>{});
+    case ast::ComparisonOp::NE: return fn(std::not_equal_to<double>{});
+  }
+  throw std::logic_error("unreachable as all comparisons are handled");
+}
+
+/**
+ * Same as `visit_relation`, but only for `==` and `!=`.
+ */
+template <typename Fn>
+decltype(auto) visit_equality(ast::ComparisonOp op, Fn&& fn) {
+  switch (op) {
+    case ast::ComparisonOp::EQ: return fn(std::equal_to<double>{});
+    case ast::ComparisonOp::NE: return fn(std::not_equal_to<double>{});
+    default: throw std::logic_error("unreachable as constraint can only be EQ and NE");
+  }
+}
+
+constexpr double get_lateral_distance(const topo::BoundingBox& bbox, const ast::CRT crt) {
+  switch (crt) {
+    // Based on partial ordering defined in paper.
+    case ast::CRT::CT: return (bbox.xmax + bbox.xmin) / 2; break;
+    case ast::CRT::RM: return bbox.xmax; break; // Bottom Right
+    case ast::CRT::LM: return bbox.xmin; break; // Top Left
+    case ast::CRT::TM: return bbox.xmax; break; // Top Right
+    case ast::CRT::BM: return bbox.xmin; break; // Bottom left
+    default: return 0;
+  }
+}
+
+constexpr double
+get_longidutnal_distance(const topo::BoundingBox& bbox, const ast::CRT crt) {
+  switch (crt) {
+    // Based on partial ordering defined in paper.
+    case ast::CRT::CT: return (bbox.ymax + bbox.ymin) / 2; break;
+    case ast::CRT::TM: return bbox.ymin; break; // Top Right
+    case ast::CRT::BM: return bbox.ymax; break; // Bottom left
+    case ast::CRT::LM: return bbox.ymin; break; // Top Left
+    case ast::CRT::RM: return bbox.ymax; break; // Bottom Right
+    default: return 0;
+  }
+}
+
+/**
+ * The frames covered by a FrameInterval at frame `t`, given as a half-open range of
+ * offsets `[first, last)` into the past, i.e., the frames in `(t - last, t - first]`.
+ */
+struct FrameWindow {
+  size_t first;
+  size_t last;
+
+  [[nodiscard]] constexpr bool empty() const { return first >= last; }
+};
+
+constexpr FrameWindow frame_window(const ast::FrameInterval& expr) {
+  const bool lopen = expr.bound == ast::FrameInterval::OPEN ||
+                     expr.bound == ast::FrameInterval::LOPEN;
+  const bool ropen = expr.bound == ast::FrameInterval::OPEN ||
+                     expr.bound == ast::FrameInterval::ROPEN;
+  return FrameWindow{expr.low + (lopen ? 1 : 0), expr.high + (ropen ? 0 : 1)};
+}
+
+/**
+ * The window for a (possibly unbounded) temporal operator over a signal of `n` frames.
+ */
+inline FrameWindow
+frame_window(const std::optional<ast::FrameInterval>& interval, size_t n) {
+  return (interval.has_value()) ? frame_window(*interval) : FrameWindow{0, n};
+}
+
+// Object attributes that can be compared against each other or a literal, scaled by
+// the multiplier given in the formula.
+
+struct ProbOf {
+  double scale;
+  double operator()(const FrameColumns& frame, const size_t i) const {
+    return frame.probability[i] * scale;
+  }
+};
+
+struct AreaOf {
+  double scale;
+  double operator()(const FrameColumns& frame, const size_t i) const {
+    return topo::area(topo::BoundingBox{frame.bbox(i)}) * scale;
+  }
+};
+
+struct LatOf {
+  ast::CRT crt;
+  double scale;
+  double operator()(const FrameColumns& frame, const size_t i) const {
+    return get_lateral_distance(topo::BoundingBox{frame.bbox(i)}, crt) * scale;
+  }
+};
+
+struct LonOf {
+  ast::CRT crt;
+  double scale;
+  double operator()(const FrameColumns& frame, const size_t i) const {
+    return get_longidutnal_distance(topo::BoundingBox{frame.bbox(i)}, crt) * scale;
+  }
+};
+
+/**
+ * Call `fn` with the attribute accessors for the LHS and RHS of a CompareProb,
+ * CompareArea, CompareLat, or CompareLon instruction.
+ */
+template <typename Fn>
+decltype(auto) visit_attributes(const Instruction& ins, Fn&& fn) {
+  switch (ins.op) {
+    case OpCode::CompareProb: return fn(ProbOf{ins.lhs_scale}, ProbOf{ins.rhs_scale});
+    case OpCode::CompareArea: return fn(AreaOf{ins.lhs_scale}, AreaOf{ins.rhs_scale});
+    case OpCode::CompareLat:
+      return fn(
+          LatOf{ins.lhs_crt, ins.lhs_scale}, LatOf{ins.rhs_crt, ins.rhs_scale});
+    case OpCode::CompareLon:
+      return fn(
+          LonOf{ins.lhs_crt, ins.lhs_scale}, LonOf{ins.rhs_crt, ins.rhs_scale});
+    default: throw std::logic_error("Instruction doesn't compare object attributes.");
+  }
+}
+
+// Leaf predicates, evaluated over the frames `[first, last)` in the buffer. The object
+// IDs bound to the Var_id in the predicate are resolved by the caller, and a `nullptr`
+// for the second ID implies that the right hand side of the comparison is a literal.
+
+template <typename OutIt>
+OutIt eval_time_bound(
+    const Instruction& ins,
+    const double x,
+    const FrameSpan& trace,
+    size_t first,
+    const size_t last,
+    OutIt out) {
+  // TODO: Check if evaluating against timestamp is correct.
+  // TODO: Timestamp should be elapsed time from beginning of monitoring.
+  const bool upper = ins.relation == ast::ComparisonOp::LT ||
+                     ins.relation == ast::ComparisonOp::LE;
+  const bool lower = ins.relation == ast::ComparisonOp::GT ||
+                     ins.relation == ast::ComparisonOp::GE;
+  return visit_relation(ins.relation, [&](const auto op) {
+    const auto holds = [&](size_t t) {
+      return op(x - trace[t].timestamp, ins.constant);
+    };
+    if (trace.ordered() && (upper || lower)) {
+      // The time since a frame doesn't increase along the trace, so an upper bound
+      // holds from the first frame where it holds, and a lower bound up to the first
+      // frame where it doesn't.
+      size_t lo = first, hi = last;
+      while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (holds(mid) != upper) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      for (; first != lo; ++first) { *out++ = bool_to_robustness(!upper); }
+      for (; first != last; ++first) { *out++ = bool_to_robustness(upper); }
+      return out;
+    }
+    for (; first != last; ++first) { *out++ = bool_to_robustness(holds(first)); }
+    return out;
+  });
+}
+
+template <typename OutIt>
+OutIt eval_frame_bound(
+    const Instruction& ins,
+    const double f,
+    const FrameSpan& trace,
+    size_t first,
+    const size_t last,
+    OutIt out) {
+  // TODO: Check if evaluating against frame_num is correct.
+  return visit_relation(ins.relation, [&](const auto op) {
+    for (; first != last; ++first) {
+      const size_t frame_num = trace[first].frame_num;
+      *out++                 = bool_to_robustness(op(f - frame_num, ins.constant));
+    }
+    return out;
+  });
+}
+
+inline double
+eval_compare_id(const Instruction& ins, const ObjectId obj_id1, const ObjectId obj_id2) {
+  // TODO: Ask Mohammad if the ID constraints are correctly evaluated. Paper is
+  // vague. Do I have to check bounding boxes and other things too?
+  switch (ins.relation) {
+    case ast::ComparisonOp::EQ: return bool_to_robustness(obj_id1 == obj_id2);
+    case ast::ComparisonOp::NE: return bool_to_robustness(obj_id1 != obj_id2);
+    default: throw std::logic_error("unreachable as constraint can only be EQ and NE");
+  }
+}
+
+template <typename OutIt>
+OutIt eval_compare_class(
+    const Instruction& ins,
+    const ObjectId id1,
+    const ObjectId* id2,
+    const FrameSpan& trace,
+    size_t first,
+    const size_t last,
+    OutIt out) {
+  return visit_equality(ins.relation, [&](const auto op) {
+    for (; first != last; ++first) { // For each frame in trace,
+      const auto& frame = trace[first];
+      // Check if ID1 is there in the frame.
+      const size_t i = frame.find(id1);
+      if (i == FrameColumns::npos) { // If ID isn't in the frame: -inf
+        *out++ = BOTTOM;
+        continue;
+      }
+      // Get the class of the ID1 if it is there in frame.
+      const int class1 = frame.object_class[i];
+
+      int class2 = -1;
+      if (id2 == nullptr) {
+        // If we are comparing against a class literal, just assign it.
+        class2 = static_cast<int>(ins.constant);
+      } else {
+        // If we are comparing against another class function, check if ID2 is there
+        // in the frame.
+        const size_t j = frame.find(*id2);
+        if (j == FrameColumns::npos) { // ID2 not in frame: -inf
+          *out++ = BOTTOM;
+          continue;
+        }
+        class2 = frame.object_class[j];
+      }
+      *out++ = bool_to_robustness(op(class1, class2));
+    }
+    return out;
+  });
+}
+
+/**
+ * Evaluate one of CompareProb, CompareArea, CompareLat, or CompareLon, i.e., a
+ * relational comparison of a (scaled) attribute of an object against either a literal
+ * or a (scaled) attribute of another object.
+ */
+template <typename OutIt>
+OutIt eval_compare_attribute(
+    const Instruction& ins,
+    const ObjectId id1,
+    const ObjectId* id2,
+    const FrameSpan& trace,
+    size_t first,
+    const size_t last,
+    OutIt out) {
+  return visit_attributes(ins, [&](const auto lhs_of, const auto rhs_of) {
+    return visit_relation(ins.relation, [&](const auto op) {
+      for (; first != last; ++first) { // For each frame in trace,
+        const auto& frame = trace[first];
+        // Check if ID1 is there in the frame.
+        const size_t i = frame.find(id1);
+        if (i == FrameColumns::npos) { // If ID isn't in the frame: -inf
+          *out++ = BOTTOM;
+          continue;
+        }
+        const double lhs = lhs_of(frame, i);
+
+        // Check if ID2 is needed and exists and get the comparing value.
+        double rhs = ins.constant;
+        if (id2 != nullptr) {
+          const size_t j = frame.find(*id2);
+          if (j == FrameColumns::npos) { // ID2 not in frame: -inf
+            *out++ = BOTTOM;
+            continue;
+          }
+          rhs = rhs_of(frame, j);
+        }
+        *out++ = bool_to_robustness(op(lhs, rhs));
+      }
+      return out;
+    });
+  });
+}
+
+template <typename OutIt>
+OutIt eval_bbox(
+    const ObjectId id,
+    const FrameSpan& trace,
+    size_t first,
+    const size_t last,
+    OutIt out) {
+  for (; first != last; ++first) {
+    // Check if ID is in frame.
+    const auto& frame = trace[first];
+    const size_t i    = frame.find(id);
+    if (i != FrameColumns::npos) {
+      *out++ = topo::Region{topo::BoundingBox{frame.bbox(i)}};
+    } else {
+      *out++ = topo::Region{topo::Empty{}};
+    }
+  }
+  return out;
+}
+
+// Demand for the values of a subformula. When evaluating lazily, each subformula is
+// only guaranteed to be evaluated at the frames where its value is demanded by its
+// parent, and the values at the remaining frames are unspecified (but never NaN, so
+// that they don't affect the min/max of decided values).
+
+using Demand = std::vector<bool>;
+
+inline bool any_demanded(const Demand& demand) {
+  return std::find(demand.begin(), demand.end(), true) != demand.end();
+}
+
+/**
+ * Demand for the formula when evaluated over `n` frames: only the robustness at the
+ * current frame is needed when evaluating lazily.
+ */
+inline Demand root_demand(size_t n, bool lazy) {
+  auto ret = Demand(n, !lazy);
+  if (n > 0) { ret.back() = true; }
+  return ret;
+}
+
+/**
+ * Demand for the operands of operators whose value at a frame depends on all the
+ * frames before it.
+ */
+inline Demand demand_prefix(const Demand& demand) {
+  auto ret  = Demand(demand.size(), false);
+  auto last = std::find(demand.rbegin(), demand.rend(), true);
+  std::fill(ret.begin(), std::next(ret.begin(), std::distance(last, demand.rend())), true);
+  return ret;
+}
+
+/**
+ * Demand for the operands of the temporal operators over the window `w`: frame `s` is
+ * demanded if it is in the window of a demanded frame.
+ */
+inline Demand demand_window(const Demand& demand, const FrameWindow& w) {
+  const size_t n = demand.size();
+  auto ret       = Demand(n, false);
+  if (w.empty()) { return ret; }
+  // Sweep backwards, tracking the nearest demanded frame at or after `s + w.first`.
+  size_t next = n;
+  for (size_t s = n; s-- > 0;) {
+    if (s + w.first < n && demand[s + w.first]) { next = s + w.first; }
+    ret[s] = next < n && next < s + w.last;
+  }
+  return ret;
+}
+
+inline Demand
+demand_window(const Demand& demand, const std::optional<ast::FrameInterval>& interval) {
+  return (interval.has_value()) ? demand_window(demand, frame_window(*interval))
+                                : demand_prefix(demand);
+}
+
+/**
+ * Demand for the operand of Previous and SpPrevious.
+ */
+inline Demand demand_previous(const Demand& demand) {
+  auto ret = Demand(demand.size(), false);
+  for (size_t t = 1; t < demand.size(); t++) { ret[t - 1] = demand[t]; }
+  return ret;
+}
+
+/**
+ * Remove the frames at which `acc` is saturated at `decided` from the demand, and
+ * check if any frames are still demanded.
+ */
+inline bool prune_decided(Demand& demand, const std::vector<double>& acc, double decided) {
+  bool any = false;
+  for (size_t t = 0; t < demand.size(); t++) {
+    demand[t] = demand[t] && acc[t] != decided;
+    any       = any || demand[t];
+  }
+  return any;
+}
+
+/**
+ * Call `fn(first, last)` for each maximal run `[first, last)` of demanded frames.
+ */
+template <typename Fn>
+void for_each_run(const Demand& demand, Fn&& fn) {
+  size_t t = 0;
+  while (t < demand.size()) {
+    if (!demand[t]) {
+      t++;
+      continue;
+    }
+    const size_t first = t;
+    while (t < demand.size() && demand[t]) { t++; }
+    fn(first, t);
+  }
+}
+
+// Point-wise operations on signals.
+
+inline std::vector<double> negate(std::vector<double> rho) {
+  for (auto&& r : rho) { r = -1 * r; }
+  return rho;
+}
+
+inline void elementwise_min(std::vector<double>& acc, const std::vector<double>& rho) {
+  for (size_t i = 0; i < acc.size(); i++) { acc[i] = std::min(acc[i], rho[i]); }
+}
+
+inline void elementwise_max(std::vector<double>& acc, const std::vector<double>& rho) {
+  for (size_t i = 0; i < acc.size(); i++) { acc[i] = std::max(acc[i], rho[i]); }
+}
+
+inline std::vector<double> compare_areas(
+    ast::ComparisonOp cmp,
+    std::vector<double> lhs,
+    const std::vector<double>& rhs) {
+  visit_relation(cmp, [&](const auto op) {
+    for (size_t i = 0; i < lhs.size(); i++) {
+      lhs[i] = bool_to_robustness(op(lhs[i], rhs[i]));
+    }
+  });
+  return lhs;
+}
+
+inline double is_nonempty(const topo::Region& region) {
+  // Simplifying the region never makes it Empty, so there is no need to do it here.
+  return bool_to_robustness(!std::holds_alternative<topo::Empty>(region));
+}
+
+// Temporal operators on robustness signals.
+
+inline std::vector<double> previous(std::vector<double> rho) {
+  // Iterate from the back and keep updating
+  for (auto i = std::rbegin(rho); i != std::rend(rho); i++) {
+    if (std::next(i) != std::rend(rho)) {
+      *i = *std::next(i);
+    } else {
+      *i = BOTTOM;
+    }
+  }
+  return rho;
+}
+
+// Sliding window aggregates.
+
+/**
+ * Compute the min (or max, depending on `cmp`) of `rho` over the window `w` at each
+ * frame, where frames with an empty window get `identity`.
+ *
+ * Uses Lemire's streaming algorithm: the deque holds the indices of the candidates for
+ * the extremum of the current and future windows, in order of both index and value, so
+ * that each frame is pushed and popped at most once.
+ */
+template <typename Compare>
+std::vector<double> sliding_extremum(
+    const std::vector<double>& rho,
+    const FrameWindow& w,
+    double identity,
+    Compare cmp) {
+  const size_t n = rho.size();
+  auto ret       = std::vector<double>(n, identity);
+  if (w.empty()) { return ret; }
+
+  auto candidates = std::deque<size_t>{};
+  for (size_t t = w.first; t < n; t++) {
+    const size_t newest = t - w.first;
+    while (!candidates.empty() && !cmp(rho[candidates.back()], rho[newest])) {
+      candidates.pop_back();
+    }
+    candidates.push_back(newest);
+    // Drop the candidates that are older than the start of the window.
+    while (candidates.front() + w.last <= t) { candidates.pop_front(); }
+    ret[t] = rho[candidates.front()];
+  }
+  return ret;
+}
+
+/**
+ * Fold `sub` with the associative `op` over the window `w` at each frame, where frames
+ * with an empty window get `identity`.
+ *
+ * The window is maintained as a queue made of two stacks: new frames are folded into
+ * the back, and when the front runs out, the back is moved to the front storing the
+ * suffix folds. Hence, each frame costs an amortized 3 applications of `op`.
+ */
+template <typename T, typename Op>
+std::vector<T>
+sliding_fold(const std::vector<T>& sub, const FrameWindow& w, const T& identity, Op op) {
+  const size_t n = sub.size();
+  auto ret       = std::vector<T>(n, identity);
+  if (w.empty()) { return ret; }
+
+  const size_t width = w.last - w.first;
+  auto front         = std::vector<T>{}; // Suffix folds, with the oldest at the back.
+  auto back          = std::vector<const T*>{};
+  T back_fold        = identity;
+  for (size_t t = w.first; t < n; t++) {
+    const T& newest = sub[t - w.first];
+    back.push_back(&newest);
+    back_fold = op(back_fold, newest);
+    if (front.size() + back.size() > width) {
+      if (front.empty()) {
+        T fold = identity;
+        for (auto it = back.rbegin(); it != back.rend(); it++) {
+          fold = op(**it, fold);
+          front.push_back(fold);
+        }
+        back.clear();
+        back_fold = identity;
+      }
+      front.pop_back();
+    }
+    ret[t] = (front.empty()) ? back_fold : op(front.back(), back_fold);
+  }
+  return ret;
+}
+
+// Temporal operators on robustness signals.
+
+inline std::vector<double>
+always(std::vector<double> rho, const std::optional<ast::FrameInterval>& interval) {
+  if (interval.has_value()) {
+    return sliding_extremum(rho, frame_window(*interval), TOP, std::less<>{});
+  }
+  // DP-style min, start from the front
+  double running_min = TOP;
+  for (auto&& i : rho) {
+    running_min = std::min(i, running_min);
+    i           = running_min;
+  }
+  return rho;
+}
+
+inline std::vector<double>
+sometimes(std::vector<double> rho, const std::optional<ast::FrameInterval>& interval) {
+  if (interval.has_value()) {
+    return sliding_extremum(rho, frame_window(*interval), BOTTOM, std::greater<>{});
+  }
+  // DP-style max, start from the front
+  double running_max = BOTTOM;
+  for (auto&& i : rho) {
+    running_max = std::max(i, running_max);
+    i           = running_max;
+  }
+  return rho;
+}
+
+inline std::vector<double> since(const std::vector<double>& x, const std::vector<double>& y) {
+  // Ported from signal-temporal-logic:
+  //  Unbounded Until but parse the signal in reverse order.
+  //  Since the actual loop computes Until robustness DP-style in reverse, we have
+  //  to do it from front.
+  auto rob = std::vector<double>{};
+  rob.reserve(x.size());
+
+  double prev      = TOP;
+  double max_right = BOTTOM;
+
+  for (size_t k = 0; k < x.size() && k < y.size(); k++) {
+    const double i = x[k], j = y[k];
+    max_right      = std::max(max_right, j);
+    prev           = std::max({j, std::min(i, prev), -max_right});
+    rob.push_back(prev);
+  }
+
+  return rob;
+}
+
+inline std::vector<double> backto(std::vector<double> x, std::vector<double> y) {
+  // phi1 BackTo phi2 is the dual for Since.
+  // phi1 B phi1 === ~(~phi1 S ~phi2)
+  // TODO: VERIFY!!!
+  return negate(since(negate(std::move(x)), negate(std::move(y))));
+}
+
+// Temporal operators on spatial signals.
+
+inline std::vector<topo::Region> sp_previous(std::vector<topo::Region> sub) {
+  // Iterate from the back and keep updating
+  for (auto i = std::rbegin(sub); i != std::rend(sub); i++) {
+    if (std::next(i) != std::rend(sub)) {
+      *i = *std::next(i);
+    } else {
+      *i = topo::Empty{};
+    }
+  }
+  return sub;
+}
+
+inline std::vector<topo::Region> sp_always(
+    const std::vector<topo::Region>& sub,
+    const std::optional<ast::FrameInterval>& interval) {
+  return sliding_fold(
+      sub,
+      frame_window(interval, sub.size()),
+      topo::Region{topo::Universe{}},
+      [](const topo::Region& a, const topo::Region& b) {
+        return topo::spatial_intersect(a, b);
+      });
+}
+
+inline std::vector<topo::Region> sp_sometimes(
+    const std::vector<topo::Region>& sub,
+    const std::optional<ast::FrameInterval>& interval) {
+  return sliding_fold(
+      sub,
+      frame_window(interval, sub.size()),
+      topo::Region{topo::Empty{}},
+      [](const topo::Region& a, const topo::Region& b) {
+        return topo::spatial_union(a, b);
+      });
+}
+
+inline std::vector<topo::Region>
+sp_since(const std::vector<topo::Region>& lhs, const std::vector<topo::Region>& rhs) {
+  // TODO: Deal with bounded.
+  auto vec = std::vector<topo::Region>{};
+  vec.reserve(lhs.size());
+
+  topo::Region prev = topo::Universe{};
+  for (size_t k = 0; k < lhs.size() && k < rhs.size(); k++) {
+    auto tmp = topo::spatial_intersect(lhs[k], prev);
+    prev     = topo::spatial_union(tmp, rhs[k]);
+    vec.push_back(prev);
+  }
+  return vec;
+}
+
+inline std::vector<topo::Region>
+sp_backto(const std::vector<topo::Region>& lhs, const std::vector<topo::Region>& rhs) {
+  // TODO: Deal with bounded.
+  auto vec = std::vector<topo::Region>{};
+  vec.reserve(lhs.size());
+
+  topo::Region prev = topo::Empty{};
+  for (size_t k = 0; k < lhs.size() && k < rhs.size(); k++) {
+    auto tmp = topo::spatial_union(lhs[k], prev);
+    prev     = topo::spatial_intersect(tmp, rhs[k]);
+    vec.push_back(prev);
+  }
+  return vec;
+}
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_SEMANTICS_HPP__ */
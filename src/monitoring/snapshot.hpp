@@ -0,0 +1,153 @@
+/**
+ * Encoding of the binary snapshots of the state of a monitor (see
+ * `OnlineMonitor::checkpoint`).
+ *
+ * A snapshot is a flat sequence of fixed-width values, strings and arrays, written in
+ * the byte order of the machine. The parts of the monitor write and read their own
+ * state in order, and the reader checks the bounds of every read, so that a truncated
+ * or corrupted snapshot is reported instead of being read past its end.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_SNAPSHOT_HPP__
+#define __PERCEMON_MONITORING_SNAPSHOT_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(std::vector<char>& out_) : out{&out_} {}
+
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    this->write_bytes(&value, sizeof(T));
+  }
+
+  void write(const std::string& value) {
+    this->write<std::uint64_t>(value.size());
+    this->write_bytes(value.data(), value.size());
+  }
+
+  /**
+   * Write the length of the array, followed by its elements.
+   */
+  template <typename T>
+  void write_array(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    this->write<std::uint64_t>(values.size());
+    this->write_bytes(values.data(), values.size() * sizeof(T));
+  }
+
+  /**
+   * Start a section, whose length in bytes is written before it by `end_section`, so
+   * that it can be read (or skipped) on its own.
+   */
+  size_t begin_section() {
+    this->write<std::uint64_t>(0);
+    return this->out->size();
+  }
+  void end_section(size_t start) {
+    const auto size = static_cast<std::uint64_t>(this->out->size() - start);
+    std::memcpy(this->out->data() + start - sizeof(size), &size, sizeof(size));
+  }
+
+ private:
+  std::vector<char>* out;
+
+  void write_bytes(const void* ptr, size_t size) {
+    // Inserting the range of bytes makes GCC warn about the copy overflowing the
+    // vector (-Wstringop-overflow), after it inlines the reallocation.
+    if (size == 0) { return; }
+    const size_t end = this->out->size();
+    this->out->resize(end + size);
+    std::memcpy(this->out->data() + end, ptr, size);
+  }
+};
+
+class SnapshotReader {
+ public:
+  SnapshotReader(const char* data_, size_t size_) : data{data_}, size{size_} {}
+  explicit SnapshotReader(const std::vector<char>& snapshot) :
+      SnapshotReader{snapshot.data(), snapshot.size()} {}
+
+  template <typename T>
+  T read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto value = T{};
+    std::memcpy(&value, this->take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string read_string() {
+    const auto n = this->read_size(1);
+    return std::string{this->take(n), n};
+  }
+
+  template <typename T>
+  void read_array(std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto n = this->read_size(sizeof(T));
+    values.resize(n);
+    if (n > 0) { std::memcpy(values.data(), this->take(n * sizeof(T)), n * sizeof(T)); }
+  }
+
+  /**
+   * Read a section written between `begin_section` and `end_section`.
+   */
+  SnapshotReader read_section() {
+    const auto n = this->read_size(1);
+    return SnapshotReader{this->take(n), n};
+  }
+
+  [[nodiscard]] bool done() const { return offset == size; }
+
+  /**
+   * @throws std::invalid_argument if there are bytes left after the values read.
+   */
+  void finish() const {
+    if (!this->done()) {
+      throw std::invalid_argument(
+          "Snapshot has trailing bytes after the monitor state.");
+    }
+  }
+
+ private:
+  const char* data;
+  size_t size;
+  size_t offset = 0;
+
+  const char* take(size_t n) {
+    if (n > this->size - this->offset) {
+      throw std::invalid_argument("Snapshot is truncated.");
+    }
+    const char* ptr = this->data + this->offset;
+    this->offset += n;
+    return ptr;
+  }
+
+  /**
+   * Read the length of an array of elements of `width` bytes, which must fit in the
+   * rest of the snapshot.
+   */
+  size_t read_size(size_t width) {
+    const auto n = this->read<std::uint64_t>();
+    if (n > (this->size - this->offset) / width) {
+      throw std::invalid_argument("Snapshot is truncated.");
+    }
+    return static_cast<size_t>(n);
+  }
+};
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_SNAPSHOT_HPP__ */
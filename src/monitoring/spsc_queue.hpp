@@ -0,0 +1,89 @@
+/**
+ * A bounded, lock-free queue with a single producer and a single consumer, used to pass
+ * frames to the worker of an AsyncOnlineMonitor.
+ *
+ * The queue is a ring of preallocated slots, where the producer only writes the tail
+ * and the consumer only writes the head, so pushing and popping are a load and a store
+ * of each index. Blocking when the queue is full (or empty) is left to the caller.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_SPSC_QUEUE_HPP__
+#define __PERCEMON_MONITORING_SPSC_QUEUE_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+template <typename T>
+class SpscQueue {
+ public:
+  /**
+   * Create a queue that holds up to `capacity` elements.
+   */
+  explicit SpscQueue(size_t capacity_) : slots(capacity_ + 1) {
+    if (capacity_ == 0) {
+      throw std::invalid_argument("Queue must have a capacity of at least 1");
+    }
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  [[nodiscard]] size_t capacity() const { return slots.size() - 1; }
+
+  /**
+   * Move `value` to the back of the queue, or return `false` (leaving `value` as is) if
+   * the queue is full. Only the producer may call this.
+   */
+  bool try_push(T& value) {
+    const size_t t    = tail.load(std::memory_order_relaxed);
+    const size_t next = (t + 1) % slots.size();
+    if (next == head.load(std::memory_order_acquire)) { return false; }
+    slots[t] = std::move(value);
+    // Sequentially consistent, so that the producer and consumer don't both miss each
+    // other when one of them goes to sleep (see AsyncOnlineMonitor).
+    tail.store(next, std::memory_order_seq_cst);
+    return true;
+  }
+
+  /**
+   * Move the front of the queue into `out`, or return `false` if the queue is empty.
+   * Only the consumer may call this.
+   */
+  bool try_pop(T& out) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) { return false; }
+    out = std::move(slots[h]);
+    head.store((h + 1) % slots.size(), std::memory_order_seq_cst);
+    return true;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return head.load(std::memory_order_seq_cst) == tail.load(std::memory_order_seq_cst);
+  }
+
+  [[nodiscard]] bool full() const {
+    const size_t t = tail.load(std::memory_order_seq_cst);
+    return (t + 1) % slots.size() == head.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  /**
+   * One more slot than the capacity, so that a full queue has `tail + 1 == head`.
+   */
+  std::vector<T> slots;
+
+  // The indices are on separate cache lines, as each is written by a different thread.
+  alignas(64) std::atomic<size_t> head = 0;
+  alignas(64) std::atomic<size_t> tail = 0;
+};
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_SPSC_QUEUE_HPP__ */
@@ -0,0 +1,118 @@
+#include "monitoring/thread_pool.hpp"
+
+#include <algorithm>
+
+using namespace percemon::monitoring::details;
+
+ThreadPool::ThreadPool(size_t num_workers_) : num_workers{num_workers_} {
+  if (this->num_workers == 0) {
+    this->num_workers = std::max(1U, std::thread::hardware_concurrency());
+  }
+  this->queues = std::make_unique<Queue[]>(this->num_workers);
+
+  // The calling thread is worker 0.
+  this->threads.reserve(this->num_workers - 1);
+  for (size_t worker = 1; worker < this->num_workers; worker++) {
+    this->threads.emplace_back([this, worker]() { this->worker_loop(worker); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    auto lock      = std::lock_guard{this->mtx};
+    this->stopping = true;
+  }
+  this->start_cv.notify_all();
+  for (auto& thread : this->threads) { thread.join(); }
+}
+
+void ThreadPool::run(size_t num_tasks, const std::function<void(size_t, size_t)>& fn) {
+  if (num_tasks == 0) { return; }
+  if (this->num_workers == 1) {
+    for (size_t task = 0; task < num_tasks; task++) { fn(0, task); }
+    return;
+  }
+
+  for (size_t worker = 0; worker < this->num_workers; worker++) {
+    const size_t first = worker * num_tasks / this->num_workers;
+    const size_t last  = (worker + 1) * num_tasks / this->num_workers;
+    auto& queue        = this->queues[worker];
+    auto lock          = std::lock_guard{queue.mtx};
+    for (size_t task = first; task < last; task++) { queue.tasks.push_back(task); }
+  }
+
+  {
+    auto lock      = std::lock_guard{this->mtx};
+    this->job      = &fn;
+    this->num_busy = this->threads.size();
+    this->error    = nullptr;
+    this->generation++;
+  }
+  this->start_cv.notify_all();
+
+  this->work(0);
+
+  {
+    auto lock = std::unique_lock{this->mtx};
+    this->done_cv.wait(lock, [&]() { return this->num_busy == 0; });
+    this->job = nullptr;
+  }
+
+  if (this->error) { std::rethrow_exception(this->error); }
+}
+
+void ThreadPool::worker_loop(size_t worker) {
+  size_t seen = 0;
+  while (true) {
+    {
+      auto lock = std::unique_lock{this->mtx};
+      this->start_cv.wait(
+          lock, [&]() { return this->stopping || this->generation != seen; });
+      if (this->stopping) { return; }
+      seen = this->generation;
+    }
+
+    this->work(worker);
+
+    {
+      auto lock = std::lock_guard{this->mtx};
+      if (--(this->num_busy) == 0) { this->done_cv.notify_one(); }
+    }
+  }
+}
+
+void ThreadPool::work(size_t worker) {
+  size_t task = 0;
+  while (this->pop(worker, task)) {
+    try {
+      (*(this->job))(worker, task);
+    } catch (...) {
+      auto lock = std::lock_guard{this->error_mtx};
+      if (!this->error) { this->error = std::current_exception(); }
+    }
+  }
+}
+
+bool ThreadPool::pop(size_t worker, size_t& task) {
+  {
+    // Take from the back of our own queue...
+    auto& queue = this->queues[worker];
+    auto lock   = std::lock_guard{queue.mtx};
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  // ... or steal from the front of someone else's.
+  for (size_t i = 1; i < this->num_workers; i++) {
+    auto& queue = this->queues[(worker + i) % this->num_workers];
+    auto lock   = std::lock_guard{queue.mtx};
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,148 @@
+/**
+ * A small work-stealing thread pool used to evaluate the permutations of objects in
+ * quantifiers in parallel.
+ */
+
+#pragma once
+
+#ifndef __PERCEMON_MONITORING_THREAD_POOL_HPP__
+#define __PERCEMON_MONITORING_THREAD_POOL_HPP__
+
+#include "monitoring/semantics.hpp"
+
+#include "percemon/iter/product.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace percemon::monitoring::details {
+
+class ThreadPool {
+ public:
+  /**
+   * Create a pool with `num_workers` workers, including the thread that calls `run`.
+   * If `num_workers` is 0, the number of hardware threads is used.
+   */
+  explicit ThreadPool(size_t num_workers);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * Number of workers in the pool, including the calling thread.
+   */
+  [[nodiscard]] size_t size() const { return num_workers; }
+
+  /**
+   * Call `fn(worker, task)` for each `task` in `[0, num_tasks)`, and block until all of
+   * them are done.
+   *
+   * The tasks are initially split into contiguous blocks, one per worker, and workers
+   * that run out of tasks steal from the front of the queues of the other workers. The
+   * first exception thrown by a task is rethrown here, after all workers are done.
+   *
+   * @note `run` must not be called from within a task.
+   */
+  void run(size_t num_tasks, const std::function<void(size_t, size_t)>& fn);
+
+ private:
+  struct Queue {
+    std::mutex mtx;
+    std::deque<size_t> tasks;
+  };
+
+  size_t num_workers;
+  std::unique_ptr<Queue[]> queues;
+  std::vector<std::thread> threads;
+
+  std::mutex mtx;
+  std::condition_variable start_cv, done_cv;
+  const std::function<void(size_t, size_t)>* job = nullptr;
+  size_t generation                              = 0;
+  size_t num_busy                                = 0;
+  bool stopping                                  = false;
+
+  std::mutex error_mtx;
+  std::exception_ptr error = nullptr;
+
+  void worker_loop(size_t worker);
+  void work(size_t worker);
+  bool pop(size_t worker, size_t& task);
+};
+
+/**
+ * Compute the element-wise max (if `is_exists`) or min of `fn(worker, choice, demand)`
+ * over all `choice` in `tuples`, splitting the enumeration across the workers in the
+ * pool.
+ *
+ * Each worker maintains its own running max/min, and these are reduced once all the
+ * workers are done. `fn` must return a signal of the same type and length as `init`,
+ * which is either a robustness signal or a packed `BitSignal`.
+ *
+ * If `demand` is given, each worker removes the frames at which its running max (min)
+ * is `+inf` (`-inf`) from its copy of the demand passed to `fn`, and skips the
+ * remaining choices once nothing is demanded. Otherwise, all frames are demanded.
+ */
+template <typename Signal, typename Fn>
+Signal reduce_product(
+    ThreadPool& pool,
+    const iter_helpers::index_tuples& tuples,
+    bool is_exists,
+    Signal init,
+    const Demand* demand,
+    Fn&& fn) {
+  const size_t total = tuples.size();
+  if (total == 0) { return init; }
+
+  const double decided = is_exists ? TOP : BOTTOM;
+  auto partial = std::vector<Signal>(pool.size(), init);
+  auto choices  = std::vector<std::vector<size_t>>(
+      pool.size(), std::vector<size_t>(tuples.arity()));
+  auto demands = std::vector<Demand>(
+      pool.size(), (demand != nullptr) ? *demand : Demand(init.size(), true));
+
+  // Oversplit the tuples so that workers can steal the expensive parts.
+  const size_t num_tasks = std::min(total, 16 * pool.size());
+  pool.run(num_tasks, [&](const size_t worker, const size_t task) {
+    auto& acc        = partial[worker];
+    auto& choice     = choices[worker];
+    auto& sub_demand = demands[worker];
+
+    const size_t first = task * total / num_tasks;
+    const size_t last  = (task + 1) * total / num_tasks;
+    if (first < last) { tuples.nth(first, choice); }
+    for (size_t i = first; i < last; i++, tuples.next(choice)) {
+      if (demand != nullptr && !any_demanded(sub_demand)) { return; }
+      const Signal rob = fn(worker, choice, std::as_const(sub_demand));
+      if (is_exists) {
+        elementwise_max(acc, rob);
+      } else {
+        elementwise_min(acc, rob);
+      }
+      if (demand != nullptr) { prune_decided(sub_demand, acc, decided); }
+    }
+  });
+
+  for (const auto& acc : partial) {
+    if (is_exists) {
+      elementwise_max(init, acc);
+    } else {
+      elementwise_min(init, acc);
+    }
+  }
+  return init;
+}
+
+} // namespace percemon::monitoring::details
+
+#endif /* end of include guard: __PERCEMON_MONITORING_THREAD_POOL_HPP__ */
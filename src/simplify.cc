@@ -0,0 +1,339 @@
+#include "percemon/ast.hpp"
+#include "percemon/utils.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace percemon;
+using namespace percemon::ast;
+
+namespace {
+
+using percemon::utils::overloaded;
+
+ComparisonOp negate(const ComparisonOp op) {
+  switch (op) {
+    case ComparisonOp::GT: return ComparisonOp::LE;
+    case ComparisonOp::GE: return ComparisonOp::LT;
+    case ComparisonOp::LT: return ComparisonOp::GE;
+    case ComparisonOp::LE: return ComparisonOp::GT;
+    case ComparisonOp::EQ: return ComparisonOp::NE;
+    case ComparisonOp::NE: return ComparisonOp::EQ;
+  }
+  return op;
+}
+
+/**
+ * Collects the names of the ID variables referenced in a formula.
+ */
+struct IdNames {
+  std::set<std::string> names;
+
+  void add(const Var_id& id) { names.insert(id.name); }
+  template <typename Attr>
+  void add_rhs(const Attr& rhs) {
+    std::visit(
+        overloaded{
+            [](const double) {},
+            [](const int) {},
+            [&](const auto& attr) { add(attr.id); }},
+        rhs);
+  }
+
+  void operator()(const Const&) {}
+  void operator()(const TimeBound&) {}
+  void operator()(const FrameBound&) {}
+  void operator()(const CompareId& e) {
+    add(e.lhs);
+    add(e.rhs);
+  }
+  void operator()(const CompareED& e) {
+    add(e.lhs.id1);
+    add(e.lhs.id2);
+  }
+  template <typename Comparison>
+  auto operator()(const Comparison& e) -> decltype(e.lhs.id, void()) {
+    add(e.lhs.id);
+    add_rhs(e.rhs);
+  }
+
+  template <typename Quantifier>
+  void quantifier(const Quantifier& e) {
+    for (const auto& id : e.ids) { add(id); }
+    if (e.pinned_at.has_value()) { std::visit(*this, e.pinned_at->phi); }
+    if (e.phi.has_value()) { std::visit(*this, *e.phi); }
+  }
+  void operator()(const ExistsPtr& e) { quantifier(*e); }
+  void operator()(const ForallPtr& e) { quantifier(*e); }
+  void operator()(const PinPtr& e) { std::visit(*this, e->phi); }
+
+  void operator()(const NotPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const AndPtr& e) {
+    for (const auto& arg : e->args) { std::visit(*this, arg); }
+  }
+  void operator()(const OrPtr& e) {
+    for (const auto& arg : e->args) { std::visit(*this, arg); }
+  }
+  void operator()(const PreviousPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const AlwaysPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SometimesPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SincePtr& e) {
+    std::visit(*this, e->args.first);
+    std::visit(*this, e->args.second);
+  }
+  void operator()(const BackToPtr& e) {
+    std::visit(*this, e->args.first);
+    std::visit(*this, e->args.second);
+  }
+
+  void operator()(const CompareSpAreaPtr& e) {
+    std::visit(*this, e->lhs.arg);
+    if (const auto rhs = std::get_if<SpArea>(&e->rhs)) { std::visit(*this, rhs->arg); }
+  }
+  void operator()(const SpExistsPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SpForallPtr& e) { std::visit(*this, e->arg); }
+
+  void operator()(const EmptySet&) {}
+  void operator()(const UniverseSet&) {}
+  void operator()(const BBox& e) { add(e.id); }
+  void operator()(const ComplementPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const IntersectPtr& e) {
+    for (const auto& arg : e->args) { std::visit(*this, arg); }
+  }
+  void operator()(const UnionPtr& e) {
+    for (const auto& arg : e->args) { std::visit(*this, arg); }
+  }
+  void operator()(const InteriorPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const ClosurePtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SpPreviousPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SpAlwaysPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SpSometimesPtr& e) { std::visit(*this, e->arg); }
+  void operator()(const SpSincePtr& e) {
+    std::visit(*this, e->args.first);
+    std::visit(*this, e->args.second);
+  }
+  void operator()(const SpBackToPtr& e) {
+    std::visit(*this, e->args.first);
+    std::visit(*this, e->args.second);
+  }
+};
+
+bool mentions_any(const Expr& e, const std::vector<Var_id>& ids) {
+  auto names = IdNames{};
+  std::visit(names, e);
+  return std::any_of(ids.begin(), ids.end(), [&](const Var_id& id) {
+    return names.names.count(id.name) > 0;
+  });
+}
+
+/**
+ * Operands of an And or Or, including its TimeBound and FrameBound operands.
+ */
+template <typename Op>
+std::vector<Expr> operands_of(const Op& e) {
+  auto ret = std::vector<Expr>{};
+  for (const auto& arg : e.temporal_bound_args) {
+    ret.push_back(std::visit([](const auto& c) { return Expr{c}; }, arg));
+  }
+  ret.insert(ret.end(), e.args.begin(), e.args.end());
+  return ret;
+}
+
+Expr make_nary(bool is_and, const std::vector<Expr>& args) {
+  if (args.empty()) { return Const{is_and}; }
+  if (args.size() == 1) { return args.front(); }
+  if (is_and) { return std::make_shared<ast::And>(args); }
+  return std::make_shared<ast::Or>(args);
+}
+
+template <typename Quantifier>
+Expr make_quantifier(const std::vector<Var_id>& ids, const Expr& phi) {
+  auto ret = std::make_shared<Quantifier>(ids);
+  ret->phi = phi;
+  return ret;
+}
+
+/**
+ * Rewrites a formula, or its negation, into negation normal form (as far as the
+ * semantics allow), flattening And and Or and folding constants on the way.
+ */
+struct Rewriter {
+  bool negated = false;
+
+  static Expr rewrite(const Expr& e, bool negated_) {
+    return std::visit(Rewriter{negated_}, e);
+  }
+
+  [[nodiscard]] Expr wrap(const Expr& e) const {
+    return (negated) ? Expr{std::make_shared<ast::Not>(e)} : e;
+  }
+
+  Expr operator()(const Const& e) const { return Const{e.value != negated}; }
+
+  // The bounds and ID comparisons are always defined, so their negation flips the
+  // relation. The other comparisons are BOTTOM at frames without the objects, so they
+  // are negated as they are.
+
+  Expr operator()(TimeBound e) const {
+    if (negated) { e.op = negate(e.op); }
+    return e;
+  }
+  Expr operator()(FrameBound e) const {
+    if (negated) { e.op = negate(e.op); }
+    return e;
+  }
+  Expr operator()(CompareId e) const {
+    if (negated) { e.op = negate(e.op); }
+    return e;
+  }
+  Expr operator()(const CompareProb& e) const { return wrap(e); }
+  Expr operator()(const CompareClass& e) const { return wrap(e); }
+  Expr operator()(const CompareED& e) const { return wrap(e); }
+  Expr operator()(const CompareLat& e) const { return wrap(e); }
+  Expr operator()(const CompareLon& e) const { return wrap(e); }
+  Expr operator()(const CompareArea& e) const { return wrap(e); }
+
+  Expr operator()(const ExistsPtr& e) const {
+    return (negated) ? quantifier<ast::Forall>(*e) : quantifier<ast::Exists>(*e);
+  }
+  Expr operator()(const ForallPtr& e) const {
+    return (negated) ? quantifier<ast::Exists>(*e) : quantifier<ast::Forall>(*e);
+  }
+  Expr operator()(const PinPtr& e) const {
+    auto ret = std::make_shared<Pin>(e->x, e->f);
+    ret->phi = rewrite(e->phi, negated);
+    return ret;
+  }
+
+  Expr operator()(const NotPtr& e) const { return rewrite(e->arg, !negated); }
+  Expr operator()(const AndPtr& e) const { return nary(!negated, operands_of(*e)); }
+  Expr operator()(const OrPtr& e) const { return nary(negated, operands_of(*e)); }
+
+  Expr operator()(const PreviousPtr& e) const {
+    // Previous is BOTTOM at the first frame, so it doesn't commute with negation.
+    return wrap(std::make_shared<ast::Previous>(rewrite(e->arg, false)));
+  }
+  Expr operator()(const AlwaysPtr& e) const {
+    return (negated) ? temporal<ast::Sometimes>(e->interval, e->arg)
+                     : temporal<ast::Always>(e->interval, e->arg);
+  }
+  Expr operator()(const SometimesPtr& e) const {
+    return (negated) ? temporal<ast::Always>(e->interval, e->arg)
+                     : temporal<ast::Sometimes>(e->interval, e->arg);
+  }
+  // BackTo is computed as the dual of Since.
+  Expr operator()(const SincePtr& e) const {
+    const auto lhs = rewrite(e->args.first, negated);
+    const auto rhs = rewrite(e->args.second, negated);
+    if (negated) { return std::make_shared<ast::BackTo>(lhs, rhs); }
+    return std::make_shared<ast::Since>(lhs, rhs);
+  }
+  Expr operator()(const BackToPtr& e) const {
+    const auto lhs = rewrite(e->args.first, negated);
+    const auto rhs = rewrite(e->args.second, negated);
+    if (negated) { return std::make_shared<ast::Since>(lhs, rhs); }
+    return std::make_shared<ast::BackTo>(lhs, rhs);
+  }
+
+  Expr operator()(const CompareSpAreaPtr& e) const {
+    if (!negated) { return e; }
+    return std::make_shared<CompareSpArea>(e->lhs, negate(e->op), e->rhs);
+  }
+  Expr operator()(const SpExistsPtr& e) const { return wrap(e); }
+  Expr operator()(const SpForallPtr& e) const { return wrap(e); }
+
+ private:
+  template <typename Op>
+  Expr temporal(const std::optional<FrameInterval>& interval, const Expr& arg) const {
+    const auto sub = rewrite(arg, negated);
+    if (interval.has_value()) { return std::make_shared<Op>(*interval, sub); }
+    return std::make_shared<Op>(sub);
+  }
+
+  /**
+   * Flatten nested operands of the same kind, and fold the constants.
+   */
+  Expr nary(bool is_and, const std::vector<Expr>& operands) const {
+    auto args = std::vector<Expr>{};
+    for (const auto& operand : operands) {
+      const auto arg = rewrite(operand, negated);
+      if (const auto c = std::get_if<Const>(&arg)) {
+        // `false` decides an And, and `true` decides an Or.
+        if (c->value != is_and) { return arg; }
+      } else if (const auto e = std::get_if<AndPtr>(&arg); e && is_and) {
+        const auto sub = operands_of(**e);
+        args.insert(args.end(), sub.begin(), sub.end());
+      } else if (const auto e = std::get_if<OrPtr>(&arg); e && !is_and) {
+        const auto sub = operands_of(**e);
+        args.insert(args.end(), sub.begin(), sub.end());
+      } else {
+        args.push_back(arg);
+      }
+    }
+    return make_nary(is_and, args);
+  }
+
+  /**
+   * Rewrite a quantifier (into `Q`, which is its dual if negated).
+   *
+   * Pins always refer to the current frame, so they commute with the quantifiers and
+   * are moved above them. Then, the operands of an Exists over an And (or a Forall
+   * over an Or) that don't depend on the quantified IDs are moved out of the
+   * quantifier, so they aren't evaluated for each permutation of the objects. The
+   * other way around doesn't hold if there are no objects in the frame.
+   */
+  template <typename Q, typename Quantifier>
+  Expr quantifier(const Quantifier& e) const {
+    auto pins = std::vector<PinPtr>{};
+    auto phi  = Expr{Const{false}};
+    if (e.pinned_at.has_value()) {
+      pins.push_back(std::make_shared<Pin>(e.pinned_at->x, e.pinned_at->f));
+      phi = rewrite(e.pinned_at->phi, negated);
+    } else if (e.phi.has_value()) {
+      phi = rewrite(*e.phi, negated);
+    } else {
+      // Leave the error to the monitor.
+      return wrap(std::make_shared<Quantifier>(e));
+    }
+    while (const auto pin = std::get_if<PinPtr>(&phi)) {
+      pins.push_back(std::make_shared<Pin>((*pin)->x, (*pin)->f));
+      phi = Expr{(*pin)->phi};
+    }
+
+    constexpr bool is_exists = std::is_same_v<Q, ast::Exists>;
+    auto ret                 = make_quantifier<Q>(e.ids, phi);
+    auto operands            = std::vector<Expr>{};
+    if (const auto a = std::get_if<AndPtr>(&phi); a && is_exists) {
+      operands = operands_of(**a);
+    } else if (const auto o = std::get_if<OrPtr>(&phi); o && !is_exists) {
+      operands = operands_of(**o);
+    }
+    const auto dependent = std::stable_partition(
+        operands.begin(), operands.end(), [&](const Expr& arg) {
+          return !mentions_any(arg, e.ids);
+        });
+    if (dependent != operands.begin() && dependent != operands.end()) {
+      auto args = std::vector<Expr>{operands.begin(), dependent};
+      const auto body = std::vector<Expr>(dependent, operands.end());
+      args.push_back(make_quantifier<Q>(e.ids, make_nary(is_exists, body)));
+      ret = make_nary(is_exists, args);
+    }
+
+    for (auto it = pins.rbegin(); it != pins.rend(); it++) {
+      (*it)->phi = ret;
+      ret        = *it;
+    }
+    return ret;
+  }
+};
+
+} // namespace
+
+Expr percemon::ast::simplify(const Expr& phi) { return Rewriter::rewrite(phi, false); }
@@ -3,10 +3,12 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
 #include <vector>
 
-#include <itertools.hpp>
-
 #include "percemon/utils.hpp"
 
 using percemon::utils::overloaded;
@@ -17,6 +19,90 @@ using namespace percemon::topo;
 constexpr double TOP    = std::numeric_limits<double>::infinity();
 constexpr double BOTTOM = -TOP;
 
+/**
+ * Memory resource that hands out memory from a list of blocks by bumping a pointer, and
+ * only reclaims it when the arena is reset.
+ *
+ * On reset, the blocks are coalesced into one large enough for everything allocated
+ * since the previous reset, so once the arena has seen the largest evaluation, it
+ * doesn't allocate from the heap any more.
+ */
+class Arena final : public std::pmr::memory_resource {
+ public:
+  /**
+   * Number of allocations made from the arena, if profiling.
+   */
+  size_t num_allocations = 0;
+
+  void reset() {
+    if (this->blocks.size() > 1) {
+      size_t total = 0;
+      for (const auto& block : this->blocks) { total += block.size; }
+      this->blocks.clear();
+      this->add_block(total);
+    }
+    this->offset = 0;
+  }
+
+ private:
+  static constexpr size_t MIN_BLOCK_SIZE = 16 * 1024;
+
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+  std::vector<Block> blocks;
+  /**
+   * Offset of the free space in the last block.
+   */
+  size_t offset = 0;
+
+  void add_block(size_t size) {
+    this->blocks.push_back(Block{std::unique_ptr<std::byte[]>{new std::byte[size]}, size});
+    this->offset = 0;
+  }
+
+  void* do_allocate(size_t bytes, size_t alignment) override {
+#if defined(PERCEMON_PROFILING)
+    this->num_allocations++;
+#endif
+    if (!this->blocks.empty()) {
+      const auto& block = this->blocks.back();
+      void* ptr         = block.data.get() + this->offset;
+      size_t space      = block.size - this->offset;
+      if (std::align(alignment, bytes, ptr, space) != nullptr) {
+        this->offset = block.size - space + bytes;
+        return ptr;
+      }
+    }
+    const size_t last_size = this->blocks.empty() ? 0 : this->blocks.back().size;
+    this->add_block(std::max({MIN_BLOCK_SIZE, 2 * last_size, bytes + alignment}));
+    const auto& block = this->blocks.back();
+    void* ptr         = block.data.get();
+    size_t space      = block.size;
+    std::align(alignment, bytes, ptr, space);
+    this->offset = block.size - space + bytes;
+    return ptr;
+  }
+
+  void do_deallocate(void*, size_t, size_t) override {}
+
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+struct ThreadArena {
+  Arena arena;
+  std::pmr::memory_resource* resource = std::pmr::new_delete_resource();
+  /**
+   * Number of active ArenaScopes on the thread.
+   */
+  size_t depth = 0;
+};
+
+thread_local ThreadArena thread_arena;
+
 Region intersection_of(const BoundingBox& a, const BoundingBox& b) {
   // First check if they intersect horizontally
 
@@ -84,13 +170,60 @@ Region intersection_of(const BoundingBox& a, const BoundingBox& b) {
   return BoundingBox{xmin, xmax, ymin, ymax, lopen, ropen, topen, bopen};
 }
 
+/**
+ * Unions with more boxes than this are intersected with the batch kernels.
+ */
+constexpr size_t BATCH_MIN_BOXES = 8;
+
+/**
+ * Add the nonempty intersections of `p` with each of the `boxes` to `ret`, using the
+ * batch kernel for the bounds. The open boundaries are picked from the boxes in the same
+ * way as `intersection_of(p, box)` does.
+ */
+void batch_intersection_of(
+    const BoundingBox& p,
+    const TopoUnion& boxes,
+    const BoxArrays& arrays,
+    BoxArrays& scratch,
+    std::pmr::vector<std::uint8_t>& mask,
+    std::pmr::vector<BoundingBox>& ret) {
+  mask.resize(arrays.size());
+  batch_intersect(p, arrays, scratch, mask.data());
+  size_t i = 0;
+  for (const BoundingBox& q : boxes) {
+    if (mask[i] != 0) {
+      const bool x_first = p.xmin <= q.xmin;
+      const bool y_first = p.ymin <= q.ymin;
+      ret.emplace_back(BoundingBox{
+          scratch.xmin[i],
+          scratch.xmax[i],
+          scratch.ymin[i],
+          scratch.ymax[i],
+          x_first ? q.lopen : p.lopen,
+          x_first ? (q.xmax <= p.xmax ? q.ropen : p.ropen)
+                  : (p.xmax <= q.xmax ? p.ropen : q.ropen),
+          y_first ? q.topen : p.topen,
+          y_first ? (q.ymax <= p.ymax ? q.bopen : p.bopen)
+                  : (p.ymax <= q.ymax ? p.bopen : q.bopen)});
+    }
+    i++;
+  }
+}
+
 Region intersection_of(const TopoUnion& a, const BoundingBox& b) {
-  auto intersect_set = std::vector<BoundingBox>{};
-  for (const BoundingBox& bbox : a) {
-    auto int_box = intersection_of(b, bbox);
-    if (auto box_p = std::get_if<BoundingBox>(&int_box)) {
-      intersect_set.push_back(*box_p);
-    } // Else do nothing as the current bboxes do not intersect.
+  auto intersect_set = std::pmr::vector<BoundingBox>{region_resource()};
+  if (a.size() > BATCH_MIN_BOXES) {
+    const auto arrays = BoxArrays{a};
+    auto scratch      = BoxArrays{};
+    auto mask         = std::pmr::vector<std::uint8_t>{region_resource()};
+    batch_intersection_of(b, a, arrays, scratch, mask, intersect_set);
+  } else {
+    for (const BoundingBox& bbox : a) {
+      auto int_box = intersection_of(b, bbox);
+      if (auto box_p = std::get_if<BoundingBox>(&int_box)) {
+        intersect_set.push_back(*box_p);
+      } // Else do nothing as the current bboxes do not intersect.
+    }
   }
   if (intersect_set.size() == 0) { return Empty{}; }
   if (intersect_set.size() == 1) { return intersect_set.back(); }
@@ -99,13 +232,22 @@ Region intersection_of(const TopoUnion& a, const BoundingBox& b) {
 }
 
 Region intersection_of(const TopoUnion& lhs, const TopoUnion& rhs) {
-  auto intersect_set = std::vector<BoundingBox>{};
-  for (const BoundingBox& a : lhs) {
-    for (const BoundingBox& b : rhs) {
-      auto int_box = intersection_of(a, b);
-      if (auto box_p = std::get_if<BoundingBox>(&int_box)) {
-        intersect_set.push_back(*box_p);
-      } // Else do nothing as the current bboxes do not intersect.
+  auto intersect_set = std::pmr::vector<BoundingBox>{region_resource()};
+  if (rhs.size() > BATCH_MIN_BOXES) {
+    const auto arrays = BoxArrays{rhs};
+    auto scratch      = BoxArrays{};
+    auto mask         = std::pmr::vector<std::uint8_t>{region_resource()};
+    for (const BoundingBox& a : lhs) {
+      batch_intersection_of(a, rhs, arrays, scratch, mask, intersect_set);
+    }
+  } else {
+    for (const BoundingBox& a : lhs) {
+      for (const BoundingBox& b : rhs) {
+        auto int_box = intersection_of(a, b);
+        if (auto box_p = std::get_if<BoundingBox>(&int_box)) {
+          intersect_set.push_back(*box_p);
+        } // Else do nothing as the current bboxes do not intersect.
+      }
     }
   }
   if (intersect_set.size() == 0) { return Empty{}; }
@@ -193,7 +335,8 @@ Region complement_of(BoundingBox bbox, const BoundingBox& universe) {
     bbox = std::get<BoundingBox>(reg);
   }
   // Holds Top, Bottom, Left, and Right fragments of complement
-  std::vector<BoundingBox> fragments;
+  auto fragments = std::pmr::vector<BoundingBox>{region_resource()};
+  fragments.reserve(4);
 
   // Get left fragment
   if (bbox.xmin > universe.xmin || (bbox.xmin == universe.xmin && bbox.lopen)) {
@@ -244,7 +387,10 @@ Region complement_of(BoundingBox bbox, const BoundingBox& universe) {
 }
 
 Region complement_of(const TopoUnion& region, const BoundingBox& universe) {
-  auto ret = TopoUnion{};
+  // Collect the fragments of all the boxes and sort them once, instead of merging them
+  // into the union one box at a time.
+  auto fragments = std::pmr::vector<BoundingBox>{region_resource()};
+  fragments.reserve(4 * region.size());
   for (auto&& box : region) {
     auto comp_box = complement_of(box, universe);
     if (std::holds_alternative<Universe>(comp_box)) {
@@ -256,121 +402,171 @@ Region complement_of(const TopoUnion& region, const BoundingBox& universe) {
       // TODO: verify.
       return Empty{};
     }
-    ret.merge(std::get<TopoUnion>(comp_box));
+    const auto& comp_union = std::get<TopoUnion>(comp_box);
+    fragments.insert(fragments.end(), comp_union.begin(), comp_union.end());
   }
-  return ret;
+  return TopoUnion{std::begin(fragments), std::end(fragments)};
 }
 
 /**
- * Helper class to convert TopoUnion to a set of disjoint rectangles.
- *
- * Adapted from:
- * https://codercareer.blogspot.com/2011/12/no-27-area-of-rectangles.html
+ * Segment tree over the elementary intervals between consecutive (sorted, unique) y
+ * coordinates, which tracks how many boxes cover each node and the length of the part
+ * of each node that is covered by at least one box.
  */
-struct TopoSimplify {
+class CoverTree {
+ public:
+  explicit CoverTree(const std::vector<double>& ys_) :
+      ys{ys_},
+      num_intervals{ys_.size() - 1},
+      count(4 * num_intervals, 0),
+      length(4 * num_intervals, 0.0) {}
+
   /**
-   * A one dimensional interval
+   * Add `delta` to the cover count of the elementary intervals in `[first, last)`.
    */
-  struct Interval {
-    double low, high;
-    Interval(double l, double h) {
-      low  = (l < h) ? l : h;
-      high = (l + h) - low;
-    }
-    constexpr bool is_overlapping(const Interval& other) {
-      return !(low > other.high || other.low > high);
-    }
-    void merge(const Interval& other) {
-      if (is_overlapping(other)) {
-        low  = std::min(low, other.low);
-        high = std::max(high, other.high);
-      }
-    }
-  };
+  void add(size_t first, size_t last, int delta) {
+    if (first < last) { update(1, 0, num_intervals, first, last, delta); }
+  }
 
   /**
-   * Sort boxes by left margin
+   * Total length of y that is covered.
    */
-  struct BoundOrder {
-    constexpr bool operator()(const BoundingBox& a, const BoundingBox& b) const {
-      return a.xmin < b.xmin;
-    }
-  };
+  [[nodiscard]] double covered() const { return length[1]; }
+
+  /**
+   * Call `fn(low, high)` for the maximal covered y intervals, in increasing order.
+   */
+  template <typename Fn>
+  void for_each_covered(Fn&& fn) const {
+    bool open  = false;
+    double low = 0, high = 0;
+    auto emit  = [&](double y0, double y1) {
+      if (open && y0 == high) {
+        high = y1;
+        return;
+      }
+      if (open) { fn(low, high); }
+      open = true;
+      low  = y0;
+      high = y1;
+    };
+    visit(1, 0, num_intervals, emit);
+    if (open) { fn(low, high); }
+  }
 
-  Region operator()(const Empty& e) { return e; }
-  Region operator()(const Universe& e) { return e; }
-  Region operator()(const BoundingBox& bbox) { return bbox; }
+ private:
+  const std::vector<double>& ys;
+  size_t num_intervals;
+  std::vector<int> count;
+  std::vector<double> length;
 
-  std::set<double> get_all_xs(const std::set<BoundingBox, BoundOrder>& rects) {
-    auto ret = std::set<double>{};
-    for (auto&& r : rects) {
-      ret.insert(r.xmin);
-      ret.insert(r.xmax);
+  void update(size_t node, size_t lo, size_t hi, size_t first, size_t last, int delta) {
+    if (last <= lo || hi <= first) { return; }
+    if (first <= lo && hi <= last) {
+      count[node] += delta;
+    } else {
+      const size_t mid = lo + (hi - lo) / 2;
+      update(2 * node, lo, mid, first, last, delta);
+      update(2 * node + 1, mid, hi, first, last, delta);
+    }
+    if (count[node] > 0) {
+      length[node] = ys[hi] - ys[lo];
+    } else if (hi - lo == 1) {
+      length[node] = 0.0;
+    } else {
+      length[node] = length[2 * node] + length[2 * node + 1];
     }
-    return ret;
   }
 
-  template <typename RectIter>
-  std::vector<Interval>
-  get_y_ranges(RectIter start, RectIter end, const Interval& x_range) {
-    static_assert(std::is_same_v<BoundingBox, std::decay_t<decltype(*start)>>);
-
-    auto ret = std::vector<Interval>{};
-
-    auto& it = start;
-    for (; it != end; ++it) {
-      if (x_range.low < it->xmax && x_range.high > it->xmin) {
-        // Current rectangle is within the range.
-        auto y_range = Interval{it->ymin, it->ymax};
-        if (ret.empty()) {
-          // Add it if there is nothing in the ranges yet.
-          ret.push_back(y_range);
-        } else { // Else, try to accumulate the ranges.
-          auto tmp = std::vector<Interval>{};
-          for (auto&& rg : ret) {
-            if (y_range.is_overlapping(rg)) {
-              y_range.merge(rg);
-            } else {
-              tmp.push_back(rg);
-            }
-          }
-          tmp.push_back(y_range);
-          ret = tmp;
-        }
-      }
+  template <typename Fn>
+  void visit(size_t node, size_t lo, size_t hi, Fn& fn) const {
+    if (length[node] == 0.0) { return; }
+    if (count[node] > 0 || hi - lo == 1) {
+      fn(ys[lo], ys[hi]);
+      return;
     }
+    const size_t mid = lo + (hi - lo) / 2;
+    visit(2 * node, lo, mid, fn);
+    visit(2 * node + 1, mid, hi, fn);
+  }
+};
+
+/**
+ * Sweep a vertical line over the boxes in the union from left to right, calling
+ * `fn(x0, x1, tree)` for each slab `[x0, x1]` between consecutive box edges, with the
+ * tree holding the y intervals covered in the slab.
+ *
+ * Open and closed boundaries are not distinguished, and boxes with no area are ignored.
+ */
+template <typename Fn>
+void sweep(const TopoUnion& region, Fn&& fn) {
+  struct Event {
+    double x;
+    size_t first, last;
+    int delta;
+  };
 
-    return ret;
+  auto ys = std::vector<double>{};
+  ys.reserve(2 * region.size());
+  for (const auto& bbox : region) {
+    ys.push_back(bbox.ymin);
+    ys.push_back(bbox.ymax);
   }
+  std::sort(ys.begin(), ys.end());
+  ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+  if (ys.size() < 2) { return; }
 
-  Region operator()(const TopoUnion& region) {
-    std::set<BoundingBox, BoundOrder> rects{std::begin(region), std::end(region)};
-    std::set<double> x_margins = get_all_xs(rects);
-
-    std::vector<BoundingBox> ret;
-
-    auto iter = rects.cbegin();
-    for (auto xpair : iter::sliding_window(x_margins, 2)) {
-      double x1 = xpair.at(0), x2 = xpair.at(1);
-      Interval x_int{x1, x2};
-      while (iter->xmax < x1) ++iter; // This step is like interval scheduling.
-      // Hold intervals of Y that correspond to the current X interval.
-      std::vector<Interval> y_intervals = get_y_ranges(iter, rects.cend(), x_int);
-      // Merge the corresponding ranges to BoundingBoxes
-      // TODO: Open Closed Bounds?
-      for (auto&& y_int : y_intervals) {
-        ret.emplace_back(BoundingBox{x_int.low, x_int.high, y_int.low, y_int.high});
-      }
+  const auto y_index = [&](double y) {
+    return static_cast<size_t>(std::lower_bound(ys.begin(), ys.end(), y) - ys.begin());
+  };
+  auto events = std::vector<Event>{};
+  events.reserve(2 * region.size());
+  for (const auto& bbox : region) {
+    const double x0 = std::min(bbox.xmin, bbox.xmax), x1 = std::max(bbox.xmin, bbox.xmax);
+    const size_t y0 = y_index(std::min(bbox.ymin, bbox.ymax));
+    const size_t y1 = y_index(std::max(bbox.ymin, bbox.ymax));
+    if (x0 == x1 || y0 == y1) { continue; }
+    events.push_back(Event{x0, y0, y1, 1});
+    events.push_back(Event{x1, y0, y1, -1});
+  }
+  std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+    return a.x < b.x;
+  });
+
+  auto tree = CoverTree{ys};
+  for (size_t i = 0; i < events.size();) {
+    const double x = events[i].x;
+    for (; i < events.size() && events[i].x == x; i++) {
+      tree.add(events[i].first, events[i].last, events[i].delta);
     }
-
-    return TopoUnion{ret.begin(), ret.end()};
+    if (i < events.size()) { fn(x, events[i].x, tree); }
   }
-};
+}
 
 } // namespace
 
 namespace percemon::topo {
 
+std::pmr::memory_resource* region_resource() { return thread_arena.resource; }
+
+size_t arena_allocations() { return thread_arena.arena.num_allocations; }
+
+ArenaScope::ArenaScope() : previous{thread_arena.resource} {
+  thread_arena.resource = &thread_arena.arena;
+  thread_arena.depth++;
+}
+
+ArenaScope::~ArenaScope() {
+  thread_arena.resource = this->previous;
+  if (--thread_arena.depth == 0) { thread_arena.arena.reset(); }
+}
+
+HeapScope::HeapScope() : previous{thread_arena.resource} {
+  thread_arena.resource = std::pmr::new_delete_resource();
+}
+
+HeapScope::~HeapScope() { thread_arena.resource = this->previous; }
+
 inline bool is_closed(const Region& region) {
   return std::visit(
       overloaded{[](const Empty&) { return true; },
@@ -410,7 +606,6 @@ inline bool is_open(const Region& region) {
 }
 
 double area(const Region& region) {
-  auto reg = simplify_region(region);
   return std::visit(
       overloaded{[](const Empty&) -> double { return 0.0; },
                  [](const Universe&) -> double {
@@ -419,15 +614,40 @@ double area(const Region& region) {
                  [](const BoundingBox& bbox) -> double {
                    return std::abs((bbox.xmin - bbox.xmax) * (bbox.ymin - bbox.ymax));
                  },
-                 [](const TopoUnion& topo_un) -> double {
-                   double region_area = 0;
-                   for (auto&& bbox : topo_un) {
-                     region_area +=
-                         std::abs((bbox.xmin - bbox.xmax) * (bbox.ymin - bbox.ymax));
-                   }
-                   return region_area;
-                 }},
-      reg);
+                 [](const TopoUnion& topo_un) -> double { return union_area(topo_un); }},
+      region);
+}
+
+double union_area(const TopoUnion& region) {
+  double ret = 0.0;
+  sweep(region, [&](double x0, double x1, const CoverTree& tree) {
+    ret += (x1 - x0) * tree.covered();
+  });
+  return ret;
+}
+
+TopoUnion decompose(const TopoUnion& region) {
+  auto boxes = std::pmr::vector<BoundingBox>{region_resource()};
+  // The y intervals covered in the previous slab, and the index of the first box created
+  // for them, so that the boxes can be extended through slabs that have the same cover.
+  auto prev_ys       = std::pmr::vector<std::pair<double, double>>{region_resource()};
+  auto ys            = std::pmr::vector<std::pair<double, double>>{region_resource()};
+  size_t prev_offset = 0;
+  double prev_x1     = 0.0;
+
+  sweep(region, [&](double x0, double x1, const CoverTree& tree) {
+    ys.clear();
+    tree.for_each_covered([&](double y0, double y1) { ys.emplace_back(y0, y1); });
+    if (!prev_ys.empty() && prev_x1 == x0 && ys == prev_ys) {
+      for (size_t i = prev_offset; i < boxes.size(); i++) { boxes[i].xmax = x1; }
+    } else {
+      prev_offset = boxes.size();
+      for (const auto& [y0, y1] : ys) { boxes.emplace_back(BoundingBox{x0, x1, y0, y1}); }
+      std::swap(prev_ys, ys);
+    }
+    prev_x1 = x1;
+  });
+  return TopoUnion{boxes.begin(), boxes.end()};
 }
 
 Region interior(const Region& region) {
@@ -572,8 +792,8 @@ Region spatial_union(const std::vector<Region>& regions) {
 }
 
 Region simplify_region(const Region& region) {
-  auto comp = TopoSimplify{};
-  return std::visit(comp, region);
+  if (const auto topo_un = std::get_if<TopoUnion>(&region)) { return decompose(*topo_un); }
+  return region;
 }
 
 } // namespace percemon::topo
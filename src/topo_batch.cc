@@ -0,0 +1,239 @@
+#include "percemon/topo.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERCEMON_TOPO_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PERCEMON_TOPO_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace percemon::topo;
+
+namespace {
+
+/**
+ * Raw pointers to the bounds of `n` boxes.
+ */
+struct Bounds {
+  const double* xmin;
+  const double* xmax;
+  const double* ymin;
+  const double* ymax;
+  size_t n;
+};
+
+struct MutBounds {
+  double* xmin;
+  double* xmax;
+  double* ymin;
+  double* ymax;
+};
+
+Bounds bounds_of(const BoxArrays& boxes) {
+  return Bounds{
+      boxes.xmin.data(),
+      boxes.xmax.data(),
+      boxes.ymin.data(),
+      boxes.ymax.data(),
+      boxes.size()};
+}
+
+MutBounds bounds_of(BoxArrays& boxes) {
+  return MutBounds{
+      boxes.xmin.data(), boxes.xmax.data(), boxes.ymin.data(), boxes.ymax.data()};
+}
+
+// Scalar kernels, which also handle the tails of the vectorized ones.
+
+void areas_scalar(const Bounds& in, size_t first, double* out) {
+  for (size_t i = first; i < in.n; i++) {
+    out[i] = std::abs((in.xmin[i] - in.xmax[i]) * (in.ymin[i] - in.ymax[i]));
+  }
+}
+
+void intersect_scalar(
+    const BoundingBox& p,
+    const Bounds& q,
+    size_t first,
+    const MutBounds& out,
+    std::uint8_t* mask) {
+  for (size_t i = first; i < q.n; i++) {
+    // Same conditions as for the intersection of a pair of boxes.
+    const bool x_overlap = (p.xmin <= q.xmin[i] && q.xmin[i] <= p.xmax) ||
+                           (q.xmin[i] <= p.xmin && p.xmin <= q.xmax[i]);
+    const bool y_overlap = (p.ymin <= q.ymin[i] && q.ymin[i] <= p.ymax) ||
+                           (q.ymin[i] <= p.ymin && p.ymin <= q.ymax[i]);
+    out.xmin[i] = std::max(p.xmin, q.xmin[i]);
+    out.xmax[i] = std::min(p.xmax, q.xmax[i]);
+    out.ymin[i] = std::max(p.ymin, q.ymin[i]);
+    out.ymax[i] = std::min(p.ymax, q.ymax[i]);
+    mask[i]     = static_cast<std::uint8_t>(x_overlap && y_overlap);
+  }
+}
+
+#if defined(PERCEMON_TOPO_AVX2)
+
+__attribute__((target("avx2"))) inline __m256d le(__m256d a, __m256d b) {
+  return _mm256_cmp_pd(a, b, _CMP_LE_OQ);
+}
+
+__attribute__((target("avx2"))) void areas_avx2(const Bounds& in, double* out) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  size_t i           = 0;
+  for (; i + 4 <= in.n; i += 4) {
+    const __m256d w =
+        _mm256_sub_pd(_mm256_loadu_pd(in.xmin + i), _mm256_loadu_pd(in.xmax + i));
+    const __m256d h =
+        _mm256_sub_pd(_mm256_loadu_pd(in.ymin + i), _mm256_loadu_pd(in.ymax + i));
+    _mm256_storeu_pd(out + i, _mm256_andnot_pd(sign, _mm256_mul_pd(w, h)));
+  }
+  areas_scalar(in, i, out);
+}
+
+__attribute__((target("avx2"))) void intersect_avx2(
+    const BoundingBox& p,
+    const Bounds& q,
+    const MutBounds& out,
+    std::uint8_t* mask) {
+  const __m256d pxmin = _mm256_set1_pd(p.xmin), pxmax = _mm256_set1_pd(p.xmax);
+  const __m256d pymin = _mm256_set1_pd(p.ymin), pymax = _mm256_set1_pd(p.ymax);
+
+  size_t i = 0;
+  for (; i + 4 <= q.n; i += 4) {
+    const __m256d qxmin = _mm256_loadu_pd(q.xmin + i);
+    const __m256d qxmax = _mm256_loadu_pd(q.xmax + i);
+    const __m256d qymin = _mm256_loadu_pd(q.ymin + i);
+    const __m256d qymax = _mm256_loadu_pd(q.ymax + i);
+
+    const __m256d x_overlap = _mm256_or_pd(
+        _mm256_and_pd(le(pxmin, qxmin), le(qxmin, pxmax)),
+        _mm256_and_pd(le(qxmin, pxmin), le(pxmin, qxmax)));
+    const __m256d y_overlap = _mm256_or_pd(
+        _mm256_and_pd(le(pymin, qymin), le(qymin, pymax)),
+        _mm256_and_pd(le(qymin, pymin), le(pymin, qymax)));
+    const int bits = _mm256_movemask_pd(_mm256_and_pd(x_overlap, y_overlap));
+
+    _mm256_storeu_pd(out.xmin + i, _mm256_max_pd(pxmin, qxmin));
+    _mm256_storeu_pd(out.xmax + i, _mm256_min_pd(pxmax, qxmax));
+    _mm256_storeu_pd(out.ymin + i, _mm256_max_pd(pymin, qymin));
+    _mm256_storeu_pd(out.ymax + i, _mm256_min_pd(pymax, qymax));
+    for (int k = 0; k < 4; k++) {
+      mask[i + k] = static_cast<std::uint8_t>((bits >> k) & 1);
+    }
+  }
+  intersect_scalar(p, q, i, out, mask);
+}
+
+bool has_avx2() {
+  static const bool ret = __builtin_cpu_supports("avx2");
+  return ret;
+}
+
+#elif defined(PERCEMON_TOPO_NEON)
+
+void areas_neon(const Bounds& in, double* out) {
+  size_t i = 0;
+  for (; i + 2 <= in.n; i += 2) {
+    const float64x2_t w = vsubq_f64(vld1q_f64(in.xmin + i), vld1q_f64(in.xmax + i));
+    const float64x2_t h = vsubq_f64(vld1q_f64(in.ymin + i), vld1q_f64(in.ymax + i));
+    vst1q_f64(out + i, vabsq_f64(vmulq_f64(w, h)));
+  }
+  areas_scalar(in, i, out);
+}
+
+void intersect_neon(
+    const BoundingBox& p,
+    const Bounds& q,
+    const MutBounds& out,
+    std::uint8_t* mask) {
+  const float64x2_t pxmin = vdupq_n_f64(p.xmin), pxmax = vdupq_n_f64(p.xmax);
+  const float64x2_t pymin = vdupq_n_f64(p.ymin), pymax = vdupq_n_f64(p.ymax);
+
+  size_t i = 0;
+  for (; i + 2 <= q.n; i += 2) {
+    const float64x2_t qxmin = vld1q_f64(q.xmin + i), qxmax = vld1q_f64(q.xmax + i);
+    const float64x2_t qymin = vld1q_f64(q.ymin + i), qymax = vld1q_f64(q.ymax + i);
+
+    const uint64x2_t x_overlap = vorrq_u64(
+        vandq_u64(vcleq_f64(pxmin, qxmin), vcleq_f64(qxmin, pxmax)),
+        vandq_u64(vcleq_f64(qxmin, pxmin), vcleq_f64(pxmin, qxmax)));
+    const uint64x2_t y_overlap = vorrq_u64(
+        vandq_u64(vcleq_f64(pymin, qymin), vcleq_f64(qymin, pymax)),
+        vandq_u64(vcleq_f64(qymin, pymin), vcleq_f64(pymin, qymax)));
+    const uint64x2_t overlap = vandq_u64(x_overlap, y_overlap);
+
+    vst1q_f64(out.xmin + i, vmaxq_f64(pxmin, qxmin));
+    vst1q_f64(out.xmax + i, vminq_f64(pxmax, qxmax));
+    vst1q_f64(out.ymin + i, vmaxq_f64(pymin, qymin));
+    vst1q_f64(out.ymax + i, vminq_f64(pymax, qymax));
+    mask[i]     = static_cast<std::uint8_t>(vgetq_lane_u64(overlap, 0) != 0);
+    mask[i + 1] = static_cast<std::uint8_t>(vgetq_lane_u64(overlap, 1) != 0);
+  }
+  intersect_scalar(p, q, i, out, mask);
+}
+
+#endif
+
+} // namespace
+
+namespace percemon::topo {
+
+BoxArrays::BoxArrays(const TopoUnion& region) : BoxArrays{} {
+  const size_t n = region.size();
+  xmin.reserve(n);
+  xmax.reserve(n);
+  ymin.reserve(n);
+  ymax.reserve(n);
+  for (const auto& bbox : region) { push_back(bbox); }
+}
+
+void BoxArrays::resize(size_t n) {
+  xmin.resize(n);
+  xmax.resize(n);
+  ymin.resize(n);
+  ymax.resize(n);
+}
+
+void BoxArrays::push_back(const BoundingBox& bbox) {
+  xmin.push_back(bbox.xmin);
+  xmax.push_back(bbox.xmax);
+  ymin.push_back(bbox.ymin);
+  ymax.push_back(bbox.ymax);
+}
+
+void batch_areas(const BoxArrays& boxes, double* out) {
+  const auto in = bounds_of(boxes);
+#if defined(PERCEMON_TOPO_NEON)
+  areas_neon(in, out);
+#else
+#if defined(PERCEMON_TOPO_AVX2)
+  if (has_avx2()) { return areas_avx2(in, out); }
+#endif
+  areas_scalar(in, 0, out);
+#endif
+}
+
+void batch_intersect(
+    const BoundingBox& bbox,
+    const BoxArrays& boxes,
+    BoxArrays& out,
+    std::uint8_t* mask) {
+  out.resize(boxes.size());
+  const auto in  = bounds_of(boxes);
+  const auto ret = bounds_of(out);
+#if defined(PERCEMON_TOPO_NEON)
+  intersect_neon(bbox, in, ret, mask);
+#else
+#if defined(PERCEMON_TOPO_AVX2)
+  if (has_avx2()) { return intersect_avx2(bbox, in, ret, mask); }
+#endif
+  intersect_scalar(bbox, in, 0, ret, mask);
+#endif
+}
+
+} // namespace percemon::topo
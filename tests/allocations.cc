@@ -0,0 +1,120 @@
+// Replacements of all the global allocation and deallocation functions, to count the
+// heap allocations, and check that the monitors don't allocate where they shouldn't.
+//
+// These are kept apart from the tests, as GCC can't tell that the replaced `operator
+// delete` is only given pointers from the replaced `operator new`, and warns about
+// `std::free` being called on them once they are inlined.
+
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+std::atomic<std::size_t> count{0};
+
+void* allocate(std::size_t size) noexcept {
+  count++;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* allocate(std::size_t size, std::align_val_t alignment) noexcept {
+  count++;
+  const auto align = static_cast<std::size_t>(alignment);
+  // The size must be a multiple of the alignment.
+  size = size == 0 ? align : (size + align - 1) / align * align;
+#ifdef _MSC_VER
+  return _aligned_malloc(size, align);
+#else
+  return std::aligned_alloc(align, size);
+#endif
+}
+
+void deallocate(void* ptr) noexcept { std::free(ptr); }
+
+void deallocate(void* ptr, std::align_val_t) noexcept {
+#ifdef _MSC_VER
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+template <typename... Args>
+void* allocate_or_throw(Args... args) {
+  if (void* ptr = allocate(args...)) { return ptr; }
+  throw std::bad_alloc{};
+}
+
+} // namespace
+
+std::size_t num_allocations() { return count.load(); }
+
+void* operator new(std::size_t size) { return allocate_or_throw(size); }
+void* operator new[](std::size_t size) { return allocate_or_throw(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate_or_throw(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate_or_throw(size, alignment);
+}
+void* operator new(
+    std::size_t size,
+    std::align_val_t alignment,
+    const std::nothrow_t&) noexcept {
+  return allocate(size, alignment);
+}
+void* operator new[](
+    std::size_t size,
+    std::align_val_t alignment,
+    const std::nothrow_t&) noexcept {
+  return allocate(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+  deallocate(ptr, alignment);
+}
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+  deallocate(ptr, alignment);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+  deallocate(ptr, alignment);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+  deallocate(ptr, alignment);
+}
+void operator delete(
+    void* ptr,
+    std::align_val_t alignment,
+    const std::nothrow_t&) noexcept {
+  deallocate(ptr, alignment);
+}
+void operator delete[](
+    void* ptr,
+    std::align_val_t alignment,
+    const std::nothrow_t&) noexcept {
+  deallocate(ptr, alignment);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
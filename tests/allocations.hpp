@@ -0,0 +1,14 @@
+#pragma once
+
+#ifndef __PERCEMON_TESTS_ALLOCATIONS_HPP__
+#define __PERCEMON_TESTS_ALLOCATIONS_HPP__
+
+#include <cstddef>
+
+/**
+ * Number of heap allocations made so far by the test binary, counted by the
+ * replacements of the global allocation functions in allocations.cc.
+ */
+std::size_t num_allocations();
+
+#endif /* end of include guard: __PERCEMON_TESTS_ALLOCATIONS_HPP__ */
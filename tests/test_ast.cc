@@ -3,6 +3,8 @@
 #include "percemon/ast.hpp"
 #include "percemon/fmt.hpp"
 
+#include <variant>
+
 using namespace percemon;
 
 TEST_CASE("AST nodes throw exceptions when constructed badly", "[ast][except]") {
@@ -196,3 +198,83 @@ TEST_CASE("AST nodes are printed correctly", "[ast][fmt]") {
     }
   }
 }
+
+TEST_CASE("Formulas are simplified", "[ast][simplify]") {
+  const auto id1  = Var_id{"1"};
+  const auto id2  = Var_id{"2"};
+  const auto f    = Var_f{"1"};
+  const Expr a    = Prob(id1) > 0.5;
+  const Expr b    = Class(id1) == 1;
+  const Expr c    = Area(id1) > 100.0;
+  const Expr near = f - C_FRAME{} < 3;
+
+  SECTION("Negations are pushed to the leaves") {
+    REQUIRE(std::holds_alternative<ast::CompareProb>(ast::simplify(~~a)));
+
+    // ~(a & near) == ~a | (f - C_FRAME >= 3)
+    const auto phi = ast::simplify(~(a & near));
+    REQUIRE(std::holds_alternative<ast::OrPtr>(phi));
+    const auto& args = std::get<ast::OrPtr>(phi)->args;
+    REQUIRE(args.size() == 1);
+    REQUIRE(std::holds_alternative<ast::NotPtr>(args[0]));
+    const auto& bounds = std::get<ast::OrPtr>(phi)->temporal_bound_args;
+    REQUIRE(bounds.size() == 1);
+    REQUIRE(std::get<ast::FrameBound>(bounds[0]).op == ComparisonOp::GE);
+
+    const auto always = ast::simplify(~Expr{Always(FrameInterval::closed(0, 2), a)});
+    REQUIRE(std::holds_alternative<ast::SometimesPtr>(always));
+    const auto& sometimes = std::get<ast::SometimesPtr>(always);
+    REQUIRE(sometimes->interval.has_value());
+    REQUIRE(std::holds_alternative<ast::NotPtr>(sometimes->arg));
+
+    const auto exists = ast::simplify(~Expr{Exists({id1})->dot(a)});
+    REQUIRE(std::holds_alternative<ast::ForallPtr>(exists));
+    REQUIRE(std::holds_alternative<ast::BackToPtr>(ast::simplify(~Expr{Since(a, b)})));
+    // Previous is BOTTOM at the first frame, so the negation stays above it.
+    REQUIRE(std::holds_alternative<ast::NotPtr>(ast::simplify(~Expr{Previous(a)})));
+  }
+
+  SECTION("And and Or are flattened and constants are folded") {
+    const auto phi = ast::simplify(And({a, And({b, Or({c, Const{false}})})}));
+    REQUIRE(std::holds_alternative<ast::AndPtr>(phi));
+    REQUIRE(std::get<ast::AndPtr>(phi)->args.size() == 3);
+
+    REQUIRE(!std::get<Const>(ast::simplify(And({a, ~Expr{Const{true}}}))).value);
+    REQUIRE(std::get<Const>(ast::simplify(Or({a, Const{true}}))).value == true);
+    const auto single = ast::simplify(Or({a, Const{false}}));
+    REQUIRE(std::holds_alternative<ast::CompareProb>(single));
+  }
+
+  SECTION("Subformulas that don't depend on the quantified IDs are hoisted") {
+    // EXISTS {id_1} . EXISTS {id_2} @ {_, f_1} . (near & a & inner)
+    //   == {_, f_1} . (near & EXISTS {id_1} . (a & EXISTS {id_2} . inner))
+    const Expr inner = Prob(id2) > Prob(id1);
+    const auto phi   = ast::simplify(
+        Exists({id1})->dot(Exists({id2})->at(Pin{f})->dot(And({near, a, inner}))));
+    REQUIRE(std::holds_alternative<ast::PinPtr>(phi));
+
+    const auto& pinned = std::get<ast::PinPtr>(phi)->phi;
+    REQUIRE(std::holds_alternative<ast::AndPtr>(pinned));
+    const auto& outer = std::get<ast::AndPtr>(pinned);
+    REQUIRE(outer->temporal_bound_args.size() == 1);
+    REQUIRE(outer->args.size() == 1);
+    REQUIRE(std::holds_alternative<ast::ExistsPtr>(outer->args[0]));
+
+    const auto& exists1 = std::get<ast::ExistsPtr>(outer->args[0]);
+    REQUIRE(!exists1->pinned_at.has_value());
+    REQUIRE(std::holds_alternative<ast::AndPtr>(*exists1->phi));
+    const auto& conj = std::get<ast::AndPtr>(*exists1->phi);
+    REQUIRE(conj->args.size() == 2);
+    REQUIRE(std::holds_alternative<ast::CompareProb>(conj->args[0]));
+    REQUIRE(std::holds_alternative<ast::ExistsPtr>(conj->args[1]));
+    const auto& exists2 = std::get<ast::ExistsPtr>(conj->args[1]);
+    REQUIRE(!exists2->pinned_at.has_value());
+    REQUIRE(std::holds_alternative<ast::CompareProb>(*exists2->phi));
+
+    // A Forall over no objects is true, so its conjuncts can't be hoisted.
+    const auto forall = ast::simplify(Forall({id2})->dot(And({a, inner})));
+    REQUIRE(std::holds_alternative<ast::ForallPtr>(forall));
+    const auto hoisted = ast::simplify(Forall({id2})->dot(Or({a, inner})));
+    REQUIRE(std::holds_alternative<ast::OrPtr>(hoisted));
+  }
+}
@@ -0,0 +1,361 @@
+#include <catch2/catch.hpp>
+
+#include "percemon/fixed.hpp"
+#include "percemon/percemon.hpp"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ds    = percemon::datastream;
+namespace mon   = percemon::monitoring;
+namespace fixed = percemon::fixed;
+
+namespace {
+
+constexpr double FPS = 30.0;
+
+constexpr size_t WIDTH  = 1920;
+constexpr size_t HEIGHT = 1080;
+
+/**
+ * Generate a deterministic stream of tracked frames with objects randomly (re)appearing
+ * in the frames.
+ */
+std::vector<ds::TrackedFrame> generate_trace(size_t num_frames, unsigned int seed) {
+  constexpr size_t num_tracks = 5;
+
+  auto rng         = std::mt19937{seed};
+  auto is_present  = std::bernoulli_distribution{0.7};
+  auto label       = std::uniform_int_distribution<int>{1, 2};
+  auto probability = std::uniform_real_distribution<double>{0.0, 1.0};
+  auto x_coord     = std::uniform_int_distribution<size_t>{0, WIDTH - 200};
+  auto y_coord     = std::uniform_int_distribution<size_t>{0, HEIGHT - 200};
+  auto size        = std::uniform_int_distribution<size_t>{10, 200};
+
+  auto trace = std::vector<ds::TrackedFrame>{};
+  for (size_t i = 0; i < num_frames; i++) {
+    auto frame = ds::TrackedFrame{static_cast<double>(i) / FPS, i, WIDTH, HEIGHT, {}};
+    for (ds::TrackId track = 0; track < num_tracks; track++) {
+      if (!is_present(rng)) { continue; }
+      const size_t xmin = x_coord(rng);
+      const size_t ymin = y_coord(rng);
+      frame.objects.emplace(
+          track,
+          ds::Object{
+              label(rng),
+              probability(rng),
+              ds::BoundingBox{xmin, xmin + size(rng), ymin, ymin + size(rng)}});
+    }
+    trace.push_back(std::move(frame));
+  }
+  return trace;
+}
+
+/**
+ * Check that the fixed monitor computes the same robustness as the OnlineMonitor, for
+ * both the formula written with the `ast` operators and the one from `to_expr`.
+ */
+template <typename Phi>
+void check_spec(
+    const std::string& name,
+    const percemon::Expr& expected,
+    const Phi& phi,
+    const std::vector<ds::TrackedFrame>& trace) {
+  INFO("Formula: " << name);
+  for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+    const auto options = mon::MonitorOptions{strategy};
+    auto reference     = mon::OnlineMonitor{expected, FPS, WIDTH, HEIGHT, options};
+    auto converted     = mon::OnlineMonitor{phi.to_expr(), FPS, WIDTH, HEIGHT, options};
+    auto monitor       = fixed::Monitor{phi, FPS};
+    REQUIRE(monitor.get_max_horizon() == reference.get_max_horizon());
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      INFO("Frame: " << i);
+      reference.add_frame(trace[i]);
+      converted.add_frame(trace[i]);
+      monitor.add_frame(trace[i]);
+      const double rob = reference.eval();
+      REQUIRE(monitor.eval() == rob);
+      REQUIRE(converted.eval() == rob);
+    }
+  }
+}
+
+// The specifications of the monitoring tests (except the spatial ones), written with
+// the `ast` operators and with the fixed ones.
+
+percemon::Expr ast_phi1() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  return Exists({id1, id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)});
+}
+
+auto fixed_phi1() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  return Exists(id1, id2).dot((id1 == id2) & (Class(id1) == Class(id2)));
+}
+
+percemon::Expr ast_phi2() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  return Forall({id1})->dot(
+      Expr{Previous(Const{true})} >>
+      Previous(Exists({id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)})));
+}
+
+auto fixed_phi2() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  return Forall(id1).dot(
+      Previous(Const{true}) >>
+      Previous(Exists(id2).dot((id1 == id2) & (Class(id1) == Class(id2)))));
+}
+
+percemon::Expr ast_phi3() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto x   = Var_x{"1"};
+  auto f   = Var_f{"1"};
+
+  Expr guard = And({1 <= f - C_FRAME{}, f - C_FRAME{} <= 2});
+  Expr body  = Exists({id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)});
+  return Forall({id1})->at({x, f})->dot(Always(guard >> body));
+}
+
+auto fixed_phi3() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  constexpr auto x   = VarX<1>{};
+  constexpr auto f   = VarF<1>{};
+
+  const auto guard = And(1 <= f - C_FRAME{}, f - C_FRAME{} <= 2);
+  const auto body  = Exists(id2).dot((id1 == id2) & (Class(id1) == Class(id2)));
+  return Forall(id1).at(x, f).dot(Always(guard >> body));
+}
+
+percemon::Expr ast_phi4() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto f   = Var_f{"1"};
+
+  Expr margins = And(
+      {Lon(id1, CRT::TM) > 200.0,
+       Lon(id1, CRT::BM) < 880.0,
+       Lat(id1, CRT::LM) > 200.0,
+       Lat(id1, CRT::RM) < 1720.0});
+  Expr high_prob = And({Class(id1) == 1, Prob(id1) > 0.8, margins});
+  Expr reappear  = Expr{id1 == id2} & (Prob(id2) > 0.7) & (Class(id2) == 1);
+  return Forall({id1})->at(Pin{f})->dot(
+      high_prob >> Always((f - C_FRAME{} < 6) >> Exists({id2})->dot(reappear)));
+}
+
+auto fixed_phi4() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  constexpr auto f   = VarF<1>{};
+
+  const auto margins = And(
+      Lon(id1, CRT::TM) > 200.0,
+      Lon(id1, CRT::BM) < 880.0,
+      Lat(id1, CRT::LM) > 200.0,
+      Lat(id1, CRT::RM) < 1720.0);
+  const auto high_prob = And(Class(id1) == 1, Prob(id1) > 0.8, margins);
+  const auto reappear  = (id1 == id2) & (Prob(id2) > 0.7) & (Class(id2) == 1);
+  return Forall(id1).at(f).dot(
+      high_prob >> Always((f - C_FRAME{} < 6) >> Exists(id2).dot(reappear)));
+}
+
+percemon::Expr ast_since() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto x   = Var_x{"1"};
+  return Exists({id1})->at(Pin{x})->dot(Since(
+      Prob(id1) > 0.4, Expr{Class(id1) == 2} & Expr{x - C_TIME{} <= 0.2}));
+}
+
+auto fixed_since() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto x   = VarX<1>{};
+  return Exists(id1).at(x).dot(
+      Since(Prob(id1) > 0.4, (Class(id1) == 2) & (x - C_TIME{} <= 0.2)));
+}
+
+percemon::Expr ast_backto() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto f   = Var_f{"1"};
+  return Forall({id1})->at(Pin{f})->dot(Sometimes(
+      Expr{f - C_FRAME{} < 4} &
+      BackTo(Lat(id1, CRT::RM) < 2.0 * Lat(id1, CRT::CT), Area(id1) > 5000.0)));
+}
+
+auto fixed_backto() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto f   = VarF<1>{};
+  return Forall(id1).at(f).dot(Sometimes(
+      (f - C_FRAME{} < 4) &
+      BackTo(Lat(id1, CRT::RM) < 2.0 * Lat(id1, CRT::CT), Area(id1) > 5000.0)));
+}
+
+percemon::Expr ast_bounded() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  return Forall({id1})->dot(
+      Always(FrameInterval::closed(0, 5), Prob(id1) > 0.3) |
+      Sometimes(FrameInterval::lopen(1, 4), Expr{Class(id1) == 2}));
+}
+
+auto fixed_bounded() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  return Forall(id1).dot(
+      Always(FrameInterval::closed(0, 5), Prob(id1) > 0.3) |
+      Sometimes(FrameInterval::lopen(1, 4), Class(id1) == 2));
+}
+
+/**
+ * Comparisons between the attributes of two objects, and against literals on the left.
+ */
+percemon::Expr ast_attributes() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  Expr body = Expr{id1 != id2} &
+              Or({Prob(id1) >= Prob(id2) * 1.5,
+                  Lon(id1, CRT::CT) <= Lon(id2, CRT::BM),
+                  Expr{Area(id1) < Area(id2, 0.5)} & Expr{Class(id1) != Class(id2)},
+                  Expr{3000.0 > Area(id1)} & Expr{2 != Class(id2)}});
+  return Forall({id1})->dot(
+      Exists({id2})->dot(Sometimes(FrameInterval::ropen(0, 3), body)));
+}
+
+auto fixed_attributes() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  const auto body    = (id1 != id2) &
+                    Or(Prob(id1) >= Prob(id2) * 1.5,
+                       Lon(id1, CRT::CT) <= Lon(id2, CRT::BM),
+                       (Area(id1) < Area(id2, 0.5)) & (Class(id1) != Class(id2)),
+                       (3000.0 > Area(id1)) & (2 != Class(id2)));
+  return Forall(id1).dot(Exists(id2).dot(Sometimes(FrameInterval::ropen(0, 3), body)));
+}
+
+/**
+ * Time bounds, including the non-positive ones that are flipped by ast::TimeBound, and
+ * constants.
+ */
+percemon::Expr ast_bounds() {
+  using namespace percemon;
+  auto id1 = Var_id{"1"};
+  auto x   = Var_x{"1"};
+  auto f   = Var_f{"1"};
+  Expr recent = Expr{x - C_TIME{} >= 0.0} | Expr{0.1 < x - C_TIME{}};
+  return Exists({id1})->at({x, f})->dot(Always(
+      Expr{f - C_FRAME{} <= 3} >>
+      (Expr{~recent} | BackTo(Prob(id1) > 0.2, Expr{Const{false}}))));
+}
+
+auto fixed_bounds() {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto x   = VarX<1>{};
+  constexpr auto f   = VarF<1>{};
+  const auto recent  = (x - C_TIME{} >= 0.0) | (0.1 < x - C_TIME{});
+  return Exists(id1).at(x, f).dot(Always(
+      (f - C_FRAME{} <= 3) >> (~recent | BackTo(Prob(id1) > 0.2, Const{false}))));
+}
+
+} // namespace
+
+TEST_CASE("Fixed formulas match the online monitor", "[fixed]") {
+  const auto trace = generate_trace(90, 42);
+
+  check_spec("phi1", ast_phi1(), fixed_phi1(), trace);
+  check_spec("phi2", ast_phi2(), fixed_phi2(), trace);
+  check_spec("phi3", ast_phi3(), fixed_phi3(), trace);
+  check_spec("phi4", ast_phi4(), fixed_phi4(), trace);
+  check_spec("since", ast_since(), fixed_since(), trace);
+  check_spec("backto", ast_backto(), fixed_backto(), trace);
+  check_spec("bounded", ast_bounded(), fixed_bounded(), trace);
+  check_spec("attributes", ast_attributes(), fixed_attributes(), trace);
+  check_spec("bounds", ast_bounds(), fixed_bounds(), trace);
+}
+
+TEST_CASE("Fixed monitors accept every kind of frame", "[fixed][datastream]") {
+  const auto trace = generate_trace(60, 7);
+  const auto phi   = fixed_phi4();
+
+  auto expected = fixed::Monitor{phi, FPS};
+  auto named    = fixed::Monitor{phi, FPS};
+  auto viewed   = fixed::Monitor{phi, FPS};
+  REQUIRE_THROWS_AS(expected.eval(), std::logic_error);
+
+  for (const auto& frame : trace) {
+    auto copy = ds::Frame{frame.timestamp, frame.frame_num, WIDTH, HEIGHT, {}};
+    auto ids  = std::vector<ds::TrackId>{};
+    auto cls  = std::vector<int>{};
+    auto prob = std::vector<double>{};
+    auto bbox = std::vector<ds::BoundingBox>{};
+    for (const auto& [id, obj] : frame.objects) {
+      copy.objects.emplace(std::to_string(id), obj);
+      ids.push_back(id);
+      cls.push_back(obj.object_class);
+      prob.push_back(obj.probability);
+      bbox.push_back(obj.bbox);
+    }
+
+    expected.add_frame(frame);
+    named.add_frame(copy);
+    viewed.add_frame(ds::FrameView{
+        frame.timestamp,
+        frame.frame_num,
+        WIDTH,
+        HEIGHT,
+        ids.size(),
+        ids.data(),
+        cls.data(),
+        prob.data(),
+        bbox.data()});
+    const double rob = expected.eval();
+    REQUIRE(named.eval() == rob);
+    REQUIRE(viewed.eval() == rob);
+  }
+
+  SECTION("Duplicate track IDs") {
+    const auto ids    = std::vector<ds::TrackId>{3, 5, 3};
+    const auto cls    = std::vector<int>{1, 1, 1};
+    const auto prob   = std::vector<double>{0.5, 0.5, 0.5};
+    const auto bboxes = std::vector<ds::BoundingBox>(3, ds::BoundingBox{0, 10, 0, 10});
+    const auto view   = ds::FrameView{
+        0.0, 0, WIDTH, HEIGHT, 3, ids.data(), cls.data(), prob.data(), bboxes.data()};
+    REQUIRE_THROWS_AS(viewed.add_frame(view), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Fixed formulas are checked like the ast ones", "[fixed]") {
+  using namespace percemon::fixed;
+  constexpr auto id1 = Id<1>{};
+  constexpr auto id2 = Id<2>{};
+  constexpr auto f   = VarF<1>{};
+
+  // An unbound ID, and an unpinned frame variable.
+  REQUIRE_THROWS_AS(Monitor(Forall(id1).dot(id1 == id2), FPS), std::invalid_argument);
+  REQUIRE_THROWS_AS(
+      Monitor(Exists(id1).dot((Class(id1) == 1) & (f - C_FRAME{} < 3)), FPS),
+      std::invalid_argument);
+}
@@ -0,0 +1,414 @@
+#include <catch2/catch.hpp>
+
+#include "percemon/fmt.hpp"
+#include "percemon/io.hpp"
+#include "percemon/percemon.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ds = percemon::datastream;
+namespace fs = std::filesystem;
+namespace io = percemon::io;
+
+namespace {
+
+/**
+ * A file in the temporary directory that is removed when it goes out of scope.
+ */
+struct TempFile {
+  fs::path path;
+
+  TempFile(const std::string& name, const std::string& contents) :
+      path{fs::temp_directory_path() / name} {
+    std::ofstream out{path, std::ios::binary};
+    out << contents;
+  }
+  ~TempFile() { fs::remove(path); }
+};
+
+bool same_frames(const ds::TrackedFrame& a, const ds::TrackedFrame& b) {
+  const auto same_object = [](const auto& p, const auto& q) {
+    return p.first == q.first && p.second.object_class == q.second.object_class &&
+           p.second.probability == q.second.probability &&
+           p.second.bbox.xmin == q.second.bbox.xmin &&
+           p.second.bbox.xmax == q.second.bbox.xmax &&
+           p.second.bbox.ymin == q.second.bbox.ymin &&
+           p.second.bbox.ymax == q.second.bbox.ymax;
+  };
+  return a.timestamp == b.timestamp && a.frame_num == b.frame_num &&
+         a.size_x == b.size_x && a.size_y == b.size_y &&
+         std::equal(
+             a.objects.begin(),
+             a.objects.end(),
+             b.objects.begin(),
+             b.objects.end(),
+             same_object);
+}
+
+} // namespace
+
+TEST_CASE("MOT results are read one frame at a time", "[io]") {
+  // Frame 2 is missing, and lines end with both \n and \r\n.
+  const auto file = TempFile{
+      "percemon_test_io.csv",
+      "1,3,-4.5,10,20,30,0.9,-1,-1,-1\n"
+      "1,7,100,200,10,10,0.5,-1,-1,-1\r\n"
+      "\n"
+      "3,7,101.5,201,10,10,0.75,-1,-1,-1\n"
+      "4,3,0,0,1,1,1"};
+
+  for (bool memory_map : {true, false}) {
+    INFO("Memory mapped: " << memory_map);
+    auto options       = io::MotOptions{10.0, 640, 480};
+    options.memory_map = memory_map;
+    // Lines are split across chunks, and some don't fit in one.
+    options.chunk_size = 8;
+
+    auto reader = io::MotReader{file.path.string(), options};
+    auto frames = std::vector<ds::TrackedFrame>{};
+    auto frame  = ds::TrackedFrame{};
+    while (reader.next(frame)) { frames.push_back(frame); }
+
+    REQUIRE(frames.size() == 4);
+    for (size_t i = 0; i < frames.size(); i++) {
+      REQUIRE(frames[i].frame_num == i + 1);
+      REQUIRE(frames[i].timestamp == Approx(static_cast<double>(i) / 10.0));
+      REQUIRE(frames[i].size_x == 640);
+      REQUIRE(frames[i].size_y == 480);
+    }
+
+    REQUIRE(frames[0].objects.size() == 2);
+    const auto& first = frames[0].objects.at(3);
+    REQUIRE(first.object_class == 1);
+    REQUIRE(first.probability == Approx(0.9));
+    // Boxes are clipped to the image.
+    REQUIRE(first.bbox.xmin == 0);
+    REQUIRE(first.bbox.xmax == 15);
+    REQUIRE(first.bbox.ymin == 10);
+    REQUIRE(first.bbox.ymax == 40);
+
+    REQUIRE(frames[1].objects.empty());
+    REQUIRE(frames[2].objects.size() == 1);
+    REQUIRE(frames[2].objects.at(7).probability == Approx(0.75));
+    REQUIRE(frames[2].objects.at(7).bbox.xmin == 101);
+    REQUIRE(frames[3].objects.size() == 1);
+
+    // The end of the file is sticky.
+    REQUIRE_FALSE(reader.next(frame));
+  }
+
+  SECTION("Reading frame views") {
+    auto reader = io::MotReader{file.path.string(), io::MotOptions{10.0, 640, 480}};
+    auto view   = ds::FrameView{};
+    REQUIRE(reader.next(view));
+    REQUIRE(view.num_objects == 2);
+    REQUIRE(view.ids[0] == 3);
+    REQUIRE(view.ids[1] == 7);
+    REQUIRE(view.bbox[1].xmax == 110);
+
+    REQUIRE(io::read_mot(file.path.string(), io::MotOptions{}).size() == 4);
+  }
+}
+
+TEST_CASE("Repeated MOT rows keep the last row", "[io]") {
+  const auto file = TempFile{
+      "percemon_test_io_dup.csv",
+      "1,7,0,0,10,10,0.9,-1,-1,-1\n"
+      "1,3,20,20,10,10,0.8,-1,-1,-1\n"
+      "1,7,40,40,10,10,0.7,-1,-1,-1\n"
+      "2,3,0,0,10,10,0.6,-1,-1,-1\n"};
+
+  auto reader = io::MotReader{file.path.string(), io::MotOptions{10.0, 640, 480}};
+  auto view   = ds::FrameView{};
+  REQUIRE(reader.next(view));
+  REQUIRE(view.num_objects == 2);
+  REQUIRE(view.ids[0] == 3);
+  REQUIRE(view.ids[1] == 7);
+  REQUIRE(view.probability[1] == Approx(0.7));
+  REQUIRE(view.bbox[1].xmin == 40);
+
+  // The frame can be monitored (which rejects views with repeated IDs), and only the
+  // last row of track 7 is seen.
+  const auto id = percemon::Var_id{"1"};
+  auto monitor  = percemon::monitoring::OnlineMonitor{
+      percemon::Exists({id})->dot(percemon::Prob(id) > 0.85), 10.0, 640, 480};
+  monitor.add_frame(view);
+  REQUIRE(monitor.eval() < 0);
+  REQUIRE(reader.next(view));
+  REQUIRE(view.num_objects == 1);
+}
+
+TEST_CASE("Unassigned MOT detections are distinct objects", "[io]") {
+  const auto file = TempFile{
+      "percemon_test_io_det.csv",
+      "1,-1,0,0,10,10,0.9,-1,-1,-1\n"
+      "1,-1,20,20,10,10,0.8,-1,-1,-1\n"
+      "1,4,40,40,10,10,0.7,-1,-1,-1\n"
+      "2,-1,0,0,10,10,0.6,-1,-1,-1\n"};
+
+  const auto frames = io::read_mot(file.path.string(), io::MotOptions{10.0, 640, 480});
+  REQUIRE(frames.size() == 2);
+  REQUIRE(frames[0].objects.size() == 3);
+  REQUIRE(frames[0].objects.at(4).probability == Approx(0.7));
+  REQUIRE(frames[0].objects.at(io::FIRST_UNASSIGNED_ID).probability == Approx(0.9));
+  REQUIRE(frames[0].objects.at(io::FIRST_UNASSIGNED_ID + 1).probability == Approx(0.8));
+  REQUIRE(frames[1].objects.size() == 1);
+  REQUIRE(frames[1].objects.at(io::FIRST_UNASSIGNED_ID + 2).probability == Approx(0.6));
+}
+
+TEST_CASE("Whole MOT files are read in any order", "[io]") {
+  // The ground truth files of MOT17 are sorted by track.
+  const auto by_frame = TempFile{
+      "percemon_test_io_by_frame.csv",
+      "1,3,0,0,10,10,0.9,-1,-1,-1\n"
+      "1,7,20,20,10,10,0.8,-1,-1,-1\n"
+      "3,3,1,1,10,10,0.7,-1,-1,-1\n"
+      "3,7,21,21,10,10,0.6,-1,-1,-1\n"};
+  const auto by_track = TempFile{
+      "percemon_test_io_by_track.csv",
+      "3,3,5,5,10,10,0.1,-1,-1,-1\n"
+      "1,3,0,0,10,10,0.9,-1,-1,-1\n"
+      "3,3,1,1,10,10,0.7,-1,-1,-1\n"
+      "3,7,21,21,10,10,0.6,-1,-1,-1\n"
+      "1,7,20,20,10,10,0.8,-1,-1,-1\n"};
+
+  const auto options  = io::MotOptions{10.0, 640, 480};
+  const auto expected = io::read_mot(by_frame.path.string(), options);
+  // The second row of track 3 in frame 3 replaces the first.
+  const auto frames = io::read_mot(by_track.path.string(), options);
+  REQUIRE(frames.size() == 3);
+  REQUIRE(frames[1].objects.empty());
+  for (size_t i = 0; i < frames.size(); i++) {
+    REQUIRE(same_frames(frames[i], expected[i]));
+  }
+
+  // Only the MotReader needs the rows in frame order: frames 1 to 3 are produced before
+  // the rows of frame 1 that follow.
+  auto reader = io::MotReader{by_track.path.string(), options};
+  auto frame  = ds::TrackedFrame{};
+  for (size_t i = 0; i < 3; i++) { REQUIRE(reader.next(frame)); }
+  REQUIRE_THROWS_AS(reader.next(frame), std::invalid_argument);
+
+  const auto zero = TempFile{"percemon_test_io_zero.csv", "0,3,0,0,10,10,0.9\n"};
+  REQUIRE_THROWS_AS(io::read_mot(zero.path.string(), options), std::invalid_argument);
+}
+
+TEST_CASE("Unassigned MOT detections are monitored in bounded memory", "[io]") {
+  auto rows = std::string{};
+  for (size_t frame = 1; frame <= 200; frame++) {
+    for (size_t i = 0; i < 3; i++) {
+      rows += fmt::format("{},-1,{},0,10,10,0.9,-1,-1,-1\n", frame, 20 * i);
+    }
+  }
+  const auto file = TempFile{"percemon_test_io_det_stream.csv", rows};
+
+  const auto id = percemon::Var_id{"1"};
+  auto monitor  = percemon::monitoring::OnlineMonitor{
+      percemon::Sometimes(
+          percemon::FrameInterval::closed(0, 4),
+          percemon::Exists({id})->dot(percemon::Prob(id) > 0.5)),
+      10.0,
+      640,
+      480};
+  auto reader = io::MotReader{file.path.string(), io::MotOptions{10.0, 640, 480}};
+  auto view   = ds::FrameView{};
+  size_t num_frames = 0;
+  while (reader.next(view)) {
+    monitor.add_frame(view);
+    REQUIRE(monitor.eval() > 0);
+    num_frames++;
+    // Only the detections in the buffered frames have IDs.
+    const size_t buffered = std::min(num_frames, monitor.get_max_horizon());
+    REQUIRE(monitor.num_object_ids() == 3 * buffered);
+  }
+  REQUIRE(num_frames == 200);
+}
+
+TEST_CASE("Malformed MOT results are rejected", "[io][except]") {
+  SECTION("Missing file") {
+    REQUIRE_THROWS_AS(
+        io::MotReader("/nonexistent/percemon_test_io.csv", io::MotOptions{}),
+        std::invalid_argument);
+  }
+
+  SECTION("Malformed row") {
+    const auto file = TempFile{"percemon_test_io_bad.csv", "1,3,0,0,1,1,0.5\n2,x,0,0\n"};
+    auto reader     = io::MotReader{file.path.string(), io::MotOptions{}};
+    auto frame      = ds::TrackedFrame{};
+    // The malformed row is read while looking for the end of the first frame.
+    REQUIRE_THROWS_AS(reader.next(frame), std::invalid_argument);
+  }
+
+  SECTION("Frames out of order") {
+    const auto file =
+        TempFile{"percemon_test_io_order.csv", "2,3,0,0,1,1,0.5\n1,3,0,0,1,1,0.5\n"};
+    auto reader = io::MotReader{file.path.string(), io::MotOptions{}};
+    auto frame  = ds::TrackedFrame{};
+    REQUIRE(reader.next(frame));
+    REQUIRE(reader.next(frame));
+    REQUIRE_THROWS_AS(reader.next(frame), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Binary traces round trip", "[io][trace]") {
+  auto rng    = std::mt19937{3};
+  auto coord  = std::uniform_int_distribution<size_t>{0, 600};
+  auto count  = std::uniform_int_distribution<size_t>{0, 7};
+  auto track  = std::uniform_int_distribution<ds::TrackId>{0, 20};
+  auto prob   = std::uniform_real_distribution<double>{0.0, 1.0};
+  auto frames = std::vector<ds::TrackedFrame>{};
+  for (size_t i = 0; i < 50; i++) {
+    auto frame = ds::TrackedFrame{static_cast<double>(i) / 10.0, i + 1, 640, 480, {}};
+    for (size_t n = count(rng); n > 0; n--) {
+      const size_t x = coord(rng), y = coord(rng);
+      const auto bbox          = ds::BoundingBox{x, x + 9, y, y + 5};
+      frame.objects[track(rng)] = ds::Object{static_cast<int>(n % 3), prob(rng), bbox};
+    }
+    frames.push_back(std::move(frame));
+  }
+
+  const auto file = TempFile{"percemon_test_trace.bin", ""};
+  {
+    auto writer = io::TraceWriter{file.path.string(), io::TraceHeader{10.0, 640, 480}};
+    for (size_t i = 0; i < frames.size(); i++) {
+      // Each kind of frame is written the same.
+      if (i % 3 == 0) {
+        writer.add_frame(frames[i]);
+      } else if (i % 3 == 1) {
+        const auto& f = frames[i];
+        auto frame    = ds::Frame{f.timestamp, f.frame_num, f.size_x, f.size_y, {}};
+        for (const auto& [id, obj] : frames[i].objects) {
+          frame.objects.emplace(std::to_string(id), obj);
+        }
+        writer.add_frame(frame);
+      } else {
+        auto ids    = std::vector<ds::TrackId>{};
+        auto cls    = std::vector<int>{};
+        auto probs  = std::vector<double>{};
+        auto bboxes = std::vector<ds::BoundingBox>{};
+        for (const auto& [id, obj] : frames[i].objects) {
+          ids.push_back(id);
+          cls.push_back(obj.object_class);
+          probs.push_back(obj.probability);
+          bboxes.push_back(obj.bbox);
+        }
+        writer.add_frame(ds::FrameView{
+            frames[i].timestamp,
+            frames[i].frame_num,
+            frames[i].size_x,
+            frames[i].size_y,
+            ids.size(),
+            ids.data(),
+            cls.data(),
+            probs.data(),
+            bboxes.data()});
+      }
+    }
+    // The header is written when the writer is destroyed.
+  }
+
+  for (bool memory_map : {true, false}) {
+    INFO("Memory mapped: " << memory_map);
+    auto reader = io::TraceReader{file.path.string(), memory_map};
+    REQUIRE(reader.get_header().fps == 10.0);
+    REQUIRE(reader.get_header().frame_width == 640);
+    REQUIRE(reader.get_header().frame_height == 480);
+    REQUIRE(reader.get_header().num_frames == frames.size());
+
+    auto frame = ds::TrackedFrame{};
+    for (const auto& expected : frames) {
+      REQUIRE(reader.next(frame));
+      REQUIRE(same_frames(frame, expected));
+    }
+    REQUIRE_FALSE(reader.next(frame));
+  }
+
+  SECTION("Offline evaluation of the views") {
+    using namespace percemon;
+    auto id1       = Var_id{"1"};
+    const auto phi = Expr{Exists({id1})->dot(Prob(id1) > 0.5)};
+    auto reader    = io::TraceReader{file.path.string()};
+    const auto views = reader.views();
+    REQUIRE(views.size() == frames.size());
+    REQUIRE(
+        monitoring::evaluate_trace(phi, views, 10.0, 640, 480) ==
+        monitoring::evaluate_trace(phi, frames, 10.0, 640, 480));
+  }
+
+  SECTION("Truncated traces") {
+    fs::resize_file(file.path, fs::file_size(file.path) - 4);
+    auto reader = io::TraceReader{file.path.string()};
+    auto frame  = ds::FrameView{};
+    for (size_t i = 0; i + 1 < frames.size(); i++) { REQUIRE(reader.next(frame)); }
+    REQUIRE_THROWS_AS(reader.next(frame), std::invalid_argument);
+  }
+
+  SECTION("Records with too many objects") {
+    // Adding 2^62 objects to the first record (whose count is after the 48 bytes of the
+    // file header, and its timestamp and frame number) leaves the size that its objects
+    // would take the same, modulo 2^64.
+    auto bytes = std::vector<char>(fs::file_size(file.path));
+    {
+      auto in = std::ifstream{file.path, std::ios::binary};
+      in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    auto num_objects = std::uint64_t{};
+    std::memcpy(&num_objects, bytes.data() + 64, sizeof(num_objects));
+    num_objects += std::uint64_t{1} << 62;
+    std::memcpy(bytes.data() + 64, &num_objects, sizeof(num_objects));
+    {
+      auto out = std::ofstream{file.path, std::ios::binary | std::ios::trunc};
+      out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    for (bool memory_map : {true, false}) {
+      INFO("Memory mapped: " << memory_map);
+      auto reader = io::TraceReader{file.path.string(), memory_map};
+      auto frame  = ds::FrameView{};
+      REQUIRE_THROWS_AS(reader.next(frame), std::invalid_argument);
+    }
+  }
+
+  SECTION("Files that can't be read") {
+    const auto dir = fs::temp_directory_path().string();
+    REQUIRE_THROWS_AS(io::TraceReader(dir, false), std::invalid_argument);
+  }
+}
+
+TEST_CASE("MOT results are converted to binary traces", "[io][trace]") {
+  const auto csv = TempFile{
+      "percemon_test_convert.csv",
+      "1,3,5,10,20,30,0.9,-1,-1,-1\n"
+      "1,7,100,200,10,10,0.5,-1,-1,-1\n"
+      "3,7,101,201,10,10,0.75,-1,-1,-1\n"};
+  const auto trace   = TempFile{"percemon_test_convert.bin", ""};
+  const auto options = io::MotOptions{10.0, 640, 480};
+  REQUIRE(io::convert_mot(csv.path.string(), trace.path.string(), options) == 3);
+
+  const auto expected = io::read_mot(csv.path.string(), options);
+  auto reader         = io::TraceReader{trace.path.string()};
+  auto frame          = ds::TrackedFrame{};
+  for (const auto& e : expected) {
+    REQUIRE(reader.next(frame));
+    REQUIRE(same_frames(frame, e));
+  }
+  REQUIRE_FALSE(reader.next(frame));
+
+  SECTION("Files that aren't traces") {
+    REQUIRE_THROWS_AS(io::TraceReader{csv.path.string()}, std::invalid_argument);
+  }
+
+  SECTION("Frames with IDs that aren't integers") {
+    auto writer = io::TraceWriter{trace.path.string(), io::TraceHeader{}};
+    auto bad    = ds::Frame{0.0, 1, 640, 480, {}};
+    bad.objects.emplace("car", ds::Object{1, 0.5, ds::BoundingBox{0, 1, 0, 1}});
+    REQUIRE_THROWS_AS(writer.add_frame(bad), std::invalid_argument);
+  }
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include "percemon/iter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace iter = percemon::iter_helpers;
+
+namespace {
+
+/**
+ * All the tuples in `[0, radices[0]) x ... x [0, radices[k - 1])`, in lexicographic
+ * order.
+ */
+std::vector<std::vector<size_t>> all_tuples(const std::vector<size_t>& radices) {
+  auto ret = std::vector<std::vector<size_t>>{{}};
+  for (const size_t radix : radices) {
+    auto next = std::vector<std::vector<size_t>>{};
+    for (const auto& prefix : ret) {
+      for (size_t i = 0; i < radix; i++) {
+        next.push_back(prefix);
+        next.back().push_back(i);
+      }
+    }
+    ret = std::move(next);
+  }
+  return ret;
+}
+
+std::vector<std::vector<size_t>> enumerate(const iter::index_tuples& tuples) {
+  auto ret = std::vector<std::vector<size_t>>{};
+  for (const auto& tuple : tuples) { ret.push_back(tuple); }
+  return ret;
+}
+
+} // namespace
+
+TEST_CASE("Index tuples enumerate products and combinations", "[iter]") {
+  using iter::TupleMode;
+
+  for (size_t n = 0; n <= 5; n++) {
+    for (size_t k = 0; k <= 3; k++) {
+      INFO("n = " << n << ", k = " << k);
+      const auto product = all_tuples(std::vector<size_t>(k, n));
+      auto multisets     = std::vector<std::vector<size_t>>{};
+      auto subsets       = std::vector<std::vector<size_t>>{};
+      for (const auto& tuple : product) {
+        if (std::is_sorted(tuple.begin(), tuple.end())) { multisets.push_back(tuple); }
+        if (std::adjacent_find(tuple.begin(), tuple.end(), std::greater_equal<>{}) ==
+            tuple.end()) {
+          subsets.push_back(tuple);
+        }
+      }
+
+      for (const auto& [mode, expected] :
+           {std::make_pair(TupleMode::Product, product),
+            std::make_pair(TupleMode::Multisets, multisets),
+            std::make_pair(TupleMode::Subsets, subsets)}) {
+        INFO("Mode: " << static_cast<int>(mode));
+        const auto tuples = iter::index_tuples{n, k, mode};
+        REQUIRE(tuples.size() == expected.size());
+        REQUIRE(enumerate(tuples) == expected);
+
+        // Each tuple can be accessed by its position in the enumeration.
+        auto digits = std::vector<size_t>(k);
+        for (size_t i = 0; i < expected.size(); i++) {
+          tuples.nth(i, digits);
+          REQUIRE(digits == expected[i]);
+          REQUIRE(tuples.next(digits) == (i + 1 < expected.size()));
+          if (i + 1 < expected.size()) { REQUIRE(digits == expected[i + 1]); }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Index tuples of different radices", "[iter]") {
+  const auto radices = std::vector<size_t>{3, 1, 4};
+  const auto tuples  = iter::index_tuples{radices};
+  REQUIRE(tuples.arity() == 3);
+  REQUIRE(tuples.size() == 12);
+  REQUIRE(enumerate(tuples) == all_tuples(radices));
+
+  REQUIRE(iter::index_tuples{{2, 0, 3}}.size() == 0);
+  REQUIRE(enumerate(iter::index_tuples{{2, 0, 3}}).empty());
+
+  // Combinations need the same objects for every index.
+  REQUIRE_THROWS_AS(
+      iter::index_tuples(radices, iter::TupleMode::Multisets), std::invalid_argument);
+  REQUIRE_THROWS_AS(
+      iter::index_tuples(radices, iter::TupleMode::Subsets), std::invalid_argument);
+}
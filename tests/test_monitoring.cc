@@ -0,0 +1,1499 @@
+#include <catch2/catch.hpp>
+
+#include "percemon/fmt.hpp"
+#include "percemon/percemon.hpp"
+
+#include "allocations.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace percemon;
+namespace ds  = percemon::datastream;
+namespace mon = percemon::monitoring;
+
+namespace {
+
+constexpr double FPS = 30.0;
+
+constexpr size_t WIDTH  = 1920;
+constexpr size_t HEIGHT = 1080;
+
+/**
+ * Generate a deterministic stream of frames with objects randomly (re)appearing in
+ * the frames.
+ */
+std::vector<ds::Frame> generate_trace(size_t num_frames, unsigned int seed) {
+  constexpr size_t num_tracks = 5;
+
+  auto rng         = std::mt19937{seed};
+  auto is_present  = std::bernoulli_distribution{0.7};
+  auto label       = std::uniform_int_distribution<int>{1, 2};
+  auto probability = std::uniform_real_distribution<double>{0.0, 1.0};
+  auto x_coord     = std::uniform_int_distribution<size_t>{0, WIDTH - 200};
+  auto y_coord     = std::uniform_int_distribution<size_t>{0, HEIGHT - 200};
+  auto size        = std::uniform_int_distribution<size_t>{10, 200};
+
+  auto trace = std::vector<ds::Frame>{};
+  for (size_t i = 0; i < num_frames; i++) {
+    auto frame = ds::Frame{static_cast<double>(i) / FPS, i, WIDTH, HEIGHT, {}};
+    for (size_t track = 0; track < num_tracks; track++) {
+      if (!is_present(rng)) { continue; }
+      const size_t xmin = x_coord(rng);
+      const size_t ymin = y_coord(rng);
+      frame.objects.emplace(
+          std::to_string(track),
+          ds::Object{
+              label(rng),
+              probability(rng),
+              ds::BoundingBox{xmin, xmin + size(rng), ymin, ymin + size(rng)}});
+    }
+    trace.push_back(std::move(frame));
+  }
+  return trace;
+}
+
+std::vector<std::pair<std::string, Expr>> get_specs() {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto x   = Var_x{"1"};
+  auto f   = Var_f{"1"};
+
+  auto specs = std::vector<std::pair<std::string, Expr>>{};
+
+  specs.emplace_back(
+      "phi1", Exists({id1, id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)}));
+  specs.emplace_back(
+      "phi2",
+      Forall({id1})->dot(
+          Expr{Previous(Const{true})} >>
+          Previous(Exists({id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)}))));
+  {
+    Expr guard = And({1 <= f - C_FRAME{}, f - C_FRAME{} <= 2});
+    Expr body  = Exists({id2})->dot((id1 == id2) & Expr{Class(id1) == Class(id2)});
+    specs.emplace_back("phi3", Forall({id1})->at({x, f})->dot(Always(guard >> body)));
+  }
+  {
+    Expr margins = And(
+        {Lon(id1, CRT::TM) > 200.0,
+         Lon(id1, CRT::BM) < 880.0,
+         Lat(id1, CRT::LM) > 200.0,
+         Lat(id1, CRT::RM) < 1720.0});
+    Expr high_prob = And({Class(id1) == 1, Prob(id1) > 0.8, margins});
+    Expr reappear  = Expr{id1 == id2} & (Prob(id2) > 0.7) & (Class(id2) == 1);
+    specs.emplace_back(
+        "phi4",
+        Forall({id1})->at(Pin{f})->dot(
+            high_prob >> Always((f - C_FRAME{} < 6) >> Exists({id2})->dot(reappear))));
+  }
+  specs.emplace_back(
+      "since",
+      Exists({id1})->at(Pin{x})->dot(Since(
+          Prob(id1) > 0.4,
+          Expr{Class(id1) == 2} & Expr{x - C_TIME{} <= 0.2})));
+  specs.emplace_back(
+      "backto",
+      Forall({id1})->at(Pin{f})->dot(Sometimes(
+          Expr{f - C_FRAME{} < 4} &
+          BackTo(Lat(id1, CRT::RM) < 2.0 * Lat(id1, CRT::CT), Area(id1) > 5000.0))));
+  specs.emplace_back(
+      "bounded",
+      Forall({id1})->dot(
+          Always(FrameInterval::closed(0, 5), Prob(id1) > 0.3) |
+          Sometimes(FrameInterval::lopen(1, 4), Expr{Class(id1) == 2})));
+  specs.emplace_back(
+      "history",
+      Forall({id1})->dot(Or(
+          {Expr{Since(Prob(id1) > 0.2, Expr{Class(id1) == 1})},
+           And({Expr{BackTo(Prob(id1) > 0.4, Area(id1) > 5000.0)},
+                Expr{Always(Prob(id1) > 0.05)}}),
+           Expr{Previous(
+               Sometimes(FrameInterval::closed(0, 2), Expr{Class(id1) == 2}))}})));
+  specs.emplace_back(
+      "history_current",
+      Exists({id1})->dot(Since(Prob(id1) > 0.2, Expr{Class(id1) == 1})));
+  specs.emplace_back(
+      "spatial",
+      Exists({id1, id2})->dot(
+          Expr{SpExists(Intersect({BBox{id1}, SpPrevious(BBox{id2})}))} |
+          Expr{std::make_shared<ast::CompareSpArea>(
+              Area(Union({BBox{id1}, BBox{id2}})) > 20000.0)}));
+  specs.emplace_back(
+      "spatial_temporal",
+      Forall({id1})->dot(
+          Expr{SpExists(SpAlways(FrameInterval::closed(0, 3), BBox{id1}))} |
+          Expr{std::make_shared<ast::CompareSpArea>(
+              Area(BBox{id1}) <
+              Area(SpSometimes(FrameInterval::ropen(0, 2), Closure(BBox{id1}))))}));
+  specs.emplace_back(
+      "spatial_since",
+      Exists({id1, id2})->dot(Previous(
+          SpExists(SpSince(Interior(BBox{id1}), Complement(BBox{id2}))) &
+          Expr{SpExists(SpBackTo(BBox{id2}, UniverseSet{}))})));
+
+  return specs;
+}
+
+} // namespace
+
+TEST_CASE("Incremental evaluation matches recomputing robustness", "[monitoring]") {
+  const auto trace = generate_trace(90, 42);
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+
+    auto recompute = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Recompute}};
+    auto incremental = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Incremental}};
+    REQUIRE(recompute.get_max_horizon() == incremental.get_max_horizon());
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      INFO("Frame: " << i);
+      recompute.add_frame(trace[i]);
+      incremental.add_frame(trace[i]);
+      REQUIRE(incremental.eval() == recompute.eval());
+    }
+  }
+}
+
+TEST_CASE("Parallel quantifiers match serial evaluation", "[monitoring][parallel]") {
+  const auto trace = generate_trace(60, 7);
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+
+    auto serial = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Recompute}};
+    auto recompute = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Recompute, 4}};
+    auto incremental = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Incremental, 4}};
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      INFO("Frame: " << i);
+      serial.add_frame(trace[i]);
+      recompute.add_frame(trace[i]);
+      incremental.add_frame(trace[i]);
+      const double expected = serial.eval();
+      REQUIRE(recompute.eval() == expected);
+      REQUIRE(incremental.eval() == expected);
+    }
+  }
+}
+
+TEST_CASE("Lazy evaluation matches eager evaluation", "[monitoring][lazy]") {
+  const auto trace = generate_trace(60, 13);
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+
+    auto eager = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Recompute}};
+    auto lazy_monitors = std::vector<mon::OnlineMonitor>{};
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      for (size_t num_threads : {1, 4}) {
+        lazy_monitors.emplace_back(
+            phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{strategy, num_threads, true});
+      }
+    }
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      INFO("Frame: " << i);
+      eager.add_frame(trace[i]);
+      const double expected = eager.eval();
+      for (auto& monitor : lazy_monitors) {
+        monitor.add_frame(trace[i]);
+        REQUIRE(monitor.eval() == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE("Boolean signals match robustness signals", "[monitoring][boolean]") {
+  const auto trace = generate_trace(200, 17);
+
+  auto specs = get_specs();
+  {
+    // Horizons spanning several words of the bitsets.
+    auto id1 = Var_id{"1"};
+    auto f   = Var_f{"1"};
+    specs.emplace_back(
+        "long_always",
+        Exists({id1})->dot(
+            Always(FrameInterval::closed(0, 70), ~Expr{Prob(id1) > 0.97})));
+    specs.emplace_back(
+        "long_sometimes",
+        Forall({id1})->dot(
+            Sometimes(FrameInterval::lopen(40, 130), Expr{Class(id1) == 2}) |
+            Previous(Sometimes(FrameInterval::closed(63, 65), Prob(id1) > 0.9))));
+    specs.emplace_back(
+        "long_since",
+        Exists({id1})->at(Pin{f})->dot(Always(
+            Expr{f - C_FRAME{} <= 150} >>
+            Since(Prob(id1) > 0.2, Expr{Class(id1) == 1} & (Prob(id1) > 0.6)))));
+    specs.emplace_back(
+        "long_backto",
+        Exists({id1})->dot(Sometimes(
+            FrameInterval::ropen(70, 90), BackTo(Prob(id1) > 0.1, Prob(id1) > 0.3))));
+  }
+
+  for (auto&& [name, phi] : specs) {
+    INFO("Formula: " << name);
+
+    auto options    = mon::MonitorOptions{mon::EvalStrategy::Recompute};
+    options.signals = mon::SignalMode::Robustness;
+    auto robustness = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+
+    auto boolean_monitors = std::vector<mon::OnlineMonitor>{};
+    for (size_t num_threads : {1, 4}) {
+      for (bool lazy : {false, true}) {
+        options.num_threads = num_threads;
+        options.lazy        = lazy;
+        options.signals     = mon::SignalMode::Boolean;
+        boolean_monitors.emplace_back(phi, FPS, WIDTH, HEIGHT, options);
+      }
+    }
+    // Every predicate is qualitative, so the Boolean mode is chosen by default.
+    auto automatic = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Recompute}};
+    REQUIRE(mon::is_qualitative(automatic.get_program()));
+    REQUIRE(automatic.get_options().signals == mon::SignalMode::Boolean);
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      INFO("Frame: " << i);
+      robustness.add_frame(trace[i]);
+      const double expected = robustness.eval();
+      for (auto& monitor : boolean_monitors) {
+        monitor.add_frame(trace[i]);
+        REQUIRE(monitor.eval() == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE("Bounded temporal operators match guarded formulas", "[monitoring][temporal]") {
+  const auto trace = generate_trace(60, 3);
+
+  auto id1 = Var_id{"1"};
+  auto f   = Var_f{"1"};
+
+  // Alw_I phi === Pin f . Alw (f - C_FRAME in I => phi), and similarly for Sometimes.
+  const auto guard = [&](const FrameInterval& i) -> Expr {
+    const bool lopen = i.bound == FrameInterval::OPEN || i.bound == FrameInterval::LOPEN;
+    const bool ropen = i.bound == FrameInterval::OPEN || i.bound == FrameInterval::ROPEN;
+    Expr lower = lopen ? Expr{i.low < f - C_FRAME{}} : Expr{i.low <= f - C_FRAME{}};
+    Expr upper = ropen ? Expr{f - C_FRAME{} < i.high} : Expr{f - C_FRAME{} <= i.high};
+    return And({lower, upper});
+  };
+
+  const auto intervals = std::vector<FrameInterval>{
+      FrameInterval::closed(0, 4),
+      FrameInterval::ropen(2, 6),
+      FrameInterval::lopen(1, 5),
+      FrameInterval::open(0, 3),
+      FrameInterval::closed(3, 3)};
+
+  for (const auto& interval : intervals) {
+    INFO("Interval: [" << interval.low << ", " << interval.high << "], bound "
+                       << interval.bound);
+    Expr phi = Prob(id1) > 0.5;
+
+    const auto pairs = std::vector<std::pair<Expr, Expr>>{
+        {Forall({id1})->dot(Always(interval, phi)),
+         Forall({id1})->at(Pin{f})->dot(Always(guard(interval) >> phi))},
+        {Exists({id1})->dot(Sometimes(interval, phi)),
+         Exists({id1})->at(Pin{f})->dot(Sometimes(guard(interval) & phi))}};
+
+    for (auto&& [bounded, guarded] : pairs) {
+      auto expected = mon::OnlineMonitor{guarded, FPS, WIDTH, HEIGHT};
+      auto monitor  = mon::OnlineMonitor{bounded, FPS, WIDTH, HEIGHT};
+      auto lazy     = mon::OnlineMonitor{
+          bounded,
+          FPS,
+          WIDTH,
+          HEIGHT,
+          mon::MonitorOptions{mon::EvalStrategy::Recompute, 1, true}};
+      REQUIRE(monitor.get_max_horizon() >= interval.high);
+
+      for (size_t i = 0; i < trace.size(); i++) {
+        INFO("Frame: " << i);
+        expected.add_frame(trace[i]);
+        monitor.add_frame(trace[i]);
+        lazy.add_frame(trace[i]);
+        const double rob = expected.eval();
+        REQUIRE(monitor.eval() == rob);
+        REQUIRE(lazy.eval() == rob);
+      }
+    }
+  }
+}
+
+TEST_CASE("Quantifier guards don't change the robustness", "[monitoring][guards]") {
+  const auto trace = generate_trace(60, 23);
+
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto f   = Var_f{"1"};
+
+  // Each guarded formula, and the same formula with every guard hidden under a
+  // Sometimes over the current frame, so that no objects can be pruned.
+  const auto specs_with = [&](bool hidden) {
+    const auto guard = [&](Expr e) -> Expr {
+      return hidden ? Expr{Sometimes(FrameInterval::closed(0, 0), e)} : e;
+    };
+    auto specs = std::vector<std::pair<std::string, Expr>>{};
+
+    Expr margins = And(
+        {guard(Lon(id1, CRT::TM) > 200.0),
+         guard(Lon(id1, CRT::BM) < 880.0),
+         guard(Lat(id1, CRT::LM) > 200.0),
+         guard(Lat(id1, CRT::RM) < 1720.0)});
+    Expr high_prob = And({guard(Class(id1) == 1), guard(Prob(id1) > 0.5), margins});
+    Expr reappear  = Expr{id1 == id2} & (Prob(id2) > 0.3);
+    specs.emplace_back(
+        "margins",
+        Forall({id1})->at(Pin{f})->dot(
+            high_prob >> Always((f - C_FRAME{} < 6) >> Exists({id2})->dot(reappear))));
+    specs.emplace_back(
+        "pairs",
+        Exists({id1, id2})->dot(And(
+            {guard(Lat(id1, CRT::CT) > 600.0),
+             guard(Lon(id2, CRT::BM) <= 700.0),
+             guard(~Expr{Class(id2) == 2}),
+             guard(~Expr{Prob(id1) > 0.9}),
+             SpExists(Intersect({BBox{id1}, SpPrevious(BBox{id2})}))})));
+    specs.emplace_back(
+        "scaled",
+        Forall({id1})->dot(
+            guard(-0.5 * Lat(id1, CRT::CT) > -500.0) |
+            guard(Lon(id1, CRT::TM) >= 300.0) | (Prob(id1) > 0.2)));
+    specs.emplace_back(
+        "classes",
+        Forall({id1})->dot(
+            guard(~Expr{Class(id1) == 1}) |
+            Exists({id2})->dot(And(
+                {guard(Class(id2) == 2),
+                 guard(Lat(id2, CRT::CT) > 300.0),
+                 SpExists(Intersect({BBox{id1}, Complement(BBox{id2})}))})) |
+            Exists({id2})->dot(guard(Class(id2) == 7))));
+    specs.emplace_back(
+        "temporal",
+        Always(
+            FrameInterval::closed(0, 3),
+            Exists({id1})->dot(guard(Lat(id1, CRT::LM) > 500.0) & (Prob(id1) > 0.4))));
+    return specs;
+  };
+
+  const auto guarded = specs_with(false);
+  const auto hidden  = specs_with(true);
+  for (size_t s = 0; s < guarded.size(); s++) {
+    INFO("Formula: " << guarded[s].first);
+    auto expected = mon::OnlineMonitor{
+        hidden[s].second,
+        FPS,
+        WIDTH,
+        HEIGHT,
+        mon::MonitorOptions{mon::EvalStrategy::Recompute}};
+    auto monitors = std::vector<mon::OnlineMonitor>{};
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      for (size_t num_threads : {1, 4}) {
+        monitors.emplace_back(
+            guarded[s].second,
+            FPS,
+            WIDTH,
+            HEIGHT,
+            mon::MonitorOptions{strategy, num_threads, num_threads > 1});
+      }
+    }
+
+    for (size_t i = 0; i < trace.size(); i++) {
+      INFO("Frame: " << i);
+      expected.add_frame(trace[i]);
+      const double rob = expected.eval();
+      for (auto& monitor : monitors) {
+        monitor.add_frame(trace[i]);
+        REQUIRE(monitor.eval() == rob);
+      }
+    }
+  }
+}
+
+TEST_CASE(
+    "Symmetric quantifiers match the product of bindings",
+    "[monitoring][symmetry]") {
+  const auto trace = generate_trace(40, 31);
+
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto id3 = Var_id{"3"};
+
+  // Each formula that is symmetric in its ID variables, and the same formula with an
+  // operand that is always true (false in a Forall) on one of them, which breaks the
+  // symmetry so that all the permutations are enumerated.
+  const auto specs_with = [&](bool broken) {
+    const Expr neutral = broken ? Expr{Prob(id1) >= 0.0} : Expr{Const{true}};
+    const Expr absurd  = broken ? Expr{Prob(id1) < 0.0} : Expr{Const{false}};
+    auto specs         = std::vector<std::pair<std::string, Expr>>{};
+
+    specs.emplace_back(
+        "distinct",
+        Exists({id1, id2})->dot(And(
+            {Expr{id1 != id2},
+             Expr{Class(id1) == Class(id2)},
+             SpExists(Intersect({BBox{id1}, BBox{id2}})),
+             neutral})));
+    specs.emplace_back(
+        "repeated",
+        Exists({id1, id2})->dot(And(
+            {Prob(id1) > 0.4,
+             Prob(id2) > 0.4,
+             Sometimes(
+                 FrameInterval::closed(0, 4),
+                 Expr{id1 == id2} | Expr{Class(id1) == Class(id2)}),
+             neutral})));
+    specs.emplace_back(
+        "oriented",
+        Forall({id1, id2})->dot(Or(
+            {Expr{id1 == id2},
+             Lat(id1, CRT::LM) > Lat(id2, CRT::LM),
+             Lat(id2, CRT::LM) > Lat(id1, CRT::LM),
+             absurd})));
+    specs.emplace_back(
+        "triples",
+        Exists({id1, id2, id3})->dot(And(
+            {~Expr{id1 == id2},
+             ~Expr{id2 == id3},
+             ~Expr{id1 == id3},
+             Expr{Class(id1) == Class(id2)},
+             Expr{Class(id2) == Class(id3)},
+             Expr{Class(id3) == Class(id1)},
+             SpExists(Intersect({BBox{id1}, BBox{id2}, BBox{id3}})),
+             neutral})));
+    return specs;
+  };
+
+  const auto symmetric = specs_with(false);
+  const auto broken    = specs_with(true);
+  for (size_t s = 0; s < symmetric.size(); s++) {
+    INFO("Formula: " << symmetric[s].first);
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      for (size_t num_threads : {1, 4}) {
+        INFO(
+            "Strategy: " << static_cast<int>(strategy)
+                         << ", threads: " << num_threads);
+        auto options    = mon::MonitorOptions{strategy, num_threads};
+        options.profile = true;
+        auto monitor =
+            mon::OnlineMonitor{symmetric[s].second, FPS, WIDTH, HEIGHT, options};
+        auto expected =
+            mon::OnlineMonitor{broken[s].second, FPS, WIDTH, HEIGHT, options};
+        for (const auto& frame : trace) {
+          monitor.add_frame(frame);
+          expected.add_frame(frame);
+          REQUIRE(monitor.eval() == expected.eval());
+        }
+
+        if constexpr (mon::profiling_enabled) {
+          const auto count = [](const mon::OnlineMonitor& m) {
+            size_t ret = 0;
+            for (const auto& node : m.get_profile().nodes) { ret += node.permutations; }
+            return ret;
+          };
+          REQUIRE(count(monitor) < count(expected));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Horizons are bounded by the guards and intervals", "[monitoring][horizon]") {
+  auto id1 = Var_id{"1"};
+  auto f   = Var_f{"1"};
+  auto x   = Var_x{"1"};
+
+  const auto expected = std::map<std::string, size_t>{
+      {"phi1", 1},
+      {"phi2", 2},
+      {"phi3", 3},
+      {"phi4", 6},
+      {"since", 7},
+      {"backto", 4},
+      {"bounded", 6},
+      {"history", 4},
+      {"history_current", 1},
+      {"spatial", 2},
+      {"spatial_temporal", 4},
+      {"spatial_since", 2}};
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    REQUIRE(mon::get_horizon(phi, FPS) == expected.at(name));
+    REQUIRE(mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT}.get_max_horizon() ==
+            expected.at(name));
+  }
+
+  const auto guarded = [&](const Expr& guard) {
+    const Expr body = Prob(id1) > 0.5;
+    return Expr{Exists({id1})->at({x, f})->dot(Sometimes(guard & body))};
+  };
+  // Frames where all the guards of a conjunction hold.
+  REQUIRE(mon::get_horizon(guarded(And({f - C_FRAME{} < 3, f - C_FRAME{} < 8}))) == 3);
+  REQUIRE(mon::get_horizon(guarded(Or({f - C_FRAME{} < 3, f - C_FRAME{} < 8}))) == 8);
+  REQUIRE(mon::get_horizon(guarded(~Expr{f - C_FRAME{} > 4})) == 5);
+  REQUIRE(mon::get_horizon(guarded(Expr{x - C_TIME{} < 0.15}), FPS) == 5);
+  // A lower bound alone doesn't bound the frames.
+  REQUIRE(mon::get_horizon(guarded(Expr{f - C_FRAME{} > 4})) == 1);
+  // Previous needs the frame before the current one.
+  REQUIRE(mon::get_horizon(Exists({id1})->dot(Previous(Prob(id1) > 0.5))) == 2);
+
+  SECTION("Horizons of each instruction") {
+    const auto horizon_of = [](const Expr& phi, mon::OpCode op) {
+      const auto program  = mon::compile(phi);
+      const auto horizons = mon::get_horizons(program);
+      REQUIRE(horizons.size() == program.code.size());
+      REQUIRE(horizons[program.root()] == 1);
+      for (size_t i = 0; i < program.code.size(); i++) {
+        if (program.code[i].op == op) { return horizons[i]; }
+      }
+      FAIL("Instruction isn't in the program");
+      return std::optional<size_t>{};
+    };
+
+    const Expr prob = Prob(id1) > 0.5;
+    REQUIRE(
+        horizon_of(Exists({id1})->dot(Always(FrameInterval::closed(0, 5), prob)),
+                   mon::OpCode::CompareProb) == 6);
+    REQUIRE(
+        horizon_of(guarded(Expr{f - C_FRAME{} < 3}), mon::OpCode::CompareProb) == 3);
+    // Operands of unbounded operators are needed at every frame in the buffer.
+    REQUIRE(
+        horizon_of(Exists({id1})->dot(Since(prob, Class(id1) == 1)),
+                   mon::OpCode::CompareProb) == std::nullopt);
+  }
+
+  SECTION("TimeBound without fps") {
+    REQUIRE_THROWS_AS(
+        mon::get_horizon(guarded(Expr{x - C_TIME{} < 0.1})), std::invalid_argument);
+  }
+
+  SECTION("Horizons in time") {
+    const auto horizon_of = [](const Expr& phi) {
+      return mon::get_time_horizon(mon::compile(phi));
+    };
+    const auto timed = horizon_of(guarded(Expr{x - C_TIME{} < 0.15}));
+    REQUIRE(timed.frames == 1);
+    REQUIRE(timed.seconds == 0.15);
+    // The frame bound is exact, so it is used when both bound the frames.
+    const auto both =
+        horizon_of(guarded(And({x - C_TIME{} < 0.15, f - C_FRAME{} < 3})));
+    REQUIRE(both.frames == 3);
+    REQUIRE(both.seconds == std::nullopt);
+    // Previous needs the frame before the oldest one in the time bound.
+    const auto shifted = horizon_of(Exists({id1})->at({x, f})->dot(
+        Sometimes((x - C_TIME{} <= 0.1) & Previous(Prob(id1) > 0.5))));
+    REQUIRE(shifted.frames == 2);
+    REQUIRE(shifted.seconds == 0.1);
+    // Without time bounds, these are the frames of `get_horizon`.
+    for (auto&& [name, phi] : get_specs()) {
+      INFO("Formula: " << name);
+      if (name == "since") { continue; }
+      const auto horizon = horizon_of(phi);
+      REQUIRE(horizon.frames == expected.at(name));
+      REQUIRE(horizon.seconds == std::nullopt);
+    }
+
+    const auto program  = mon::compile(guarded(Expr{x - C_TIME{} < 0.15}));
+    const auto horizons = mon::get_time_horizons(program);
+    for (size_t i = 0; i < program.code.size(); i++) {
+      if (program.code[i].op == mon::OpCode::CompareProb) {
+        REQUIRE(horizons[i] == std::nullopt);
+      }
+    }
+  }
+}
+
+TEST_CASE("Buffering by time matches buffering enough frames", "[monitoring][time]") {
+  // Frames come in at a varying rate, from twice the nominal rate to a third of it.
+  auto trace    = generate_trace(120, 11);
+  auto rng      = std::mt19937{5};
+  auto interval = std::uniform_real_distribution<double>{0.5 / FPS, 3.0 / FPS};
+  double now    = 0.0;
+  for (auto& frame : trace) {
+    frame.timestamp = now;
+    now += interval(rng);
+  }
+
+  auto id1   = Var_id{"1"};
+  auto id2   = Var_id{"2"};
+  auto x     = Var_x{"1"};
+  auto f     = Var_f{"1"};
+  auto specs = get_specs();
+  {
+    Expr reappear = Expr{id1 == id2} & (Prob(id2) > 0.5);
+    specs.emplace_back(
+        "timed",
+        Forall({id1})->at({x, f})->dot(
+            (Prob(id1) > 0.2) >>
+            Always((x - C_TIME{} < 0.3) >> Exists({id2})->dot(reappear))));
+    specs.emplace_back(
+        "timed_previous",
+        Exists({id1})->at({x, f})->dot(Sometimes(
+            Expr{x - C_TIME{} <= 0.25} & Previous(Class(id1) == 2) &
+            Expr{f - C_FRAME{} > 1})));
+  }
+
+  SECTION("Varying frame rate") {
+    for (auto&& [name, phi] : specs) {
+      INFO("Formula: " << name);
+      // At four times the nominal rate, the horizon in frames holds every frame that
+      // the time bounds can select.
+      auto reference = mon::OnlineMonitor{phi, 4 * FPS, WIDTH, HEIGHT};
+      auto monitors  = std::vector<mon::OnlineMonitor>{};
+      for (auto strategy :
+           {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+        auto options   = mon::MonitorOptions{strategy};
+        options.buffer = mon::BufferMode::Time;
+        monitors.emplace_back(phi, FPS, WIDTH, HEIGHT, options);
+      }
+      for (size_t i = 0; i < trace.size(); i++) {
+        INFO("Frame: " << i);
+        reference.add_frame(trace[i]);
+        const double rob = reference.eval();
+        for (auto& monitor : monitors) {
+          monitor.add_frame(trace[i]);
+          REQUIRE(monitor.eval() == rob);
+        }
+      }
+    }
+  }
+
+  SECTION("Restored from a checkpoint") {
+    const auto& phi = specs[specs.size() - 2].second;
+    for (auto strategy :
+         {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      INFO("Strategy: " << static_cast<int>(strategy));
+      auto options   = mon::MonitorOptions{strategy};
+      options.buffer = mon::BufferMode::Time;
+      auto monitor   = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      for (size_t i = 0; i < 60; i++) {
+        monitor.add_frame(trace[i]);
+        monitor.eval();
+      }
+      // The buffer has grown past its initial frames by now, and the snapshot is only
+      // restored into a monitor that buffers by time.
+      auto restored = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      restored.restore(monitor.checkpoint());
+      for (size_t i = 60; i < trace.size(); i++) {
+        INFO("Frame: " << i);
+        monitor.add_frame(trace[i]);
+        restored.add_frame(trace[i]);
+        REQUIRE(restored.eval() == monitor.eval());
+      }
+      auto by_frames = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT};
+      REQUIRE_THROWS_AS(by_frames.restore(monitor.checkpoint()), std::invalid_argument);
+    }
+  }
+
+  SECTION("Timestamps that stop advancing") {
+    auto options                = mon::MonitorOptions{};
+    options.buffer              = mon::BufferMode::Time;
+    options.max_buffered_frames = 10;
+    const auto& phi = specs[specs.size() - 2].second;
+    auto monitor    = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+    // Every frame stays within the time horizon of the next, until the buffer is full.
+    for (size_t i = 0; i < options.max_buffered_frames; i++) {
+      auto frame      = trace[i];
+      frame.timestamp = 1.0;
+      monitor.add_frame(frame);
+    }
+    const double rob = monitor.eval();
+    auto frozen      = trace[10];
+    frozen.timestamp = 1.0;
+    REQUIRE_THROWS_AS(monitor.add_frame(frozen), std::invalid_argument);
+    REQUIRE(monitor.eval() == rob);
+
+    // Once the clock advances, the frames are evicted again.
+    for (size_t i = 10; i < trace.size(); i++) {
+      auto frame      = trace[i];
+      frame.timestamp = 1.0 + static_cast<double>(i) / FPS;
+      monitor.add_frame(frame);
+      monitor.eval();
+    }
+  }
+
+  SECTION("Frames out of order") {
+    auto options   = mon::MonitorOptions{};
+    options.buffer = mon::BufferMode::Time;
+    const auto& phi = specs.back().second;
+    auto monitor    = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+    monitor.add_frame(trace[1]);
+    REQUIRE_THROWS_AS(monitor.add_frame(trace[0]), std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        (mon::MonitorSet{{phi}, FPS, WIDTH, HEIGHT, options}),
+        std::invalid_argument);
+  }
+}
+
+TEST_CASE("Object IDs are freed once no frame has them", "[monitoring][datastream]") {
+  // Every few frames, the tracker gives all the objects new track IDs.
+  const auto trace = generate_trace(150, 17);
+  auto tracked     = std::vector<ds::TrackedFrame>{};
+  for (size_t i = 0; i < trace.size(); i++) {
+    const auto& frame  = trace[i];
+    auto tracked_frame = ds::TrackedFrame{
+        frame.timestamp, frame.frame_num, frame.size_x, frame.size_y, {}};
+    for (const auto& [id, obj] : frame.objects) {
+      tracked_frame.objects.emplace(std::stoull(id) + 5 * (i / 3), obj);
+    }
+    tracked.push_back(std::move(tracked_frame));
+  }
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    auto expected = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT};
+    auto monitor  = mon::OnlineMonitor{
+        phi, FPS, WIDTH, HEIGHT, mon::MonitorOptions{mon::EvalStrategy::Incremental}};
+    const size_t horizon = monitor.get_max_horizon();
+    for (size_t i = 0; i < tracked.size(); i++) {
+      INFO("Frame: " << i);
+      expected.add_frame(tracked[i]);
+      monitor.add_frame(tracked[i]);
+      // The IDs of the objects that left the buffer are reused by the new objects.
+      REQUIRE(monitor.eval() == expected.eval());
+
+      auto buffered = std::set<ds::TrackId>{};
+      for (size_t j = i + 1 - std::min(i + 1, horizon); j <= i; j++) {
+        for (const auto& [id, obj] : tracked[j].objects) { buffered.insert(id); }
+      }
+      REQUIRE(monitor.num_object_ids() == buffered.size());
+    }
+  }
+}
+
+TEST_CASE("Frames with integer track IDs are monitored", "[monitoring][datastream]") {
+  const auto trace = generate_trace(60, 11);
+
+  // The same trace, with the IDs given as integers.
+  auto tracked = std::vector<ds::TrackedFrame>{};
+  for (const auto& frame : trace) {
+    auto tracked_frame = ds::TrackedFrame{
+        frame.timestamp, frame.frame_num, frame.size_x, frame.size_y, {}};
+    for (const auto& [id, obj] : frame.objects) {
+      tracked_frame.objects.emplace(std::stoull(id), obj);
+    }
+    tracked.push_back(std::move(tracked_frame));
+  }
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      const auto options = mon::MonitorOptions{strategy};
+      auto expected      = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      auto monitor       = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      auto mixed         = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+
+      for (size_t i = 0; i < trace.size(); i++) {
+        INFO("Frame: " << i);
+        expected.add_frame(trace[i]);
+        monitor.add_frame(tracked[i]);
+        // Track IDs refer to the same objects as their decimal strings.
+        if (i % 2 == 0) {
+          mixed.add_frame(trace[i]);
+        } else {
+          mixed.add_frame(tracked[i]);
+        }
+        const double rob = expected.eval();
+        REQUIRE(monitor.eval() == rob);
+        REQUIRE(mixed.eval() == rob);
+      }
+    }
+  }
+}
+
+TEST_CASE("Frame views are monitored without allocating", "[monitoring][datastream]") {
+  const auto trace = generate_trace(60, 19);
+
+  // The same trace, with the objects of each frame in arrays.
+  struct ViewArrays {
+    std::vector<ds::TrackId> ids;
+    std::vector<int> object_class;
+    std::vector<double> probability;
+    std::vector<ds::BoundingBox> bbox;
+  };
+  auto arrays = std::vector<ViewArrays>{};
+  auto views  = std::vector<ds::FrameView>{};
+  for (const auto& frame : trace) {
+    auto& a = arrays.emplace_back();
+    // Objects in a view don't need to be sorted by their ID.
+    for (auto it = frame.objects.rbegin(); it != frame.objects.rend(); it++) {
+      a.ids.push_back(std::stoull(it->first));
+      a.object_class.push_back(it->second.object_class);
+      a.probability.push_back(it->second.probability);
+      a.bbox.push_back(it->second.bbox);
+    }
+  }
+  for (size_t i = 0; i < trace.size(); i++) {
+    const auto& a = arrays[i];
+    views.push_back(ds::FrameView{
+        trace[i].timestamp,
+        trace[i].frame_num,
+        trace[i].size_x,
+        trace[i].size_y,
+        a.ids.size(),
+        a.ids.data(),
+        a.object_class.data(),
+        a.probability.data(),
+        a.bbox.data()});
+  }
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      const auto options = mon::MonitorOptions{strategy};
+      auto expected      = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      auto monitor       = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+
+      for (size_t i = 0; i < trace.size(); i++) {
+        INFO("Frame: " << i);
+        expected.add_frame(trace[i]);
+        monitor.add_frame(views[i]);
+        REQUIRE(monitor.eval() == expected.eval());
+      }
+    }
+  }
+
+  SECTION("Adding frames doesn't allocate once the buffer is full") {
+    auto monitor = mon::OnlineMonitor{get_specs().front().second, FPS, WIDTH, HEIGHT};
+    // Intern all the track IDs, then grow all the slots to fit the largest frame.
+    for (const auto& view : views) { monitor.add_frame(view); }
+    const auto& largest = *std::max_element(
+        views.begin(), views.end(), [](const auto& a, const auto& b) {
+          return a.num_objects < b.num_objects;
+        });
+    for (size_t i = 0; i < monitor.get_max_horizon(); i++) { monitor.add_frame(largest); }
+
+    const size_t before = num_allocations();
+    for (const auto& view : views) { monitor.add_frame(view); }
+    REQUIRE(num_allocations() == before);
+
+    const auto counted = std::make_unique<int>(0);
+    REQUIRE(num_allocations() > before);
+  }
+
+  SECTION("Adding frames with new track IDs doesn't allocate") {
+    // Each frame has only objects with new IDs, which the table assigns the integers
+    // freed by the frames that left the buffer. The IDs are too long to be formatted
+    // without allocating, like those given to unassigned detections by io::MotReader.
+    auto fresh = arrays;
+    for (size_t i = 0; i < fresh.size(); i++) {
+      for (auto& id : fresh[i].ids) { id += (ds::TrackId{1} << 62) + 1000 * (i + 1); }
+      views[i].ids = fresh[i].ids.data();
+    }
+    const auto add_round = [&](mon::OnlineMonitor& monitor) {
+      for (size_t i = 0; i < fresh.size(); i++) {
+        for (auto& id : fresh[i].ids) { id += 1000 * fresh.size(); }
+        monitor.add_frame(views[i]);
+      }
+    };
+    auto monitor = mon::OnlineMonitor{get_specs().front().second, FPS, WIDTH, HEIGHT};
+    const auto& largest = *std::max_element(
+        views.begin(), views.end(), [](const auto& a, const auto& b) {
+          return a.num_objects < b.num_objects;
+        });
+    for (size_t i = 0; i < monitor.get_max_horizon(); i++) { monitor.add_frame(largest); }
+    // The table holds the most objects at the same frames of each round.
+    add_round(monitor);
+    add_round(monitor);
+
+    const size_t before = num_allocations();
+    for (size_t round = 0; round < 3; round++) { add_round(monitor); }
+    REQUIRE(num_allocations() == before);
+    REQUIRE(monitor.num_object_ids() <= 5 * monitor.get_max_horizon());
+  }
+
+  SECTION("Duplicate track IDs") {
+    auto monitor      = mon::OnlineMonitor{get_specs().front().second, FPS, WIDTH, HEIGHT};
+    const auto ids    = std::vector<ds::TrackId>{3, 5, 3};
+    const auto cls    = std::vector<int>{1, 1, 1};
+    const auto prob   = std::vector<double>{0.5, 0.5, 0.5};
+    const auto bboxes = std::vector<ds::BoundingBox>(3, ds::BoundingBox{0, 10, 0, 10});
+    const auto view   = ds::FrameView{
+        0.0, 0, WIDTH, HEIGHT, 3, ids.data(), cls.data(), prob.data(), bboxes.data()};
+    REQUIRE_THROWS_AS(monitor.add_frame(view), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Monitor sets match monitoring each formula", "[monitoring][set]") {
+  const auto trace = generate_trace(60, 5);
+  const auto specs = get_specs();
+
+  auto phis = std::vector<Expr>{};
+  for (auto&& [name, phi] : specs) { phis.push_back(phi); }
+
+  for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+    for (size_t num_threads : {1, 4}) {
+      auto options        = mon::MonitorOptions{strategy};
+      options.num_threads = num_threads;
+      auto set            = mon::MonitorSet{phis, FPS, WIDTH, HEIGHT, options};
+      auto monitors       = std::vector<mon::OnlineMonitor>{};
+      for (auto&& phi : phis) { monitors.emplace_back(phi, FPS, WIDTH, HEIGHT); }
+
+      size_t max_horizon = 0;
+      for (auto& monitor : monitors) {
+        max_horizon = std::max(max_horizon, monitor.get_max_horizon());
+      }
+      REQUIRE(set.size() == specs.size());
+      REQUIRE(set.get_max_horizon() == max_horizon);
+
+      for (size_t i = 0; i < trace.size(); i++) {
+        INFO("Frame: " << i);
+        set.add_frame(trace[i]);
+        for (auto& monitor : monitors) { monitor.add_frame(trace[i]); }
+        const auto rob = set.eval();
+        REQUIRE(rob.size() == specs.size());
+        for (size_t j = 0; j < specs.size(); j++) {
+          INFO("Formula: " << specs[j].first);
+          REQUIRE(rob[j] == monitors[j].eval());
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Multi-stream monitors match one monitor per stream", "[monitoring][streams]") {
+  constexpr size_t NUM_STREAMS = 3;
+  constexpr size_t NUM_FRAMES  = 40;
+
+  auto traces = std::vector<std::vector<ds::Frame>>{};
+  for (unsigned int seed = 0; seed < NUM_STREAMS; seed++) {
+    traces.push_back(generate_trace(NUM_FRAMES, 17 + seed));
+  }
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      for (size_t num_threads : {1, 4}) {
+        auto options        = mon::MonitorOptions{strategy};
+        options.num_threads = num_threads;
+        auto streams = mon::MultiStreamMonitor{phi, NUM_STREAMS, FPS, WIDTH, HEIGHT, options};
+        auto monitors = std::vector<mon::OnlineMonitor>{};
+        for (size_t s = 0; s < NUM_STREAMS; s++) {
+          monitors.emplace_back(phi, FPS, WIDTH, HEIGHT);
+        }
+        REQUIRE(streams.num_streams() == NUM_STREAMS);
+        REQUIRE(streams.get_max_horizon() == monitors.front().get_max_horizon());
+
+        for (size_t i = 0; i < NUM_FRAMES; i++) {
+          INFO("Frame: " << i);
+          auto frames = std::vector<ds::Frame>{};
+          for (size_t s = 0; s < NUM_STREAMS; s++) {
+            frames.push_back(traces[s][i]);
+            monitors[s].add_frame(traces[s][i]);
+          }
+          streams.add_frames(frames);
+          const auto rob = streams.eval_all();
+          REQUIRE(rob.size() == NUM_STREAMS);
+          for (size_t s = 0; s < NUM_STREAMS; s++) {
+            INFO("Stream: " << s);
+            REQUIRE(rob[s] == monitors[s].eval());
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Adding the wrong number of frames") {
+    auto streams = mon::MultiStreamMonitor{
+        get_specs().front().second, NUM_STREAMS, FPS, WIDTH, HEIGHT};
+    const auto frames = std::vector<ds::Frame>{traces[0][0], traces[1][0]};
+    REQUIRE_THROWS_AS(streams.add_frames(frames), std::invalid_argument);
+    REQUIRE_THROWS_AS(streams.add_frame(NUM_STREAMS, traces[0][0]), std::out_of_range);
+  }
+}
+
+TEST_CASE("Offline evaluation matches the online monitor", "[monitoring][offline]") {
+  const auto trace = generate_trace(90, 23);
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    auto monitor  = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT};
+    auto expected = std::vector<double>{};
+    for (const auto& frame : trace) {
+      monitor.add_frame(frame);
+      expected.push_back(monitor.eval());
+    }
+
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      for (size_t num_threads : {1, 4}) {
+        auto options        = mon::MonitorOptions{strategy};
+        options.num_threads = num_threads;
+        REQUIRE(mon::evaluate_trace(phi, trace, FPS, WIDTH, HEIGHT, options) == expected);
+      }
+    }
+  }
+
+  const auto empty = std::vector<ds::Frame>{};
+  REQUIRE(mon::evaluate_trace(get_specs().front().second, empty, FPS, WIDTH, HEIGHT).empty());
+}
+
+TEST_CASE(
+    "Restored monitors continue from the checkpoint",
+    "[monitoring][checkpoint]") {
+  const auto trace          = generate_trace(60, 31);
+  constexpr size_t RESTORED = 35;
+  const auto strategies     = {
+      mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental};
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    for (auto from : strategies) {
+      for (auto to : strategies) {
+        INFO("Strategies: " << static_cast<int>(from) << ", " << static_cast<int>(to));
+        auto monitor = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, {from}};
+        for (size_t i = 0; i < RESTORED; i++) {
+          monitor.add_frame(trace[i]);
+          monitor.eval();
+        }
+
+        // The state of the restored monitor is replaced, including its frames.
+        auto restored = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, {to}};
+        restored.add_frame(trace.back());
+        restored.restore(monitor.checkpoint());
+        REQUIRE(restored.eval() == monitor.eval());
+
+        for (size_t i = RESTORED; i < trace.size(); i++) {
+          INFO("Frame: " << i);
+          monitor.add_frame(trace[i]);
+          restored.add_frame(trace[i]);
+          REQUIRE(restored.eval() == monitor.eval());
+        }
+      }
+    }
+  }
+
+  SECTION("Malformed snapshots") {
+    const auto specs = get_specs();
+    auto monitor = mon::OnlineMonitor{specs.front().second, FPS, WIDTH, HEIGHT};
+    auto other   = mon::OnlineMonitor{specs.back().second, FPS, WIDTH, HEIGHT};
+    for (size_t i = 0; i < 10; i++) {
+      monitor.add_frame(trace[i]);
+      other.add_frame(trace[i]);
+    }
+    const auto snapshot = monitor.checkpoint();
+    const double rob    = monitor.eval();
+
+    REQUIRE_THROWS_AS(other.restore(snapshot), std::invalid_argument);
+    REQUIRE_THROWS_AS(monitor.restore({}), std::invalid_argument);
+    auto truncated = snapshot;
+    truncated.resize(snapshot.size() / 2);
+    REQUIRE_THROWS_AS(monitor.restore(truncated), std::invalid_argument);
+    auto trailing = snapshot;
+    trailing.push_back(0);
+    REQUIRE_THROWS_AS(monitor.restore(trailing), std::invalid_argument);
+    // Nothing is restored from a snapshot that is rejected.
+    REQUIRE(monitor.eval() == rob);
+  }
+}
+
+TEST_CASE("Snapshots only hold the objects in the buffer", "[monitoring][checkpoint]") {
+  // The same objects in every frame, each time with new track IDs.
+  const auto base = generate_trace(1, 23).front();
+  auto trace      = std::vector<ds::TrackedFrame>{};
+  for (size_t i = 0; i < 600; i++) {
+    auto frame = ds::TrackedFrame{static_cast<double>(i) / FPS, i, WIDTH, HEIGHT, {}};
+    for (const auto& [id, obj] : base.objects) {
+      frame.objects.emplace(std::stoull(id) + 5 * i, obj);
+    }
+    trace.push_back(std::move(frame));
+  }
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+      INFO("Strategy: " << static_cast<int>(strategy));
+      auto monitor = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, {strategy}};
+      auto sizes   = std::vector<size_t>{};
+      for (size_t i = 0; i < trace.size(); i++) {
+        monitor.add_frame(trace[i]);
+        monitor.eval();
+        if (i == 99 || i == trace.size() - 1) {
+          sizes.push_back(monitor.checkpoint().size());
+        }
+      }
+      REQUIRE(sizes[0] == sizes[1]);
+
+      auto restored = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, {strategy}};
+      restored.restore(monitor.checkpoint());
+      REQUIRE(restored.num_object_ids() == monitor.num_object_ids());
+      for (size_t i = 0; i < 20; i++) {
+        INFO("Frame: " << i);
+        auto frame = trace[i];
+        for (auto& [id, obj] : frame.objects) {
+          obj.probability = 1.0 - obj.probability;
+        }
+        frame.frame_num = trace.size() + i;
+        frame.timestamp = static_cast<double>(frame.frame_num) / FPS;
+        monitor.add_frame(frame);
+        restored.add_frame(frame);
+        REQUIRE(restored.eval() == monitor.eval());
+      }
+    }
+  }
+}
+
+TEST_CASE("Unchanged frames skip the evaluation", "[monitoring][changes]") {
+  // A static camera, where each frame is repeated a few times.
+  const auto frames = generate_trace(30, 7);
+  auto rng          = std::mt19937{3};
+  auto repeats      = std::uniform_int_distribution<size_t>{4, 10};
+  auto trace        = std::vector<ds::Frame>{};
+  for (const auto& frame : frames) {
+    for (size_t n = repeats(rng); n > 0; n--) {
+      trace.push_back(frame);
+      trace.back().frame_num = trace.size() - 1;
+      trace.back().timestamp = static_cast<double>(trace.size() - 1) / FPS;
+    }
+  }
+
+  SECTION("Repeated frames") {
+    for (auto&& [name, phi] : get_specs()) {
+      INFO("Formula: " << name);
+      for (auto strategy :
+           {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+        INFO("Strategy: " << static_cast<int>(strategy));
+        auto options           = mon::MonitorOptions{strategy};
+        auto reference         = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+        options.skip_unchanged = true;
+        auto monitor           = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+        for (size_t i = 0; i < trace.size(); i++) {
+          INFO("Frame: " << i);
+          reference.add_frame(trace[i]);
+          monitor.add_frame(trace[i]);
+          REQUIRE(monitor.eval() == reference.eval());
+        }
+
+        const auto counts = monitor.get_eval_counts();
+        REQUIRE(counts.evaluated + counts.skipped == trace.size());
+        REQUIRE(reference.get_eval_counts().skipped == 0);
+        // The time bound of `since` changes with every timestamp.
+        if (name == "since") {
+          REQUIRE(counts.skipped == 0);
+        } else {
+          REQUIRE(counts.skipped > 0);
+        }
+      }
+    }
+  }
+
+  SECTION("Attributes that aren't read") {
+    auto id1 = Var_id{"1"};
+    auto phi = Expr{Exists({id1})->dot(Class(id1) == 1)};
+    auto options           = mon::MonitorOptions{};
+    options.skip_unchanged = true;
+    auto monitor           = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+    constexpr double TOP   = std::numeric_limits<double>::infinity();
+
+    // Neither the probability nor a change between classes other than 1 is read.
+    auto frame = ds::Frame{0.0, 0, WIDTH, HEIGHT, {}};
+    frame.objects.emplace("1", ds::Object{2, 0.5, ds::BoundingBox{0, 10, 0, 10}});
+    monitor.add_frame(frame);
+    REQUIRE(monitor.eval() == -TOP);
+    for (size_t i = 1; i < 5; i++) {
+      frame.frame_num = i;
+      frame.timestamp = static_cast<double>(i) / FPS;
+      auto& obj        = frame.objects.at("1");
+      obj.object_class = (i % 2 == 0) ? 2 : 3;
+      obj.probability  = 0.1 * static_cast<double>(i);
+      monitor.add_frame(frame);
+      REQUIRE(monitor.eval() == -TOP);
+    }
+    REQUIRE(monitor.get_eval_counts().evaluated == 1);
+    REQUIRE(monitor.get_eval_counts().skipped == 4);
+
+    frame.objects.at("1").object_class = 1;
+    monitor.add_frame(frame);
+    REQUIRE(monitor.eval() == TOP);
+    REQUIRE(monitor.get_eval_counts().evaluated == 2);
+  }
+}
+
+TEST_CASE("Profiles count the evaluation of each instruction", "[monitoring][profile]") {
+  const auto trace = generate_trace(40, 29);
+  auto id1         = Var_id{"1"};
+  Expr leaf = Class(id1) == 1;
+  Expr phi  = Exists({id1})->dot(leaf & SpExists(BBox{id1}));
+
+  // Every object in the current frame that passes the guard is enumerated once per eval.
+  size_t num_permutations = 0;
+  for (const auto& frame : trace) {
+    for (const auto& [_, obj] : frame.objects) {
+      if (obj.object_class == 1) { num_permutations++; }
+    }
+  }
+
+  for (auto strategy : {mon::EvalStrategy::Recompute, mon::EvalStrategy::Incremental}) {
+    for (size_t num_threads : {1, 4}) {
+      INFO("Strategy: " << static_cast<int>(strategy) << ", threads: " << num_threads);
+      auto options        = mon::MonitorOptions{strategy};
+      options.num_threads = num_threads;
+      auto reference      = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      options.profile     = true;
+      auto monitor        = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT, options};
+      for (const auto& frame : trace) {
+        reference.add_frame(frame);
+        monitor.add_frame(frame);
+        REQUIRE(monitor.eval() == reference.eval());
+      }
+
+      const auto& program = monitor.get_program();
+      const auto profile  = monitor.get_profile();
+      const auto report   = mon::format_profile(program, profile);
+      REQUIRE(std::holds_alternative<Expr>(program.sources.at(program.root())));
+      if constexpr (!mon::profiling_enabled) {
+        REQUIRE(profile.nodes.empty());
+        continue;
+      }
+
+      REQUIRE(profile.nodes.size() == program.code.size());
+      const auto& root = profile.nodes[program.root()];
+      REQUIRE(root.calls == trace.size());
+      REQUIRE(root.permutations == num_permutations);
+      REQUIRE(root.total_time >= root.self_time);
+      for (size_t idx = 0; idx < program.code.size(); idx++) {
+        if (program.code[idx].op != mon::OpCode::Exists) {
+          REQUIRE(profile.nodes[idx].permutations == 0);
+        }
+        REQUIRE(profile.nodes[idx].total_time <= root.total_time);
+      }
+      // The report is annotated with the subformulas.
+      REQUIRE(report.find(fmt::format("{}", leaf)) != std::string::npos);
+
+      monitor.reset_profile();
+      REQUIRE(monitor.get_profile().nodes[program.root()].calls == 0);
+    }
+  }
+}
+
+TEST_CASE("Asynchronous monitor matches the synchronous one", "[monitoring][async]") {
+  const auto trace = generate_trace(80, 37);
+  const auto phi   = get_specs().front().second;
+
+  auto expected = std::vector<double>{};
+  auto monitor  = mon::OnlineMonitor{phi, FPS, WIDTH, HEIGHT};
+  for (const auto& frame : trace) {
+    monitor.add_frame(frame);
+    expected.push_back(monitor.eval());
+  }
+
+  SECTION("Blocking on a full queue") {
+    for (size_t capacity : {1, 4, 64}) {
+      INFO("Capacity: " << capacity);
+      auto results = std::vector<mon::AsyncResult>{};
+      auto async   = mon::AsyncOnlineMonitor{
+          phi,
+          FPS,
+          WIDTH,
+          HEIGHT,
+          mon::MonitorOptions{},
+          mon::AsyncOptions{capacity, mon::Backpressure::Block},
+          [&](const mon::AsyncResult& result) { results.push_back(result); }};
+      for (const auto& frame : trace) { REQUIRE(async.add_frame(frame)); }
+      async.flush();
+
+      REQUIRE(results.size() == trace.size());
+      for (size_t i = 0; i < trace.size(); i++) {
+        REQUIRE(results[i].frame_num == trace[i].frame_num);
+        REQUIRE(results[i].timestamp == trace[i].timestamp);
+        REQUIRE(results[i].robustness == expected[i]);
+      }
+      REQUIRE(async.num_dropped() == 0);
+      REQUIRE(async.take_results().empty());
+    }
+  }
+
+  SECTION("Coalescing the queued frames") {
+    auto async = mon::AsyncOnlineMonitor{
+        phi,
+        FPS,
+        WIDTH,
+        HEIGHT,
+        mon::MonitorOptions{},
+        mon::AsyncOptions{8, mon::Backpressure::Coalesce}};
+    for (const auto& frame : trace) { REQUIRE(async.add_frame(frame)); }
+    async.flush();
+
+    // Every frame is added, but only some of them are evaluated, including the last.
+    const auto results = async.take_results();
+    REQUIRE(!results.empty());
+    REQUIRE(results.back().frame_num == trace.back().frame_num);
+    for (const auto& result : results) {
+      REQUIRE(result.robustness == expected.at(result.frame_num));
+    }
+  }
+
+  SECTION("Dropping frames") {
+    auto async = mon::AsyncOnlineMonitor{
+        phi,
+        FPS,
+        WIDTH,
+        HEIGHT,
+        mon::MonitorOptions{},
+        mon::AsyncOptions{2, mon::Backpressure::Drop}};
+    size_t num_added = 0;
+    for (auto frame : trace) {
+      if (async.add_frame(std::move(frame))) { num_added++; }
+    }
+    async.flush();
+    REQUIRE(num_added + async.num_dropped() == trace.size());
+    REQUIRE(async.take_results().size() == num_added);
+  }
+
+  SECTION("Destroying the monitor evaluates the queued frames") {
+    auto results = std::vector<mon::AsyncResult>{};
+    {
+      auto async = mon::AsyncOnlineMonitor{
+          phi,
+          FPS,
+          WIDTH,
+          HEIGHT,
+          mon::MonitorOptions{},
+          mon::AsyncOptions{},
+          [&](const mon::AsyncResult& result) { results.push_back(result); }};
+      for (const auto& frame : trace) { async.add_frame(frame); }
+    }
+    REQUIRE(results.size() == trace.size());
+    REQUIRE(results.back().robustness == expected.back());
+  }
+
+  SECTION("Errors in the worker are rethrown") {
+    auto async = mon::AsyncOnlineMonitor{
+        phi,
+        FPS,
+        WIDTH,
+        HEIGHT,
+        mon::MonitorOptions{},
+        mon::AsyncOptions{},
+        [](const mon::AsyncResult&) { throw std::runtime_error("callback failed"); }};
+    async.add_frame(trace.front());
+    REQUIRE_THROWS_AS(async.flush(), std::runtime_error);
+    REQUIRE_THROWS_AS(async.add_frame(trace.back()), std::runtime_error);
+  }
+}
+
+TEST_CASE("Incremental monitor rejects malformed formulas", "[monitoring][except]") {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto f   = Var_f{"1"};
+
+  const auto options = mon::MonitorOptions{mon::EvalStrategy::Incremental};
+
+  SECTION("Quantifying the same ID variable twice") {
+    Expr phi = Exists({id1})->dot(Exists({id1})->dot(Prob(id1) > 0.5));
+    REQUIRE_THROWS_AS(
+        mon::OnlineMonitor(phi, FPS, WIDTH, HEIGHT, options), std::invalid_argument);
+  }
+
+  SECTION("Using an unbound ID variable") {
+    Expr phi = Exists({id1})->dot(Prob(id2) > 0.5);
+    REQUIRE_THROWS_AS(
+        mon::OnlineMonitor(phi, FPS, WIDTH, HEIGHT, options), std::invalid_argument);
+  }
+
+  SECTION("Using a frame variable that isn't pinned") {
+    Expr phi = Exists({id1})->dot(Always(Expr{f - C_FRAME{} < 3} >> (Prob(id1) > 0.5)));
+    REQUIRE_THROWS_AS(
+        mon::OnlineMonitor(phi, FPS, WIDTH, HEIGHT, options), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Formulas are compiled to post-ordered programs", "[monitoring][compile]") {
+  auto id1 = Var_id{"1"};
+  auto id2 = Var_id{"2"};
+  auto f   = Var_f{"1"};
+
+  for (auto&& [name, phi] : get_specs()) {
+    INFO("Formula: " << name);
+    const auto program = mon::compile(phi);
+
+    REQUIRE(!program.code.empty());
+    for (size_t i = 0; i < program.code.size(); i++) {
+      const auto& ins = program.code[i];
+      for (const size_t arg : program.args(ins)) { REQUIRE(arg < i); }
+      for (const size_t slot : program.ids(ins)) {
+        REQUIRE(slot < program.id_slots.size());
+      }
+    }
+    // The root is a closed formula.
+    REQUIRE(program.free_ids(program.code[program.root()]).empty());
+  }
+
+  SECTION("Variables are resolved to slots") {
+    Expr phi = Forall({id1})->at(Pin{f})->dot(Exists({id2})->dot(
+        Expr{id1 == id2} & (Prob(id2) > Prob(id1)) & Expr{f - C_FRAME{} < 3}));
+    const auto program = mon::compile(phi);
+
+    REQUIRE(program.id_slots == std::vector<std::string>{"1", "2"});
+    REQUIRE(program.frame_slots == std::vector<std::string>{"1"});
+    REQUIRE(program.time_slots.empty());
+    REQUIRE(program.code[program.root()].op == mon::OpCode::Forall);
+
+    const auto cmp = std::find_if(
+        program.code.begin(), program.code.end(), [](const mon::Instruction& ins) {
+          return ins.op == mon::OpCode::CompareProb;
+        });
+    REQUIRE(cmp != program.code.end());
+    REQUIRE(cmp->relation == ast::ComparisonOp::GT);
+    REQUIRE(cmp->frame_local);
+    const auto ids = program.ids(*cmp);
+    REQUIRE(std::vector<size_t>(ids.begin(), ids.end()) == std::vector<size_t>{1, 0});
+  }
+
+  SECTION("Operands of And are ordered by cost") {
+    Expr phi = Forall({id1})->at(Pin{f})->dot(
+        Exists({id2})->dot(Expr{id1 == id2} & (Prob(id2) > 0.5)) &
+        Expr{f - C_FRAME{} < 3});
+    const auto program = mon::compile(phi);
+
+    // The outermost conjunction is the last one in the program.
+    const auto conj = std::find_if(
+        program.code.rbegin(), program.code.rend(), [](const mon::Instruction& ins) {
+          return ins.op == mon::OpCode::And;
+        });
+    REQUIRE(conj != program.code.rend());
+    const auto args = program.args(*conj);
+    REQUIRE(program.code[args[0]].op == mon::OpCode::FrameBound);
+    for (size_t i = 1; i < args.size(); i++) {
+      REQUIRE(program.code[args[i - 1]].cost <= program.code[args[i]].cost);
+    }
+  }
+
+  SECTION("Equal subformulas share instructions") {
+    auto idA = Var_id{"A"};
+    Expr phi = Forall({id1})->dot(Expr{Class(id1) == 2} & (Prob(id1) > 0.5));
+    Expr psi = Exists({idA})->dot((Prob(idA) > 0.5) | Expr{Class(idA) == 2});
+    Expr chi = Forall({id1})->dot((Prob(id1) > 0.5) & Expr{Class(id1) == 2});
+
+    const auto single  = mon::compile(phi);
+    const auto program = mon::compile(std::vector<Expr>{phi, psi, chi, phi});
+
+    REQUIRE(program.roots.size() == 4);
+    REQUIRE(program.root() == program.roots[0]);
+    REQUIRE(program.roots[3] == program.roots[0]);
+    // The conjunction is the same regardless of the order of its operands.
+    REQUIRE(program.roots[2] == program.roots[0]);
+    // Only the Or and the Exists are new in psi.
+    REQUIRE(program.code.size() == single.code.size() + 2);
+    REQUIRE(program.id_slots == std::vector<std::string>{"1"});
+    REQUIRE(program.code[program.roots[1]].op == mon::OpCode::Exists);
+  }
+}
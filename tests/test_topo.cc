@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+
+#include "percemon/topo.hpp"
+
+#include <algorithm>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+namespace topo = percemon::topo;
+
+namespace {
+
+std::vector<double> xmins(const topo::TopoUnion& region) {
+  auto ret = std::vector<double>{};
+  for (const auto& bbox : region) { ret.push_back(bbox.xmin); }
+  return ret;
+}
+
+/**
+ * Number of unit cells in [0, size)^2 covered by the boxes, which have integer corners.
+ */
+double count_cells(const std::vector<topo::BoundingBox>& boxes, int size) {
+  double ret = 0;
+  for (int x = 0; x < size; x++) {
+    for (int y = 0; y < size; y++) {
+      const bool covered = std::any_of(boxes.begin(), boxes.end(), [&](const auto& b) {
+        return b.xmin <= x && x + 1 <= b.xmax && b.ymin <= y && y + 1 <= b.ymax;
+      });
+      ret += covered ? 1 : 0;
+    }
+  }
+  return ret;
+}
+
+} // namespace
+
+TEST_CASE("Unions of boxes are sorted sets", "[topo]") {
+  const auto a = topo::BoundingBox{0, 2, 0, 2};
+  const auto b = topo::BoundingBox{1, 3, 1, 3};
+  const auto c = topo::BoundingBox{4, 5, 0, 1};
+
+  SECTION("Construction from a range") {
+    const auto boxes = std::vector<topo::BoundingBox>{c, a, b, a};
+    const auto u     = topo::TopoUnion{boxes.begin(), boxes.end()};
+    REQUIRE(u.size() == 3);
+    REQUIRE(xmins(u) == std::vector<double>{0, 1, 4});
+  }
+
+  SECTION("Insertion") {
+    auto u = topo::TopoUnion{};
+    u.insert(c);
+    u.insert(a);
+    u.insert(c);
+    REQUIRE(xmins(u) == std::vector<double>{0, 4});
+  }
+
+  SECTION("Merging") {
+    auto u = topo::TopoUnion{};
+    u.insert(a);
+    u.insert(c);
+    auto v = topo::TopoUnion{};
+    v.insert(b);
+    v.insert(c);
+    u.merge(v);
+    REQUIRE(xmins(u) == std::vector<double>{0, 1, 4});
+  }
+}
+
+TEST_CASE("Regions are allocated from the arena in an ArenaScope", "[topo][arena]") {
+  REQUIRE(topo::region_resource() == std::pmr::new_delete_resource());
+
+  auto kept = topo::Region{topo::Empty{}};
+  {
+    const topo::ArenaScope arena_scope{};
+    REQUIRE(topo::region_resource() != std::pmr::new_delete_resource());
+
+    const auto a   = topo::Region{topo::BoundingBox{0, 1, 0, 1}};
+    const auto b   = topo::Region{topo::BoundingBox{2, 3, 0, 1}};
+    const auto tmp = topo::spatial_union(a, b);
+    {
+      const topo::HeapScope heap_scope{};
+      REQUIRE(topo::region_resource() == std::pmr::new_delete_resource());
+      kept = topo::spatial_union(tmp, topo::BoundingBox{4, 5, 0, 1});
+    }
+    REQUIRE(topo::region_resource() != std::pmr::new_delete_resource());
+  }
+  REQUIRE(topo::region_resource() == std::pmr::new_delete_resource());
+
+  // The region created in the HeapScope outlives the arena.
+  REQUIRE(std::get<topo::TopoUnion>(kept).size() == 3);
+  REQUIRE(topo::area(kept) == Approx(3.0));
+}
+
+TEST_CASE("Area of unions counts overlaps once", "[topo][area]") {
+  SECTION("Boxes with the same left edge") {
+    const auto boxes = std::vector<topo::BoundingBox>{{0, 2, 0, 1}, {0, 1, 2, 4}};
+    const auto u     = topo::TopoUnion{boxes.begin(), boxes.end()};
+    REQUIRE(topo::union_area(u) == Approx(4.0));
+  }
+
+  SECTION("Random boxes") {
+    constexpr int SIZE = 24;
+    auto rng           = std::mt19937{7};
+    auto coord         = std::uniform_int_distribution<int>{0, SIZE};
+    for (int trial = 0; trial < 50; trial++) {
+      auto boxes = std::vector<topo::BoundingBox>{};
+      for (int i = 0; i < 1 + trial % 12; i++) {
+        const int x0 = coord(rng), x1 = coord(rng), y0 = coord(rng), y1 = coord(rng);
+        boxes.emplace_back(
+            std::min(x0, x1), std::max(x0, x1), std::min(y0, y1), std::max(y0, y1));
+      }
+      const auto u          = topo::TopoUnion{boxes.begin(), boxes.end()};
+      const double expected = count_cells(boxes, SIZE);
+      REQUIRE(topo::union_area(u) == Approx(expected));
+
+      // The decomposition covers the same cells with disjoint boxes.
+      const auto parts       = topo::decompose(u);
+      const auto parts_boxes = std::vector<topo::BoundingBox>{parts.begin(), parts.end()};
+      REQUIRE(count_cells(parts_boxes, SIZE) == Approx(expected));
+      double sum = 0;
+      for (const auto& b : parts) { sum += (b.xmax - b.xmin) * (b.ymax - b.ymin); }
+      REQUIRE(sum == Approx(expected));
+    }
+  }
+}
+
+TEST_CASE("Batch kernels match the box operations", "[topo][batch]") {
+  auto rng   = std::mt19937{11};
+  auto coord = std::uniform_int_distribution<int>{0, 16};
+  auto flag  = std::bernoulli_distribution{0.5};
+  const auto random_box = [&]() {
+    const int x0 = coord(rng), x1 = coord(rng), y0 = coord(rng), y1 = coord(rng);
+    return topo::BoundingBox{
+        static_cast<double>(std::min(x0, x1)),
+        static_cast<double>(std::max(x0, x1)),
+        static_cast<double>(std::min(y0, y1)),
+        static_cast<double>(std::max(y0, y1)),
+        flag(rng),
+        flag(rng),
+        flag(rng),
+        flag(rng)};
+  };
+  const auto same_boxes = [](const topo::Region& lhs, const topo::Region& rhs) {
+    const auto boxes_of = [](const topo::Region& reg) {
+      auto ret = std::vector<topo::BoundingBox>{};
+      if (const auto bbox = std::get_if<topo::BoundingBox>(&reg)) { ret.push_back(*bbox); }
+      if (const auto u = std::get_if<topo::TopoUnion>(&reg)) {
+        ret.assign(u->begin(), u->end());
+      }
+      return ret;
+    };
+    const auto a = boxes_of(lhs), b = boxes_of(rhs);
+    return lhs.index() == rhs.index() &&
+           std::equal(a.begin(), a.end(), b.begin(), b.end(), [](auto& p, auto& q) {
+             return p.xmin == q.xmin && p.xmax == q.xmax && p.ymin == q.ymin &&
+                    p.ymax == q.ymax && p.lopen == q.lopen && p.ropen == q.ropen &&
+                    p.topen == q.topen && p.bopen == q.bopen;
+           });
+  };
+
+  for (size_t n : {1, 7, 9, 14, 33}) {
+    auto boxes = std::vector<topo::BoundingBox>{};
+    for (size_t i = 0; i < n; i++) { boxes.push_back(random_box()); }
+    const auto u = topo::TopoUnion{boxes.begin(), boxes.end()};
+
+    const auto arrays = topo::BoxArrays{u};
+    auto areas        = std::vector<double>(arrays.size());
+    topo::batch_areas(arrays, areas.data());
+    size_t i = 0;
+    for (const auto& bbox : u) { REQUIRE(areas[i++] == Approx(topo::area(bbox))); }
+
+    for (int trial = 0; trial < 20; trial++) {
+      const auto bbox = random_box();
+      // Intersect the boxes one at a time, which doesn't use the batch kernels.
+      auto pairs = std::vector<topo::BoundingBox>{};
+      for (const auto& other : u) {
+        const auto reg = topo::spatial_intersect(bbox, other);
+        if (const auto b = std::get_if<topo::BoundingBox>(&reg)) { pairs.push_back(*b); }
+      }
+      auto expected = topo::Region{topo::Empty{}};
+      if (pairs.size() == 1) { expected = pairs.back(); }
+      if (pairs.size() > 1) { expected = topo::TopoUnion{pairs.begin(), pairs.end()}; }
+
+      const auto actual = topo::spatial_intersect(topo::Region{u}, topo::Region{bbox});
+      REQUIRE(same_boxes(actual, expected));
+    }
+  }
+}